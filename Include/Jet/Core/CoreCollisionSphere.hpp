@@ -52,6 +52,7 @@ public:
     //! Sets the radius of the sphere
     inline void radius(float radius) {
         radius_ = radius;
+        parent_->geometry_changed();
     }
     
 private:
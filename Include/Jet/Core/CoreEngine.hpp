@@ -22,6 +22,7 @@
 #pragma once
 
 #include <Jet/Core/CoreTypes.hpp>
+#include <Jet/Core/CoreMeshSplitter.hpp>
 #include <Jet/Types/Iterator.hpp>
 #include <Jet/Resources/Texture.hpp>
 #include <Jet/Resources/Cubemap.hpp>
@@ -102,6 +103,13 @@ public:
 	inline float frame_accumulator() const {
 		return frame_accumulator_;
 	}
+
+	//! Returns how far the current frame is between the last tick and the
+	//! next tick, from 0 to 1.  Used to interpolate transforms for 
+	//! rendering.
+	inline float tick_alpha() const {
+		return frame_accumulator_ / timestep();
+	}
 	
 	//! The delta since the last render
 	inline float frame_delta() const {
@@ -158,14 +166,12 @@ public:
     //! @param name the name of the material
     Material* material(const std::string& name="");
 
-    //! Returns the mesh with the given name.
+    //! Returns the mesh with the given name.  If the name is empty, a new
+    //! anonymous mesh is created.  Anonymous meshes (e.g., the pieces of a
+    //! fractured mesh) are freed once nothing else holds a reference to 
+    //! them.
     //! @param name the name of the mesh.
     Mesh* mesh(const std::string& name="");
-	
-	//! Returns a mesh that is a copy of the given mesh.  The new mesh will
-	//! share a read-only reference to the old mesh's vertex buffer, but will
-	//! have its own index buffer.
-    Mesh* mesh(Mesh* mesh);
 
     //! Returns the given texture descriptor.  This function will attempt to
     //! load the underlying resource if load is set to true.
@@ -203,6 +209,20 @@ public:
 	//! Returns the input system
 	Input* input() const;
 	
+	//! Returns the worker thread pool.  The pool is created the first time
+	//! it is used, with the number of threads given by the worker_threads 
+	//! option.
+	CoreWorkerPool* worker_pool();
+
+	//! Returns the splitter used to fracture meshes.  It is shared so that
+	//! its scratch memory is reused by every fracture.
+	inline CoreMeshSplitter* mesh_splitter() {
+		return &mesh_splitter_;
+	}
+
+	//! Returns the cache of precomputed shatter patterns.
+	CoreShatterCache* shatter_cache();
+	
 	//! Returns the network interface.
 	inline void network(Network* network) {
 		network_ = network;
@@ -244,6 +264,12 @@ public:
 		tick_id_++;
 	}
 
+	//! Returns a new node serial number.  Serial numbers are handed out in
+	//! order, so they don't depend on where nodes are allocated.
+	inline uint32_t node_serial_inc() {
+		return node_serial_++;
+	}
+
     //! Adds a listener, which listens for engine events.
     //! @param listener the engine listener.
     inline void listener(EngineListener* listener) {
@@ -355,7 +381,9 @@ private:
     std::string resolve_path(const std::string& path);
     void update_frame_delta();
 	void update_fps();
+	void tick();
 	void init_systems();
+	void free_anonymous_meshes();
 	
 	// Map containing engine options
 	std::map<std::string, boost::any> option_;
@@ -366,6 +394,7 @@ private:
 	std::map<std::string, SoundPtr> sound_;
     std::map<std::string, MaterialPtr> material_;
     std::map<std::string, MeshPtr> mesh_;
+	std::vector<std::string> anonymous_mesh_;
     std::map<std::string, TexturePtr> texture_;
 	std::map<std::string, CubemapPtr> cubemap_;
 	std::map<std::string, ShaderPtr> shader_;
@@ -389,6 +418,9 @@ private:
 	PhysicsPtr physics_;
 	AudioPtr audio_;
 	NetworkPtr network_;
+	CoreWorkerPoolPtr worker_pool_;
+	CoreMeshSplitter mesh_splitter_;
+	CoreShatterCachePtr shatter_cache_;
 
     // Record-keeping values for timing statistics
     bool running_;
@@ -400,9 +432,10 @@ private:
 	float fps_elapsed_time_;
 	size_t auto_name_counter_;
     
-    uint32_t prev_time_;
+    double prev_time_;
     uint32_t frame_id_;
 	uint32_t tick_id_;
+	uint32_t node_serial_;
 };
 
 }
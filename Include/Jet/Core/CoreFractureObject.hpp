@@ -24,6 +24,7 @@
 #include <Jet/Core/CoreTypes.hpp>
 #include <Jet/Core/CoreNode.hpp>
 #include <Jet/Core/CoreMeshObject.hpp>
+#include <Jet/Core/CoreShatterCache.hpp>
 #include <Jet/Scene/FractureObject.hpp>
 #include <vector>
 
@@ -40,7 +41,8 @@ public:
         engine_(engine),
         parent_(parent),
         seal_fractures_(false),
-        fracture_count_(0) {
+        fracture_count_(0),
+        shatter_count_(0) {
             
             
         mesh_object_ = static_cast<CoreMeshObject*>(parent_->mesh_object());
@@ -77,6 +79,11 @@ public:
         return fracture_count_;
     }
 
+    //! Returns the number of pieces that this object shatters into.
+    inline size_t shatter_count() const {
+        return shatter_count_;
+    }
+
     
     //! Sets the material used to render this object.
     //! @param material a pointer to the material
@@ -126,6 +133,12 @@ public:
     inline void fracture_count(size_t count) {
         fracture_count_ = count;
     }
+
+    //! Sets the number of pieces that this object shatters into, and
+    //! creates the nodes for the pieces.  The nodes aren't added to the
+    //! scene graph until the object shatters.
+    //! @param count the number of pieces
+    void shatter_count(size_t count);
     
     //! Adds a fracture to this fracture object.  The object will effectively
     //! be split in half along the given plane.  The smaller half of the
@@ -135,19 +148,28 @@ public:
     //! fracture object and remain with the original parent node.
     //! @param plane the plane to split the object along
     void fracture(const Plane& plane);
+
+    //! Replaces this object with its precomputed pieces.
+    void shatter();
     
 private:
     //! Creates a clone of this fracture object
     CoreFractureObject* create_clone();
     
-    //! Creates a new fracture on the given plane
-    void fracture_indices(const Plane& plane);
+    //! Splits the mesh on the given plane, and spins off the smaller half
+    void fracture_mesh(const Plane& plane);
+
+    //! Creates the nodes for the shatter pieces
+    void init_pieces();
     
     CoreEngine* engine_;
     CoreNode* parent_;
     CoreMeshObjectPtr mesh_object_;
     bool seal_fractures_;
     size_t fracture_count_;
+    size_t shatter_count_;
+    std::vector<CoreNodePtr> piece_;
+    CoreShatterPatternPtr pattern_;
 };
 
 }
\ No newline at end of file
@@ -81,7 +81,10 @@ public:
     //! Sets the mesh used to render this object.
     //! @param mesh the mesh
 	inline void mesh(Mesh* mesh) {
-		mesh_ = mesh;
+		if (mesh_ != mesh) {
+			mesh_ = mesh;
+			parent_->geometry_changed();
+		}
 	}
     
     //! Sets whether or not this object casts shadows.
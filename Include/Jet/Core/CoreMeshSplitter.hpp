@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Types.hpp>
+#include <Jet/Types/Vertex.hpp>
+#include <Jet/Types/Plane.hpp>
+#include <Jet/Types/Box.hpp>
+#include <vector>
+#include <string>
+
+namespace Jet {
+
+//! Name of the mesh group that holds the faces that seal a fracture.
+#define JET_FRACTURE_CAP_GROUP "cap"
+
+//! Distance, as a fraction of the size of the mesh, within which points on
+//! the cut outline are welded together.  Vertices this close to the plane
+//! are treated as lying on it.
+#define JET_SPLIT_WELD_TOLERANCE 1e-5f
+
+//! Geometry for one piece of a split mesh.  Unlike a mesh that shares its
+//! parent's vertex buffer, a piece only holds the vertices that its own 
+//! triangles use.
+//! @class CoreMeshPiece
+//! @brief Geometry for one piece of a split mesh.
+class CoreMeshPiece {
+public:
+    //! Removes all triangles from the piece, but keeps the memory.
+    void clear();
+
+    //! Returns the number of triangle indices in all groups.
+    size_t index_count() const;
+
+    //! Swaps the contents of this piece with another piece.
+    void swap(CoreMeshPiece& other);
+
+    //! Copies the vertices and triangles of a mesh into this piece.
+    //! @param mesh the mesh to copy
+    void read(const Mesh* mesh);
+
+    //! Copies this piece into a mesh.  The mesh must own its vertex data.
+    //! @param mesh the mesh to write to
+    void write(Mesh* mesh) const;
+
+    std::vector<Vertex> vertex;
+    std::vector<std::vector<uint32_t> > index;
+    std::vector<std::string> group;
+    Box bounds;
+};
+
+//! Splits meshes along a plane.  Triangles that cross the plane are clipped,
+//! and the new vertices on the plane are interpolated from the edge that
+//! they split, so that both pieces have clean edges.  Vertices that are
+//! already on the plane are shared by both pieces instead of being cut.
+//! Optionally, the cross-section is triangulated to seal the pieces; holes
+//! in the cross-section are left open.  The splitter keeps its scratch 
+//! buffers between calls, so reuse it to avoid allocations.
+//! @class CoreMeshSplitter
+//! @brief Splits meshes along a plane.
+class CoreMeshSplitter {
+public:
+    //! Splits a piece along a plane.  Returns false if all the triangles
+    //! are on one side of the plane; in that case, the input is copied to 
+    //! the piece on that side, and the other piece is left empty.
+    //! @param in the piece to split
+    //! @param plane the plane to split along
+    //! @param seal true if the cross-section should be capped
+    //! @param below receives the piece behind the plane
+    //! @param above receives the piece in front of the plane (on the side
+    //! of the plane normal)
+    bool split(const CoreMeshPiece& in, const Plane& plane, bool seal, CoreMeshPiece& below, CoreMeshPiece& above);
+
+private:
+    struct Edge {
+        uint64_t key;
+        uint32_t cut;
+    };
+
+    uint32_t vertex(const CoreMeshPiece& in, uint32_t i, std::vector<uint32_t>& remap, CoreMeshPiece& out);
+    uint32_t cut(const CoreMeshPiece& in, uint32_t i0, uint32_t i1, CoreMeshPiece& below, CoreMeshPiece& above);
+    uint32_t node(const Vector& position);
+    int side(const CoreMeshPiece& in, uint32_t i0, uint32_t i1, uint32_t i2) const;
+    void link(uint32_t from, uint32_t to);
+    void clip(const CoreMeshPiece& in, size_t group, uint32_t a, uint32_t b, uint32_t c, bool lone_above, CoreMeshPiece& below, CoreMeshPiece& above);
+    void clip_at_vertex(const CoreMeshPiece& in, size_t group, uint32_t a, uint32_t b, uint32_t c, CoreMeshPiece& below, CoreMeshPiece& above);
+    void seal(CoreMeshPiece& below, CoreMeshPiece& above);
+    bool contains(size_t outline, float x, float y) const;
+    void bridge(size_t hole);
+    void triangulate();
+
+    Vector normal_;
+    float offset_;
+    float weld_;
+    std::vector<float> distance_;
+    std::vector<int8_t> side_;
+    std::vector<uint32_t> plane_node_;
+    std::vector<uint32_t> remap_below_;
+    std::vector<uint32_t> remap_above_;
+    std::vector<Edge> edge_;
+    std::vector<uint32_t> cut_below_;
+    std::vector<uint32_t> cut_above_;
+    std::vector<uint32_t> cut_node_;
+    std::vector<uint32_t> node_slot_;
+    std::vector<Vector> node_position_;
+    std::vector<uint32_t> node_next_;
+    std::vector<uint8_t> node_visited_;
+    std::vector<float> node_x_;
+    std::vector<float> node_y_;
+    std::vector<uint32_t> outline_;
+    std::vector<size_t> outline_first_;
+    std::vector<float> outline_area_;
+    std::vector<size_t> outline_parent_;
+    std::vector<std::pair<float, size_t> > hole_;
+    std::vector<uint32_t> bridge_;
+    std::vector<uint32_t> loop_;
+    std::vector<float> loop_x_;
+    std::vector<float> loop_y_;
+    std::vector<uint32_t> loop_prev_;
+    std::vector<uint32_t> loop_next_;
+    std::vector<uint32_t> triangle_;
+};
+
+}
@@ -75,7 +75,11 @@ public:
 		destroyed_(false),
 		transform_modified_count_(1),
 		transform_update_count_(0),
-		auto_name_counter_(0) {
+		auto_name_counter_(0),
+		tick_modified_count_(1),
+		tick_id_(engine->tick_id()),
+		interpolated_(false),
+		serial_(engine->node_serial_inc()) {
 	}
     
     //! Creates a new node with a parent.
@@ -90,7 +94,11 @@ public:
 		destroyed_(false),
 		transform_modified_count_(1),
 		transform_update_count_(0),
-		auto_name_counter_(0) {
+		auto_name_counter_(0),
+		tick_modified_count_(1),
+		tick_id_(engine->tick_id()),
+		interpolated_(false),
+		serial_(engine->node_serial_inc()) {
 	}
 	
     //! Destructor.
@@ -185,6 +193,12 @@ public:
 		return destroyed_;
 	}
 
+	//! Returns the serial number of this node.  Nodes are numbered in the
+	//! order they are created, so the number is the same from run to run.
+	inline uint32_t serial() const {
+		return serial_;
+	}
+
 	//! Returns true if this node is the master node.  If networking is currently
 	//! enabled, then the node is the master if the player name of the network
 	//! monitor matches the local player name.
@@ -226,6 +240,14 @@ public:
 	inline const Matrix& matrix() const {
 		return matrix_;
 	}
+
+	//! Returns the matrix used to render this node.  If the node moved 
+	//! during the last tick, this is interpolated between the transforms 
+	//! before and after the tick, so that motion looks smooth when the 
+	//! frame rate differs from the tick rate.
+	inline const Matrix& render_matrix() const {
+		return interpolated_ ? render_matrix_ : matrix_;
+	}
 	
 	//! Returns the linear velocity.
 	Vector linear_velocity() const;
@@ -247,11 +269,31 @@ public:
 		rotation_ = rotation;
 		transform_modified_count_++;
 	}
+
+	//! Sets the raw position and rotation of the node together, so that
+	//! the transform is only marked as modified once.
+	void raw_transform(const Vector& position, const Quaternion& rotation) {
+		position_ = position;
+		rotation_ = rotation;
+		transform_modified_count_++;
+        if (audio_source_) {
+            audio_source_->position(position);
+        }
+	}
 	
 	//! Sets the rigid body of this node.
 	void rigid_body(RigidBody* rigid_body) {
 		rigid_body_ = rigid_body;
 	}
+
+	//! Called when geometry attached to this node changes, or when an 
+	//! object with geometry is added to or removed from this node, so that
+	//! the rigid body can update its collision shape.
+	void geometry_changed() {
+		if (rigid_body_) {
+			rigid_body_->invalidate_shape();
+		}
+	}
 	
 	//! Sets the visibility of this node.
 	void visible(bool visible);
@@ -274,6 +316,11 @@ public:
 	//! to the node are destroyed.
 	void destroy();
 
+	//! Adds a node to the scene graph that was created with this node as 
+	//! its parent, but wasn't added yet (e.g., a pooled fracture piece).
+	//! @param node the node to add
+	void attach(CoreNode* node);
+
 	//! Called during a physics update.  This function is only called if the
 	//! node has a rigid body attached.
 	void update();
@@ -283,6 +330,9 @@ public:
 
 	//! Called to notify of a collision event.
 	void collision(Node* node, const Vector& position);
+
+	//! Called to notify that a collision has ended.
+	void separation(Node* node);
 	
 	//! Called once per game loop.  This is called before the
 	//! render event, which also happens once per game loop.
@@ -309,6 +359,9 @@ private:
 	
 	//! Updates this node's internal matrix transform.
 	void update_transform();
+
+	//! Updates the interpolated render transform.
+	void update_render_transform();
   
 	CoreEngine* engine_;
     CoreNode* parent_;
@@ -329,6 +382,15 @@ private:
 	size_t transform_modified_count_;
 	size_t transform_update_count_;
 	size_t auto_name_counter_;
+
+	// Transform at the start of the last tick, for interpolation
+	Vector prev_position_;
+	Quaternion prev_rotation_;
+	Matrix render_matrix_;
+	size_t tick_modified_count_;
+	uint32_t tick_id_;
+	bool interpolated_;
+	uint32_t serial_;
 };
 
 }
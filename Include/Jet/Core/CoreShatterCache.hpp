@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Core/CoreTypes.hpp>
+#include <Jet/Core/CoreMeshSplitter.hpp>
+#include <Jet/Resources/Mesh.hpp>
+#include <Jet/Types/Vector.hpp>
+#include <Jet/Types/Quaternion.hpp>
+#include <Jet/Object.hpp>
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace Jet {
+
+//! One precomputed piece of a shattered mesh.  The mesh is centered on the
+//! piece's center of mass and lined up with its principal axes, so that 
+//! the piece spins about the right point, and its inertia is just three 
+//! moments.
+//! @class CoreShatterPiece
+//! @brief One precomputed piece of a shattered mesh.
+class CoreShatterPiece {
+public:
+    MeshPtr mesh;
+
+    //! Center of mass, in the coordinates of the source mesh
+    Vector center;
+
+    //! Rotation from the piece's principal axes to the source mesh
+    Quaternion rotation;
+
+    //! Moments of inertia about the principal axes, per unit mass
+    Vector inertia;
+
+    //! Fraction of the source mesh's volume in this piece
+    float mass_fraction;
+};
+
+//! The pieces that a mesh shatters into.  Fracture objects hold on to the
+//! pattern they use, so it stays alive after the cache drops it.
+//! @class CoreShatterPattern
+//! @brief Precomputed pieces of a shattered mesh.
+class CoreShatterPattern : public Object {
+public:
+    std::vector<CoreShatterPiece> piece;
+};
+
+//! Breaks meshes into Voronoi cells ahead of time, so that shattering an
+//! object at runtime doesn't have to clip any geometry.  Patterns are 
+//! cooked offline with HullCook, which writes them next to the mesh file
+//! (e.g., "Ship.obj.8.shatter" for 8 pieces).  If there is no cooked 
+//! pattern, or the mesh has changed since it was cooked, the pattern is
+//! computed when it is first needed.  Patterns are keyed by the geometry
+//! hash of the mesh and the piece count, so they are shared by every 
+//! object that uses the same mesh.  At most "shatter_cache_size" patterns 
+//! are kept.
+//! @class CoreShatterCache
+//! @brief Cache of precomputed shatter patterns.
+class CoreShatterCache : public Object {
+public:
+    //! Creates a new shatter cache.
+    CoreShatterCache(CoreEngine* engine);
+
+    //! Returns the pieces that the given mesh shatters into, loading or
+    //! computing them if necessary.  Fewer pieces than requested may be 
+    //! returned if some of the cells miss the mesh.
+    //! @param mesh the mesh to shatter
+    //! @param count the number of Voronoi cells to break the mesh into
+    CoreShatterPattern* pattern(Mesh* mesh, size_t count);
+
+    //! Computes the pattern for a mesh and writes it to a file.  Throws an
+    //! exception if the file can't be written.
+    //! @param mesh the mesh to shatter
+    //! @param count the number of Voronoi cells to break the mesh into
+    //! @param path the path of the pattern file
+    static void cook(Mesh* mesh, size_t count, const std::string& path);
+
+private:
+    typedef std::pair<uint64_t, size_t> Key;
+
+    static void shatter(const CoreMeshPiece& in, size_t count, CoreMeshSplitter* splitter, std::vector<CoreMeshPiece>& cell, std::vector<CoreShatterPiece>& piece);
+    static bool read_pattern(const std::string& path, uint64_t hash, size_t count, std::vector<CoreMeshPiece>& cell, std::vector<CoreShatterPiece>& piece);
+    static bool write_pattern(const std::string& path, uint64_t hash, size_t count, const std::vector<CoreMeshPiece>& cell, const std::vector<CoreShatterPiece>& piece);
+    void insert(const Key& key, CoreShatterPattern* pattern);
+
+    CoreEngine* engine_;
+    CoreMeshPiece piece_;
+    std::vector<CoreMeshPiece> cell_;
+    std::map<Key, CoreShatterPatternPtr> pattern_;
+    std::deque<Key> order_;
+};
+
+}
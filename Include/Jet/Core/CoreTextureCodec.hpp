@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Types.hpp>
+#include <vector>
+#include <string>
+
+namespace Jet {
+
+//! Block-compressed texture formats.  BC1 stores opaque RGB in 4 bits per
+//! pixel, BC3 stores RGBA in 8 bits per pixel, and BC5 stores two channels
+//! (e.g., the X and Y of a normal map) in 8 bits per pixel.
+enum TextureCodecFormat { TCF_BC1, TCF_BC3, TCF_BC5 };
+
+//! Encodes and decodes block-compressed textures, and reads and writes
+//! them as DDS files.  None of these functions touch OpenGL, so they can be
+//! used by offline tools and on worker threads.  Uncompressed images are
+//! always tightly packed RGBA.
+//! @class CoreTextureCodec
+//! @brief Encodes and decodes block-compressed textures.
+class CoreTextureCodec {
+public:
+    //! Returns the number of bytes in each 4x4 block for the given format.
+    static size_t block_size(TextureCodecFormat format);
+
+    //! Returns the number of bytes needed to store an image of the given
+    //! size.  Partial blocks at the edges are padded out to a full block.
+    static size_t compressed_size(TextureCodecFormat format, size_t width, size_t height);
+
+    //! Compresses an RGBA image.
+    //! @param format the compressed format
+    //! @param rgba tightly packed RGBA pixels
+    //! @param width the width of the image in pixels
+    //! @param height the height of the image in pixels
+    //! @param out receives compressed_size() bytes
+    static void encode(TextureCodecFormat format, const uint8_t* rgba, size_t width, size_t height, uint8_t* out);
+
+    //! Decompresses an image into RGBA.  BC5 images are decoded into the
+    //! red and green channels; blue is 0 and alpha is 255.
+    //! @param format the compressed format
+    //! @param in compressed_size() bytes of compressed data
+    //! @param width the width of the image in pixels
+    //! @param height the height of the image in pixels
+    //! @param rgba receives width*height*4 bytes
+    static void decode(TextureCodecFormat format, const uint8_t* in, size_t width, size_t height, uint8_t* rgba);
+
+    //! Returns the peak signal-to-noise ratio in dB between two RGBA images.
+    //! Only the first channels of each pixel are compared (3 for BC1, 4 for
+    //! BC3, 2 for BC5).  Identical images return 99 dB.
+    static float psnr(const uint8_t* rgba1, const uint8_t* rgba2, size_t width, size_t height, size_t channels);
+
+    //! Returns the number of channels that the given format preserves.
+    static size_t channels(TextureCodecFormat format);
+
+    //! Generates the next mipmap level from an image using a 2x2 box
+    //! filter.  Odd dimensions are handled by repeating the last row/column.
+    //! @param channels the number of bytes per pixel (3 or 4)
+    //! @param out receives max(width/2, 1)*max(height/2, 1)*channels bytes
+    static void downsample(const uint8_t* in, size_t width, size_t height, uint8_t* out, size_t channels=4);
+
+    //! Writes a compressed mip chain to a DDS file.  Throws an exception on
+    //! failure.
+    static void write_dds(const std::string& path, TextureCodecFormat format, size_t width, size_t height, const std::vector<std::vector<uint8_t> >& level);
+
+    //! Reads a compressed mip chain from a DDS file.  Only BC1, BC3 and BC5
+    //! files are supported.  Throws an exception on failure.
+    static void read_dds(const std::string& path, TextureCodecFormat& format, size_t& width, size_t& height, std::vector<std::vector<uint8_t> >& level);
+};
+
+}
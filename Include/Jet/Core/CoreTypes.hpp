@@ -37,6 +37,9 @@ namespace Jet {
     class CoreParticleSystem;
     class CoreQuadChain;
     class CoreQuadSet;    
+    class CoreWorkerPool;
+    class CoreShatterCache;
+    class CoreShatterPattern;
 
     typedef boost::intrusive_ptr<CoreCamera> CoreCameraPtr;
     typedef boost::intrusive_ptr<CoreCollisionSphere> CoreCollisionSpherePtr;
@@ -49,4 +52,7 @@ namespace Jet {
     typedef boost::intrusive_ptr<CoreParticleSystem> CoreParticleSystemPtr;
     typedef boost::intrusive_ptr<CoreQuadChain> CoreQuadChainPtr;
     typedef boost::intrusive_ptr<CoreQuadSet> CoreQuadSetPtr;
+    typedef boost::intrusive_ptr<CoreWorkerPool> CoreWorkerPoolPtr;
+    typedef boost::intrusive_ptr<CoreShatterCache> CoreShatterCachePtr;
+    typedef boost::intrusive_ptr<CoreShatterPattern> CoreShatterPatternPtr;
 }
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Core/CoreTypes.hpp>
+#include <Jet/Object.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <deque>
+
+namespace Jet {
+
+//! Task queued on the worker pool.  The thread that queued the task keeps
+//! a handle to it, and gets back any exception the task threw when it 
+//! waits for the task.
+//! @class CoreWorkerTask
+//! @brief Task queued on the worker pool.
+class CoreWorkerTask {
+public:
+    //! Creates a new task that runs the given function.
+    //! @param function the function to run
+    CoreWorkerTask(const boost::function<void ()>& function);
+
+    //! Returns true if the task has finished running.  Doesn't block.
+    bool done();
+
+    //! Blocks until the task has finished.  If the task threw an 
+    //! exception, it is rethrown here as a runtime_error.
+    void wait();
+
+    //! Runs the task on the calling thread.  An exception thrown by the
+    //! task is kept until wait() is called.
+    void run();
+
+private:
+    void finish(const std::string& error);
+
+    boost::mutex mutex_;
+    boost::condition_variable condition_;
+    boost::function<void ()> function_;
+    bool done_;
+    std::string error_;
+
+    friend class CoreWorkerPool;
+};
+
+//! Runs tasks on a fixed set of worker threads.  Tasks must not touch
+//! engine objects (nodes, resources, etc.), because reference counts and
+//! the scene graph are not thread-safe; they should only work on data that
+//! they own, and hand the results back to the main thread.
+//! @class CoreWorkerPool
+//! @brief Pool of worker threads.
+class CoreWorkerPool : public Object {
+public:
+    //! Creates a new worker pool.
+    //! @param threads the number of worker threads
+    CoreWorkerPool(size_t threads);
+
+    //! Destructor.  Tasks that have not started yet are discarded; waiting
+    //! on a discarded task throws an exception.
+    ~CoreWorkerPool();
+
+    //! Returns the number of worker threads.
+    inline size_t thread_count() const {
+        return thread_count_;
+    }
+
+    //! Queues a task to run on one of the worker threads.  Returns a 
+    //! handle that can be used to wait for the task and get its errors.
+    //! @param function the function to run
+    boost::shared_ptr<CoreWorkerTask> task(const boost::function<void ()>& function);
+
+    //! Splits the range [0, count) into chunks of at most grain items, and
+    //! runs the function on each chunk.  The calling thread works on chunks
+    //! too, and the call returns when every chunk is done, so the function
+    //! may safely use data owned by the caller.  If a chunk throws, the
+    //! exception is rethrown on the calling thread as a runtime_error.
+    //! @param count the number of items
+    //! @param grain the maximum number of items per chunk
+    //! @param function called with the begin and end of each chunk
+    void parallel_for(size_t count, size_t grain, const boost::function<void (size_t, size_t)>& function);
+
+private:
+    class ParallelJob;
+    void run();
+    static void run_chunks(boost::shared_ptr<ParallelJob> job);
+
+    boost::mutex mutex_;
+    boost::condition_variable condition_;
+    std::deque<boost::shared_ptr<CoreWorkerTask> > task_;
+    boost::thread_group thread_;
+    size_t thread_count_;
+    bool stopped_;
+};
+
+}
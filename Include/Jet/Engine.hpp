@@ -150,10 +150,9 @@ public:
     static Engine* create_custom();
 };
 
-//! Listens for engine events.  Examples include on_pre_render (called before
-//! rendering), on_post_render (called after rendering), on_render (called
-//! during rendering), and on_update (called with each tick of the physics
-//! engine.
+//! Listens for engine events.  Examples include on_tick (called at a fixed
+//! rate, once for each simulation step), on_update (called once per frame),
+//! and on_render (called during rendering).
 //! @class EngineListener
 //! @brief Interface for handling engine events.
 class EngineListener : public virtual Object {
@@ -161,10 +160,10 @@ public:
 	//! Called when the engine is initialized
 	virtual void on_init()=0;
 	
-	//! Called at the beginning of a tick.
+	//! Called once per fixed-rate simulation tick.
 	virtual void on_tick()=0;
 	
-    //! Called for each physics update.
+    //! Called once per frame, before rendering.
     virtual void on_update()=0;
     
     //! Called when the frame is rendered.
@@ -48,9 +48,6 @@ public:
     
     //! Creates a new mesh with the given name
     virtual Mesh* mesh(const std::string& mesh)=0;
-    
-    //! Creates a new mesh with the given name and parent
-    virtual Mesh* mesh(const std::string& name, Mesh* parent)=0;
 };
 
 }
@@ -22,16 +22,20 @@
 #pragma once
 
 #include <Jet/Graphics/OpenGLTypes.hpp>
+#include <Jet/Graphics/OpenGLTextureAtlas.hpp>
 #include <Jet/Core/CoreEngine.hpp>
 #include <Jet/Resources/Font.hpp>
 #include <ft2build.h>
 #include <freetype/ftglyph.h>
 #include <freetype/freetype.h>
 #include <vector>
+#include <map>
 
 namespace Jet {
 
-//! Class to hold a Font data for rendering.
+//! Class to hold a Font data for rendering.  Glyphs are rasterized lazily
+//! the first time they are used, and packed into the shared texture atlas
+//! so that a whole string (or overlay tree) is drawn in one batch.
 //! @class Font
 //! @brief Class to hold Font data.
 class OpenGLFont : public Font {
@@ -65,21 +69,45 @@ public:
 	//! Returns the resource state of the shader
 	void state(ResourceState state);
     
-    //! Renders this font.  An orthographic screen
-    //! space projection must be used!
-    void render(const std::string& text);
+    //! Lays out the text and adds one quad per glyph to the quad buffer.
+    //! The text is UTF-8 encoded.  An orthographic screen space projection
+    //! must be used!
+    //! @param buffer the quad buffer to add glyphs to
+    //! @param text the text to render
+    //! @param x the x-coordinate of the start of the baseline
+    //! @param y the y-coordinate of the baseline
+    void render(OpenGLQuadBuffer* buffer, const std::string& text, float x, float y);
 
 private:
+    class Glyph {
+    public:
+        uint32_t index;
+        float advance;
+        float left;
+        float top;
+        float width;
+        float height;
+        OpenGLAtlasRegion region;
+    };
+
     void read_font_data();
-    void create_bitmap(FT_Face face, unsigned char letter);
+    void free_font_data();
+    void init_kerning();
+    int glyph(OpenGLTextureAtlas* atlas, uint32_t code);
+    float kerning(uint32_t prev_code, int prev, uint32_t code, int next);
     
     CoreEngine* engine_;
     std::string name_;
     std::string face_;
     size_t height_;
     ResourceState state_;
-    std::vector<GLuint> texture_;
-    GLuint list_;
+    FT_Library library_;
+    FT_Face ft_face_;
+    std::vector<Glyph> glyph_;
+    std::vector<int> latin_glyph_;
+    std::map<uint32_t, int> extended_glyph_;
+    std::vector<int16_t> kerning_;
+    std::vector<uint8_t> bitmap_;
 };
 
 }
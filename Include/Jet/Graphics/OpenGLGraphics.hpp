@@ -24,6 +24,8 @@
 #include <Jet/Graphics/OpenGLTypes.hpp>
 #include <Jet/Graphics/OpenGLRenderTarget.hpp>
 #include <Jet/Graphics/OpenGLParticleBuffer.hpp>
+#include <Jet/Graphics/OpenGLQuadBuffer.hpp>
+#include <Jet/Graphics/OpenGLTextureAtlas.hpp>
 #include <Jet/Graphics/OpenGLShader.hpp>
 #include <Jet/Graphics/OpenGLFont.hpp>
 #include <Jet/Graphics/OpenGLMaterial.hpp>
@@ -75,10 +77,6 @@ private:
         return new OpenGLMesh(engine_, name);
     }
     
-    inline OpenGLMesh* mesh(const std::string& name, Mesh* parent) {
-        return new OpenGLMesh(engine_, name, static_cast<OpenGLMesh*>(parent));
-    }
-    
     void on_tick() {}
     void on_init();
     void on_update() {}
@@ -98,9 +96,10 @@ private:
 	void render_visible_quad_sets();
     void render_fullscreen_quad();
     void render_overlays();
-    void render_overlay(CoreOverlay* overlay);
+    void render_overlay(CoreOverlay* overlay, float x, float y);
     void render_skysphere();
     void check_video_mode();
+    void update_resource_budget();
     
     static bool compare_mesh_objects(MeshObjectPtr o1, MeshObjectPtr o2);
     static bool compare_particle_systems(ParticleSystemPtr o1, ParticleSystemPtr o2);
@@ -110,6 +109,8 @@ private:
     // Shadow-mapping variables
     std::vector<OpenGLRenderTargetPtr> shadow_target_;
     OpenGLParticleBufferPtr particle_buffer_;
+    OpenGLTextureAtlasPtr texture_atlas_;
+    OpenGLQuadBufferPtr quad_buffer_;
     
     std::vector<CoreMeshObjectPtr> mesh_objects_;
     std::vector<CoreParticleSystemPtr> particle_systems_;
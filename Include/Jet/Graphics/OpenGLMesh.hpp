@@ -44,21 +44,12 @@ public:
 		state_(RS_UNLOADED),
 		vbuffer_(0),
 		ibuffer_(0),
-		sync_mode_(SM_STATIC) {
+		sync_mode_(SM_STATIC),
+		last_used_(0),
+		geometry_hash_(0),
+		geometry_hash_valid_(false) {
 	}
 	
-	//! Creates a new mesh.
-	inline OpenGLMesh(CoreEngine* engine, const std::string& name, OpenGLMesh* parent) :
-		engine_(engine),
-		parent_(parent),
-		geometry_(engine->geometry(name)),
-		name_(name),
-		state_(RS_UNLOADED),
-		vbuffer_(0),
-		ibuffer_(0),
-		sync_mode_(SM_STATIC) {
-	}
-
 	//! Destructor.
 	virtual ~OpenGLMesh();
 
@@ -117,7 +108,7 @@ public:
 
     //! Returns the number of vertices.
     inline size_t vertex_count() const {
-		return parent_? parent_->vertex_count() : vertex_.size();
+		return vertex_.size();
     }
 
     //! Returns the number of indices.
@@ -168,6 +159,22 @@ public:
 	inline Geometry* geometry() const {
 		return geometry_.get();
 	}
+
+	//! Returns a hash of the vertex positions and indices of this mesh.
+	uint64_t geometry_hash() const;
+
+	//! Returns the number of bytes of video memory used by the hardware 
+	//! buffers owned by this mesh.
+	size_t gpu_bytes() const;
+
+	//! Returns the number of bytes of system memory used by the vertex and
+	//! index data owned by this mesh.
+	size_t cpu_bytes() const;
+
+	//! Returns the id of the last frame that rendered this mesh.
+	inline uint32_t last_used() const {
+		return last_used_;
+	}
 	
 	//! Sets the resource state
 	void state(ResourceState state);
@@ -184,7 +191,6 @@ private:
 	void update_tangents();
     
     CoreEngine* engine_;
-	OpenGLMeshPtr parent_;
 	GeometryPtr geometry_;
 	std::string name_;
 	ResourceState state_;
@@ -194,6 +200,9 @@ private:
 	GLuint vbuffer_;
 	std::vector<GLuint> ibuffer_;
 	SyncMode sync_mode_;
+	uint32_t last_used_;
+	mutable uint64_t geometry_hash_;
+	mutable bool geometry_hash_valid_;
 };
 
 }
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Graphics/OpenGLTypes.hpp>
+#include <Jet/Graphics/OpenGLTextureAtlas.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Object.hpp>
+#include <Jet/Types/Vector.hpp>
+#include <Jet/Types/Texcoord.hpp>
+#include <Jet/Types/Color.hpp>
+#include <vector>
+
+namespace Jet {
+
+//! This class is used to batch textured quads for quad sets and overlays.
+//! Textures are looked up in the texture atlas, so that quads from many
+//! different textures can be drawn with a single draw call per atlas page.
+//! @class OpenGLQuadBuffer
+//! @brief Stores quads for rendering.
+class OpenGLQuadBuffer : public Object {
+public:
+    //! Constructor.  Creates a new quad buffer of the given size.  When the
+    //! quad buffer is full, it will be flushed.
+    //! @param engine the engine object
+    //! @param atlas the texture atlas used to look up textures
+    //! @param size the maximum number of quads in each draw batch
+    //! @param buffers the number of hardware buffers to use (for pipelining)
+    OpenGLQuadBuffer(CoreEngine* engine, OpenGLTextureAtlas* atlas, size_t size=4096, size_t buffers=2);
+
+    //! Destructor.
+    ~OpenGLQuadBuffer();
+
+    //! Sets the texture used by the following quads.  If the texture is
+    //! not on the same atlas page as the previous texture, then the quads
+    //! in the buffer are flushed.  Quads are dropped until the texture has
+    //! finished loading.  Atlas pages have no mip levels, and a region of
+    //! a page can't repeat, so textures that are drawn minified or with 
+    //! texcoords outside [0, 1] should not be packed.
+    //! @param texture the texture
+    //! @param packed false if the texture should be bound by itself
+    void texture(OpenGLTexture* texture, bool packed=true);
+
+    //! Sets the atlas page used by the following quads.  The texcoords
+    //! passed to vertex() are used as-is.
+    void page(size_t page);
+
+    //! Returns the texture atlas used by this buffer.
+    inline OpenGLTextureAtlas* atlas() const {
+        return atlas_.get();
+    }
+
+    //! Sets the color used by the following vertices.
+    inline void color(const Color& color) {
+        color_ = color;
+    }
+
+    //! Adds a vertex to the buffer.  Vertices are drawn as quads, so they
+    //! must be added four at a time.  The texcoord is mapped into the atlas
+    //! region of the current texture.
+    void vertex(const Vector& position, const Texcoord& texcoord);
+
+    //! Flushes quads that are currently contained in the buffer.
+    void flush();
+
+private:
+    class QuadVertex {
+    public:
+        Vector position;
+        Texcoord texcoord;
+        Color color;
+    };
+
+    CoreEngine* engine_;
+    OpenGLTextureAtlasPtr atlas_;
+    OpenGLTexturePtr texture_;
+    size_t page_;
+    bool atlased_;
+    bool mapped_;
+    bool skip_;
+    OpenGLAtlasRegion region_;
+    Color color_;
+    std::vector<QuadVertex> vertex_;
+    std::vector<GLuint> vbuffer_;
+    size_t size_;
+    size_t current_buffer_;
+};
+
+}
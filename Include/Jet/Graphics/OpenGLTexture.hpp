@@ -24,11 +24,20 @@
 #include <Jet/Graphics/OpenGLTypes.hpp>
 #include <Jet/Core/CoreEngine.hpp>
 #include <Jet/Resources/Texture.hpp>
+#include <boost/shared_ptr.hpp>
 #include <vector>
 
 namespace Jet {
+class CoreWorkerTask;
 
-//! Class to hold a texture data for rendering.
+//! Class to hold a texture data for rendering.  Images are decoded and the
+//! mipmap chain is generated on a worker thread; the render thread only
+//! uploads the finished levels, and then frees the mipmap chain.  The 
+//! base level stays in memory, so a texture that is evicted from video
+//! memory is uploaded again without reading the file; the chain is 
+//! rebuilt from the base level.  DDS files holding BC1, BC3 or BC5 data
+//! are uploaded without being decompressed, and keep their whole chain.
+//! RGB images stay RGB in memory.
 //! @class Texture
 //! @brief Class to hold texture data.
 class OpenGLTexture : public Texture {
@@ -42,7 +51,10 @@ public:
 		height_(0),
 		texture_(0),
 		bytes_per_pixel_(0),
-		texture_format_(0) {
+		texture_format_(0),
+		gpu_bytes_(0),
+		last_used_(0),
+		mipmap_freed_(false) {
 			
 	}
 	
@@ -79,6 +91,44 @@ public:
 		return name_;
 	}
 
+	//! Returns the number of bytes per pixel in the texture data.
+	inline uint32_t bytes_per_pixel() const {
+		return bytes_per_pixel_;
+	}
+
+	//! Returns the OpenGL pixel format of the texture data.  For compressed
+	//! textures, this is the compressed internal format.
+	inline uint32_t texture_format() const {
+		return texture_format_;
+	}
+
+	//! Returns true if the texture data is block-compressed.  Compressed
+	//! textures have no per-pixel layout, so bytes_per_pixel() is 0.
+	inline bool compressed() const {
+		return texture_format_ && !bytes_per_pixel_;
+	}
+
+	//! Returns the number of bytes of video memory used by the texture,
+	//! including the mip chain.
+	inline size_t gpu_bytes() const {
+		return gpu_bytes_;
+	}
+
+	//! Returns the number of bytes of system memory used by the decoded
+	//! image and its mip chain.  The mip chain is freed once it has been
+	//! uploaded.
+	size_t cpu_bytes() const;
+
+	//! Returns the id of the last frame that used this texture.
+	inline uint32_t last_used() const {
+		return last_used_;
+	}
+
+	//! Returns true if the image is still being decoded on a worker thread.
+	inline bool loading() const {
+		return pending_.get() != 0;
+	}
+
     //! Sets the width of the texture in pixels.
     //! @param width the new width
     inline void width(size_t width) {
@@ -93,26 +143,51 @@ public:
 		data_.resize(width_ * height_ * bytes_per_pixel_);
 	}
 	
+	//! Returns true if the texture data is in memory.  If the image is
+	//! still being decoded on a worker thread, this returns false without
+	//! blocking.
+	bool ready();
+	
 	//! Sets the resource state
 	void state(ResourceState state);
 	
 	//! Sets the sampler this texture is bound to.
 	void sampler(uint32_t sampler);
 
-private:	
+private:
+	class TextureData {
+	public:
+		TextureData() : width(0), height(0), bytes_per_pixel(0), texture_format(0) {}
+		
+		std::string path;
+		std::vector<std::vector<uint8_t> > level;
+		size_t width;
+		size_t height;
+		uint32_t bytes_per_pixel;
+		uint32_t texture_format;
+	};
+	
+	static void decode_texture_data(boost::shared_ptr<TextureData> data);
+	static void build_mipmap(std::vector<std::vector<uint8_t> >& level, size_t width, size_t height, size_t bpp);
 	void read_texture_data();
+	bool finish_texture_data(bool wait);
 	void init_texture();
     
 	CoreEngine* engine_;
 	std::string name_;
 	ResourceState state_;
     std::vector<uint8_t> data_;
+	std::vector<std::vector<uint8_t> > mipmap_;
+	boost::shared_ptr<TextureData> pending_;
+	boost::shared_ptr<CoreWorkerTask> task_;
     size_t width_;
     size_t height_;
 	GLuint texture_;
 	uint32_t bytes_per_pixel_;
 	uint32_t texture_format_;
-	
+	size_t gpu_bytes_;
+	uint32_t last_used_;
+	bool mipmap_freed_;
 
     friend class Engine;
 };
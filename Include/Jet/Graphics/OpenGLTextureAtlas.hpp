@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Graphics/OpenGLTypes.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Types/Texcoord.hpp>
+#include <Jet/Object.hpp>
+#include <vector>
+#include <map>
+
+namespace Jet {
+
+//! Location of an image inside a texture atlas.  The texcoords give the
+//! corners of the image on the atlas page.
+//! @class OpenGLAtlasRegion
+//! @brief Location of an image inside an atlas page.
+class OpenGLAtlasRegion {
+public:
+    //! Creates an empty region.
+    inline OpenGLAtlasRegion() :
+        page(0) {
+    }
+
+    //! Maps a texcoord in the [0, 1] range of the original image to a
+    //! texcoord on the atlas page.
+    inline Texcoord map(const Texcoord& texcoord) const {
+        return Texcoord(
+            min.u + (max.u - min.u) * texcoord.u,
+            min.v + (max.v - min.v) * texcoord.v);
+    }
+
+    size_t page;
+    Texcoord min;
+    Texcoord max;
+};
+
+//! Packs small textures (UI images, quad set textures, glyphs) into a few
+//! large RGBA pages using skyline bottom-left packing.  Anything drawn from
+//! the same page can go into the same draw call.
+//! @class OpenGLTextureAtlas
+//! @brief Packs small textures into shared pages.
+class OpenGLTextureAtlas : public Object {
+public:
+    //! Creates a new texture atlas.
+    //! @param engine the engine object
+    //! @param size the width and height of each atlas page in pixels
+    //! @param max_texture_size textures larger than this are not packed
+    OpenGLTextureAtlas(CoreEngine* engine, size_t size=1024, size_t max_texture_size=256);
+
+    //! Destructor.
+    ~OpenGLTextureAtlas();
+
+    //! Returns the region for the given texture, packing the texture into
+    //! a page the first time it is used.  Returns false if the texture is too
+    //! large to be packed or is block-compressed; in that case it must be 
+    //! bound on its own.
+    //! @param texture the texture to look up
+    //! @param region set to the location of the texture
+    bool region(OpenGLTexture* texture, OpenGLAtlasRegion& region);
+
+    //! Packs an RGBA image into the atlas.  Returns false if the image does
+    //! not fit into a page.
+    //! @param width the width of the image in pixels
+    //! @param height the height of the image in pixels
+    //! @param data tightly packed RGBA pixels
+    //! @param region set to the location of the image
+    bool insert(size_t width, size_t height, const uint8_t* data, OpenGLAtlasRegion& region);
+
+    //! Binds the given page to the given sampler.
+    void sampler(size_t page, uint32_t sampler);
+
+    //! Returns the number of pages in the atlas.
+    inline size_t page_count() const {
+        return page_.size();
+    }
+
+    //! Returns the width and height of each page in pixels.
+    inline size_t size() const {
+        return size_;
+    }
+
+private:
+    class SkylineNode {
+    public:
+        SkylineNode(size_t x, size_t y, size_t width) :
+            x(x), y(y), width(width) {
+        }
+
+        size_t x;
+        size_t y;
+        size_t width;
+    };
+
+    class Page {
+    public:
+        GLuint texture;
+        std::vector<SkylineNode> skyline;
+    };
+
+    bool fit(const Page& page, size_t index, size_t width, size_t height, size_t& y) const;
+    bool pack(Page& page, size_t width, size_t height, size_t& x, size_t& y);
+    void new_page();
+
+    CoreEngine* engine_;
+    size_t size_;
+    size_t max_texture_size_;
+    std::vector<Page> page_;
+    std::map<std::string, OpenGLAtlasRegion> region_;
+    std::vector<uint8_t> scratch_;
+};
+
+}
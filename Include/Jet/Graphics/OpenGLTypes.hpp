@@ -45,20 +45,24 @@ namespace Jet {
     class OpenGLMaterial;
     class OpenGLMesh;
     class OpenGLParticleBuffer;
+    class OpenGLQuadBuffer;
     class OpenGLRenderSystem;
     class OpenGLRenderTarget;
     class OpenGLShader;
     class OpenGLTexture;
+    class OpenGLTextureAtlas;
     
     typedef boost::intrusive_ptr<OpenGLCubemap> OpenGLCubemapPtr;
     typedef boost::intrusive_ptr<OpenGLFont> OpenGLFontPtr;
     typedef boost::intrusive_ptr<OpenGLMaterial> OpenGLMaterialPtr;
     typedef boost::intrusive_ptr<OpenGLMesh> OpenGLMeshPtr;
     typedef boost::intrusive_ptr<OpenGLParticleBuffer> OpenGLParticleBufferPtr;
+    typedef boost::intrusive_ptr<OpenGLQuadBuffer> OpenGLQuadBufferPtr;
     typedef boost::intrusive_ptr<OpenGLRenderSystem> OpenGLRenderSystemPtr;
     typedef boost::intrusive_ptr<OpenGLRenderTarget> OpenGLRenderTargetPtr;
     typedef boost::intrusive_ptr<OpenGLShader> OpenGLShaderPtr;
     typedef boost::intrusive_ptr<OpenGLTexture> OpenGLTexturePtr;
+    typedef boost::intrusive_ptr<OpenGLTextureAtlas> OpenGLTextureAtlasPtr;
 
     enum OpenGLTextureSampler {
         TS_DIFFUSE = 0,
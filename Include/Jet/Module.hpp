@@ -83,7 +83,7 @@ public:
     //! Called when the module is created.
     virtual void on_init()=0;
     
-    //! Called when the module is updated (during the physics update)
+    //! Called once per frame, with the time since the last frame.
     virtual void on_update(float delta)=0;
     
     //! Called when the module is rendered.
@@ -92,7 +92,7 @@ public:
     //! Called when the module is destroyed.
     virtual void on_destroy()=0;
     
-    //! Called once per frame.
+    //! Called once per fixed-rate simulation tick.
     virtual void on_tick()=0;
 };
 
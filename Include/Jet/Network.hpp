@@ -73,10 +73,10 @@ public:
 	//! @param args the arguments to invoke
 	virtual void unreliable_rpc(const std::string& name, const std::vector<boost::any>& args)=0;
 
-	//! Invokes a reliable RPC on all connected machines.  Note that 
-	//! reliable RPCs should not be used frequently, because they are slow 
-	//! and can cause packet loss in the low-latency UDP packet stream as
-	//! a side-effect of the interaction between UDP and TCP.  Note that RPCs are only invoked
+	//! Invokes a reliable RPC on all connected machines.  Reliable RPCs 
+	//! are resent until they arrive, and arrive in the order they were 
+	//! invoked, so a lost RPC holds up the reliable RPCs behind it (but 
+	//! not the unreliable traffic).  Note that RPCs are only invoked
 	//! on the remote machine(s) and not on the local machine.
 	virtual void reliable_rpc(const std::string& name, const std::vector<boost::any>& args)=0;
 };
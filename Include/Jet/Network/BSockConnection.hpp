@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Network/BSockTypes.hpp>
+#include <Jet/Network/BSockPacket.hpp>
+#include <Jet/Network/BSockSocket.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Types/Address.hpp>
+#include <Jet/Object.hpp>
+#include <vector>
+
+// Number of reliable messages on each channel that can be in flight at
+// once.  The receiver buffers up to this many messages that arrive ahead
+// of a lost one.
+#define JET_RELIABLE_WINDOW 64
+
+// Number of sent packets that a connection remembers, so that it can tell
+// which messages an acknowledgement covers.
+#define JET_PACKET_HISTORY 256
+
+namespace Jet {
+
+//! Exchanges messages with one peer over a datagram socket, which can be
+//! shared by the connections to many peers.  Every packet has a sequence 
+//! number, and acknowledges the newest packet received from the peer plus
+//! the 32 packets before it with a bit field.  Messages on CT_UNRELIABLE
+//! are sent once.  Messages on the other channels are resent until a 
+//! packet that carried them is acknowledged, and are delivered in the 
+//! order they were sent.  Each reliable channel is ordered separately, so
+//! a lost message only holds up the messages behind it on its channel, and
+//! reliable and unreliable messages share packets, so they share one UDP
+//! flow.  Messages are written with BSockWriter and read with BSockReader,
+//! and are queued until the network flushes the connection at the end of
+//! the frame.
+//! @class BSockConnection
+//! @brief Reliable and unreliable messages to one peer over UDP.
+class BSockConnection : public Object {
+public:
+    //! Creates a new connection.
+    //! @param socket the datagram socket used to send and receive packets
+    //! @param address the address of the peer
+    BSockConnection(CoreEngine* engine, BSockSocket* socket, const Address& address);
+
+    //! Destructor.  Sends the queued messages one last time.
+    ~BSockConnection();
+
+    //! Returns true if a packet from a new peer opens a connection: the 
+    //! packet must start with the first reliable message on the given 
+    //! channel, and the message must start with the given type.  The 
+    //! reader is rewound, so the packet can still be passed to receive().
+    static bool opens(BSockReader* reader, ChannelType channel, int type);
+
+    //! Returns the address of the peer
+    inline const Address& address() const {
+        return address_;
+    }
+
+    //! Returns the socket that packets are sent and received on
+    inline BSockSocket* socket() const {
+        return socket_.get();
+    }
+
+    //! Returns the largest message that can be written, including the
+    //! message header.  A message this big fills a packet by itself.
+    inline size_t capacity() const {
+        return capacity_;
+    }
+
+    //! Returns the smoothed round-trip time, in seconds.
+    inline float round_trip_time() const {
+        return round_trip_time_;
+    }
+
+    //! Returns the number of reliable messages that have been resent.
+    inline size_t resent() const {
+        return resent_;
+    }
+
+    //! Returns true if nothing has been received from the peer for longer 
+    //! than the network_timeout option.
+    inline bool timed_out() const {
+        return time_ - receive_time_ > timeout_;
+    }
+
+    //! Returns true if the peer has acknowledged every reliable message
+    //! written to the connection.
+    bool acknowledged() const;
+
+    //! Advances the connection's clock, which times resends and timeouts.
+    void update(float delta);
+
+    //! Reads a packet that came from the peer.  Acknowledged messages are
+    //! released, and the messages in the packet are queued for readers.
+    void receive(BSockReader* reader);
+
+    //! Sends the queued messages, the reliable messages that haven't been
+    //! acknowledged in time, and acknowledgements for the packets received
+    //! since the last flush.
+    void flush();
+
+private:
+    BSockPacket* read_packet();
+    BSockPacket* write_packet(ChannelType channel);
+    void send(BSockPacket* packet, ChannelType channel);
+    void release(BSockPacket* packet);
+
+    bool pending() const;
+    bool due(size_t channel, uint16_t id) const;
+    bool received(uint16_t sequence);
+    void acknowledge(uint16_t sequence);
+    void advance(size_t channel);
+    void deliver(size_t channel, uint16_t id, const char* data, size_t length);
+
+    // Messages on one channel.  Reliable messages wait in the queue until
+    // there is room in the window, and then stay in flight until they are
+    // acknowledged.  Unreliable messages only use the queue.
+    struct Channel {
+        BSockPacketQueue queued;
+        BSockPacket* sent[JET_RELIABLE_WINDOW];
+        float sent_time[JET_RELIABLE_WINDOW];
+        BSockPacket* received[JET_RELIABLE_WINDOW];
+        uint16_t oldest;
+        uint16_t next;
+        uint16_t expected;
+    };
+
+    // Sent packet, and the reliable messages that it carried.  Each 
+    // message is stored as its channel in the high bits and its ID in the
+    // low 16 bits.
+    struct SentPacket {
+        uint16_t sequence;
+        bool acked;
+        float time;
+        std::vector<uint32_t> message;
+    };
+
+    CoreEngine* engine_;
+    BSockPacketPool* pool_;
+    BSockSocketPtr socket_;
+    Address address_;
+    size_t capacity_;
+    Channel channel_[JET_CHANNEL_COUNT];
+    SentPacket sent_[JET_PACKET_HISTORY];
+    BSockPacketQueue delivered_;
+    uint16_t sequence_;
+    uint16_t remote_sequence_;
+    uint32_t remote_mask_;
+    bool ack_pending_;
+    float time_;
+    float send_time_;
+    float receive_time_;
+    float round_trip_time_;
+    float resend_time_;
+    float timeout_;
+    size_t resent_;
+
+    friend class BSockReader;
+    friend class BSockWriter;
+};
+
+}
@@ -23,8 +23,9 @@
 
 #include <Jet/Network/BSockTypes.hpp>
 #include <Jet/Network/BSockSocket.hpp>
-#include <Jet/Network/BSockServerSocket.hpp>
+#include <Jet/Network/BSockConnection.hpp>
 #include <Jet/Network/BSockNetworkMonitor.hpp>
+#include <Jet/Network/BSockSnapshotCodec.hpp>
 #include <Jet/Core/CoreEngine.hpp>
 #include <Jet/Types/Player.hpp>
 #include <Jet/Types/NetworkMatch.hpp>
@@ -113,12 +114,17 @@ public:
 	//! @param args the arguments to invoke
 	void unreliable_rpc(const std::string& name, const std::vector<boost::any>& args);
 
-	//! Invokes a reliable RPC on all connected machines.  Note that 
-	//! reliable RPCs should not be used frequently, because they are slow 
-	//! and can cause packet loss in the low-latency UDP packet stream as
-	//! a side-effect of the interaction between UDP and TCP.
+	//! Invokes a reliable RPC on all connected machines.  Reliable RPCs 
+	//! are resent until they arrive, and arrive in order.  They share 
+	//! packets with the state updates, so a lost RPC doesn't hold up the
+	//! state updates, but it does hold up the reliable RPCs after it.
 	void reliable_rpc(const std::string& name, const std::vector<boost::any>& args);
 
+	//! Returns the reactor that waits for events on the network's sockets.
+	inline BSockReactor* reactor() {
+		return &reactor_;
+	}
+
 private:
 	// System initialization functions
     void on_tick();
@@ -135,26 +141,33 @@ private:
     void do_discover();
     void do_host();
 	void do_host_hello();
-	void do_host_incoming_connections();
 	void do_host_poll_sockets();
+	BSockConnection* do_host_accept(const Address& address);
+	void do_host_drop_player(size_t index);
     void do_client();
+	void do_closing();
+	void read_datagrams();
     
 	// RPC send functions
     void rpc_match_info(BSockSocket* socket);
     void rpc_match_destroy(BSockSocket* socket);
-    void rpc_player_join(BSockSocket* socket);
-    void rpc_player_leave(BSockSocket* socket);
-    void rpc_player_list(BSockSocket* socket);
-	void rpc_sync_tick(BSockSocket* socket);
-	void rpc_node_state(BSockSocket* socket);
-	void rpc_input(BSockSocket* socket);
-	void rpc_ping(BSockSocket* socket);
-	void rpc_user_rpc(BSockSocket* socket, const std::string& name, const std::vector<boost::any>& args);
+    void rpc_match_destroy(BSockConnection* connection);
+    void rpc_player_join(BSockConnection* connection);
+    void rpc_player_leave(BSockConnection* connection);
+    void rpc_player_list(BSockConnection* connection);
+	void rpc_sync_tick(BSockConnection* connection, ChannelType channel);
+	void rpc_node_state();
+	void rpc_input(BSockConnection* connection);
+	void rpc_ping(BSockConnection* connection);
+	void rpc_user_rpc(BSockConnection* connection, ChannelType channel, const std::string& name, const std::vector<boost::any>& args);
+	void rpc_forward(BSockReader* reader);
     void rpc_match_destroy_all();
     void rpc_player_list_all();
 
 	// RPC response functions    
     void read_rpcs(BSockSocket* socket);
+    void read_rpcs(BSockConnection* connection);
+    void read_rpc(BSockReader* reader);
     void on_match_info(BSockReader* reader);
     void on_match_destroy(BSockReader* reader);
     void on_player_join(BSockReader* reader);
@@ -167,8 +180,10 @@ private:
 	void on_user_rpc(BSockReader* reader);
 
 	void update_stats();
+	void flush_sockets();
     
     CoreEngine* engine_;
+	BSockSnapshotCodec snapshot_codec_;
 
 	// Various recordkeeping structures
     float accumulator_;
@@ -181,18 +196,35 @@ private:
 	uint32_t tx_bytes_;
 	uint32_t rx_bytes_;
 	float stats_elapsed_time_;
-    
-	// Sockets used by the network engine
-	std::vector<BSockSocketPtr> stream_;
+
+	// Packet buffers and the event reactor shared by all the sockets.  
+	// These must be declared before the sockets, so that they are 
+	// destroyed after them.
+	BSockPacketPool packet_pool_;
+	BSockReactor reactor_;
+    
+	// Sockets used by the network engine.  The datagram socket carries all
+	// the traffic between the host and the clients; the multicast socket
+	// is only used to find matches.
     BSockSocketPtr multicast_;
 	BSockSocketPtr datagram_;
-    BSockServerSocketPtr server_;
+
+	// Connections over the datagram socket.  The host has one for each 
+	// player slot (its own slot is always empty), and clients have one, 
+	// to the host.
+	std::vector<BSockConnectionPtr> connection_;
+
+	// Connections that have been closed, but still have reliable messages
+	// (e.g., the leave message) that the peer hasn't acknowledged.  They
+	// are kept until the peer acknowledges them or times out.
+	std::vector<BSockConnectionPtr> closing_;
 
 	// This map holds all the network monitors for objects
 	// displayed on the screen
 	std::map<uint32_t, BSockNetworkMonitorPtr> network_monitor_;
 
 	friend class BSockSocket;
+	friend class BSockConnection;
 };
 
 }
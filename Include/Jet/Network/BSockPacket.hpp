@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Network/BSockTypes.hpp>
+
+namespace Jet {
+
+//! A fixed-size packet buffer.  Packets are linked into queues through the
+//! next pointer, so queuing a packet never allocates memory.
+//! @class BSockPacket
+//! @brief Fixed-size packet buffer.
+class BSockPacket {
+public:
+    //! Pointer to the next packet in the queue
+    BSockPacket* next;
+
+    //! Length of the packet, including the header
+    size_t size;
+
+    //! Number of bytes sent or received so far
+    size_t offset;
+
+    //! Address that a datagram came from, or is sent to
+    sockaddr_in address;
+
+    //! Channel that a message came in on, for messages received by a
+    //! connection
+    ChannelType channel;
+
+    //! Time at which the network simulator lets the packet go
+    double time;
+
+    //! Packet data, starting with the header
+    char data[JET_MAX_PACKET_SIZE];
+};
+
+//! Intrusive FIFO queue of packets.  The queue doesn't own the packets;
+//! they are returned to the pool by whoever pops them.
+//! @class BSockPacketQueue
+//! @brief Intrusive FIFO queue of packets.
+class BSockPacketQueue {
+public:
+    //! Creates an empty queue.
+    inline BSockPacketQueue() :
+        head_(0),
+        tail_(0),
+        size_(0) {
+    }
+
+    //! Returns the packet at the front of the queue, or null if the queue 
+    //! is empty.
+    inline BSockPacket* front() const {
+        return head_;
+    }
+
+    //! Returns true if the queue is empty.
+    inline bool empty() const {
+        return !head_;
+    }
+
+    //! Returns the number of packets in the queue.
+    inline size_t size() const {
+        return size_;
+    }
+
+    //! Adds a packet to the back of the queue.
+    inline void push(BSockPacket* packet) {
+        packet->next = 0;
+        if (tail_) {
+            tail_->next = packet;
+        } else {
+            head_ = packet;
+        }
+        tail_ = packet;
+        size_++;
+    }
+
+    //! Removes the packet at the front of the queue, and returns it.
+    //! Returns null if the queue is empty.
+    inline BSockPacket* pop() {
+        BSockPacket* packet = head_;
+        if (packet) {
+            head_ = packet->next;
+            if (!head_) {
+                tail_ = 0;
+            }
+            packet->next = 0;
+            size_--;
+        }
+        return packet;
+    }
+
+private:
+    BSockPacket* head_;
+    BSockPacket* tail_;
+    size_t size_;
+};
+
+//! Pool of packet buffers shared by all the sockets of a network.  Once 
+//! the pool has grown to the number of packets in flight, sending and 
+//! receiving packets doesn't allocate any memory.
+//! @class BSockPacketPool
+//! @brief Pool of packet buffers.
+class BSockPacketPool {
+public:
+    //! Creates an empty pool.
+    BSockPacketPool();
+
+    //! Frees all the packets in the pool.  All packets must be released
+    //! first.
+    ~BSockPacketPool();
+
+    //! Returns the number of packets that the pool has allocated.
+    inline size_t allocated() const {
+        return allocated_;
+    }
+
+    //! Returns an empty packet, allocating a new one if the pool is empty.
+    BSockPacket* acquire();
+
+    //! Returns a packet to the pool.
+    void release(BSockPacket* packet);
+
+    //! Returns all the packets in the queue to the pool.
+    void release(BSockPacketQueue& queue);
+
+private:
+    BSockPacketQueue free_;
+    size_t allocated_;
+};
+
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Network/BSockTypes.hpp>
+#include <vector>
+
+// Use epoll where it's available.  Define JET_NO_EPOLL to use the portable
+// select()-based reactor instead.
+#if defined(__linux__) && !defined(JET_NO_EPOLL)
+#define JET_EPOLL
+#endif
+
+#ifdef JET_EPOLL
+#include <sys/epoll.h>
+#endif
+
+namespace Jet {
+
+//! Waits for I/O events on the sockets of a network.  Each socket registers
+//! itself when it is created.  poll() marks the sockets that can be read or
+//! written, and returns the list of ready sockets, so that the network only
+//! touches sockets with pending I/O.  Sockets ask for write events only
+//! while they have data queued.
+//! @class BSockReactor
+//! @brief Waits for I/O events on sockets.
+class BSockReactor {
+public:
+    //! Creates a new reactor.
+    BSockReactor();
+
+    //! Destroys the reactor.  All sockets must be removed first.
+    ~BSockReactor();
+
+    //! Registers a socket for read events.
+    void add(BSockSocket* socket);
+
+    //! Unregisters a socket.  If the socket is in the ready list, its entry
+    //! is set to null.
+    void remove(BSockSocket* socket);
+
+    //! Updates the events that the socket is waiting for, after the socket
+    //! has queued or flushed data.
+    void update(BSockSocket* socket);
+
+    //! Checks for events without blocking.  Returns the number of ready 
+    //! sockets.
+    size_t poll();
+
+    //! Returns a socket that was ready during the last poll, or null if
+    //! the socket has been destroyed since.
+    inline BSockSocket* ready(size_t index) const {
+        return ready_[index];
+    }
+
+private:
+    bool write_interest(BSockSocket* socket) const;
+
+#ifdef JET_EPOLL
+    int epoll_;
+    std::vector<epoll_event> event_;
+#else
+    std::vector<BSockSocket*> socket_;
+#endif
+    std::vector<BSockSocket*> ready_;
+};
+
+}
@@ -23,58 +23,113 @@
 
 #include <Jet/Network/BSockTypes.hpp>
 #include <Jet/Network/BSockSocket.hpp>
-#include <Jet/Object.hpp>
+#include <Jet/Network/BSockConnection.hpp>
 
 namespace Jet {
 
-//! Reads data from a socket synchronously.
+//! Reads data from a socket synchronously.  Each reader takes the next 
+//! complete packet from the socket, and is meant to be created on the 
+//! stack; if no packet has been received, ok() returns false.  The packet
+//! goes back to the pool when the reader is destroyed.  Reads never throw: 
+//! if a field
+//! runs past the end of the packet, the reader returns zero (or an empty
+//! string) for it and every field after it, and ok() returns false.  Check
+//! ok() before acting on what was read.
 //! @class BSockReader
 //! @brief Reads data from a socket synchronously.
-class BSockReader : public Object {
+class BSockReader {
 public:
-    //! Creates a new socket reader and locks the buffer for reading.
+    //! Creates a new socket reader, and takes the next packet from the
+    //! socket.
     BSockReader(BSockSocket* socket);
+
+    //! Creates a new reader, and takes the next message that the 
+    //! connection has delivered.
+    BSockReader(BSockConnection* connection);
     
     //! Destructor
     ~BSockReader();
 
-	//! Reads a vector from the socket.  Throws an exception if data is not
-	//! available.  Does not block.
+    //! Returns false if there was no packet, or if a read went past the
+    //! end of the packet.
+    inline bool ok() const {
+        return !underflow_;
+    }
+
+    //! Returns the number of bytes left in the packet.
+    inline size_t remaining() const {
+        return packet_ ? packet_->size - bytes_read_ : 0;
+    }
+
+	//! Reads a vector from the socket.  Does not block.
 	Vector vector();
 
-	//! Reads a quaternion from the socket.  Throws an exception if data is 
-	//! not available.  Does not block.
+	//! Reads a quaternion from the socket.  Does not block.
 	Quaternion quaternion();
 
-    //! Reads floating-point data from the socket.  Throws an exception if 
-	//! data is not available.  Does not block.
+    //! Reads floating-point data from the socket.  Does not block.
     float real();
     
-    //! Reads integer data from the socket.  Throws an exception if data is 
-	//! not available.  Does not block.
+    //! Reads integer data from the socket.  Does not block.
     int integer();
 
 	//! Reads a byte from the socket.
 	uint8_t byte();
+
+	//! Reads a bit field written by BSockWriter::bits().
+	//! @param count the number of bits to read (at most 32)
+	uint32_t bits(size_t count);
+
+	//! Reads a variable-length integer written by BSockWriter::varint().
+	//! @param group the number of bits in each group
+	uint32_t varint(size_t group=7);
+
+	//! Reads an integer written by BSockWriter::ranged().
+	int32_t ranged(int32_t min, int32_t max);
+
+	//! Reads a number written by BSockWriter::quantized().
+	float quantized(float min, float max, size_t count);
+
+	//! Reads a single bit.
+	bool boolean();
     
-    //! Reads a string from the socket.  Throws an exception if data is not
-    //! available.  Does not block.
+    //! Reads a string from the socket.  Does not block.
     std::string string();
 
-	//! Returns the underlying socket type
-	inline SocketType socket_type() {
-		return socket_->type_;
+	//! Reads raw bytes.  Returns a pointer into the packet, or null if the
+	//! packet is too short.
+	const char* bytes(size_t length);
+
+	//! Returns the address that the packet came from.
+	Address address() const;
+
+	//! Starts reading the packet again from the beginning.
+	void rewind();
+
+	//! Returns the channel that the message came in on
+	inline ChannelType channel() const {
+		return packet_ ? packet_->channel : CT_UNRELIABLE;
 	}
     
     //! Returns the socket
     inline BSockSocket* socket() const {
         return socket_.get();
     }
+
+    //! Returns the connection, or null if reading straight from a socket
+    inline BSockConnection* connection() const {
+        return connection_.get();
+    }
     
 private:
+    const char* consume(size_t bytes);
+
     BSockSocketPtr socket_;
+    BSockConnectionPtr connection_;
+    BSockPacket* packet_;
     size_t bytes_read_;
-    std::vector<char> in_;
+    size_t bit_offset_;
+    bool underflow_;
 
 	friend class BSockWriter;
 };
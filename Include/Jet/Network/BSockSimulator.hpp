@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Network/BSockTypes.hpp>
+#include <Jet/Network/BSockPacket.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+
+namespace Jet {
+
+//! Simulates a bad network on a datagram socket, so that netcode can be 
+//! tested on one machine.  Packets going each way are dropped, duplicated,
+//! delayed by a fixed latency plus random jitter (which also reorders 
+//! them), and held back to stay under a bandwidth cap.  The simulator is 
+//! set up with the network_sim_* options, and is off when they are all 0.
+//! The conditions apply separately to each direction, so a packet between
+//! two simulated sockets is delayed (and may be lost) twice.
+//! Random numbers come from a generator seeded with network_sim_seed, and
+//! time only moves when the network advances the socket's clock, so the 
+//! same seed and the same frames always give the same packets.
+//! @class BSockSimulator
+//! @brief Simulates latency, jitter, loss, duplication and bandwidth caps.
+class BSockSimulator {
+public:
+    //! Creates a new simulator.  Packets are copied and released using the
+    //! given pool.
+    BSockSimulator(CoreEngine* engine, BSockPacketPool* pool);
+
+    //! Destructor.  Releases the packets that are still being held.
+    ~BSockSimulator();
+
+    //! Returns true if any network conditions are being simulated.
+    inline bool enabled() const {
+        return enabled_;
+    }
+
+    //! Advances the clock, and reloads the options.
+    void update(float delta);
+
+    //! Takes a packet that is about to be sent.
+    void send(BSockPacket* packet);
+
+    //! Takes a packet that was just received.
+    void receive(BSockPacket* packet);
+
+    //! Returns the next outgoing packet that is due to be sent, or null.
+    BSockPacket* sent();
+
+    //! Returns the next incoming packet that is due to arrive, or null.
+    BSockPacket* received();
+
+    //! Lets all the held outgoing packets go right away (e.g., when the
+    //! socket is closed).
+    void flush();
+
+private:
+    // Packets going one way, sorted by the time they are let go, and the 
+    // time at which the simulated link is free to carry another packet
+    struct Link {
+        BSockPacket* head;
+        BSockPacket* tail;
+        double free;
+    };
+
+    void transmit(Link& link, BSockPacket* packet, size_t size);
+    void delay(Link& link, BSockPacket* packet, size_t size);
+    BSockPacket* release(Link& link);
+    float random();
+
+    CoreEngine* engine_;
+    BSockPacketPool* pool_;
+    Link out_;
+    Link in_;
+    double time_;
+    uint32_t random_;
+    float latency_;
+    float jitter_;
+    float loss_;
+    float duplicate_;
+    float bandwidth_;
+    bool enabled_;
+};
+
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Network/BSockTypes.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Types/Vector.hpp>
+#include <Jet/Types/Quaternion.hpp>
+#include <vector>
+#include <map>
+
+// Number of snapshots kept for delta compression.  A snapshot can only be
+// used as a baseline if it is less than this many snapshots old.
+#define JET_SNAPSHOT_HISTORY 32
+
+namespace Jet {
+
+//! Quantized state of one node.  Positions and velocities are stored as
+//! integer multiples of the network precision, and the rotation is stored
+//! in smallest-three form, so that the host and the clients rebuild 
+//! exactly the same values from a delta.
+//! @class BSockNodeState
+//! @brief Quantized state of one node.
+class BSockNodeState {
+public:
+    uint32_t hash;
+    uint32_t state_hash;
+    int32_t position[3];
+    uint32_t rotation;
+    int32_t linear_velocity[3];
+    int32_t angular_velocity[3];
+};
+
+//! The state of all the nodes sent by the host on one tick, sorted by 
+//! node hash.
+//! @class BSockSnapshot
+//! @brief Node state for one tick.
+class BSockSnapshot {
+public:
+    BSockSnapshot() :
+        sequence(0),
+        tick(0) {
+    }
+
+    uint32_t sequence;
+    uint32_t tick;
+    std::vector<BSockNodeState> node;
+};
+
+//! Records which snapshots a client has received: the newest sequence 
+//! number, plus one bit for each of the 32 sequence numbers before it.
+//! @class BSockSnapshotAck
+//! @brief Snapshot acknowledgement.
+class BSockSnapshotAck {
+public:
+    BSockSnapshotAck() :
+        sequence(0),
+        mask(0) {
+    }
+
+    uint32_t sequence;
+    uint32_t mask;
+};
+
+//! Encodes node state snapshots for the network.  Each snapshot is sent as
+//! a delta from the newest snapshot that every client has acknowledged.
+//! Fields that haven't changed are left out, and positions are predicted
+//! from the baseline's velocity, so only the error is sent.  Positions and
+//! velocities are quantized to "network_position_precision" and 
+//! "network_velocity_precision", and rotations are sent in smallest-three
+//! form with "network_rotation_bits" bits per component.  These options 
+//! must be the same on every machine.
+//! @class BSockSnapshotCodec
+//! @brief Delta-compresses node state snapshots.
+class BSockSnapshotCodec {
+public:
+    //! Creates a new snapshot codec.
+    BSockSnapshotCodec(CoreEngine* engine);
+
+    //! Returns the snapshot that is being built, or that was just read.
+    inline const BSockSnapshot& snapshot() const {
+        return current_;
+    }
+
+    //! Returns the snapshots that this client has received.
+    inline const BSockSnapshotAck& ack() const {
+        return ack_;
+    }
+
+    //! Clears all snapshot history and acknowledgements.  Called when the
+    //! network state changes.
+    void reset();
+
+    //! Starts building a new snapshot.
+    void clear();
+
+    //! Adds a node to the snapshot.  Nodes must be added in order of 
+    //! increasing hash.
+    void node(uint32_t hash, uint32_t state_hash, const Vector& position, const Quaternion& rotation, const Vector& linear_velocity, const Vector& angular_velocity);
+
+    //! Writes the snapshot that was built.  The baseline is the newest
+    //! snapshot that all of the given peers have acknowledged.
+    //! @param writer the packet writer
+    //! @param tick the tick that the snapshot was taken on
+    //! @param peer the UUIDs of the players that receive the snapshot
+    void write(BSockWriter* writer, uint32_t tick, const std::vector<uint32_t>& peer);
+
+    //! Reads a snapshot.  Returns false if the snapshot can't be decoded,
+    //! because its baseline was never received or the packet is truncated.
+    //! @param reader the packet reader
+    //! @param tick the tick that the snapshot was taken on
+    bool read(BSockReader* reader, uint32_t tick);
+
+    //! Records the snapshots that a peer has received.
+    //! @param peer the UUID of the player
+    //! @param ack the snapshots that the player has received
+    void ack(uint32_t peer, const BSockSnapshotAck& ack);
+
+    //! Returns the position stored in a quantized node state.
+    Vector position(const BSockNodeState& state) const;
+
+    //! Returns the rotation stored in a quantized node state.
+    Quaternion rotation(const BSockNodeState& state) const;
+
+    //! Returns the linear velocity stored in a quantized node state.
+    Vector linear_velocity(const BSockNodeState& state) const;
+
+    //! Returns the angular velocity stored in a quantized node state.
+    Vector angular_velocity(const BSockNodeState& state) const;
+
+private:
+    void update_options();
+    void write_node(BSockWriter* writer, const BSockNodeState& base, const BSockNodeState& state, uint32_t ticks);
+    void read_node(BSockReader* reader, const BSockNodeState& base, BSockNodeState& state, uint32_t ticks);
+    const BSockSnapshot* baseline(const std::vector<uint32_t>& peer) const;
+    int32_t predict(int32_t position, int32_t velocity, uint32_t ticks) const;
+    uint32_t pack_rotation(const Quaternion& rotation) const;
+    Quaternion unpack_rotation(uint32_t rotation) const;
+    static bool acked(const BSockSnapshotAck& ack, uint32_t sequence);
+    
+    CoreEngine* engine_;
+    float position_precision_;
+    float velocity_precision_;
+    size_t rotation_bits_;
+    int64_t velocity_scale_;
+    uint32_t sequence_;
+    BSockSnapshot current_;
+    BSockSnapshot history_[JET_SNAPSHOT_HISTORY];
+    BSockSnapshotAck ack_;
+    std::map<uint32_t, BSockSnapshotAck> peer_ack_;
+};
+
+}
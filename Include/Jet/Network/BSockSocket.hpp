@@ -22,36 +22,31 @@
 #pragma once
 
 #include <Jet/Network/BSockTypes.hpp>
+#include <Jet/Network/BSockPacket.hpp>
+#include <Jet/Network/BSockReactor.hpp>
+#include <Jet/Network/BSockSimulator.hpp>
 #include <Jet/Core/CoreEngine.hpp>
 #include <Jet/Types/Address.hpp>
 #include <Jet/Object.hpp>
-#include <vector>
-#include <queue>
 
 namespace Jet {
 
-//! Reads and writes data to a multicast, unicast TCP, or unicast UDP socket.
+//! Reads and writes data to a multicast or unicast UDP socket.
 //! @class BSockSocket
-//! @brief Reads and writes data to a multicast, unicast TCP, or unicast UDP
-//! socket.  For TCP sockets, data is read as a packet even though the
-//! underlying protocol is stream-oriented.
+//! @brief Reads and writes data to a multicast or unicast UDP socket.  
+//! Reliable messages go through a BSockConnection, which sends them as 
+//! datagrams on one of these sockets.  Packets are stored in buffers
+//! from the network's packet pool, so once the pool has warmed up, sending
+//! and receiving packets doesn't allocate memory.  Sockets only make read
+//! and write calls after the network's reactor has reported them ready.
+//! Each datagram carries its own address, so one UDP socket can exchange
+//! packets with many peers.  Datagrams pass through a BSockSimulator in
+//! both directions, which can add lag and loss for testing.
 class BSockSocket : public Object {
 public:
     //! Destructor
     ~BSockSocket();
     
-	//! Creates a unicast TCP socket connecting to the given port and IP
-    //! address.
-    //! @param ip the destination address
-    //! @param port the destination port
-    static BSockSocket* client(CoreEngine* engine, const Address& addres);
-    
-    //! Creates a unicast TCP socket serving on the given port and IP
-    //! address.
-    //! @param ip the destination address
-    //! @param port the destination port
-    static BSockSocket* server(CoreEngine* engine, const Address& address);
-    
     //! Creates a multicast UDP socket on the given port and using the
     //! specified multicast IP.  Returns immediately if the port is free,
     //! or throws an std::runtime_error if the operation fails.
@@ -62,58 +57,65 @@ public:
     //! Creates a unicast UDP socket on the given port.  Returns immediately
     //! if the port is free, or throws an std::runtime_error if the operation
     //! fails
-    //! @param ip the group ip
-    //! @param port the group port
-    static BSockSocket* datagram(CoreEngine* engine, const Address& address);
+    //! @param address the local port
+    //! @param remote the address that packets are sent to
+    static BSockSocket* datagram(CoreEngine* engine, const Address& address, const Address& remote=Address());
         
-    //! Returns a packet writer for this socket, or null if no data is
-    //! available.
-    BSockWriter* writer();
-    
-    //! Returns a socket reader for this socket, or null if no data is
-    //! available.
-    BSockReader* reader();
-    
-    //! Receives data if possible
+    //! Receives data if the socket is readable
     void poll_read();
     
-    //! Send data if possible
+    //! Sends queued data if the socket is writable.  Datagrams are queued
+    //! until a batch fills up, so the network calls this at the end of 
+    //! each frame to flush the batch.
     void poll_write();
+
+    //! Advances the network simulator's clock.  The network calls this 
+    //! once per frame.
+    void update(float delta);
     
     //! Returns the port
     inline const Address& address() const {
         return address_;
 	}
+
+    //! Returns the socket type
+    inline SocketType type() const {
+        return type_;
+    }
    
 private:
-    BSockSocket(CoreEngine* engine, const sockaddr_in& local, const sockaddr_in& remote, SocketType type, int socket=INVALID_SOCKET);
+    BSockSocket(CoreEngine* engine, const sockaddr_in& local, const sockaddr_in& remote, SocketType type);
     
     void init_multicast();
-    void init_client();
-    void init_server();
     void init_datagram();
     
-    void accept();
-    void connect();
-    void read_stream();
     void read_datagram();
-    void write_stream();
     void write_datagram();
+
+    BSockPacket* read_packet();
+    BSockPacket* write_packet();
+    void send(BSockPacket* packet);
+    void release(BSockPacket* packet);
     
 	CoreEngine* engine_;
+    BSockPacketPool* pool_;
+    BSockReactor* reactor_;
+    BSockSimulator simulator_;
     int socket_;
     sockaddr_in local_;
     sockaddr_in remote_;
-    std::vector<char> in_;
-    std::queue<std::vector<char> > out_;
+    BSockPacketQueue received_;
+    BSockPacketQueue out_;
     SocketType type_;
-    size_t write_bytes_;
-    size_t read_bytes_;
+    size_t batch_;
 	Address address_;
+    bool readable_;
+    bool writable_;
+    bool write_interest_;
     
     friend class BSockReader;
     friend class BSockWriter;
-    friend class BSockServerSocket;
+    friend class BSockReactor;
 };
 
 }
@@ -53,7 +53,19 @@ inline int socket_errcode() {
 #define socket_errcode() errno
 #define closesocket close
 #endif
-#undef ST_CLIENT
+
+// Size of the pooled packet buffers, and so the largest packet that can be
+// sent or received on any socket.  This is bigger than an Ethernet MTU so
+// that a full state snapshot of a big scene still fits in one packet; the
+// IP layer fragments the datagrams that need it.
+#define JET_MAX_PACKET_SIZE 4096
+
+// Largest number of datagrams that a socket sends or receives with one 
+// system call.  The network_batch_size option can lower this.
+#define JET_DATAGRAM_BATCH 32
+
+// Number of channels that a connection has, including the unreliable one
+#define JET_CHANNEL_COUNT 3
 
 namespace Jet {
 
@@ -62,24 +74,21 @@ namespace Jet {
 	class BSockNetworkMonitor;
     class BSockNetwork;
     class BSockShader;
-    class BSockServerSocket;
     class BSockSocket;
+    class BSockConnection;
     class BSockWriter;
     class BSockReader;
+    class BSockPacket;
+    class BSockPacketPool;
     
 	typedef boost::intrusive_ptr<BSockNetworkMonitor> BSockNetworkMonitorPtr;
 	typedef boost::intrusive_ptr<BSockNetwork> BSockNetworkPtr;
-    typedef boost::intrusive_ptr<BSockServerSocket> BSockServerSocketPtr;
     typedef boost::intrusive_ptr<BSockSocket> BSockSocketPtr;
-    typedef boost::intrusive_ptr<BSockReader> BSockReaderPtr;
-    typedef boost::intrusive_ptr<BSockWriter> BSockWriterPtr;
+    typedef boost::intrusive_ptr<BSockConnection> BSockConnectionPtr;
 
     enum SocketType { 
-		ST_SERVER, 
-		ST_CLIENT, 
 		ST_MULTICAST, 
-		ST_DATAGRAM, 
-		ST_STREAM 
+		ST_DATAGRAM
 	};
 
 	enum PacketType { 
@@ -95,6 +104,16 @@ namespace Jet {
 		PT_USER_RPC,
 	};
 
+	//! Channels that a connection sends messages on.  Messages on the 
+	//! unreliable channel may be lost.  Messages on the other channels are
+	//! resent until they arrive, and are delivered in the order they were 
+	//! sent; each of those channels is ordered separately.
+	enum ChannelType {
+		CT_UNRELIABLE,
+		CT_SYSTEM,
+		CT_RPC,
+	};
+
 	enum DataType {
 		DT_NUMBER,
 		DT_STRING,
@@ -23,21 +23,62 @@
 
 #include <Jet/Network/BSockTypes.hpp>
 #include <Jet/Network/BSockSocket.hpp>
-#include <Jet/Object.hpp>
+#include <Jet/Network/BSockConnection.hpp>
 
 namespace Jet {
 
-//! Writes data to a socket synchronously.
+//! Writes data to a socket synchronously.  Each writer fills in one packet
+//! from the socket's packet pool, and is meant to be created on the stack:
+//!
+//!     BSockWriter writer(socket);
+//!     if (writer.ok()) {
+//!         writer.integer(PT_PING);
+//!     }
+//!
+//! A writer can also write a message to a connection, on one of the 
+//! connection's channels:
+//!
+//!     BSockWriter writer(connection, CT_SYSTEM);
+//!     if (writer.ok()) {
+//!         writer.integer(PT_PING);
+//!     }
+//!
+//! Fields can be whole bytes (integer(), real(), 
+//! etc.) or bit fields (bits(), varint(), boolean(), etc.); consecutive bit
+//! fields are packed together.  If the packet runs out of space, the rest 
+//! of the fields are ignored, ok() returns false, and the packet is dropped
+//! instead of sent.
 //! @class BSockWriter
 //! @brief Writes data to a socket synchronously.
-class BSockWriter : public Object {
+class BSockWriter {
 public:
-    //! Creates a new socket writer, and locks the socket's buffer.
+    //! Creates a new socket writer, and takes a packet from the pool.  If
+    //! the socket can't send right now, ok() returns false.
     BSockWriter(BSockSocket* socket);
+
+    //! Creates a new socket writer for a datagram that is sent to the 
+    //! given address, instead of the socket's remote address.
+    BSockWriter(BSockSocket* socket, const Address& address);
+
+    //! Creates a new writer for a message on the given channel of a 
+    //! connection.  If the connection's unreliable queue is full, ok() 
+    //! returns false.
+    BSockWriter(BSockConnection* connection, ChannelType channel);
     
-    //! Destructor
+    //! Destructor.  Sends the packet.
     ~BSockWriter();
 
+    //! Returns false if the socket can't send, or if the packet ran out of
+    //! space.
+    inline bool ok() const {
+        return !overflow_;
+    }
+
+    //! Returns the number of bytes written so far, including the header.
+    inline size_t size() const {
+        return bytes_written_;
+    }
+
 	//! Writes a vector to the socket.  Does not block.
 	void vector(const Vector& vector);
 
@@ -52,21 +93,65 @@ public:
 
 	//! Writes a byte to the socket
 	void byte(uint8_t byte);
+
+	//! Writes the low bits of an integer to the socket.  Consecutive bit
+	//! fields are packed together; the next non-bit field starts on a new 
+	//! byte.
+	//! @param value the bits to write
+	//! @param count the number of bits to write (at most 32)
+	void bits(uint32_t value, size_t count);
+
+	//! Writes a variable-length integer.  The integer is split into groups 
+	//! of bits, and each group is followed by a bit that is set if more 
+	//! groups follow, so small values take fewer bits.
+	//! @param value the integer to write
+	//! @param group the number of bits in each group
+	void varint(uint32_t value, size_t group=7);
+
+	//! Writes an integer in the range [min, max] using as few bits as 
+	//! possible.  Values outside the range are clamped.
+	void ranged(int32_t value, int32_t min, int32_t max);
+
+	//! Writes a number in the range [min, max], quantized to the given 
+	//! number of bits (at most 32).  Values outside the range are clamped.
+	void quantized(float value, float min, float max, size_t count);
+
+	//! Writes a single bit.
+	void boolean(bool value);
     
     //! Writes a string to the socket
     void string(const std::string& string);
 
+	//! Writes raw bytes.
+	void bytes(const char* data, size_t length);
+
 	//! Writes the whole packet stored in the given reader.
 	void packet(BSockReader* reader);
 
+	//! Writes everything that the given writer has written so far.
+	void packet(BSockWriter* writer);
+
     //! Returns the socket
     inline BSockSocket* socket() const {
         return socket_.get();
     }
+
+    //! Returns the connection, or null if writing straight to a socket
+    inline BSockConnection* connection() const {
+        return connection_.get();
+    }
     
 private:
+    char* reserve(size_t bytes);
+
     BSockSocketPtr socket_;
+    BSockConnectionPtr connection_;
+    ChannelType channel_;
+    BSockPacket* packet_;
+    size_t capacity_;
     size_t bytes_written_;
+    size_t bit_offset_;
+    bool overflow_;
 };
 
 }
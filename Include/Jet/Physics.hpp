@@ -23,6 +23,8 @@
 
 #include <Jet/Types.hpp>
 #include <Jet/Object.hpp>
+#include <Jet/Types/PhysicsQuery.hpp>
+#include <vector>
 
 namespace Jet {
 
@@ -36,6 +38,16 @@ public:
     
     //! Creates a new rigid body for the given node.
     virtual RigidBody* rigid_body(Node* parent)=0;
+
+    //! Runs a batch of raycasts, sphere sweeps and overlap tests against
+    //! the rigid bodies in the world.  Results are in the same order as 
+    //! the queries, and each result holds the index of its query.  There
+    //! is one result for each raycast and sweep, and one result for each
+    //! body that an overlap test finds (or a single miss if it finds 
+    //! none).  Queries only see the world as of the last physics step.
+    //! @param query the queries to run
+    //! @param hit receives the results
+    virtual void query(const std::vector<PhysicsQuery>& query, std::vector<PhysicsHit>& hit)=0;
     
 };
 
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Physics/BulletTypes.hpp>
+#include <Jet/Core/CoreTypes.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+#include <memory>
+
+namespace Jet {
+
+//! Collision dispatcher that can run the narrowphase on the engine worker
+//! pool.  Algorithms are looked up for each overlapping pair on the main
+//! thread, and then the pairs are processed in parallel.  Manifold and 
+//! algorithm allocation is serialized with a lock.  Set the option
+//! "physics_parallel_narrowphase" to enable the parallel path.  If
+//! "physics_deterministic" is set, the manifolds are sorted by body after
+//! each dispatch, so that the solver sees them in the same order no matter
+//! which thread created them.
+//! @class BulletCollisionDispatcher
+//! @brief Parallel collision dispatcher.
+class BulletCollisionDispatcher : public btCollisionDispatcher {
+public:
+    //! Creates a new dispatcher.  The convex-convex algorithm in the 
+    //! collision configuration is replaced with one that is safe to run on
+    //! several threads at once.  The collision configuration must be 
+    //! created with a custom algorithm size of at least algorithm_size().
+    BulletCollisionDispatcher(CoreEngine* engine, btCollisionConfiguration* config);
+
+    //! Destructor.
+    virtual ~BulletCollisionDispatcher();
+
+    //! Returns the size of the largest collision algorithm used by this
+    //! dispatcher.
+    static size_t algorithm_size();
+
+    virtual btCollisionAlgorithm* findAlgorithm(btCollisionObject* body0, btCollisionObject* body1, btPersistentManifold* manifold = 0);
+    virtual btPersistentManifold* getNewManifold(void* body0, void* body1);
+    virtual void releaseManifold(btPersistentManifold* manifold);
+    virtual void* allocateCollisionAlgorithm(int size);
+    virtual void freeCollisionAlgorithm(void* ptr);
+    virtual void dispatchAllCollisionPairs(btOverlappingPairCache* pairs, const btDispatcherInfo& info, btDispatcher* dispatcher);
+
+private:
+    class ConvexCreateFunc;
+    void process_pairs(size_t begin, size_t end);
+    void sort_manifolds();
+
+    CoreEngine* engine_;
+    std::auto_ptr<ConvexCreateFunc> convex_create_func_;
+    std::vector<btBroadphasePair*> pair_;
+    const btDispatcherInfo* info_;
+    boost::recursive_mutex mutex_;
+};
+
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Physics/BulletTypes.hpp>
+#include <Jet/Core/CoreTypes.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
+#include <map>
+
+//! Size in bytes of the scratch stack given to each solver thread.
+#define JET_SOLVER_STACK_SIZE (1024*1024)
+
+namespace Jet {
+
+//! Constraint solver that can solve simulation islands on the engine 
+//! worker pool.  Islands don't share any bodies, so each one is solved by
+//! its own sequential impulse solver.  Set the option
+//! "physics_parallel_solver" to enable the parallel path.  If 
+//! "physics_deterministic" is set, the solver's random seed is reset for
+//! each island, so that the result doesn't depend on which thread solved
+//! which island.  Each thread has its own solver and its own scratch 
+//! stack.  Bullet's built-in profiler isn't thread-safe, so the parallel
+//! path needs a Bullet library built with BT_NO_PROFILE.
+//! @class BulletConstraintSolver
+//! @brief Parallel island solver.
+class BulletConstraintSolver : public btConstraintSolver {
+public:
+    //! Creates a new solver.
+    BulletConstraintSolver(CoreEngine* engine);
+
+    //! Destructor.
+    virtual ~BulletConstraintSolver();
+
+    virtual void prepareSolve(int bodies, int manifolds);
+    virtual btScalar solveGroup(btCollisionObject** bodies, int nbodies, btPersistentManifold** manifolds, int nmanifolds, btTypedConstraint** constraints, int nconstraints, const btContactSolverInfo& info, btIDebugDraw* debug_draw, btStackAlloc* stack_alloc, btDispatcher* dispatcher);
+    virtual void allSolved(const btContactSolverInfo& info, btIDebugDraw* debug_draw, btStackAlloc* stack_alloc);
+    virtual void reset();
+
+    //! Returns the number of groups solved during the last step.  Bullet
+    //! may batch several small islands into one group.
+    inline size_t groups() const {
+        return groups_;
+    }
+
+private:
+    class Island {
+    public:
+        std::vector<btCollisionObject*> body;
+        std::vector<btPersistentManifold*> manifold;
+        std::vector<btTypedConstraint*> constraint;
+    };
+
+    class ThreadSolver {
+    public:
+        ThreadSolver() : stack_alloc(JET_SOLVER_STACK_SIZE) {}
+
+        btSequentialImpulseConstraintSolver solver;
+        btStackAlloc stack_alloc;
+    };
+
+    ThreadSolver* thread_solver();
+    void solve_islands(size_t begin, size_t end);
+
+    CoreEngine* engine_;
+    boost::mutex mutex_;
+    std::map<boost::thread::id, ThreadSolver*> thread_solver_;
+    std::vector<Island> island_;
+    std::vector<size_t> order_;
+    size_t island_count_;
+    size_t groups_;
+    bool parallel_;
+    bool deterministic_;
+    const btContactSolverInfo* info_;
+    btIDebugDraw* debug_draw_;
+    btDispatcher* dispatcher_;
+};
+
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Physics/BulletTypes.hpp>
+#include <Jet/Core/CoreTypes.hpp>
+
+namespace Jet {
+
+//! Dynamics world that copies body transforms back to the scene in one
+//! pass after each step, instead of calling the motion state of each body.
+//! Only bodies that are awake are copied; sleeping and static bodies 
+//! haven't moved.  The world also times each stage of the step, so that 
+//! the physics system can report where the time goes.
+//! @class BulletDynamicsWorld
+//! @brief Dynamics world with bulk transform sync.
+class BulletDynamicsWorld : public btDiscreteDynamicsWorld {
+public:
+    //! Creates a new world.
+    BulletDynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* broadphase, btConstraintSolver* solver, btCollisionConfiguration* config);
+
+    //! Returns the time spent in the broadphase since the timers were last
+    //! reset, in microseconds.
+    inline unsigned long broadphase_time() const {
+        return broadphase_time_;
+    }
+
+    //! Returns the time spent in the narrowphase, in microseconds.
+    inline unsigned long narrowphase_time() const {
+        return narrowphase_time_;
+    }
+
+    //! Returns the time spent building islands and solving constraints, in
+    //! microseconds.
+    inline unsigned long solver_time() const {
+        return solver_time_;
+    }
+
+    //! Returns the time spent integrating and copying transforms back to
+    //! the scene, in microseconds.
+    inline unsigned long integration_time() const {
+        return integration_time_;
+    }
+
+    //! Resets the stage timers.
+    void reset_timers();
+
+    //! Counts the dynamic bodies that are awake and asleep.
+    void count_bodies(size_t& active, size_t& sleeping) const;
+
+    virtual void synchronizeMotionStates();
+    virtual void performDiscreteCollisionDetection();
+
+protected:
+    virtual void predictUnconstraintMotion(btScalar step);
+    virtual void integrateTransforms(btScalar step);
+    virtual void calculateSimulationIslands();
+    virtual void solveConstraints(btContactSolverInfo& info);
+
+private:
+    btClock clock_;
+    unsigned long broadphase_time_;
+    unsigned long narrowphase_time_;
+    unsigned long solver_time_;
+    unsigned long integration_time_;
+};
+
+}
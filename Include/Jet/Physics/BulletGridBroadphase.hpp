@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Physics/BulletTypes.hpp>
+#include <Jet/Types.hpp>
+#include <vector>
+#include <memory>
+
+namespace Jet {
+
+//! Broadphase that sorts objects into a uniform grid.  This works well for
+//! large numbers of similarly sized objects spread evenly over a large 
+//! volume (e.g., asteroid fields), where the grid is cheaper to maintain 
+//! than a dynamic AABB tree.  The grid is rebuilt every step, so there is
+//! no limit on the size of the world.  Objects that cover too many cells 
+//! are tested against every object instead.
+//! @class BulletGridBroadphase
+//! @brief Uniform grid broadphase.
+class BulletGridBroadphase : public btBroadphaseInterface {
+public:
+    //! Creates a new grid broadphase.
+    //! @param cell_size the width of a grid cell; this should be a bit 
+    //! larger than the typical object
+    BulletGridBroadphase(float cell_size);
+
+    //! Destructor.
+    virtual ~BulletGridBroadphase();
+
+    virtual btBroadphaseProxy* createProxy(const btVector3& min, const btVector3& max, int shape_type, void* user, short int group, short int mask, btDispatcher* dispatcher, void* multi_sap_proxy);
+    virtual void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
+    virtual void setAabb(btBroadphaseProxy* proxy, const btVector3& min, const btVector3& max, btDispatcher* dispatcher);
+    virtual void getAabb(btBroadphaseProxy* proxy, btVector3& min, btVector3& max) const;
+    virtual void rayTest(const btVector3& from, const btVector3& to, btBroadphaseRayCallback& callback, const btVector3& min = btVector3(0.0f, 0.0f, 0.0f), const btVector3& max = btVector3(0.0f, 0.0f, 0.0f));
+    virtual void aabbTest(const btVector3& min, const btVector3& max, btBroadphaseAabbCallback& callback);
+    virtual void calculateOverlappingPairs(btDispatcher* dispatcher);
+    virtual btOverlappingPairCache* getOverlappingPairCache();
+    virtual const btOverlappingPairCache* getOverlappingPairCache() const;
+    virtual void getBroadphaseAabb(btVector3& min, btVector3& max) const;
+    virtual void resetPool(btDispatcher* dispatcher) {}
+    virtual void printStats() {}
+
+private:
+    class Proxy : public btBroadphaseProxy {
+    public:
+        Proxy(const btVector3& min, const btVector3& max, void* user, short int group, short int mask, void* multi_sap_proxy) :
+            btBroadphaseProxy(min, max, user, group, mask, multi_sap_proxy),
+            index(0),
+            large(false) {
+        }
+
+        size_t index;
+        bool large;
+    };
+
+    class Cell {
+    public:
+        Cell(uint64_t key, Proxy* proxy) :
+            key(key),
+            proxy(proxy) {
+        }
+
+        bool operator<(const Cell& other) const {
+            return key < other.key;
+        }
+
+        uint64_t key;
+        Proxy* proxy;
+    };
+
+    bool cell_range(const btVector3& min, const btVector3& max, int* lo, int* hi) const;
+    uint64_t cell_key(const btVector3& point) const;
+    static uint64_t cell_key(int x, int y, int z);
+    static bool overlap(const btBroadphaseProxy* a, const btBroadphaseProxy* b);
+
+    float cell_size_;
+    std::auto_ptr<btHashedOverlappingPairCache> pair_cache_;
+    std::vector<Proxy*> proxy_;
+    std::vector<Cell> cell_;
+    std::vector<Proxy*> large_;
+    int next_uid_;
+};
+
+}
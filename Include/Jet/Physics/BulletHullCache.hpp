@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Physics/BulletTypes.hpp>
+#include <Jet/Core/CoreTypes.hpp>
+#include <Jet/Resources/Mesh.hpp>
+#include <vector>
+#include <deque>
+#include <map>
+
+namespace Jet {
+
+//! Caches the convex hulls built for collision shapes.  Hulls are keyed by
+//! the geometry hash of the mesh, so meshes with the same vertices and
+//! indices share a hull whatever their names are.  Hulls for meshes 
+//! loaded from files can be cooked ahead of time with the HullCook tool,
+//! which writes them next to the mesh file (e.g., "Ship.obj.hull"); the
+//! cache only reads these files, and never writes them.  Each hull is
+//! reduced to at most "physics_hull_max_vertices" points, and at most
+//! "physics_hull_cache_size" hulls are kept in memory.
+//! @class BulletHullCache
+//! @brief Convex hull cache.
+class BulletHullCache {
+public:
+    //! Creates a new hull cache.
+    BulletHullCache(CoreEngine* engine);
+
+    //! Returns the convex hull of the triangles in the given mesh.  The 
+    //! hull is built if it isn't in the cache yet.
+    //! @param mesh the mesh
+    //! @param point receives the hull vertices
+    void hull(Mesh* mesh, std::vector<btVector3>& point);
+
+    //! Builds the convex hull of a mesh and writes it to a hull file.  
+    //! Throws an exception if the file can't be written.
+    //! @param mesh the mesh
+    //! @param max_vertices the maximum number of points in the hull
+    //! @param path the path of the hull file
+    static void cook(Mesh* mesh, size_t max_vertices, const std::string& path);
+
+private:
+    class Hull {
+    public:
+        uint64_t geometry_hash;
+        size_t max_vertices;
+        std::vector<btVector3> point;
+    };
+
+    static void build_hull(Mesh* mesh, size_t max_vertices, std::vector<btVector3>& point);
+    static void reduce_hull(size_t max_vertices, std::vector<btVector3>& point);
+    static bool read_hull(const std::string& path, Hull& hull);
+    static bool write_hull(const std::string& path, const Hull& hull);
+    void insert(uint64_t key, const Hull& hull);
+
+    CoreEngine* engine_;
+    std::map<uint64_t, Hull> hull_;
+    std::deque<uint64_t> order_;
+};
+
+}
@@ -24,11 +24,19 @@
 #include <Jet/Physics/BulletTypes.hpp>
 #include <Jet/Physics/BulletGeometry.hpp>
 #include <Jet/Physics/BulletRigidBody.hpp>
+#include <Jet/Physics/BulletCollisionDispatcher.hpp>
+#include <Jet/Physics/BulletConstraintSolver.hpp>
+#include <Jet/Physics/BulletDynamicsWorld.hpp>
+#include <Jet/Physics/BulletGridBroadphase.hpp>
+#include <Jet/Physics/BulletHullCache.hpp>
+#include <Jet/Physics/BulletQuery.hpp>
 #include <Jet/Core/CoreEngine.hpp>
 #include <Jet/Core/CoreNode.hpp>
 #include <Jet/Physics.hpp>
 #include <vector>
 #include <memory>
+#include <map>
+#include <fstream>
 
 namespace Jet { 
 
@@ -48,31 +56,102 @@ public:
         return world_.get();
     }
 
+    //! Returns the convex hull cache
+    inline BulletHullCache* hull_cache() {
+        return &hull_cache_;
+    }
+
+    //! Queues a rigid body with pending shape or mass changes.  Queued 
+    //! bodies are flushed once per step, after the nodes are updated.
+    void queue_flush(BulletRigidBody* body);
+
+    //! Removes a rigid body from the flush queue.
+    void cancel_flush(BulletRigidBody* body);
+
 private:
+    enum ContactState { CS_BEGIN, CS_PERSIST, CS_END };
+
+    // Contact between a pair of nodes.  Nodes are held by strong
+    // references until the contact ends, so that collision callbacks can
+    // safely destroy either node.
+    class Contact {
+    public:
+        Contact() : touching(false), started(false) {}
+
+        CoreNodePtr node_a;
+        CoreNodePtr node_b;
+        Vector position_a;
+        Vector position_b;
+        bool touching;
+        bool started;
+    };
+
+    class ContactEvent {
+    public:
+        ContactEvent(const Contact& contact, ContactState state) :
+            node_a(contact.node_a),
+            node_b(contact.node_b),
+            position_a(contact.position_a),
+            position_b(contact.position_b),
+            state(state) {
+        }
+
+        CoreNodePtr node_a;
+        CoreNodePtr node_b;
+        Vector position_a;
+        Vector position_b;
+        ContactState state;
+    };
+
+    // Contacts are keyed by node serial numbers rather than addresses, so
+    // that the callbacks run in the same order on every run
+    typedef std::pair<uint32_t, uint32_t> ContactKey;
+
     inline BulletGeometry* geometry(const std::string& name) {
         return new BulletGeometry(engine_, name);
     }
     
     inline BulletRigidBody* rigid_body(Node* parent) {
-        return new BulletRigidBody(engine_, static_cast<CoreNode*>(parent));
+        return new BulletRigidBody(engine_, this, static_cast<CoreNode*>(parent));
+    }
+
+    inline void query(const std::vector<PhysicsQuery>& query, std::vector<PhysicsHit>& hit) {
+        query_.query(world_.get(), query, hit);
     }
     
-    void on_tick() {}
+    void on_tick();
     void on_init();
-    void on_update();
+    void on_update() {}
     void on_render() {}
     
 	static void on_pre_tick(btDynamicsWorld* world, btScalar step);
     static void on_post_tick(btDynamicsWorld* world, btScalar step);    
+    void gather_contacts();
+    void dispatch_contacts();
+    void flush_rigid_bodies();
+    void update_stats();
+    void init_broadphase();
+    
     CoreEngine* engine_;
     
     std::auto_ptr<btCollisionConfiguration> config_;
-    std::auto_ptr<btCollisionDispatcher> dispatcher_;
+    std::auto_ptr<BulletCollisionDispatcher> dispatcher_;
     std::auto_ptr<btBroadphaseInterface> broadphase_;
-    std::auto_ptr<btConstraintSolver> solver_;
-    std::auto_ptr<btDynamicsWorld> world_;
-
+    std::auto_ptr<BulletConstraintSolver> solver_;
+    std::auto_ptr<BulletDynamicsWorld> world_;
+    BulletHullCache hull_cache_;
+    BulletQuery query_;
+    std::map<ContactKey, Contact> contact_;
+    std::vector<ContactEvent> contact_event_;
+    std::vector<BulletRigidBody*> flush_body_;
     
+    // Profiling counters for the last tick
+    btClock clock_;
+    unsigned long contact_time_;
+    size_t manifold_count_;
+    size_t contact_count_;
+    std::string trace_path_;
+    std::ofstream trace_;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Physics/BulletTypes.hpp>
+#include <Jet/Core/CoreTypes.hpp>
+#include <Jet/Types/PhysicsQuery.hpp>
+#include <vector>
+
+namespace Jet {
+
+//! Runs batches of spatial queries against the physics world.  Candidate
+//! bodies are found with the broadphase on the calling thread, because 
+//! the broadphase keeps a shared stack for ray tests.  The exact tests
+//! against each candidate don't modify the world (unlike 
+//! btCollisionWorld::rayTest, which temporarily swaps the shape of 
+//! compound objects), so they can run on the worker pool.  Set the option
+//! "physics_parallel_queries" to run large batches in parallel.
+//! @class BulletQuery
+//! @brief Batched spatial queries.
+class BulletQuery {
+public:
+    //! Creates a new query runner.
+    BulletQuery(CoreEngine* engine);
+
+    //! Runs the given queries.  Overlap tests return one result for each
+    //! body they find; other queries return one result each.
+    void query(btCollisionWorld* world, const std::vector<PhysicsQuery>& query, std::vector<PhysicsHit>& hit);
+
+private:
+    void test_queries(size_t begin, size_t end);
+    void test(const PhysicsQuery& query, Node* node, const btCollisionShape* shape, const btTransform& transform, PhysicsHit& hit);
+
+    CoreEngine* engine_;
+    const std::vector<PhysicsQuery>* query_;
+    std::vector<std::vector<PhysicsHit> > result_;
+    std::vector<btCollisionObject*> candidate_;
+    std::vector<size_t> first_;
+};
+
+}
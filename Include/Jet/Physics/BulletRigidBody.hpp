@@ -40,7 +40,7 @@ namespace Jet {
 class BulletRigidBody : public RigidBody, public btMotionState {
 public:
     //! Creates a new rigid body with the given parent node.
-    BulletRigidBody(CoreEngine* engine, CoreNode* parent);
+    BulletRigidBody(CoreEngine* engine, BulletPhysics* physics, CoreNode* parent);
     
     //! Destructor
     virtual ~BulletRigidBody();
@@ -72,6 +72,21 @@ public:
         return mass_;
     }
 
+    //! Returns the moments of inertia per unit mass.
+    inline Vector inertia() const {
+        return inertia_;
+    }
+
+    //! Returns the radius of the sphere used for CCD.
+    inline float ccd_sphere_radius() const {
+        return body_->getCcdSweptSphereRadius();
+    }
+
+    //! Returns the motion threshold for CCD.
+    inline float ccd_motion_threshold() const {
+        return body_->getCcdMotionThreshold();
+    }
+
     //! Returns the rigid body shape.
     inline btCollisionShape* shape() const {
         return shape_.get();
@@ -107,14 +122,32 @@ public:
     //! @param v the torque to apply
     void apply_local_torque(const Vector& v);
     
-    //! Sets the mass of the rigid body.
+    //! Sets the mass of the rigid body.  The new mass takes effect before
+    //! the next physics step.
     void mass(float mass);
 
+    //! Sets the moments of inertia per unit mass.  The new inertia takes 
+    //! effect before the next physics step.
+    void inertia(const Vector& inertia);
+
 	//! Sets whether or not the rigid body is active.
 	void active(bool active);
+
+    //! Sets the radius of the sphere used for CCD.
+    void ccd_sphere_radius(float radius);
+
+    //! Sets the motion threshold for CCD.
+    void ccd_motion_threshold(float threshold);
     
     //! Updates the collision shapes attached to this rigid body
     void update_collision_shapes();
+
+    //! Marks the collision shape as out of date.
+    void invalidate_shape();
+
+    //! Applies pending shape and mass changes.  Called by the physics 
+    //! system once per step.
+    void flush();
     
     //! Sets the rigid body position
     void position(const Vector& position);
@@ -128,13 +161,23 @@ private:
     void attach_mesh_object(const btTransform& trans, CoreMeshObject* mesh_object);
     void attach_node(const btTransform& transform, CoreNode* node);
     void attach_collision_sphere(const btTransform& transform, CoreCollisionSphere* collision_shape);
+    void update_ccd();
+    void update_mass();
+    void queue_flush();
     
     CoreEngine* engine_;
+    BulletPhysics* physics_;
     CoreNode* parent_;
     float mass_;
+    Vector inertia_;
 	bool active_;
+    bool ccd_auto_;
+    bool shape_dirty_;
+    bool mass_dirty_;
+    bool queued_;
 
     std::vector<boost::shared_ptr<btCollisionShape> > component_;
+    std::vector<MeshPtr> mesh_;
     std::auto_ptr<btRigidBody> body_;
     std::auto_ptr<btCompoundShape> shape_;
     
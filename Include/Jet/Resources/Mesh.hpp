@@ -106,6 +106,11 @@ public:
 
 	//! Returns the physics geometry associated with this mesh.
 	virtual Geometry* geometry() const=0;
+
+	//! Returns a hash of the vertex positions and indices of this mesh.
+	//! The hash is computed the first time it is needed, and kept until
+	//! the vertices or indices change.
+	virtual uint64_t geometry_hash() const=0;
 };
 
 }
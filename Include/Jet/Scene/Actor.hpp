@@ -72,8 +72,13 @@ public:
     //! application.
     virtual void on_update(float delta)=0;
     
-    //! Called when a colllision is detected by the physics engine.
+    //! Called when a colllision is detected by the physics engine.  This is
+    //! called once per frame for as long as the two nodes are touching.
     virtual void on_collision(Node* node, const Vector& position)=0;
+
+    //! Called when a node that was colliding with this node is no longer
+    //! touching it.
+    virtual void on_separation(Node* node)=0;
     
     //! Called when the node is destroyed.
     virtual void on_destroy()=0;
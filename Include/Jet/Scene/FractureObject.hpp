@@ -51,6 +51,10 @@ public:
     
     //! Returns the fracture count of this object.
     virtual size_t fracture_count() const=0;
+
+    //! Returns the number of pieces that this object breaks into when it
+    //! is shattered.
+    virtual size_t shatter_count() const=0;
     
     //! Sets the material used to render this object.
     //! @param material a pointer to the material
@@ -86,6 +90,13 @@ public:
     //! be reduced by one.  When it reaches zero, subsequent calls to fracture
     //! will be ignored.
     virtual void fracture_count(size_t count)=0;
+
+    //! Sets the number of pieces that this object breaks into when it is
+    //! shattered.  The pieces are computed, and nodes for them are created
+    //! and hidden, when this is called; so set the mesh first, and call 
+    //! this while the level is loading.  Zero disables shattering.
+    //! @param count the number of pieces
+    virtual void shatter_count(size_t count)=0;
     
     //! Adds a fracture to this fracture object.  The object will effectively
     //! be split in half along the given plane.  The smaller half of the
@@ -95,6 +106,13 @@ public:
     //! fracture object and remain with the original parent node.
     //! @param plane the plane to split the object along
     virtual void fracture(const Plane& plane)=0;
+
+    //! Breaks this object into the pieces that were set up by 
+    //! shatter_count.  The pieces are peers of the parent node, and they 
+    //! keep its velocity.  The parent node is hidden afterwards.  Unlike 
+    //! fracture, no geometry is clipped, so this is cheap enough to call
+    //! from a collision handler.
+    virtual void shatter()=0;
 };
 
 }
\ No newline at end of file
@@ -48,10 +48,22 @@ public:
     
     //! Returns the mass fo the object
     virtual float mass() const=0;
+
+    //! Returns the moments of inertia about the body's axes, per unit 
+    //! mass, or zero if they are estimated from the collision shape.
+    virtual Vector inertia() const=0;
     
     //! Returns true if the rigid body is active
     virtual bool active() const=0;
 
+    //! Returns the radius of the sphere used for continuous collision 
+    //! detection.
+    virtual float ccd_sphere_radius() const=0;
+
+    //! Returns the distance the body must move in one step before 
+    //! continuous collision detection is used, or 0 if it is disabled.
+    virtual float ccd_motion_threshold() const=0;
+
     //! Sets the linear velocity of the object.
     //! @param v the new linear velocity
     virtual void linear_velocity(const Vector& v)=0;
@@ -80,15 +92,38 @@ public:
     
     //! Sets the mass of the rigid body.
     virtual void mass(float mass)=0;
+
+    //! Sets the moments of inertia about the body's axes, per unit mass.
+    //! The axes must be the principal axes of the body.  Set to zero to 
+    //! estimate the inertia from the collision shape (the default).
+    //! @param inertia the moments of inertia about the x, y, and z axes
+    virtual void inertia(const Vector& inertia)=0;
     
     //! Sets whether or not the rigid body is active.
 	virtual void active(bool active)=0;
+
+    //! Sets the radius of the sphere that is swept along the body's path 
+    //! to find collisions when continuous collision detection is used.  
+    //! The sphere should fit inside the body.  By default, small bodies 
+    //! get a radius based on their size.
+    virtual void ccd_sphere_radius(float radius)=0;
+
+    //! Sets the distance the body must move in one step before continuous
+    //! collision detection is used.  Set to 0 to disable continuous
+    //! collision detection.  By default, small bodies use their size as
+    //! the threshold, so that they can't pass through other objects.
+    virtual void ccd_motion_threshold(float threshold)=0;
     
     //! Sets the rigid body position
     virtual void position(const Vector& position)=0;
     
     //! Sets the rigid body rotation
     virtual void rotation(const Quaternion& rotation)=0;
+
+    //! Marks the collision shape as out of date.  The shape is rebuilt 
+    //! from the geometry attached to the node tree before the next physics
+    //! step.
+    virtual void invalidate_shape()=0;
 };
 
 
@@ -58,6 +58,10 @@ public:
 		self_["on_collision"](self_, node, position);
 	}
 
+	inline void on_separation(Node* node) {
+		self_["on_separation"](self_, node);
+	}
+
     inline void on_destroy() {
 		self_["on_destroy"](self_);
 	}
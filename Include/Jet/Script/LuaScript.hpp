@@ -71,6 +71,7 @@ private:
 
 	static int network_unreliable_rpc(lua_State* env);
 	static int network_reliable_rpc(lua_State* env);
+	static luabind::object physics_query(Physics* physics, const luabind::object& query);
     
     class Compare {
     public:
@@ -90,6 +90,8 @@ namespace Jet {
     class Plane;
     class Point;
     class Physics;
+    class PhysicsHit;
+    class PhysicsQuery;
     class Quad;
     class QuadChain;
     class QuadSet;
@@ -150,4 +152,5 @@ namespace Jet {
     enum LayoutMode { LM_RELATIVE, LM_ABSOLUTE };
     enum Alignment { AL_TOP, AL_CENTER, AL_BOTTOM, AL_LEFT, AL_RIGHT };
     enum NetworkState { NS_DISCOVER, NS_HOST, NS_CLIENT, NS_RUNNING, NS_DISABLED };
+    enum QueryType { QT_RAY, QT_SWEEP, QT_OVERLAP };
 }
@@ -41,6 +41,14 @@ public:
 
 	//! Creates a new address
 	Address();
+
+	inline bool operator==(const Address& other) const {
+		return address == other.address && port == other.port;
+	}
+
+	inline bool operator!=(const Address& other) const {
+		return !operator==(other);
+	}
  
 	uint32_t address;
 	uint16_t port;
@@ -55,7 +55,6 @@ public:
     }
     
     std::string name;
-    Address stream_address;
 	Address datagram_address;
     uint32_t uuid;
     float timestamp;
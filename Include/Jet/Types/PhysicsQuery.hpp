@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+#pragma once
+
+#include <Jet/Types.hpp>
+#include <Jet/Types/Vector.hpp>
+
+namespace Jet {
+
+//! Spatial query against the physics world.  Raycasts (QT_RAY) and sphere
+//! sweeps (QT_SWEEP) find the first body between from and to.  Overlap 
+//! tests (QT_OVERLAP) find every body that penetrates the sphere at from,
+//! deepest first.
+//! @class PhysicsQuery
+//! @brief Spatial query.
+class PhysicsQuery {
+public:
+    //! Creates a new raycast.
+    inline PhysicsQuery() :
+        type(QT_RAY),
+        radius(0.0f),
+        ignore(0) {
+    }
+
+    //! Creates a new query.
+    inline PhysicsQuery(QueryType type, const Vector& from, const Vector& to, float radius) :
+        type(type),
+        from(from),
+        to(to),
+        radius(radius),
+        ignore(0) {
+    }
+
+    QueryType type;
+    Vector from;
+    Vector to;
+    float radius;
+    
+    //! Node to skip, e.g., the node that is casting the ray
+    Node* ignore;
+};
+
+//! Result of a spatial query.
+//! @class PhysicsHit
+//! @brief Result of a spatial query.
+class PhysicsHit {
+public:
+    inline PhysicsHit() :
+        query(0),
+        hit(false),
+        node(0),
+        fraction(1.0f) {
+    }
+
+    //! Index of the query that produced this result
+    size_t query;
+    bool hit;
+    Node* node;
+    Vector position;
+    Vector normal;
+    
+    //! Fraction of the way from the start to the end of the query where 
+    //! the hit happened
+    float fraction;
+};
+
+}
@@ -29,6 +29,11 @@ namespace Jet {
 	//! @param str the string to hash
 	uint32_t hash(const std::string& str);
 
+	//! Hashes the vertex positions and indices of a mesh (64-bit FNV-1a).
+	//! The hash is the same on every run, so it can be saved to disk.
+	//! @param mesh the mesh to hash
+	uint64_t hash(const Mesh* mesh);
+
 	//! Computes a random number using the given seed.  This PRNG is deterministic
 	//! across all platforms, making it ideal for networking.
 	//uint32_t rand();
@@ -33,6 +33,11 @@ engine:option("shadow_correction", 0.55)
 engine:option("shaders_enabled", true)
 engine:option("window_title", "zero combat")
 engine:option("gravity", 0)
+engine:option("physics_parallel_narrowphase", false)
+engine:option("physics_parallel_solver", false)
+engine:option("physics_deterministic", true)
+engine:option("physics_trace_file", "")
+engine:option("physics_broadphase", "dbvt")
 engine:option("network_smoothness", 0.05)
 engine:option("network_packet_rate", 6)
 engine:option("input_delay", 6)
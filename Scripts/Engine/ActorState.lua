@@ -27,6 +27,7 @@ end
 function ActorState.on_update() end
 function ActorState.on_render() end
 function ActorState.on_collision()  end
+function ActorState.on_separation()  end
 function ActorState.on_destroy() end
 function ActorState.on_fracture()  end
 function ActorState.on_tick() end
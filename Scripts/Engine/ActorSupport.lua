@@ -52,6 +52,7 @@ function state(name)
     state.on_update = function() end
     state.on_render = function() end
     state.on_collision = function()  end
+    state.on_separation = function()  end
     state.on_destroy = function() end
     state.on_fracture = function()  end
     state.on_tick = function() end
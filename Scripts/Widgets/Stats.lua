@@ -42,7 +42,9 @@ function Stats:on_update(delta)
     local stat_memory = engine:option("stat_memory")
     local stat_rx = math.round(engine:option("stat_rx_rate"))
     local stat_tx = math.round(engine:option("stat_tx_rate"))
+    local stat_gpu = math.round(engine:option("stat_gpu_memory"))
+    local stat_cpu = math.round(engine:option("stat_cpu_memory"))
     
-    self.overlay.text = stat_fps.." FPS "..stat_tx.." Kbps "..stat_rx.." Kbps "..stat_memory.." KB"
+    self.overlay.text = stat_fps.." FPS "..stat_tx.." Kbps "..stat_rx.." Kbps "..stat_memory.." KB "..stat_gpu.." KB GPU "..stat_cpu.." KB CPU"
 end
 
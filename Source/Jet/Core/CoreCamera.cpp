@@ -30,7 +30,7 @@ using namespace std;
 
 Frustum CoreCamera::frustum(float near_dist, float far_dist) const {
     // Ge the height, width, and shadow distance of the frustum
-    const Matrix& matrix = parent_->matrix();
+    const Matrix& matrix = parent_->render_matrix();
     float width = engine_->option<float>("display_width");
 	float height = engine_->option<float>("display_height");
     
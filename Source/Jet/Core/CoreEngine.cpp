@@ -27,6 +27,11 @@
 #else
 #include <dlfcn.h>
 #endif
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#elif !defined(WINDOWS)
+#include <time.h>
+#endif
 #include <boost/filesystem/operations.hpp>
 #include <boost/lexical_cast.hpp>
 #include <SDL/SDL_image.h>
@@ -38,6 +43,8 @@
 #include <Jet/Core/CoreQuadSet.hpp>
 #include <Jet/Core/CoreCamera.hpp>
 #include <Jet/Core/CoreLight.hpp>
+#include <Jet/Core/CoreWorkerPool.hpp>
+#include <Jet/Core/CoreShatterCache.hpp>
 #include <Jet/Types/Iterator.hpp>
 
 #include <Jet/Network/BSockNetwork.hpp>
@@ -48,9 +55,11 @@
 #include <Jet/Audio/FMODAudio.hpp>
 #include <fstream>
 #include <memory>
+#include <cmath>
 #include <boost/date_time/c_time.hpp>
 
 #define JET_MAX_TIME_LAG 0.5f
+#define JET_MAX_TICKS_PER_FRAME 4
 
 using namespace Jet;
 using namespace std;
@@ -84,9 +93,10 @@ CoreEngine::CoreEngine() :
 	fps_frame_count_(0),
 	fps_elapsed_time_(0.0f),
 	auto_name_counter_(0),
-    prev_time_(0),
+    prev_time_(0.0),
     frame_id_(0),
-	tick_id_(0) {
+	tick_id_(0),
+	node_serial_(0) {
 		
 	cout << "Starting kernel" << endl;
 	
@@ -101,6 +111,7 @@ CoreEngine::CoreEngine() :
 	option("shadows_enabled", false);
 	option("shaders_enabled", false);
 	option("window_title", string(""));
+	option("worker_threads", (float)max(boost::thread::hardware_concurrency(), 2u) - 1.0f);
 
 	// Add some default search folders
 	search_folder(".");
@@ -110,6 +121,7 @@ CoreEngine::CoreEngine() :
 	option("simulation_speed", 1.0f);
 	option("stat_fps", 0.0f);
 	option("stat_memory", 0.0f);
+	option("stat_meshes", 0.0f);
         
 	// Create the root node of the scene graph
     root_ = new CoreNode(this);
@@ -130,8 +142,13 @@ CoreEngine::~CoreEngine() {
 	camera_.reset();
 	focused_overlay_.reset();
 	module_.reset();
+	
+	// Stop the worker threads before freeing the resources they may be
+	// loading
+	worker_pool_.reset();
 
 	// Free resources
+	shatter_cache_.reset();
 	sound_.clear();
 	material_.clear();
 	mesh_.clear();
@@ -192,6 +209,7 @@ Mesh* CoreEngine::mesh(const std::string& name) {
 		string name = "__" + lexical_cast<string>(auto_name_counter_++);
 		MeshPtr mesh(graphics()->mesh(name));
 		mesh_.insert(make_pair(name, mesh));
+		anonymous_mesh_.push_back(name);
 		return mesh.get();
 	}
 	
@@ -216,14 +234,6 @@ Geometry* CoreEngine::geometry(const std::string& name) {
 	}
 }
 
-Mesh* CoreEngine::mesh(Mesh* parent) {
-	string name = "__" + lexical_cast<string>(auto_name_counter_++);
-	
-    MeshPtr mesh(graphics()->mesh(name, parent));
-    mesh_.insert(make_pair(name, mesh));
-    return mesh.get();
-}
-
 Texture* CoreEngine::texture(const std::string& name) {
     map<string, TexturePtr>::iterator i = texture_.find(name);
     if (i == texture_.end()) {
@@ -311,8 +321,23 @@ void CoreEngine::update() {
 	// Update the delta since the last tick
     update_frame_delta();
 	update_fps();
+	
+	// Run as many fixed-rate ticks as fit in the time since the last frame.
+	// The time that is left over carries into the next frame, and is used
+	// to interpolate transforms for rendering.  If the simulation falls too
+	// far behind, drop the extra time rather than running more and more 
+	// ticks each frame.
+	frame_accumulator_ += frame_delta();
+	uint32_t ticks = 0;
+	while (frame_accumulator_ >= timestep() && ticks < JET_MAX_TICKS_PER_FRAME) {
+		tick();
+		ticks++;
+	}
+	if (frame_accumulator_ >= timestep()) {
+		frame_accumulator_ = fmodf(frame_accumulator_, timestep());
+	}
     
-	// Run the tick callback
+	// Run the update callback
 	for (list<EngineListenerPtr>::iterator i = listener_.begin(); i != listener_.end(); i++) {
 		(*i)->on_update();
 	}
@@ -329,12 +354,49 @@ void CoreEngine::update() {
 	if (module_) {
 		module_->on_render();
 	}
+	free_anonymous_meshes();
 	
 	frame_time_ += frame_delta_ * option<float>("simulation_speed");
     frame_id_++;
 
 }
 
+void CoreEngine::tick() {
+	// Update the active module, then the nodes
+	if (module_) {
+		module_->on_tick();
+	}
+	static_cast<CoreNode*>(root())->tick();
+	tick_id_inc();
+	
+	// Step the physics, network and input systems
+	for (list<EngineListenerPtr>::iterator i = listener_.begin(); i != listener_.end(); i++) {
+		(*i)->on_tick();
+	}
+}
+
+void CoreEngine::free_anonymous_meshes() {
+	// Anonymous meshes can't be looked up by name, so once the engine holds
+	// the only reference, nothing can use the mesh again.  Free it, along
+	// with its geometry, so that fractured pieces don't pile up over a long
+	// game.  This runs after rendering, when no raw pointers to the mesh 
+	// are left on the stack; rigid bodies keep their own references to the
+	// meshes that their collision shapes use.
+	for (size_t i = 0; i < anonymous_mesh_.size();) {
+		map<string, MeshPtr>::iterator j = mesh_.find(anonymous_mesh_[i]);
+		if (j != mesh_.end() && j->second->refcount() > 1) {
+			i++;
+			continue;
+		}
+		if (j != mesh_.end()) {
+			mesh_.erase(j);
+		}
+		geometry_.erase(anonymous_mesh_[i]);
+		anonymous_mesh_[i] = anonymous_mesh_.back();
+		anonymous_mesh_.pop_back();
+	}
+}
+
 void CoreEngine::update_fps() {
 	// This is a rough calculation of the number of frames per second.
     fps_elapsed_time_ += frame_delta_;
@@ -342,22 +404,68 @@ void CoreEngine::update_fps() {
     if (fps_elapsed_time_ > 0.1f) {
 		option("stat_fps", fps_frame_count_/fps_elapsed_time_);
 		option("stat_memory", (float)script()->memory_usage());
+		option("stat_meshes", (float)mesh_.size());
         fps_frame_count_ = 0;
         fps_elapsed_time_ = 0.0f;
     }
 }
 
 
+// Returns the time in seconds from a monotonic, high-resolution clock.  
+// SDL_GetTicks only has millisecond resolution, which is too coarse for a 
+// fixed-rate simulation (1/60th of a second isn't a whole number of ms).
+static double current_time() {
+#if defined(WINDOWS)
+	static double period = 0.0;
+	if (period == 0.0) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		period = 1.0 / (double)frequency.QuadPart;
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart * period;
+#elif defined(__APPLE__)
+	static double period = 0.0;
+	if (period == 0.0) {
+		mach_timebase_info_data_t info;
+		mach_timebase_info(&info);
+		period = 1e-9 * info.numer / info.denom;
+	}
+	return mach_absolute_time() * period;
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
 void CoreEngine::update_frame_delta() {
 	// Query the counter, and initialize it.  If this is the first time the
 	// function is being called, set the "previous" time equal to the current
-	// time so that there is not a huge lag for the first frame.
-    unsigned current_time = SDL_GetTicks();
+	// time so that there is not a huge lag for the first frame.  Long 
+	// pauses (e.g., while loading) are clamped, so that the simulation 
+	// doesn't try to catch up all at once.
+    double now = current_time();
     if (!prev_time_) {
-        prev_time_ = current_time;
+        prev_time_ = now;
     }
-    frame_delta_ = (current_time - prev_time_) / 1000.0f;
-    prev_time_ = current_time;
+    frame_delta_ = (float)min(now - prev_time_, (double)JET_MAX_TIME_LAG);
+    prev_time_ = now;
+}
+
+CoreWorkerPool* CoreEngine::worker_pool() {
+	if (!worker_pool_) {
+		worker_pool_ = new CoreWorkerPool((size_t)option<float>("worker_threads"));
+	}
+	return worker_pool_.get();
+}
+
+CoreShatterCache* CoreEngine::shatter_cache() {
+	if (!shatter_cache_) {
+		shatter_cache_ = new CoreShatterCache(this);
+	}
+	return shatter_cache_.get();
 }
 
 Network* CoreEngine::network() const {
@@ -21,6 +21,7 @@
  */
 
 #include <Jet/Core/CoreFractureObject.hpp>
+#include <Jet/Core/CoreMeshSplitter.hpp>
 #include <Jet/Scene/RigidBody.hpp>
 #include <Jet/Types/Plane.hpp>
 #include <Jet/Types/Box.hpp>
@@ -32,94 +33,61 @@ void CoreFractureObject::fracture(const Plane& plane) {
     Mesh* mesh = mesh_object_->mesh();
     
     if (mesh && fracture_count_ > 0 && parent_->visible()) {
-        mesh->state(RS_LOADED);
+        // The splitter only needs the vertex data in memory, not the
+        // hardware buffers
+        if (RS_UNLOADED == mesh->state()) {
+            mesh->state(RS_CACHED);
+        }
         
         // Here, we will begin the fracture.  The object must have a mesh
         // attached, or else we won't be able to split the object.
-        fracture_count_--;
-        fracture_indices(plane);
+        fracture_mesh(plane);
     }
 }
 
-void CoreFractureObject::fracture_indices(const Plane& plane) {
+void CoreFractureObject::fracture_mesh(const Plane& plane) {
     Mesh* mesh = mesh_object_->mesh();
-    
-    // Create two new anonymous meshes for the pieces that splinter off
-	// Vertex data will automatically be shared
-	MeshPtr mesh1 = engine_->mesh(mesh);
-	MeshPtr mesh2 = engine_->mesh(mesh);
-    
-    Box b1;
-    Box b2;
-
-	size_t index_count = 0;
-
-    // Loop through each face, and divide them using the plane.  Some vertices
-    // will go to one mesh, some will go to the other
-	for (size_t g = 0; g < mesh->group_count(); g++) {
-		mesh1->group(g, mesh->group(g));
-		mesh2->group(g, mesh->group(g));
-
-		for (size_t i = 2; i < mesh->index_count(g); i += 3) {
-			uint32_t i0 = mesh->index(g, i-2);
-			uint32_t i1 = mesh->index(g, i-1);
-			uint32_t i2 = mesh->index(g, i-0);
-			const Vector& v0 = mesh->vertex(i0).position;
-			const Vector& v1 = mesh->vertex(i1).position;
-			const Vector& v2 = mesh->vertex(i2).position;
-			float d0 = plane.distance(v0);
-			float d1 = plane.distance(v1);
-			float d2 = plane.distance(v2);
-	        
-	        
-			if (d0 <= 0 && d1 <= 0 && d2 <= 0) {
-				// If all the vertices are on the lower half-space created by the
-				// plane, then push the indices to the first buffer
-				mesh1->index(g, mesh1->index_count(g), i0);
-				mesh1->index(g, mesh1->index_count(g), i1);
-				mesh1->index(g, mesh1->index_count(g), i2);
-				b1.point(v0);
-				b1.point(v1);
-				b1.point(v2);
-			} else {
-				// If all the vertices are on the upper half-space created by the
-				// plane, then push the indices to the second buffer
-				mesh2->index(g, mesh2->index_count(g), i0);
-				mesh2->index(g, mesh2->index_count(g), i1);
-				mesh2->index(g, mesh2->index_count(g), i2);
-				b2.point(v0);
-				b2.point(v1);
-				b2.point(v2);
-
-				index_count += 3;
-			}
-		}
-	}
+
+    // Clip the mesh against the plane.  Each half gets its own compact 
+    // vertex buffer, rather than sharing the vertex buffer of the original 
+    // mesh.  If the plane misses the mesh, then there is nothing to do.
+    CoreMeshPiece piece;
+    CoreMeshPiece below;
+    CoreMeshPiece above;
+    piece.read(mesh);
+    if (!engine_->mesh_splitter()->split(piece, plane, seal_fractures_, below, above)) {
+        return;
+    }
+    fracture_count_--;
 
     // Get the volume of bounding box to decide which half of the mesh is
     // bigger.  The bigger half stays with the current fracture object and the
     // smaller half goes with the new fracture object.
-    float v1 = b1.volume();
-    float v2 = b2.volume();
+    float v1 = below.bounds.volume();
+    float v2 = above.bounds.volume();
 
     // Sets the mass of the rigid bodies
     float mass = parent_->rigid_body()->mass();
     float m1 = v1 * mass / (v1 + v2);
     float m2 = v2 * mass / (v1 + v2);
     
-    // Swap the mesh halves if v1 is smaller than v2 (mesh1 should always
-    // have the largest mesh)
+    // Swap the mesh halves if v1 is smaller than v2 (the first half should 
+    // always be the largest)
+    CoreMeshPiece* piece1 = &below;
+    CoreMeshPiece* piece2 = &above;
     if (v1 < v2) {
-        swap(b1, b2);
         swap(m1, m2);
         swap(v1, v2);
-        swap(mesh1, mesh2);
+        swap(piece1, piece2);
     }
     
-    if (index_count > 20) {
+    if (piece2->index_count() > 20) {
         // Create a new fracture object that is an approximate "clone" of this
-        // one.  Material, mesh, and other attributes should be copied, but
-        // the indices will be different.
+        // one.  Material and other attributes are copied, but the mesh is
+        // the smaller half.
+        MeshPtr mesh2 = engine_->mesh();
+        piece2->write(mesh2.get());
+
         CoreFractureObject* clone = create_clone();
         clone->mesh_object_->mesh(mesh2.get());   
         clone->parent()->rigid_body()->mass(m2);
@@ -127,12 +95,85 @@ void CoreFractureObject::fracture_indices(const Plane& plane) {
 		parent_->fracture(clone->parent());
     }
     
-    // Initialize the index buffer for this object
+    // Replace the mesh for this object with the larger half
+    MeshPtr mesh1 = engine_->mesh();
+    piece1->write(mesh1.get());
     mesh_object_->mesh(mesh1.get());
     parent_->rigid_body()->mass(m1);
     parent_->fracture(parent_);
 }
 
+void CoreFractureObject::shatter_count(size_t count) {
+    shatter_count_ = count;
+    init_pieces();
+}
+
+void CoreFractureObject::init_pieces() {
+    piece_.clear();
+    pattern_.reset();
+    Mesh* mesh = mesh_object_->mesh();
+    if (!shatter_count_ || !mesh || !parent_->parent()) {
+        return;
+    }
+
+    // Create a node for each piece, with its collision shape already 
+    // built.  The nodes are hidden and aren't in the scene graph, so their
+    // rigid bodies stay out of the physics world until the object 
+    // shatters.  If this object goes away first, so do the pieces.
+    CoreNode* peer = static_cast<CoreNode*>(parent_->parent());
+    pattern_ = engine_->shatter_cache()->pattern(mesh, shatter_count_);
+    for (size_t i = 0; i < pattern_->piece.size(); i++) {
+        CoreNodePtr node(new CoreNode(engine_, peer, ""));
+        node->visible(false);
+        node->mesh_object()->mesh(pattern_->piece[i].mesh.get());
+        node->rigid_body()->inertia(pattern_->piece[i].inertia);
+        piece_.push_back(node);
+    }
+}
+
+void CoreFractureObject::shatter() {
+    if (!shatter_count_ || !parent_->visible()) {
+        return;
+    }
+    if (piece_.empty()) {
+        init_pieces();
+    }
+    if (piece_.empty()) {
+        return;
+    }
+
+    // Move the pieces to where they are in the object, and give each one
+    // the velocity of that point on the object
+    RigidBody* body = parent_->rigid_body();
+    float mass = body->mass();
+    Vector linear_velocity = body->linear_velocity();
+    Vector angular_velocity = body->angular_velocity();
+    const Vector& position = parent_->position();
+    const Quaternion& rotation = parent_->rotation();
+    CoreNode* peer = static_cast<CoreNode*>(parent_->parent());
+    for (size_t i = 0; i < piece_.size(); i++) {
+        CoreNode* node = piece_[i].get();
+        const CoreShatterPiece& piece = pattern_->piece[i];
+        Vector offset = rotation * piece.center;
+        node->position(position + offset);
+        node->rotation(rotation * piece.rotation);
+        node->mesh_object()->material(material());
+        node->mesh_object()->cast_shadows(cast_shadows());
+        peer->attach(node);
+
+        RigidBody* piece_body = node->rigid_body();
+        piece_body->mass(mass * piece.mass_fraction);
+        node->visible(true);
+        piece_body->linear_velocity(linear_velocity + angular_velocity.cross(offset));
+        piece_body->angular_velocity(angular_velocity);
+        parent_->fracture(node);
+    }
+    piece_.clear();
+    pattern_.reset();
+    shatter_count_ = 0;
+    parent_->visible(false);
+}
+
 CoreFractureObject* CoreFractureObject::create_clone() {
 
     // Create a new node and fracture object
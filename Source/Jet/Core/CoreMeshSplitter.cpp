@@ -0,0 +1,743 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Core/CoreMeshSplitter.hpp>
+#include <Jet/Resources/Mesh.hpp>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cfloat>
+
+using namespace Jet;
+using namespace std;
+
+static const uint32_t NONE = 0xffffffff;
+
+// Returns a power-of-two hash table size with room for the given number of
+// entries at a load factor of 1/2 or less
+static size_t table_size(size_t count) {
+    size_t size = 16;
+    while (size < 2*count) {
+        size *= 2;
+    }
+    return size;
+}
+
+static inline size_t hash_key(uint64_t key) {
+    key ^= key >> 29;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 32;
+    return (size_t)key;
+}
+
+static inline size_t hash_cell(int32_t x, int32_t y, int32_t z) {
+    return (size_t)((uint32_t)x*73856093u ^ (uint32_t)y*19349663u ^ (uint32_t)z*83492791u);
+}
+
+void CoreMeshPiece::clear() {
+    vertex.clear();
+    for (size_t g = 0; g < index.size(); g++) {
+        index[g].clear();
+    }
+    bounds = Box();
+}
+
+size_t CoreMeshPiece::index_count() const {
+    size_t count = 0;
+    for (size_t g = 0; g < index.size(); g++) {
+        count += index[g].size();
+    }
+    return count;
+}
+
+void CoreMeshPiece::swap(CoreMeshPiece& other) {
+    vertex.swap(other.vertex);
+    index.swap(other.index);
+    group.swap(other.group);
+    std::swap(bounds, other.bounds);
+}
+
+void CoreMeshPiece::read(const Mesh* mesh) {
+    const Vertex* data = mesh->vertex_data();
+    vertex.assign(data, data + mesh->vertex_count());
+    index.resize(mesh->group_count());
+    group.resize(mesh->group_count());
+    for (size_t g = 0; g < mesh->group_count(); g++) {
+        const uint32_t* data = mesh->index_data(g);
+        index[g].assign(data, data + mesh->index_count(g));
+        group[g] = mesh->group(g);
+    }
+    bounds = Box();
+    for (size_t i = 0; i < vertex.size(); i++) {
+        bounds.point(vertex[i].position);
+    }
+}
+
+void CoreMeshPiece::write(Mesh* mesh) const {
+    mesh->vertex_count(vertex.size());
+    for (size_t i = 0; i < vertex.size(); i++) {
+        mesh->vertex(i, vertex[i]);
+    }
+    mesh->group_count(group.size());
+    for (size_t g = 0; g < group.size(); g++) {
+        mesh->group(g, group[g]);
+        mesh->index_count(g, index[g].size());
+        for (size_t i = 0; i < index[g].size(); i++) {
+            mesh->index(g, i, index[g][i]);
+        }
+    }
+}
+
+bool CoreMeshSplitter::split(const CoreMeshPiece& in, const Plane& plane, bool seal, CoreMeshPiece& below, CoreMeshPiece& above) {
+    // Normalize the plane once, rather than for every vertex as 
+    // Plane::distance does
+    float length = sqrtf(plane.a*plane.a + plane.b*plane.b + plane.c*plane.c);
+    normal_ = Vector(plane.a, plane.b, plane.c) / length;
+    offset_ = plane.d / length;
+
+    // Points on the cut outline closer than this are welded together.
+    // Slivers left by earlier cuts can put the cuts on neighboring edges 
+    // a rounding error apart.
+    const Box& box = in.bounds;
+    float size = max(box.max_x - box.min_x, max(box.max_y - box.min_y, box.max_z - box.min_z));
+    weld_ = (size > 0.0f ? size : 1.0f) * JET_SPLIT_WELD_TOLERANCE;
+
+    // Vertices within the weld distance of the plane are on it.  They are
+    // shared by both pieces rather than cut, because cutting an edge right
+    // at its end leaves a zero-area triangle.
+    size_t vertex_count = in.vertex.size();
+    size_t plane_count = 0;
+    distance_.resize(vertex_count);
+    side_.resize(vertex_count);
+    for (size_t i = 0; i < vertex_count; i++) {
+        float distance = normal_.dot(in.vertex[i].position) + offset_;
+        distance_[i] = distance;
+        side_[i] = (distance > weld_) ? 1 : (distance < -weld_) ? -1 : 0;
+        plane_count += !side_[i];
+    }
+
+    // Count the triangles on each side, so that the tables are sized once
+    size_t below_count = 0;
+    size_t above_count = 0;
+    size_t crossing_count = 0;
+    for (size_t g = 0; g < in.index.size(); g++) {
+        const vector<uint32_t>& index = in.index[g];
+        for (size_t i = 2; i < index.size(); i += 3) {
+            int side = this->side(in, index[i-2], index[i-1], index[i]);
+            if (side < 0) {
+                below_count++;
+            } else if (side > 0) {
+                above_count++;
+            } else {
+                crossing_count++;
+            }
+        }
+    }
+    if (!crossing_count && (!below_count || !above_count)) {
+        below.clear();
+        above.clear();
+        if (below_count) {
+            below = in;
+        } else {
+            above = in;
+        }
+        return false;
+    }
+
+    // Each crossing triangle cuts two edges, and each cut edge is shared
+    // by up to two triangles
+    Edge empty = { 0, NONE };
+    edge_.assign(table_size(2*crossing_count), empty);
+    node_slot_.assign(table_size(2*crossing_count + plane_count), NONE);
+    plane_node_.assign(vertex_count, NONE);
+    remap_below_.assign(vertex_count, NONE);
+    remap_above_.assign(vertex_count, NONE);
+    cut_below_.clear();
+    cut_above_.clear();
+    cut_node_.clear();
+    node_position_.clear();
+    node_next_.clear();
+
+    below.clear();
+    above.clear();
+    below.group = in.group;
+    above.group = in.group;
+    below.index.resize(in.index.size());
+    above.index.resize(in.index.size());
+
+    // Vertices on the plane are part of the cross-section outline
+    for (size_t i = 0; i < vertex_count; i++) {
+        if (!side_[i]) {
+            plane_node_[i] = node(in.vertex[i].position);
+        }
+    }
+
+    for (size_t g = 0; g < in.index.size(); g++) {
+        const vector<uint32_t>& index = in.index[g];
+        vector<uint32_t>& below_index = below.index[g];
+        vector<uint32_t>& above_index = above.index[g];
+        for (size_t i = 2; i < index.size(); i += 3) {
+            uint32_t i0 = index[i-2];
+            uint32_t i1 = index[i-1];
+            uint32_t i2 = index[i-0];
+            int side = this->side(in, i0, i1, i2);
+            if (side < 0) {
+                // Edges of the lower piece that lie on the plane are part 
+                // of the outline
+                below_index.push_back(vertex(in, i0, remap_below_, below));
+                below_index.push_back(vertex(in, i1, remap_below_, below));
+                below_index.push_back(vertex(in, i2, remap_below_, below));
+                if (!side_[i0] && !side_[i1]) {
+                    link(plane_node_[i0], plane_node_[i1]);
+                }
+                if (!side_[i1] && !side_[i2]) {
+                    link(plane_node_[i1], plane_node_[i2]);
+                }
+                if (!side_[i2] && !side_[i0]) {
+                    link(plane_node_[i2], plane_node_[i0]);
+                }
+                continue;
+            } else if (side > 0) {
+                above_index.push_back(vertex(in, i0, remap_above_, above));
+                above_index.push_back(vertex(in, i1, remap_above_, above));
+                above_index.push_back(vertex(in, i2, remap_above_, above));
+                continue;
+            }
+
+            // A crossing triangle with a vertex on the plane only has one 
+            // edge to cut.  The vertices are rotated so that the one on the
+            // plane comes first, to preserve the winding.
+            if (!side_[i0]) {
+                clip_at_vertex(in, g, i0, i1, i2, below, above);
+                continue;
+            } else if (!side_[i1]) {
+                clip_at_vertex(in, g, i1, i2, i0, below, above);
+                continue;
+            } else if (!side_[i2]) {
+                clip_at_vertex(in, g, i2, i0, i1, below, above);
+                continue;
+            }
+
+            // Triangles with one vertex on one side of the plane and two on 
+            // the other side are clipped.  The vertices are rotated so that
+            // the one by itself comes first, to preserve the winding.
+            int mask = (side_[i0] > 0) | (side_[i1] > 0) << 1 | (side_[i2] > 0) << 2;
+            switch (mask) {
+            case 1: clip(in, g, i0, i1, i2, true, below, above); break;
+            case 6: clip(in, g, i0, i1, i2, false, below, above); break;
+            case 2: clip(in, g, i1, i2, i0, true, below, above); break;
+            case 5: clip(in, g, i1, i2, i0, false, below, above); break;
+            case 4: clip(in, g, i2, i0, i1, true, below, above); break;
+            case 3: clip(in, g, i2, i0, i1, false, below, above); break;
+            }
+        }
+    }
+
+    if (seal) {
+        this->seal(below, above);
+    }
+    return below.index_count() && above.index_count();
+}
+
+uint32_t CoreMeshSplitter::vertex(const CoreMeshPiece& in, uint32_t i, vector<uint32_t>& remap, CoreMeshPiece& out) {
+    // Copy each vertex into the piece the first time that it is used, so
+    // that the piece's vertex buffer is compact
+    uint32_t& index = remap[i];
+    if (NONE == index) {
+        index = (uint32_t)out.vertex.size();
+        out.vertex.push_back(in.vertex[i]);
+
+        // Vertices on the plane are snapped to the outline, like cuts
+        if (!side_[i]) {
+            out.vertex.back().position = node_position_[plane_node_[i]];
+        }
+        out.bounds.point(out.vertex.back().position);
+    }
+    return index;
+}
+
+int CoreMeshSplitter::side(const CoreMeshPiece& in, uint32_t i0, uint32_t i1, uint32_t i2) const {
+    // Returns -1 if the triangle goes in the lower piece, 1 if it goes in
+    // the upper piece, and 0 if it crosses the plane and must be clipped.
+    // Vertices on the plane go with either side.
+    int s0 = side_[i0];
+    int s1 = side_[i1];
+    int s2 = side_[i2];
+    bool below = s0 < 0 || s1 < 0 || s2 < 0;
+    bool above = s0 > 0 || s1 > 0 || s2 > 0;
+    if (below != above) {
+        return below ? -1 : 1;
+    } else if (below) {
+        return 0;
+    }
+
+    // The triangle lies in the plane.  It goes with the piece that it is 
+    // the surface of: a triangle that faces along the plane normal is the
+    // top of the lower piece.
+    const Vector& p0 = in.vertex[i0].position;
+    const Vector& p1 = in.vertex[i1].position;
+    const Vector& p2 = in.vertex[i2].position;
+    return ((p1 - p0).cross(p2 - p0).dot(normal_) >= 0.0f) ? -1 : 1;
+}
+
+void CoreMeshSplitter::link(uint32_t from, uint32_t to) {
+    // Links an edge of the lower piece that lies on the plane into the 
+    // cross-section outline.  The outline runs opposite to the edge, so 
+    // that it winds counter-clockwise around the plane normal.  If the
+    // opposite edge was already linked, the edge is shared by two 
+    // triangles of the lower piece, so it isn't part of the outline.
+    if (NONE == from || NONE == to || from == to) {
+        return;
+    }
+    if (node_next_[from] == to) {
+        node_next_[from] = NONE;
+    } else {
+        node_next_[to] = from;
+    }
+}
+
+uint32_t CoreMeshSplitter::cut(const CoreMeshPiece& in, uint32_t i0, uint32_t i1, CoreMeshPiece& below, CoreMeshPiece& above) {
+    // Look up the edge, so that neighboring triangles share the new vertex
+    uint32_t lo = min(i0, i1);
+    uint32_t hi = max(i0, i1);
+    uint64_t key = (uint64_t)lo << 32 | hi;
+    size_t mask = edge_.size() - 1;
+    size_t slot = hash_key(key) & mask;
+    while (NONE != edge_[slot].cut) {
+        if (key == edge_[slot].key) {
+            return edge_[slot].cut;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    const Vertex& v0 = in.vertex[lo];
+    const Vertex& v1 = in.vertex[hi];
+    float t = distance_[lo] / (distance_[lo] - distance_[hi]);
+    Vertex vertex = v0 * (1.0f - t) + v1 * t;
+    vertex.normal = vertex.normal.unit();
+
+    // Snap the vertex to the outline node, so that the sides of the piece
+    // meet the cap exactly.  This also joins the cuts on either side of a
+    // texture seam.
+    uint32_t node = this->node(vertex.position);
+    vertex.position = node_position_[node];
+
+    uint32_t cut = (uint32_t)cut_below_.size();
+    cut_below_.push_back((uint32_t)below.vertex.size());
+    cut_above_.push_back((uint32_t)above.vertex.size());
+    cut_node_.push_back(node);
+    below.vertex.push_back(vertex);
+    above.vertex.push_back(vertex);
+    below.bounds.point(vertex.position);
+    above.bounds.point(vertex.position);
+    edge_[slot].key = key;
+    edge_[slot].cut = cut;
+    return cut;
+}
+
+uint32_t CoreMeshSplitter::node(const Vector& position) {
+    // Returns the cross-section node near the given position, creating it
+    // if necessary.  Nodes are hashed by grid cell, and the neighboring 
+    // cells are searched too, in case the nodes fall on either side of a
+    // cell boundary.
+    size_t mask = node_slot_.size() - 1;
+    int32_t x = (int32_t)floorf(position.x / weld_);
+    int32_t y = (int32_t)floorf(position.y / weld_);
+    int32_t z = (int32_t)floorf(position.z / weld_);
+    float weld2 = weld_ * weld_;
+    for (int32_t i = x - 1; i <= x + 1; i++) {
+        for (int32_t j = y - 1; j <= y + 1; j++) {
+            for (int32_t k = z - 1; k <= z + 1; k++) {
+                size_t slot = hash_cell(i, j, k) & mask;
+                while (NONE != node_slot_[slot]) {
+                    if (node_position_[node_slot_[slot]].distance2(position) <= weld2) {
+                        return node_slot_[slot];
+                    }
+                    slot = (slot + 1) & mask;
+                }
+            }
+        }
+    }
+
+    size_t slot = hash_cell(x, y, z) & mask;
+    while (NONE != node_slot_[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    uint32_t node = (uint32_t)node_position_.size();
+    node_position_.push_back(position);
+    node_next_.push_back(NONE);
+    node_slot_[slot] = node;
+    return node;
+}
+
+void CoreMeshSplitter::clip(const CoreMeshPiece& in, size_t group, uint32_t a, uint32_t b, uint32_t c, bool lone_above, CoreMeshPiece& below, CoreMeshPiece& above) {
+    // Vertex a is alone on one side of the plane.  It keeps one triangle,
+    // and the quad on the other side is split into two triangles.
+    uint32_t ab = cut(in, a, b, below, above);
+    uint32_t ca = cut(in, c, a, below, above);
+
+    CoreMeshPiece& lone = lone_above ? above : below;
+    CoreMeshPiece& pair = lone_above ? below : above;
+    vector<uint32_t>& lone_remap = lone_above ? remap_above_ : remap_below_;
+    vector<uint32_t>& pair_remap = lone_above ? remap_below_ : remap_above_;
+    vector<uint32_t>& lone_cut = lone_above ? cut_above_ : cut_below_;
+    vector<uint32_t>& pair_cut = lone_above ? cut_below_ : cut_above_;
+
+    vector<uint32_t>& lone_index = lone.index[group];
+    lone_index.push_back(vertex(in, a, lone_remap, lone));
+    lone_index.push_back(lone_cut[ab]);
+    lone_index.push_back(lone_cut[ca]);
+
+    uint32_t pb = vertex(in, b, pair_remap, pair);
+    uint32_t pc = vertex(in, c, pair_remap, pair);
+    vector<uint32_t>& pair_index = pair.index[group];
+    pair_index.push_back(pair_cut[ab]);
+    pair_index.push_back(pb);
+    pair_index.push_back(pc);
+    pair_index.push_back(pair_cut[ab]);
+    pair_index.push_back(pc);
+    pair_index.push_back(pair_cut[ca]);
+
+    // Link the cut edge into the cross-section outline
+    if (lone_above) {
+        link(cut_node_[ca], cut_node_[ab]);
+    } else {
+        link(cut_node_[ab], cut_node_[ca]);
+    }
+}
+
+void CoreMeshSplitter::clip_at_vertex(const CoreMeshPiece& in, size_t group, uint32_t a, uint32_t b, uint32_t c, CoreMeshPiece& below, CoreMeshPiece& above) {
+    // Vertex a is on the plane, and b and c are on opposite sides of it, so
+    // only edge bc is cut.  Each piece gets one triangle.
+    uint32_t bc = cut(in, b, c, below, above);
+    vector<uint32_t>& below_index = below.index[group];
+    vector<uint32_t>& above_index = above.index[group];
+    if (side_[b] < 0) {
+        below_index.push_back(vertex(in, a, remap_below_, below));
+        below_index.push_back(vertex(in, b, remap_below_, below));
+        below_index.push_back(cut_below_[bc]);
+        above_index.push_back(vertex(in, a, remap_above_, above));
+        above_index.push_back(cut_above_[bc]);
+        above_index.push_back(vertex(in, c, remap_above_, above));
+        link(cut_node_[bc], plane_node_[a]);
+    } else {
+        above_index.push_back(vertex(in, a, remap_above_, above));
+        above_index.push_back(vertex(in, b, remap_above_, above));
+        above_index.push_back(cut_above_[bc]);
+        below_index.push_back(vertex(in, a, remap_below_, below));
+        below_index.push_back(cut_below_[bc]);
+        below_index.push_back(vertex(in, c, remap_below_, below));
+        link(plane_node_[a], cut_node_[bc]);
+    }
+}
+
+void CoreMeshSplitter::seal(CoreMeshPiece& below, CoreMeshPiece& above) {
+    // Caps go in their own group, so that the outline of the fracture can
+    // be drawn differently later
+    size_t group = find(below.group.begin(), below.group.end(), JET_FRACTURE_CAP_GROUP) - below.group.begin();
+    if (group == below.group.size()) {
+        below.group.push_back(JET_FRACTURE_CAP_GROUP);
+        above.group.push_back(JET_FRACTURE_CAP_GROUP);
+        below.index.resize(group + 1);
+        above.index.resize(group + 1);
+    }
+
+    // Project the outline onto the plane, with the axes chosen so that 
+    // counter-clockwise is around the plane normal
+    Vector u = normal_.orthogonal().unit();
+    Vector v = normal_.cross(u);
+    size_t node_count = node_position_.size();
+    node_x_.resize(node_count);
+    node_y_.resize(node_count);
+    for (size_t i = 0; i < node_count; i++) {
+        node_x_[i] = node_position_[i].dot(u);
+        node_y_[i] = node_position_[i].dot(v);
+    }
+
+    // Collect the closed outlines.  If the mesh isn't watertight, an 
+    // outline may be open, and it can't be capped.  Outlines that wind
+    // clockwise are the edges of holes in the cross-section.
+    outline_.clear();
+    outline_first_.clear();
+    outline_area_.clear();
+    node_visited_.assign(node_count, 0);
+    for (uint32_t start = 0; start < node_count; start++) {
+        size_t first = outline_.size();
+        uint32_t n = start;
+        while (NONE != n && !node_visited_[n]) {
+            node_visited_[n] = 1;
+            outline_.push_back(n);
+            n = node_next_[n];
+        }
+        if (n != start || outline_.size() - first < 3) {
+            outline_.resize(first);
+            continue;
+        }
+        float area = 0.0f;
+        for (size_t i = first, j = outline_.size() - 1; i < outline_.size(); j = i++) {
+            area += node_x_[outline_[j]]*node_y_[outline_[i]] - node_x_[outline_[i]]*node_y_[outline_[j]];
+        }
+        outline_first_.push_back(first);
+        outline_area_.push_back(area);
+    }
+    size_t outline_count = outline_area_.size();
+    outline_first_.push_back(outline_.size());
+
+    // Each hole belongs to the smallest outline around it
+    outline_parent_.assign(outline_count, NONE);
+    for (size_t h = 0; h < outline_count; h++) {
+        if (outline_area_[h] >= 0.0f) {
+            continue;
+        }
+        uint32_t point = outline_[outline_first_[h]];
+        for (size_t o = 0; o < outline_count; o++) {
+            size_t parent = outline_parent_[h];
+            if (outline_area_[o] > 0.0f && (NONE == parent || outline_area_[o] < outline_area_[parent]) && contains(o, node_x_[point], node_y_[point])) {
+                outline_parent_[h] = o;
+            }
+        }
+    }
+
+    for (size_t o = 0; o < outline_count; o++) {
+        if (outline_area_[o] <= 0.0f) {
+            continue;
+        }
+        loop_.assign(outline_.begin() + outline_first_[o], outline_.begin() + outline_first_[o+1]);
+        
+        // Join the holes to the outline, rightmost hole first, so that each
+        // hole can also be joined to the holes before it
+        hole_.clear();
+        for (size_t h = 0; h < outline_count; h++) {
+            if (o == outline_parent_[h]) {
+                float max_x = -FLT_MAX;
+                for (size_t i = outline_first_[h]; i < outline_first_[h+1]; i++) {
+                    max_x = max(max_x, node_x_[outline_[i]]);
+                }
+                hole_.push_back(make_pair(max_x, h));
+            }
+        }
+        sort(hole_.begin(), hole_.end(), greater<pair<float, size_t> >());
+        for (size_t i = 0; i < hole_.size(); i++) {
+            bridge(hole_[i].second);
+        }
+
+        loop_x_.resize(loop_.size());
+        loop_y_.resize(loop_.size());
+        for (size_t i = 0; i < loop_.size(); i++) {
+            loop_x_[i] = node_x_[loop_[i]];
+            loop_y_[i] = node_y_[loop_[i]];
+        }
+        triangulate();
+        if (triangle_.empty()) {
+            continue;
+        }
+
+        // Cap vertices are flat-shaded, and textured with a planar 
+        // projection
+        uint32_t below_base = (uint32_t)below.vertex.size();
+        uint32_t above_base = (uint32_t)above.vertex.size();
+        for (size_t i = 0; i < loop_.size(); i++) {
+            Vertex vertex;
+            vertex.position = node_position_[loop_[i]];
+            vertex.texcoord = Texcoord(loop_x_[i], loop_y_[i]);
+            vertex.normal = normal_;
+            below.vertex.push_back(vertex);
+            vertex.normal = -normal_;
+            above.vertex.push_back(vertex);
+        }
+        vector<uint32_t>& below_index = below.index[group];
+        vector<uint32_t>& above_index = above.index[group];
+        for (size_t i = 2; i < triangle_.size(); i += 3) {
+            below_index.push_back(below_base + triangle_[i-2]);
+            below_index.push_back(below_base + triangle_[i-1]);
+            below_index.push_back(below_base + triangle_[i-0]);
+            above_index.push_back(above_base + triangle_[i-2]);
+            above_index.push_back(above_base + triangle_[i-0]);
+            above_index.push_back(above_base + triangle_[i-1]);
+        }
+    }
+}
+
+bool CoreMeshSplitter::contains(size_t outline, float x, float y) const {
+    // Even-odd test of a point against one of the collected outlines
+    bool inside = false;
+    size_t first = outline_first_[outline];
+    size_t last = outline_first_[outline+1];
+    for (size_t i = first, j = last - 1; i < last; j = i++) {
+        float xi = node_x_[outline_[i]];
+        float yi = node_y_[outline_[i]];
+        float xj = node_x_[outline_[j]];
+        float yj = node_y_[outline_[j]];
+        if ((yi > y) != (yj > y) && x < xi + (y - yi)*(xj - xi)/(yj - yi)) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+void CoreMeshSplitter::bridge(size_t hole) {
+    // Joins a hole to the current outline with a pair of opposite edges, 
+    // so that the ear clipper sees a single outline that goes around the
+    // hole.  The bridge starts at the rightmost point of the hole, and ends
+    // at a point of the outline that it can see along the x-axis.
+    size_t first = outline_first_[hole];
+    size_t count = outline_first_[hole+1] - first;
+    size_t m = 0;
+    for (size_t i = 1; i < count; i++) {
+        if (node_x_[outline_[first+i]] > node_x_[outline_[first+m]]) {
+            m = i;
+        }
+    }
+    float mx = node_x_[outline_[first+m]];
+    float my = node_y_[outline_[first+m]];
+
+    // Find the nearest edge hit by a ray from the hole point along the 
+    // x-axis, and take the end of that edge that is farther right
+    size_t loop_count = loop_.size();
+    size_t best = NONE;
+    float hit_x = FLT_MAX;
+    for (size_t i = 0; i < loop_count; i++) {
+        size_t j = (i + 1) % loop_count;
+        float ax = node_x_[loop_[i]];
+        float ay = node_y_[loop_[i]];
+        float bx = node_x_[loop_[j]];
+        float by = node_y_[loop_[j]];
+        if ((ay > my) == (by > my)) {
+            continue;
+        }
+        float x = ax + (my - ay)*(bx - ax)/(by - ay);
+        if (x >= mx && x < hit_x) {
+            hit_x = x;
+            best = (ax > bx) ? i : j;
+        }
+    }
+    if (NONE == best) {
+        return;
+    }
+
+    // Another point inside the triangle between the hole point, the hit,
+    // and the end of the edge would block the bridge.  The point in the
+    // triangle closest in angle to the ray can always be seen.
+    float px = node_x_[loop_[best]];
+    float py = node_y_[loop_[best]];
+    float best_slope = (px > mx) ? fabsf(py - my)/(px - mx) : FLT_MAX;
+    for (size_t i = 0; i < loop_count; i++) {
+        float x = node_x_[loop_[i]];
+        float y = node_y_[loop_[i]];
+        if (i == best || x <= mx) {
+            continue;
+        }
+        float d1 = (hit_x - mx)*(y - my);
+        float d2 = (px - hit_x)*(y - my) - (py - my)*(x - hit_x);
+        float d3 = (mx - px)*(y - py) - (my - py)*(x - px);
+        bool negative = d1 < 0.0f || d2 < 0.0f || d3 < 0.0f;
+        bool positive = d1 > 0.0f || d2 > 0.0f || d3 > 0.0f;
+        if (negative && positive) {
+            continue;
+        }
+        float slope = fabsf(y - my)/(x - mx);
+        if (slope < best_slope) {
+            best_slope = slope;
+            best = i;
+        }
+    }
+
+    // Splice the hole in after the outline point: the hole point, the rest
+    // of the hole, the hole point again, and back to the outline point
+    bridge_.clear();
+    for (size_t i = 0; i <= count; i++) {
+        bridge_.push_back(outline_[first + (m + i) % count]);
+    }
+    bridge_.push_back(loop_[best]);
+    loop_.insert(loop_.begin() + best + 1, bridge_.begin(), bridge_.end());
+}
+
+void CoreMeshSplitter::triangulate() {
+    // Triangulates the current outline by ear clipping.  Holes have already
+    // been bridged into the outline, so it is a single simple polygon.
+    triangle_.clear();
+    uint32_t count = (uint32_t)loop_.size();
+    const float* x = &loop_x_.front();
+    const float* y = &loop_y_.front();
+    float area = 0.0f;
+    for (uint32_t i = 0, j = count - 1; i < count; j = i++) {
+        area += x[j]*y[i] - x[i]*y[j];
+    }
+    if (area <= 0.0f) {
+        return;
+    }
+
+    loop_prev_.resize(count);
+    loop_next_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        loop_prev_[i] = (i + count - 1) % count;
+        loop_next_[i] = (i + 1) % count;
+    }
+    uint32_t* prev = &loop_prev_.front();
+    uint32_t* next = &loop_next_.front();
+
+    // Corners smaller than this are treated as straight, since cutting 
+    // through flat faces leaves many points in a row.  Straight corners 
+    // aren't ears, but they are kept, because the faces around the cut
+    // share them.
+    float epsilon = area * 1e-6f;
+    uint32_t remaining = count;
+    uint32_t i = 0;
+    uint32_t skipped = 0;
+    while (remaining > 3) {
+        uint32_t p = prev[i];
+        uint32_t n = next[i];
+        float corner = (x[i] - x[p])*(y[n] - y[i]) - (y[i] - y[p])*(x[n] - x[i]);
+        bool ear = false;
+        if (corner > epsilon) {
+            // The corner is an ear if no other point is inside it
+            ear = true;
+            for (uint32_t j = next[n]; j != p; j = next[j]) {
+                if ((x[i] - x[p])*(y[j] - y[p]) - (y[i] - y[p])*(x[j] - x[p]) > 0.0f &&
+                    (x[n] - x[i])*(y[j] - y[i]) - (y[n] - y[i])*(x[j] - x[i]) > 0.0f &&
+                    (x[p] - x[n])*(y[j] - y[n]) - (y[p] - y[n])*(x[j] - x[n]) > 0.0f) {
+                    ear = false;
+                    break;
+                }
+            }
+        }
+
+        // If the outline is self-intersecting, there may be no ears left;
+        // clip a corner anyway so that the loop terminates
+        if (ear || skipped > remaining) {
+            triangle_.push_back(p);
+            triangle_.push_back(i);
+            triangle_.push_back(n);
+            next[p] = n;
+            prev[n] = p;
+            remaining--;
+            skipped = 0;
+        } else {
+            skipped++;
+        }
+        i = n;
+    }
+
+    triangle_.push_back(prev[i]);
+    triangle_.push_back(i);
+    triangle_.push_back(next[i]);
+}
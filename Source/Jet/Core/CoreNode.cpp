@@ -32,6 +32,7 @@
 #include <Jet/Core/CoreFractureObject.hpp>
 #include <Jet/Core/CoreCollisionSphere.hpp>
 #include <stdexcept>
+#include <typeinfo>
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
@@ -48,6 +49,24 @@ V& get_value(std::pair<K, V>& p) {
     return p.second; 
 }
 
+static bool has_geometry(Object* object) {
+	// Returns true if the object adds a shape to the rigid body.  This 
+	// matches the objects that BulletRigidBody::attach_node() attaches.
+	const type_info& info = typeid(*object);
+	if (typeid(CoreMeshObject) == info) {
+		return static_cast<CoreMeshObject*>(object)->mesh() != 0;
+	} else if (typeid(CoreCollisionSphere) == info) {
+		return true;
+	} else if (typeid(CoreNode) == info) {
+		for (Iterator<ObjectPtr> i = static_cast<CoreNode*>(object)->objects(); i; i++) {
+			if (has_geometry(i->get())) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 CoreNode::~CoreNode() {
 	if (!destroyed_) {
 		// If the node hasn't been destroyed, then mark it as destroyed
@@ -124,6 +143,13 @@ void CoreNode::add_object(const std::string& name, Object* object) {
 	} else {
 		object_.insert(make_pair(name, object));
 	}
+	
+	// If the new object carries geometry (a mesh, a collision sphere, or a
+	// subtree with either), then the owning rigid body must rebuild its 
+	// shape.  Other objects, and empty child nodes, don't change it.
+	if (has_geometry(object)) {
+		geometry_changed();
+	}
 }
 
 void CoreNode::delete_object(Object* object) {
@@ -132,7 +158,11 @@ void CoreNode::delete_object(Object* object) {
 	// many children, and deletes are infrequent.
     for (unordered_map<string, ObjectPtr>::iterator i = object_.begin(); i != object_.end(); i++) {
         if (i->second == object) {
+            bool geometry = has_geometry(object);
             object_.erase(i);
+            if (geometry) {
+                geometry_changed();
+            }
             return;
         }
     }
@@ -293,6 +323,13 @@ void CoreNode::destroy() {
     }
 }
 
+void CoreNode::attach(CoreNode* node) {
+	if (node->parent_ != this) {
+		throw runtime_error("Node has a different parent");
+	}
+	add_object("", node);
+}
+
 void CoreNode::collision(Node* node, const Vector& position) {
 	if (master()) {
 		// Handle a collision event by notifying all listeners
@@ -303,6 +340,15 @@ void CoreNode::collision(Node* node, const Vector& position) {
 	}
 }
 
+void CoreNode::separation(Node* node) {
+	if (master()) {
+		CoreActor* actor = static_cast<CoreActor*>(actor_.get());
+		if (actor && actor->current_state_) {
+			actor->current_state_->on_separation(node);
+		}
+	}
+}
+
 void CoreNode::fracture(Node* node) {
 	// Handle a fracture event (i.e., a new node is created using this
 	// node as a template of some kind)
@@ -315,6 +361,7 @@ void CoreNode::fracture(Node* node) {
 void CoreNode::update() {	
 	// Calculate the transform for this node if the transform is dirty.
 	update_transform();
+	update_render_transform();
 	
 	// Update all child nodes, and their transforms
 	for (unordered_map<string, ObjectPtr>::iterator i = object_.begin(); i != object_.end(); i++) {
@@ -336,6 +383,13 @@ void CoreNode::tick() {
 	// Calculate the transform for this node if the transform is dirty.
 	update_transform();
 	
+	// Save the transform, so that rendering can interpolate between the
+	// transform before this tick and the transform after it
+	prev_position_ = position_;
+	prev_rotation_ = rotation_;
+	tick_modified_count_ = transform_modified_count_;
+	tick_id_ = engine_->tick_id();
+	
 	// Update all child nodes, and their transforms
 	for (unordered_map<string, ObjectPtr>::iterator i = object_.begin(); i != object_.end(); i++) {
 		const type_info& info = typeid(*i->second);
@@ -382,3 +436,28 @@ void CoreNode::update_transform() {
 		world_rotation_ = matrix_.rotation();
 	}
 }
+
+void CoreNode::update_render_transform() {
+	// Only nodes that moved during the last tick need to be interpolated.
+	// Nodes that were created after the last tick started have nothing to
+	// interpolate from.  Children of interpolated nodes must be updated 
+	// too, but they can use their own current transform.
+	bool moved = (engine_->tick_id() == tick_id_ + 1) && (transform_modified_count_ != tick_modified_count_);
+	interpolated_ = moved || (parent_ && parent_->interpolated_);
+	if (!interpolated_) {
+		return;
+	}
+	
+	Matrix local;
+	if (moved) {
+		float alpha = engine_->tick_alpha();
+		local = Matrix(prev_rotation_.slerp(rotation_, alpha), prev_position_.lerp(position_, alpha));
+	} else {
+		local = Matrix(rotation_, position_);
+	}
+	if (parent_) {
+		render_matrix_ = parent_->render_matrix() * local;
+	} else {
+		render_matrix_ = local;
+	}
+}
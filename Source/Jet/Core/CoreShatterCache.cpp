@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Core/CoreShatterCache.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Resources/Geometry.hpp>
+#include <Jet/Types/Plane.hpp>
+#include <Jet/Types/Vertex.hpp>
+#include <boost/lexical_cast.hpp>
+#include <stdexcept>
+#include <fstream>
+#include <cmath>
+
+using namespace Jet;
+using namespace std;
+using namespace boost;
+
+// Seed for the cell centers.  The seed is fixed so that a mesh always
+// shatters the same way, including on every machine in a network game.
+#define JET_SHATTER_SEED 0x9e3779b9
+
+#define SHATTER_MAGIC 0x5448534a // "JSHT"
+#define SHATTER_VERSION 1
+
+// Returns a random number between 0 and 1, and advances the seed
+static inline float random_unit(uint32_t& seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) / (float)(1 << 24);
+}
+
+// Finds the eigenvalues and eigenvectors of a symmetric 3x3 matrix with
+// Jacobi rotations.  The matrix is destroyed; the eigenvalues end up on
+// its diagonal, and the eigenvectors are the columns of v.
+static void jacobi(double a[3][3], double v[3][3]) {
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            v[i][j] = (i == j) ? 1.0 : 0.0;
+        }
+    }
+    for (int sweep = 0; sweep < 32; sweep++) {
+        double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+        double diagonal = fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2]);
+        if (off <= 1e-12 * diagonal) {
+            return;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (0.0 == a[p][q]) {
+                    continue;
+                }
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta + 1.0));
+                double c = 1.0 / sqrt(t*t + 1.0);
+                double s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    double akp = a[k][p];
+                    double akq = a[k][q];
+                    a[k][p] = c*akp - s*akq;
+                    a[k][q] = s*akp + c*akq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double apk = a[p][k];
+                    double aqk = a[q][k];
+                    a[p][k] = c*apk - s*aqk;
+                    a[q][k] = s*apk + c*aqk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double vkp = v[k][p];
+                    double vkq = v[k][q];
+                    v[k][p] = c*vkp - s*vkq;
+                    v[k][q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+}
+
+// Finds the volume, center of mass, principal axes, and moments of inertia
+// (per unit mass) of a closed piece, assuming it has uniform density.  
+// Returns the volume, which is 0 or less if the piece is empty.
+static float mass_properties(const CoreMeshPiece& cell, Vector& center, Vector axis[3], Vector& inertia) {
+    // Add up the tetrahedrons formed by each triangle and the origin.  The
+    // second moment of each tetrahedron is det/120 * (sum of v v^T over 
+    // its corners + s s^T), where s is the sum of the corners.
+    double volume = 0.0;
+    double centroid[3] = { 0.0, 0.0, 0.0 };
+    double moment[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+    for (size_t g = 0; g < cell.index.size(); g++) {
+        const vector<uint32_t>& index = cell.index[g];
+        for (size_t k = 2; k < index.size(); k += 3) {
+            const Vector& a = cell.vertex[index[k-2]].position;
+            const Vector& b = cell.vertex[index[k-1]].position;
+            const Vector& c = cell.vertex[index[k-0]].position;
+            double det = a.dot(b.cross(c));
+            double p[3][3] = { { a.x, a.y, a.z }, { b.x, b.y, b.z }, { c.x, c.y, c.z } };
+            double s[3] = { p[0][0] + p[1][0] + p[2][0], p[0][1] + p[1][1] + p[2][1], p[0][2] + p[1][2] + p[2][2] };
+            volume += det;
+            for (int i = 0; i < 3; i++) {
+                centroid[i] += s[i] * det;
+                for (int j = 0; j < 3; j++) {
+                    moment[i][j] += det * (p[0][i]*p[0][j] + p[1][i]*p[1][j] + p[2][i]*p[2][j] + s[i]*s[j]);
+                }
+            }
+        }
+    }
+    if (volume <= 0.0) {
+        return 0.0f;
+    }
+    for (int i = 0; i < 3; i++) {
+        centroid[i] /= 4.0 * volume;
+    }
+    volume /= 6.0;
+
+    // Move the second moment to the center of mass, and turn it into the
+    // inertia tensor per unit mass
+    double tensor[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            moment[i][j] = moment[i][j] / (120.0 * volume) - centroid[i]*centroid[j];
+        }
+    }
+    double trace = moment[0][0] + moment[1][1] + moment[2][2];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            tensor[i][j] = ((i == j) ? trace : 0.0) - moment[i][j];
+        }
+    }
+
+    double v[3][3];
+    jacobi(tensor, v);
+    center = Vector((float)centroid[0], (float)centroid[1], (float)centroid[2]);
+    inertia = Vector((float)max(tensor[0][0], 0.0), (float)max(tensor[1][1], 0.0), (float)max(tensor[2][2], 0.0));
+    axis[0] = Vector((float)v[0][0], (float)v[1][0], (float)v[2][0]).unit();
+    axis[1] = Vector((float)v[0][1], (float)v[1][1], (float)v[2][1]).unit();
+    axis[2] = axis[0].cross(axis[1]);
+    return (float)volume;
+}
+
+CoreShatterCache::CoreShatterCache(CoreEngine* engine) :
+    engine_(engine) {
+
+    engine_->option("shatter_cache_size", 16.0f);
+}
+
+CoreShatterPattern* CoreShatterCache::pattern(Mesh* mesh, size_t count) {
+    if (RS_UNLOADED == mesh->state()) {
+        mesh->state(RS_CACHED);
+    }
+    uint64_t hash = mesh->geometry_hash();
+    Key key(hash, count);
+    map<Key, CoreShatterPatternPtr>::iterator i = pattern_.find(key);
+    if (i != pattern_.end()) {
+        return i->second.get();
+    }
+
+    // Use the cooked pattern if there is one for this version of the mesh
+    string path;
+    try {
+        path = engine_->resource_path(mesh->name() + "." + lexical_cast<string>(count) + ".shatter");
+    } catch (std::exception&) {
+        path.clear();
+    }
+    vector<CoreShatterPiece> piece;
+    if (path.empty() || !read_pattern(path, hash, count, cell_, piece)) {
+        piece_.read(mesh);
+        shatter(piece_, count, engine_->mesh_splitter(), cell_, piece);
+    }
+
+    // Build the collision hulls now, rather than when the pieces are 
+    // first used
+    CoreShatterPatternPtr pattern(new CoreShatterPattern);
+    pattern->piece.swap(piece);
+    for (size_t i = 0; i < pattern->piece.size(); i++) {
+        pattern->piece[i].mesh = engine_->mesh();
+        cell_[i].write(pattern->piece[i].mesh.get());
+        pattern->piece[i].mesh->geometry()->state(RS_LOADED);
+    }
+    insert(key, pattern.get());
+    return pattern.get();
+}
+
+void CoreShatterCache::cook(Mesh* mesh, size_t count, const std::string& path) {
+    CoreMeshPiece in;
+    CoreMeshSplitter splitter;
+    vector<CoreMeshPiece> cell;
+    vector<CoreShatterPiece> piece;
+    in.read(mesh);
+    shatter(in, count, &splitter, cell, piece);
+    if (!write_pattern(path, mesh->geometry_hash(), count, cell, piece)) {
+        throw runtime_error("Could not write shatter file: " + path);
+    }
+}
+
+void CoreShatterCache::shatter(const CoreMeshPiece& in, size_t count, CoreMeshSplitter* splitter, std::vector<CoreMeshPiece>& cell, std::vector<CoreShatterPiece>& piece) {
+    // Scatter the cell centers through the bounding box of the mesh
+    const Box& box = in.bounds;
+    uint32_t seed = JET_SHATTER_SEED;
+    vector<Vector> center(count);
+    for (size_t i = 0; i < count; i++) {
+        center[i].x = box.min_x + (box.max_x - box.min_x) * random_unit(seed);
+        center[i].y = box.min_y + (box.max_y - box.min_y) * random_unit(seed);
+        center[i].z = box.min_z + (box.max_z - box.min_z) * random_unit(seed);
+    }
+
+    // Each cell is the part of the mesh that is closer to its center than
+    // to any other center, so clip the mesh by the plane halfway between
+    // the cell's center and each of the others
+    CoreMeshPiece below;
+    CoreMeshPiece above;
+    float total_volume = 0.0f;
+    cell.resize(count);
+    piece.clear();
+    for (size_t i = 0; i < count; i++) {
+        CoreMeshPiece& out = cell[piece.size()];
+        out = in;
+        for (size_t j = 0; j < count && out.index_count(); j++) {
+            Vector normal = center[j] - center[i];
+            if (i == j || normal.length2() <= 0.0f) {
+                continue;
+            }
+            Plane plane(normal.unit(), (center[i] + center[j]) * 0.5f);
+            splitter->split(out, plane, true, below, above);
+            out.swap(below);
+        }
+
+        CoreShatterPiece result;
+        Vector axis[3];
+        float volume = mass_properties(out, result.center, axis, result.inertia);
+        if (volume <= 0.0f) {
+            continue;
+        }
+
+        // Move the piece into its principal frame
+        out.bounds = Box();
+        for (size_t k = 0; k < out.vertex.size(); k++) {
+            Vertex& vertex = out.vertex[k];
+            Vector position = vertex.position - result.center;
+            vertex.position = Vector(position.dot(axis[0]), position.dot(axis[1]), position.dot(axis[2]));
+            vertex.normal = Vector(vertex.normal.dot(axis[0]), vertex.normal.dot(axis[1]), vertex.normal.dot(axis[2]));
+            vertex.tangent = Vector(vertex.tangent.dot(axis[0]), vertex.tangent.dot(axis[1]), vertex.tangent.dot(axis[2]));
+            out.bounds.point(vertex.position);
+        }
+        result.rotation = Quaternion(axis[0], axis[1], axis[2]);
+        result.mass_fraction = volume;
+        piece.push_back(result);
+        total_volume += volume;
+    }
+    cell.resize(piece.size());
+
+    for (size_t i = 0; i < piece.size(); i++) {
+        piece[i].mass_fraction /= total_volume;
+    }
+}
+
+// Reads and writes the fields of a pattern file.  Counts are stored as 
+// 32-bit integers and everything else as floats.
+static void write_uint(ofstream& out, uint32_t value) {
+    out.write((const char*)&value, sizeof(value));
+}
+
+static void write_floats(ofstream& out, const float* value, size_t count) {
+    out.write((const char*)value, count * sizeof(float));
+}
+
+static bool read_uint(ifstream& in, uint32_t& value, uint32_t max) {
+    return in.read((char*)&value, sizeof(value)) && value <= max;
+}
+
+static bool read_floats(ifstream& in, float* value, size_t count) {
+    return !!in.read((char*)value, count * sizeof(float));
+}
+
+bool CoreShatterCache::read_pattern(const std::string& path, uint64_t hash, size_t count, std::vector<CoreMeshPiece>& cell, std::vector<CoreShatterPiece>& piece) {
+    ifstream in(path.c_str(), ios::binary);
+    in.seekg(0, ios::end);
+    uint32_t size = (uint32_t)in.tellg();
+    in.seekg(0, ios::beg);
+
+    // Every count is checked against the size of the file before anything
+    // is allocated, so a damaged file can't cause a huge allocation
+    uint32_t header[4];
+    uint64_t file_hash = 0;
+    if (!in.read((char*)header, sizeof(header)) || !in.read((char*)&file_hash, sizeof(file_hash))) {
+        return false;
+    }
+    if (SHATTER_MAGIC != header[0] || SHATTER_VERSION != header[1] || count != header[2] || hash != file_hash || header[3] > count) {
+        return false;
+    }
+
+    cell.resize(header[3]);
+    piece.resize(header[3]);
+    for (size_t i = 0; i < piece.size(); i++) {
+        float value[11];
+        uint32_t vertex_count = 0;
+        uint32_t group_count = 0;
+        if (!read_floats(in, value, 11) || !read_uint(in, vertex_count, size / sizeof(Vertex)) || !read_uint(in, group_count, size)) {
+            return false;
+        }
+        piece[i].center = Vector(value[0], value[1], value[2]);
+        piece[i].rotation = Quaternion(value[3], value[4], value[5], value[6]);
+        piece[i].inertia = Vector(value[7], value[8], value[9]);
+        piece[i].mass_fraction = value[10];
+
+        CoreMeshPiece& out = cell[i];
+        out.bounds = Box();
+        out.vertex.resize(vertex_count);
+        for (size_t k = 0; k < vertex_count; k++) {
+            float data[11];
+            if (!read_floats(in, data, 11)) {
+                return false;
+            }
+            Vertex& vertex = out.vertex[k];
+            vertex.position = Vector(data[0], data[1], data[2]);
+            vertex.normal = Vector(data[3], data[4], data[5]);
+            vertex.tangent = Vector(data[6], data[7], data[8]);
+            vertex.texcoord = Texcoord(data[9], data[10]);
+            out.bounds.point(vertex.position);
+        }
+        out.group.resize(group_count);
+        out.index.resize(group_count);
+        for (size_t g = 0; g < group_count; g++) {
+            uint32_t length = 0;
+            uint32_t index_count = 0;
+            if (!read_uint(in, length, size)) {
+                return false;
+            }
+            out.group[g].resize(length);
+            if (length && !in.read(&out.group[g][0], length)) {
+                return false;
+            }
+            if (!read_uint(in, index_count, size / sizeof(uint32_t))) {
+                return false;
+            }
+            out.index[g].resize(index_count);
+            if (index_count && !in.read((char*)&out.index[g].front(), index_count * sizeof(uint32_t))) {
+                return false;
+            }
+            for (size_t k = 0; k < index_count; k++) {
+                if (out.index[g][k] >= vertex_count) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool CoreShatterCache::write_pattern(const std::string& path, uint64_t hash, size_t count, const std::vector<CoreMeshPiece>& cell, const std::vector<CoreShatterPiece>& piece) {
+    ofstream out(path.c_str(), ios::binary);
+    if (!out) {
+        return false;
+    }
+    uint32_t header[4] = { SHATTER_MAGIC, SHATTER_VERSION, (uint32_t)count, (uint32_t)piece.size() };
+    out.write((const char*)header, sizeof(header));
+    out.write((const char*)&hash, sizeof(hash));
+    for (size_t i = 0; i < piece.size(); i++) {
+        const CoreShatterPiece& p = piece[i];
+        float value[11] = { 
+            p.center.x, p.center.y, p.center.z, 
+            p.rotation.w, p.rotation.x, p.rotation.y, p.rotation.z,
+            p.inertia.x, p.inertia.y, p.inertia.z,
+            p.mass_fraction 
+        };
+        write_floats(out, value, 11);
+        write_uint(out, (uint32_t)cell[i].vertex.size());
+        write_uint(out, (uint32_t)cell[i].group.size());
+        for (size_t k = 0; k < cell[i].vertex.size(); k++) {
+            const Vertex& v = cell[i].vertex[k];
+            float data[11] = { 
+                v.position.x, v.position.y, v.position.z, 
+                v.normal.x, v.normal.y, v.normal.z,
+                v.tangent.x, v.tangent.y, v.tangent.z,
+                v.texcoord.u, v.texcoord.v
+            };
+            write_floats(out, data, 11);
+        }
+        for (size_t g = 0; g < cell[i].group.size(); g++) {
+            const string& group = cell[i].group[g];
+            const vector<uint32_t>& index = cell[i].index[g];
+            write_uint(out, (uint32_t)group.length());
+            out.write(group.data(), group.length());
+            write_uint(out, (uint32_t)index.size());
+            if (!index.empty()) {
+                out.write((const char*)&index.front(), index.size() * sizeof(uint32_t));
+            }
+        }
+    }
+    return out.good();
+}
+
+void CoreShatterCache::insert(const Key& key, CoreShatterPattern* pattern) {
+    // Throw out the oldest patterns first.  Objects that are still using
+    // a pattern keep their own reference to it.
+    size_t max_size = max((size_t)engine_->option<float>("shatter_cache_size"), (size_t)1);
+    if (pattern_.find(key) == pattern_.end()) {
+        order_.push_back(key);
+    }
+    pattern_[key] = pattern;
+    while (order_.size() > max_size) {
+        pattern_.erase(order_.front());
+        order_.pop_front();
+    }
+}
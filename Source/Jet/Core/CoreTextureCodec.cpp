@@ -0,0 +1,584 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Core/CoreTextureCodec.hpp>
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JET_SSE2
+#endif
+
+using namespace Jet;
+using namespace std;
+
+// DDS header constants; see the DDS_HEADER docs on MSDN
+#define DDS_HEADER_SIZE 128
+#define DDS_HEADER_DX10_SIZE 20
+#define DDSD_CAPS 0x1
+#define DDSD_HEIGHT 0x2
+#define DDSD_WIDTH 0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE 0x80000
+#define DDPF_FOURCC 0x4
+#define DDSCAPS_COMPLEX 0x8
+#define DDSCAPS_TEXTURE 0x1000
+#define DDSCAPS_MIPMAP 0x400000
+#define DXGI_FORMAT_BC1_UNORM 71
+#define DXGI_FORMAT_BC1_UNORM_SRGB 72
+#define DXGI_FORMAT_BC3_UNORM 77
+#define DXGI_FORMAT_BC3_UNORM_SRGB 78
+#define DXGI_FORMAT_BC5_UNORM 83
+
+static inline uint32_t fourcc(const char* code) {
+	return code[0] | (code[1] << 8) | (code[2] << 16) | (code[3] << 24);
+}
+
+static inline uint32_t read32(const uint8_t* in) {
+	return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static inline void write32(uint8_t* out, uint32_t value) {
+	out[0] = (uint8_t)(value);
+	out[1] = (uint8_t)(value >> 8);
+	out[2] = (uint8_t)(value >> 16);
+	out[3] = (uint8_t)(value >> 24);
+}
+
+// Converts a color to 5:6:5, rounding to the nearest representable color
+static uint16_t pack565(const float color[3]) {
+	int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+	r = min(max(r, 0), 31);
+	g = min(max(g, 0), 63);
+	b = min(max(b, 0), 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// Expands a 5:6:5 color to 8 bits per channel the same way the hardware does
+static void unpack565(uint16_t color, int out[3]) {
+	int r = (color >> 11) & 0x1f;
+	int g = (color >> 5) & 0x3f;
+	int b = color & 0x1f;
+	out[0] = (r << 3) | (r >> 2);
+	out[1] = (g << 2) | (g >> 4);
+	out[2] = (b << 3) | (b >> 2);
+}
+
+// Builds the palette for a color block.  If c0 <= c1 in BC1, the block
+// uses 3 colors plus transparent black; BC3 blocks always use 4 colors.
+static void color_palette(uint16_t c0, uint16_t c1, bool four_color, int palette[4][4]) {
+	unpack565(c0, palette[0]);
+	unpack565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	for (size_t c = 0; c < 3; c++) {
+		if (four_color) {
+			palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+		} else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	if (!four_color) {
+		palette[3][3] = 0;
+	}
+}
+
+// Picks the closest palette entry for each pixel in the block, and returns
+// the total squared error
+static uint32_t color_indices(const uint8_t block[64], uint16_t c0, uint16_t c1, uint32_t& indices) {
+	int palette[4][4];
+	color_palette(c0, c1, true, palette);
+
+	uint32_t error = 0;
+	indices = 0;
+	for (size_t i = 0; i < 16; i++) {
+		const uint8_t* pixel = block + 4*i;
+		uint32_t best_error = 0xffffffff;
+		uint32_t best = 0;
+		for (uint32_t j = 0; j < 4; j++) {
+			int dr = pixel[0] - palette[j][0];
+			int dg = pixel[1] - palette[j][1];
+			int db = pixel[2] - palette[j][2];
+			uint32_t e = dr*dr + dg*dg + db*db;
+			if (e < best_error) {
+				best_error = e;
+				best = j;
+			}
+		}
+		indices |= best << (2*i);
+		error += best_error;
+	}
+	return error;
+}
+
+// Encodes the colors of a 4x4 block.  The endpoints start at the extremes
+// of the block along its principal axis, and are then refined by a least
+// squares fit to the chosen indices.
+static void encode_color_block(const uint8_t block[64], uint8_t* out) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t i = 0; i < 16; i++) {
+		for (size_t c = 0; c < 3; c++) {
+			mean[c] += block[4*i+c];
+		}
+	}
+	for (size_t c = 0; c < 3; c++) {
+		mean[c] /= 16.0f;
+	}
+
+	// Covariance matrix, stored as rr, rg, rb, gg, gb, bb
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (size_t i = 0; i < 16; i++) {
+		float r = block[4*i+0] - mean[0];
+		float g = block[4*i+1] - mean[1];
+		float b = block[4*i+2] - mean[2];
+		cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+		cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+	}
+
+	// Find the principal axis using power iteration
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (size_t k = 0; k < 8; k++) {
+		float x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+		float y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+		float z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+		float length = max(max(fabsf(x), fabsf(y)), fabsf(z));
+		if (length < 1e-6f) {
+			break;
+		}
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	float tmin = 0.0f, tmax = 0.0f;
+	for (size_t i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (size_t c = 0; c < 3; c++) {
+			t += (block[4*i+c] - mean[c]) * axis[c];
+		}
+		tmin = min(tmin, t);
+		tmax = max(tmax, t);
+	}
+	float length2 = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+	float e0[3], e1[3];
+	for (size_t c = 0; c < 3; c++) {
+		e0[c] = mean[c] + axis[c] * tmax / max(length2, 1e-6f);
+		e1[c] = mean[c] + axis[c] * tmin / max(length2, 1e-6f);
+	}
+
+	uint16_t c0 = pack565(e0);
+	uint16_t c1 = pack565(e1);
+	uint32_t indices = 0;
+	uint32_t error = color_indices(block, c0, c1, indices);
+
+	// Refine the endpoints.  Index 0 and 1 are the endpoints; 2 and 3 are
+	// at 1/3 and 2/3 of the way from endpoint 0 to endpoint 1.
+	static const float weight[4] = { 1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f };
+	for (size_t k = 0; k < 2 && error > 0; k++) {
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[3] = { 0.0f, 0.0f, 0.0f };
+		float bx[3] = { 0.0f, 0.0f, 0.0f };
+		for (size_t i = 0; i < 16; i++) {
+			float a = weight[(indices >> (2*i)) & 0x3];
+			float b = 1.0f - a;
+			aa += a*a;
+			bb += b*b;
+			ab += a*b;
+			for (size_t c = 0; c < 3; c++) {
+				ax[c] += a * block[4*i+c];
+				bx[c] += b * block[4*i+c];
+			}
+		}
+		float det = aa*bb - ab*ab;
+		if (fabsf(det) < 1e-6f) {
+			break;
+		}
+		for (size_t c = 0; c < 3; c++) {
+			e0[c] = (ax[c]*bb - bx[c]*ab) / det;
+			e1[c] = (bx[c]*aa - ax[c]*ab) / det;
+		}
+
+		uint16_t n0 = pack565(e0);
+		uint16_t n1 = pack565(e1);
+		uint32_t n_indices = 0;
+		uint32_t n_error = color_indices(block, n0, n1, n_indices);
+		if (n_error >= error) {
+			break;
+		}
+		c0 = n0;
+		c1 = n1;
+		indices = n_indices;
+		error = n_error;
+	}
+
+	// The decoder picks 4-color mode only if c0 > c1.  Swapping the
+	// endpoints maps index 0 <-> 1 and 2 <-> 3.
+	if (c0 < c1) {
+		swap(c0, c1);
+		indices ^= 0x55555555;
+	} else if (c0 == c1) {
+		indices = 0;
+	}
+	out[0] = (uint8_t)(c0);
+	out[1] = (uint8_t)(c0 >> 8);
+	out[2] = (uint8_t)(c1);
+	out[3] = (uint8_t)(c1 >> 8);
+	write32(out + 4, indices);
+}
+
+static void decode_color_block(const uint8_t* in, bool four_color, uint8_t block[64]) {
+	uint16_t c0 = in[0] | (in[1] << 8);
+	uint16_t c1 = in[2] | (in[3] << 8);
+	uint32_t indices = read32(in + 4);
+
+	int palette[4][4];
+	color_palette(c0, c1, four_color || c0 > c1, palette);
+	for (size_t i = 0; i < 16; i++) {
+		const int* color = palette[(indices >> (2*i)) & 0x3];
+		block[4*i+0] = (uint8_t)color[0];
+		block[4*i+1] = (uint8_t)color[1];
+		block[4*i+2] = (uint8_t)color[2];
+		block[4*i+3] = (uint8_t)color[3];
+	}
+}
+
+// Builds the palette for a single-channel block (BC3 alpha, BC4, BC5).  If
+// a0 <= a1 the block uses 6 interpolated values plus 0 and 255.
+static void channel_palette(uint8_t a0, uint8_t a1, int palette[8]) {
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1) {
+		for (int i = 2; i < 8; i++) {
+			palette[i] = ((8-i)*a0 + (i-1)*a1) / 7;
+		}
+	} else {
+		for (int i = 2; i < 6; i++) {
+			palette[i] = ((6-i)*a0 + (i-1)*a1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// Encodes one channel of a 4x4 block using 8 values between the minimum
+// and maximum of the block
+static void encode_channel_block(const uint8_t block[64], size_t channel, uint8_t* out) {
+	uint8_t a0 = 0, a1 = 255;
+	for (size_t i = 0; i < 16; i++) {
+		a0 = max(a0, block[4*i+channel]);
+		a1 = min(a1, block[4*i+channel]);
+	}
+
+	uint64_t indices = 0;
+	if (a0 != a1) {
+		int palette[8];
+		channel_palette(a0, a1, palette);
+		for (size_t i = 0; i < 16; i++) {
+			int value = block[4*i+channel];
+			uint64_t best = 0;
+			int best_error = 256;
+			for (size_t j = 0; j < 8; j++) {
+				int e = abs(value - palette[j]);
+				if (e < best_error) {
+					best_error = e;
+					best = j;
+				}
+			}
+			indices |= best << (3*i);
+		}
+	}
+	out[0] = a0;
+	out[1] = a1;
+	for (size_t i = 0; i < 6; i++) {
+		out[2+i] = (uint8_t)(indices >> (8*i));
+	}
+}
+
+static void decode_channel_block(const uint8_t* in, size_t channel, uint8_t block[64]) {
+	int palette[8];
+	channel_palette(in[0], in[1], palette);
+	uint64_t indices = 0;
+	for (size_t i = 0; i < 6; i++) {
+		indices |= (uint64_t)in[2+i] << (8*i);
+	}
+	for (size_t i = 0; i < 16; i++) {
+		block[4*i+channel] = (uint8_t)palette[(indices >> (3*i)) & 0x7];
+	}
+}
+
+size_t CoreTextureCodec::block_size(TextureCodecFormat format) {
+	return (TCF_BC1 == format) ? 8 : 16;
+}
+
+size_t CoreTextureCodec::compressed_size(TextureCodecFormat format, size_t width, size_t height) {
+	return ((width + 3) / 4) * ((height + 3) / 4) * block_size(format);
+}
+
+size_t CoreTextureCodec::channels(TextureCodecFormat format) {
+	switch (format) {
+		case TCF_BC1: return 3;
+		case TCF_BC3: return 4;
+		case TCF_BC5: return 2;
+	}
+	return 4;
+}
+
+void CoreTextureCodec::encode(TextureCodecFormat format, const uint8_t* rgba, size_t width, size_t height, uint8_t* out) {
+	uint8_t block[64];
+	for (size_t by = 0; by < height; by += 4) {
+		for (size_t bx = 0; bx < width; bx += 4) {
+
+			// Gather the block.  Blocks that hang over the edge of the image
+			// repeat the last row/column.
+			for (size_t y = 0; y < 4; y++) {
+				const uint8_t* row = rgba + 4*width*min(by + y, height - 1);
+				for (size_t x = 0; x < 4; x++) {
+					const uint8_t* pixel = row + 4*min(bx + x, width - 1);
+					uint8_t* dst = block + 4*(4*y + x);
+					dst[0] = pixel[0];
+					dst[1] = pixel[1];
+					dst[2] = pixel[2];
+					dst[3] = pixel[3];
+				}
+			}
+
+			switch (format) {
+				case TCF_BC1:
+					encode_color_block(block, out);
+					break;
+				case TCF_BC3:
+					encode_channel_block(block, 3, out);
+					encode_color_block(block, out + 8);
+					break;
+				case TCF_BC5:
+					encode_channel_block(block, 0, out);
+					encode_channel_block(block, 1, out + 8);
+					break;
+			}
+			out += block_size(format);
+		}
+	}
+}
+
+void CoreTextureCodec::decode(TextureCodecFormat format, const uint8_t* in, size_t width, size_t height, uint8_t* rgba) {
+	uint8_t block[64];
+	for (size_t by = 0; by < height; by += 4) {
+		for (size_t bx = 0; bx < width; bx += 4) {
+			switch (format) {
+				case TCF_BC1:
+					decode_color_block(in, false, block);
+					break;
+				case TCF_BC3:
+					decode_color_block(in + 8, true, block);
+					decode_channel_block(in, 3, block);
+					break;
+				case TCF_BC5:
+					for (size_t i = 0; i < 16; i++) {
+						block[4*i+2] = 0;
+						block[4*i+3] = 255;
+					}
+					decode_channel_block(in, 0, block);
+					decode_channel_block(in + 8, 1, block);
+					break;
+			}
+			in += block_size(format);
+
+			// Scatter the block, dropping the pixels past the image edges
+			for (size_t y = 0; y < 4 && by + y < height; y++) {
+				for (size_t x = 0; x < 4 && bx + x < width; x++) {
+					uint8_t* dst = rgba + 4*(width*(by + y) + bx + x);
+					const uint8_t* src = block + 4*(4*y + x);
+					dst[0] = src[0];
+					dst[1] = src[1];
+					dst[2] = src[2];
+					dst[3] = src[3];
+				}
+			}
+		}
+	}
+}
+
+float CoreTextureCodec::psnr(const uint8_t* rgba1, const uint8_t* rgba2, size_t width, size_t height, size_t channels) {
+	double error = 0.0;
+	for (size_t i = 0; i < width * height; i++) {
+		for (size_t c = 0; c < channels; c++) {
+			double d = (double)rgba1[4*i+c] - (double)rgba2[4*i+c];
+			error += d*d;
+		}
+	}
+	if (0.0 == error) {
+		return 99.0f;
+	}
+	double mse = error / (double)(width * height * channels);
+	return (float)(10.0 * log10(255.0 * 255.0 / mse));
+}
+
+void CoreTextureCodec::downsample(const uint8_t* in, size_t width, size_t height, uint8_t* out, size_t channels) {
+	size_t out_width = max(width/2, (size_t)1);
+	size_t out_height = max(height/2, (size_t)1);
+	size_t n = channels;
+
+	for (size_t y = 0; y < out_height; y++) {
+		const uint8_t* row0 = in + n*width*min(2*y, height-1);
+		const uint8_t* row1 = in + n*width*min(2*y+1, height-1);
+		uint8_t* dst = out + n*out_width*y;
+		size_t x = 0;
+
+#ifdef JET_SSE2
+		// Average 4 source pixels from each row into 2 output pixels at a
+		// time.  The sums are computed with 16-bit lanes so that the
+		// rounding matches the scalar path exactly.
+		if (4 == n && width == 2*out_width) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16(2);
+			for (; x + 2 <= out_width; x += 2) {
+				__m128i a = _mm_loadu_si128((const __m128i*)(row0 + 8*x));
+				__m128i b = _mm_loadu_si128((const __m128i*)(row1 + 8*x));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64((__m128i*)(dst + 4*x), _mm_packus_epi16(sum, sum));
+			}
+		}
+#endif
+		for (; x < out_width; x++) {
+			size_t x0 = min(2*x, width-1);
+			size_t x1 = min(2*x+1, width-1);
+			for (size_t c = 0; c < n; c++) {
+				uint32_t sum = row0[n*x0+c] + row0[n*x1+c] + row1[n*x0+c] + row1[n*x1+c];
+				dst[n*x+c] = (uint8_t)((sum + 2) >> 2);
+			}
+		}
+	}
+}
+
+void CoreTextureCodec::write_dds(const string& path, TextureCodecFormat format, size_t width, size_t height, const vector<vector<uint8_t> >& level) {
+	uint8_t header[DDS_HEADER_SIZE] = { 0 };
+	uint32_t flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+	uint32_t caps = DDSCAPS_TEXTURE;
+	if (level.size() > 1) {
+		flags |= DDSD_MIPMAPCOUNT;
+		caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	}
+
+	write32(header + 0, fourcc("DDS "));
+	write32(header + 4, 124);
+	write32(header + 8, flags);
+	write32(header + 12, height);
+	write32(header + 16, width);
+	write32(header + 20, level.empty() ? 0 : level[0].size());
+	write32(header + 28, level.size());
+	write32(header + 76, 32);
+	write32(header + 80, DDPF_FOURCC);
+	switch (format) {
+		case TCF_BC1: write32(header + 84, fourcc("DXT1")); break;
+		case TCF_BC3: write32(header + 84, fourcc("DXT5")); break;
+		case TCF_BC5: write32(header + 84, fourcc("ATI2")); break;
+	}
+	write32(header + 108, caps);
+
+	ofstream out(path.c_str(), ios::binary);
+	if (!out.good()) {
+		throw runtime_error("Could not open file: " + path);
+	}
+	out.write((const char*)header, sizeof(header));
+	for (size_t i = 0; i < level.size(); i++) {
+		out.write((const char*)&level[i].front(), level[i].size());
+	}
+	if (!out.good()) {
+		throw runtime_error("Could not write file: " + path);
+	}
+}
+
+void CoreTextureCodec::read_dds(const string& path, TextureCodecFormat& format, size_t& width, size_t& height, vector<vector<uint8_t> >& level) {
+	ifstream in(path.c_str(), ios::binary);
+	if (!in.good()) {
+		throw runtime_error("Could not open file: " + path);
+	}
+	vector<uint8_t> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	if (data.size() < DDS_HEADER_SIZE || read32(&data[0]) != fourcc("DDS ") || read32(&data[4]) != 124) {
+		throw runtime_error("Invalid DDS file: " + path);
+	}
+
+	uint32_t flags = read32(&data[8]);
+	height = read32(&data[12]);
+	width = read32(&data[16]);
+	if (!width || !height) {
+		throw runtime_error("Invalid DDS file: " + path);
+	}
+	size_t levels = (flags & DDSD_MIPMAPCOUNT) ? max(read32(&data[28]), (uint32_t)1) : 1;
+
+	// Look up the compressed format.  Newer tools write the format in the
+	// DX10 extension header instead of the FourCC code.
+	size_t offset = DDS_HEADER_SIZE;
+	uint32_t code = read32(&data[84]);
+	if (!(read32(&data[80]) & DDPF_FOURCC)) {
+		throw runtime_error("Unsupported DDS format: " + path);
+	} else if (fourcc("DXT1") == code) {
+		format = TCF_BC1;
+	} else if (fourcc("DXT5") == code) {
+		format = TCF_BC3;
+	} else if (fourcc("ATI2") == code || fourcc("BC5U") == code) {
+		format = TCF_BC5;
+	} else if (fourcc("DX10") == code && data.size() >= DDS_HEADER_SIZE + DDS_HEADER_DX10_SIZE) {
+		uint32_t dxgi = read32(&data[DDS_HEADER_SIZE]);
+		if (DXGI_FORMAT_BC1_UNORM == dxgi || DXGI_FORMAT_BC1_UNORM_SRGB == dxgi) {
+			format = TCF_BC1;
+		} else if (DXGI_FORMAT_BC3_UNORM == dxgi || DXGI_FORMAT_BC3_UNORM_SRGB == dxgi) {
+			format = TCF_BC3;
+		} else if (DXGI_FORMAT_BC5_UNORM == dxgi) {
+			format = TCF_BC5;
+		} else {
+			throw runtime_error("Unsupported DDS format: " + path);
+		}
+		offset += DDS_HEADER_DX10_SIZE;
+	} else {
+		throw runtime_error("Unsupported DDS format: " + path);
+	}
+
+	// Split the data into mip levels
+	level.clear();
+	size_t level_width = width;
+	size_t level_height = height;
+	for (size_t i = 0; i < levels; i++) {
+		size_t size = compressed_size(format, level_width, level_height);
+		if (offset + size > data.size()) {
+			throw runtime_error("Truncated DDS file: " + path);
+		}
+		level.push_back(vector<uint8_t>(data.begin() + offset, data.begin() + offset + size));
+		offset += size;
+		if (1 == level_width && 1 == level_height) {
+			break;
+		}
+		level_width = max(level_width/2, (size_t)1);
+		level_height = max(level_height/2, (size_t)1);
+	}
+}
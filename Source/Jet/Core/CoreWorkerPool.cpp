@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Core/CoreWorkerPool.hpp>
+#include <stdexcept>
+
+using namespace Jet;
+using namespace std;
+
+CoreWorkerTask::CoreWorkerTask(const boost::function<void ()>& function) :
+    function_(function),
+    done_(false) {
+}
+
+bool CoreWorkerTask::done() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return done_;
+}
+
+void CoreWorkerTask::wait() {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (!done_) {
+        condition_.wait(lock);
+    }
+    if (!error_.empty()) {
+        throw runtime_error(error_);
+    }
+}
+
+void CoreWorkerTask::run() {
+    // Don't let an exception take down the worker thread; keep it for the
+    // thread that waits on the task
+    std::string error;
+    try {
+        function_();
+    } catch (std::exception& ex) {
+        error = ex.what();
+    } catch (...) {
+        error = "Unknown exception in worker task";
+    }
+    function_.clear();
+    finish(error);
+}
+
+void CoreWorkerTask::finish(const std::string& error) {
+    boost::mutex::scoped_lock lock(mutex_);
+    done_ = true;
+    error_ = error;
+    condition_.notify_all();
+}
+
+// Shared state for a parallel_for call.  Helper tasks hold a reference to
+// the job, because they may start running after the call has returned.
+class CoreWorkerPool::ParallelJob {
+public:
+    ParallelJob(size_t count, size_t grain, const boost::function<void (size_t, size_t)>& function) :
+        function(function),
+        count(count),
+        grain(grain),
+        next(0),
+        pending((count + grain - 1) / grain) {
+    }
+
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    boost::function<void (size_t, size_t)> function;
+    size_t count;
+    size_t grain;
+    size_t next;
+    size_t pending;
+    std::string error;
+};
+
+CoreWorkerPool::CoreWorkerPool(size_t threads) :
+    thread_count_(max(threads, (size_t)1)),
+    stopped_(false) {
+
+    for (size_t i = 0; i < thread_count_; i++) {
+        thread_.create_thread(boost::bind(&CoreWorkerPool::run, this));
+    }
+}
+
+CoreWorkerPool::~CoreWorkerPool() {
+    // Wake up all the workers and wait for them to finish their current
+    // task before discarding the queue
+    std::deque<boost::shared_ptr<CoreWorkerTask> > discarded;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        stopped_ = true;
+        discarded.swap(task_);
+    }
+    condition_.notify_all();
+    thread_.join_all();
+    
+    for (size_t i = 0; i < discarded.size(); i++) {
+        discarded[i]->finish("Worker task was discarded");
+    }
+}
+
+boost::shared_ptr<CoreWorkerTask> CoreWorkerPool::task(const boost::function<void ()>& function) {
+    boost::shared_ptr<CoreWorkerTask> task(new CoreWorkerTask(function));
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        task_.push_back(task);
+    }
+    condition_.notify_one();
+    return task;
+}
+
+void CoreWorkerPool::parallel_for(size_t count, size_t grain, const boost::function<void (size_t, size_t)>& function) {
+    grain = max(grain, (size_t)1);
+    if (count <= grain) {
+        if (count) {
+            function(0, count);
+        }
+        return;
+    }
+
+    // Queue one helper per worker thread, up to the number of chunks that 
+    // the calling thread won't take on itself
+    boost::shared_ptr<ParallelJob> job(new ParallelJob(count, grain, function));
+    size_t helpers = min(thread_count_, job->pending - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        task(boost::bind(&CoreWorkerPool::run_chunks, job));
+    }
+    run_chunks(job);
+
+    boost::mutex::scoped_lock lock(job->mutex);
+    while (job->pending) {
+        job->condition.wait(lock);
+    }
+    if (!job->error.empty()) {
+        throw runtime_error(job->error);
+    }
+}
+
+void CoreWorkerPool::run_chunks(boost::shared_ptr<ParallelJob> job) {
+    while (true) {
+        size_t begin = 0;
+        {
+            boost::mutex::scoped_lock lock(job->mutex);
+            if (job->next >= job->count) {
+                return;
+            }
+            begin = job->next;
+            job->next = min(job->next + job->grain, job->count);
+        }
+        
+        std::string error;
+        try {
+            job->function(begin, min(begin + job->grain, job->count));
+        } catch (std::exception& ex) {
+            error = ex.what();
+        } catch (...) {
+            error = "Unknown exception in worker job";
+        }
+
+        boost::mutex::scoped_lock lock(job->mutex);
+        if (!error.empty() && job->error.empty()) {
+            job->error = error;
+        }
+        if (0 == --job->pending) {
+            job->condition.notify_all();
+        }
+    }
+}
+
+void CoreWorkerPool::run() {
+    while (true) {
+        boost::shared_ptr<CoreWorkerTask> task;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            while (task_.empty() && !stopped_) {
+                condition_.wait(lock);
+            }
+            if (stopped_) {
+                return;
+            }
+            task.swap(task_.front());
+            task_.pop_front();
+        }
+
+        task->run();
+    }
+}
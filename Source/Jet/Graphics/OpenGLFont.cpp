@@ -21,25 +21,25 @@
  */
 
 #include <Jet/Graphics/OpenGLFont.hpp>
+#include <Jet/Graphics/OpenGLQuadBuffer.hpp>
 #include <Jet/Core/CoreEngine.hpp>
 #include <boost/lexical_cast.hpp>
+#include <cmath>
 
 using namespace Jet;
 using namespace std;
 
-inline int next_p2(int a) {
-	int rval=1;
-	while(rval < a) {
-        rval *= 2;
-    }
-	return rval;
-}
+// Glyphs for code points below this value are looked up directly in an 
+// array.  Kerning is precomputed for pairs of ASCII characters.
+#define FONT_LATIN_GLYPHS 256
+#define FONT_KERNING_GLYPHS 128
 
 OpenGLFont::OpenGLFont(CoreEngine* engine, const std::string& name) :
     engine_(engine),
     name_(name),
     state_(RS_UNLOADED),
-    list_(0) {
+    library_(0),
+    ft_face_(0) {
         
     size_t pos = name.find("#");
     if (pos == std::string::npos) {
@@ -62,139 +62,210 @@ void OpenGLFont::state(ResourceState state) {
         read_font_data();
     }
     
+    // The glyphs live in the texture atlas, which is destroyed along with
+    // the OpenGL context.  Drop the glyph cache so that the glyphs are
+    // rasterized again the next time they are used.
     if (RS_LOADED == state_) {
-        if (list_ && !texture_.empty()) {
-            glDeleteLists(list_, texture_.size());
-            glDeleteTextures(128, &texture_[0]);
-            texture_.resize(0);
-        }
+        free_font_data();
     }
     
     state_ = state;
 }
 
 void OpenGLFont::read_font_data() {
-    // This routine taken from nehe.gamedev.net
     const std::string path = engine_->resource_path(face_);
-    texture_.resize(128);
     
     // Create and initialize a new FreeType font library handle.
-    FT_Library library;
-    if (FT_Init_FreeType(&library)) {
+    if (FT_Init_FreeType(&library_)) {
         throw runtime_error("Could not initialize font library");
     }
     
-    // Create and initialize a new font face.
-    FT_Face face;
-    if (FT_New_Face(library, path.c_str(), 0, &face)) {
+    // Create and initialize a new font face.  The face stays open while
+    // the font is loaded, so that new glyphs can be rasterized on demand.
+    if (FT_New_Face(library_, path.c_str(), 0, &ft_face_)) {
+        FT_Done_FreeType(library_);
+        library_ = 0;
         throw runtime_error("Could not initialize font");
     }
     
     // FreeType measures font size in 1/64ths of pixels.  So we multiply the
     // height by 64 to get the right size
-    FT_Set_Char_Size(face, height_*64, height_*64, 96, 96);
+    FT_Set_Char_Size(ft_face_, height_*64, height_*64, 96, 96);
     
-    // Generate GL display lists and textures
-    glGenTextures(128, &texture_[0]);
-    list_ = glGenLists(texture_.size());
-    for (unsigned char i = 0; i < 128; i++) {
-        create_bitmap(face, i);
-    }
+    latin_glyph_.assign(FONT_LATIN_GLYPHS, -1);
+    init_kerning();
+}
+
+void OpenGLFont::free_font_data() {
+    glyph_.clear();
+    latin_glyph_.clear();
+    extended_glyph_.clear();
+    kerning_.clear();
     
     // Release the face and font library
-    FT_Done_Face(face);
-    FT_Done_FreeType(library);
+    if (ft_face_) {
+        FT_Done_Face(ft_face_);
+        ft_face_ = 0;
+    }
+    if (library_) {
+        FT_Done_FreeType(library_);
+        library_ = 0;
+    }
 }
 
-void OpenGLFont::create_bitmap(FT_Face face, unsigned char ch) {
-    // Load the glyph for the current character
-    if (FT_Load_Glyph(face, FT_Get_Char_Index(face, ch), FT_LOAD_DEFAULT)) {
-        throw runtime_error("Could not load font glyph");
+void OpenGLFont::init_kerning() {
+    if (!FT_HAS_KERNING(ft_face_)) {
+        return;
     }
     
-    // Move the face's glyph into a glyph object
-    FT_Glyph glyph;
-    if (FT_Get_Glyph(face->glyph, &glyph)) {
-        throw runtime_error("Could not get glyph object");
+    // Precompute the kerning table for all pairs of ASCII characters, which
+    // covers nearly all of the text that is drawn.  Values are stored in
+    // 1/64ths of a pixel.
+    std::vector<FT_UInt> index(FONT_KERNING_GLYPHS);
+    for (size_t i = 0; i < FONT_KERNING_GLYPHS; i++) {
+        index[i] = FT_Get_Char_Index(ft_face_, i);
     }
-    
-    // Convert to a bitmap so that it can be stored in a texture
-    FT_Glyph_To_Bitmap(&glyph, ft_render_mode_normal, 0, 1);
-    FT_BitmapGlyph bitmap_glyph = (FT_BitmapGlyph)glyph;
-    FT_Bitmap bitmap = bitmap_glyph->bitmap;
-    
-    // Get the width and height of the bitmap data
-    int width = next_p2(bitmap.width);
-    int height = next_p2(bitmap.rows);
-    
-    // Allocate memory fo the texture data
-    std::vector<unsigned char> bitmap_data(2*width*height);
-    
-    // Fill the data for the bitmap.  This is a two-channel bitmap,
-    // with luminosity and alpha (no need for separate RGB components)
-    for (int j = 0; j < height; j++) {
-        for (int i = 0; i < width; i++) {
-            int value;
-            if (i >= bitmap.width || j >= bitmap.rows) {
-                value = 0;
-            } else {
-                value = bitmap.buffer[i + bitmap.width*j];
+    kerning_.assign(FONT_KERNING_GLYPHS*FONT_KERNING_GLYPHS, 0);
+    for (size_t i = 0; i < FONT_KERNING_GLYPHS; i++) {
+        for (size_t j = 0; j < FONT_KERNING_GLYPHS; j++) {
+            FT_Vector delta;
+            if (!FT_Get_Kerning(ft_face_, index[i], index[j], FT_KERNING_DEFAULT, &delta)) {
+                kerning_[i*FONT_KERNING_GLYPHS + j] = (int16_t)delta.x;
             }
-            bitmap_data[2*(i+j*width)] = 255; // Luminosity
-            bitmap_data[2*(i+j*width)+1] = value; // Alpha
         }
     }
-    
-    // Now initialize the texture.
-    glBindTexture(GL_TEXTURE_2D, texture_[ch]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, &bitmap_data[0]);
+}
 
-    // Start a new display list.
-    glNewList(list_+ch, GL_COMPILE);
-    glBindTexture(GL_TEXTURE_2D, texture_[ch]);
-    glPushMatrix();
+int OpenGLFont::glyph(OpenGLTextureAtlas* atlas, uint32_t code) {
+    // Check the glyph cache first
+    if (code < FONT_LATIN_GLYPHS) {
+        if (latin_glyph_[code] >= 0) {
+            return latin_glyph_[code];
+        }
+    } else {
+        map<uint32_t, int>::iterator i = extended_glyph_.find(code);
+        if (i != extended_glyph_.end()) {
+            return i->second;
+        }
+    }
     
-    // Adjust for left spacing and descent of the glyph.
-    glTranslatef((float)bitmap_glyph->left, 0, 0);
-    glTranslatef(0, (float)(bitmap.rows-bitmap_glyph->top), 0);
+    // Load and rasterize the glyph for the character
+    FT_UInt index = FT_Get_Char_Index(ft_face_, code);
+    if (FT_Load_Glyph(ft_face_, index, FT_LOAD_RENDER)) {
+        return -1;
+    }
+    FT_GlyphSlot slot = ft_face_->glyph;
+    FT_Bitmap& bitmap = slot->bitmap;
     
-    // Compensate for blank space surrounding the character.
-    float x = (float)bitmap.width / (float)width;
-    float y = (float)bitmap.rows / (float)height;
-
-    // Draw the quad for the glyph.
-    glBegin(GL_QUADS);
-    glTexCoord2d(0, 0); glVertex2f(0, -(float)bitmap.rows);
-    glTexCoord2d(0, y); glVertex2f(0, 0);
-    glTexCoord2d(x, y); glVertex2f((float)bitmap.width, 0);
-    glTexCoord2d(x, 0); glVertex2f((float)bitmap.width, -(float)bitmap.rows);
-    glEnd();
-    glPopMatrix();
+    Glyph glyph;
+    glyph.index = index;
+    glyph.advance = (float)slot->advance.x/64;
+    glyph.left = (float)slot->bitmap_left;
+    glyph.top = (float)slot->bitmap_top;
+    glyph.width = (float)bitmap.width;
+    glyph.height = (float)bitmap.rows;
     
-    // Translate by an amount equal to the width of the character.
-    // This puts the cursor in the right position to render
-    // the next character.
-    glTranslatef((float)face->glyph->advance.x/64, 0, 0);
+    // Copy the coverage values into the alpha channel of a white RGBA 
+    // image, and pack the image into the atlas.  Blank glyphs (spaces) 
+    // only have an advance.
+    if (bitmap.width > 0 && bitmap.rows > 0) {
+        bitmap_.resize(4*bitmap.width*bitmap.rows);
+        for (int j = 0; j < (int)bitmap.rows; j++) {
+            for (int i = 0; i < (int)bitmap.width; i++) {
+                uint8_t* out = &bitmap_[4*(i + j*bitmap.width)];
+                out[0] = 255;
+                out[1] = 255;
+                out[2] = 255;
+                out[3] = bitmap.buffer[i + bitmap.pitch*j];
+            }
+        }
+        if (!atlas->insert(bitmap.width, bitmap.rows, &bitmap_.front(), glyph.region)) {
+            glyph.width = 0.0f;
+            glyph.height = 0.0f;
+        }
+    } else {
+        glyph.width = 0.0f;
+        glyph.height = 0.0f;
+    }
     
-    glEndList();
+    int id = (int)glyph_.size();
+    glyph_.push_back(glyph);
+    if (code < FONT_LATIN_GLYPHS) {
+        latin_glyph_[code] = id;
+    } else {
+        extended_glyph_.insert(make_pair(code, id));
+    }
+    return id;
+}
 
-	FT_Done_Glyph(glyph);
+float OpenGLFont::kerning(uint32_t prev_code, int prev, uint32_t code, int next) {
+    if (prev < 0 || next < 0 || !FT_HAS_KERNING(ft_face_)) {
+        return 0.0f;
+    }
+    if (prev_code < FONT_KERNING_GLYPHS && code < FONT_KERNING_GLYPHS) {
+        return (float)kerning_[prev_code*FONT_KERNING_GLYPHS + code]/64;
+    }
+    FT_Vector delta;
+    if (FT_Get_Kerning(ft_face_, glyph_[prev].index, glyph_[next].index, FT_KERNING_DEFAULT, &delta)) {
+        return 0.0f;
+    }
+    return (float)delta.x/64;
 }
 
-void OpenGLFont::render(const std::string& text) {
+void OpenGLFont::render(OpenGLQuadBuffer* buffer, const std::string& text, float x, float y) {
     state(RS_LOADED);
-
-    // Push some parameters to enable proper texturing
-    glListBase(list_);
     
-    // Render all the lists necessary at once using the string
-    // directly (very efficient!!)
-    glPushMatrix();
-    glCallLists(text.length(), GL_UNSIGNED_BYTE, text.c_str());
-    glPopMatrix();
-    
-    // Pop any old attributes
-    glListBase(0);
+    uint32_t prev_code = 0;
+    int prev = -1;
+    for (size_t i = 0; i < text.length();) {
+        // Decode the next UTF-8 character.  Bytes that aren't part of a
+        // valid sequence are treated as Latin-1 characters.
+        uint32_t code = (uint8_t)text[i];
+        size_t length = 1;
+        if (code >= 0xf0) {
+            length = 4;
+            code &= 0x07;
+        } else if (code >= 0xe0) {
+            length = 3;
+            code &= 0x0f;
+        } else if (code >= 0xc0) {
+            length = 2;
+            code &= 0x1f;
+        }
+        if (length > 1) {
+            bool valid = (i + length <= text.length());
+            for (size_t j = 1; valid && j < length; j++) {
+                uint8_t ch = (uint8_t)text[i + j];
+                valid = (0x80 == (ch & 0xc0));
+                code = (code << 6) | (ch & 0x3f);
+            }
+            if (!valid) {
+                code = (uint8_t)text[i];
+                length = 1;
+            }
+        }
+        i += length;
+        
+        int id = glyph(buffer->atlas(), code);
+        x += kerning(prev_code, prev, code, id);
+        prev_code = code;
+        prev = id;
+        if (id < 0) {
+            continue;
+        }
+        
+        // Emit the glyph quad.  The top of the glyph bitmap is at the top
+        // of the atlas region.  Snap to whole pixels to keep the text sharp.
+        const Glyph& g = glyph_[id];
+        if (g.width > 0.0f) {
+            float left = floorf(x + g.left + 0.5f);
+            float top = y - g.top;
+            buffer->page(g.region.page);
+            buffer->vertex(Vector(left, top, 0.0f), g.region.min);
+            buffer->vertex(Vector(left, top + g.height, 0.0f), Texcoord(g.region.min.u, g.region.max.v));
+            buffer->vertex(Vector(left + g.width, top + g.height, 0.0f), g.region.max);
+            buffer->vertex(Vector(left + g.width, top, 0.0f), Texcoord(g.region.max.u, g.region.min.v));
+        }
+        x += g.advance;
+    }
 }
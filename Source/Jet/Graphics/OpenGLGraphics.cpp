@@ -47,10 +47,38 @@ using namespace Jet;
 using namespace std;
 using namespace boost;
 
+// Resource that can be evicted when the memory budget is exceeded.  Only
+// one of the texture and mesh pointers is set.
+class ResidentResource {
+public:
+	ResidentResource(uint32_t last_used, size_t bytes, OpenGLTexture* texture, OpenGLMesh* mesh) :
+		last_used(last_used),
+		bytes(bytes),
+		texture(texture),
+		mesh(mesh) {
+	}
+	
+	bool operator<(const ResidentResource& other) const {
+		return last_used < other.last_used;
+	}
+	
+	uint32_t last_used;
+	size_t bytes;
+	OpenGLTexture* texture;
+	OpenGLMesh* mesh;
+};
+
 OpenGLGraphics::OpenGLGraphics(CoreEngine* engine) :
     engine_(engine) {
 		
 	engine_->listener(this);	
+	engine_->option("texture_atlas_size", 1024.0f);
+	engine_->option("texture_atlas_max_size", 256.0f);
+	engine_->option("texture_async_loading", true);
+	engine_->option("resource_gpu_budget", 0.0f);
+	engine_->option("resource_cpu_budget", 0.0f);
+	engine_->option("stat_gpu_memory", 0.0f);
+	engine_->option("stat_cpu_memory", 0.0f);
 	
 	// Initialize SDL
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -209,6 +237,13 @@ void OpenGLGraphics::on_init() {
 	// Initialize particle buffer
 	particle_buffer_.reset(new OpenGLParticleBuffer(engine_));
 	
+	// Initialize the texture atlas and the quad buffer for quad sets and
+	// overlays
+	size_t atlas_size = (size_t)engine_->option<float>("texture_atlas_size");
+	size_t atlas_max_size = (size_t)engine_->option<float>("texture_atlas_max_size");
+	texture_atlas_.reset(new OpenGLTextureAtlas(engine_, atlas_size, atlas_max_size));
+	quad_buffer_.reset(new OpenGLQuadBuffer(engine_, texture_atlas_.get()));
+	
 	engine_->option("video_mode_synced", true);
 	//GLuint width = (GLuint)engine_->option<float>("display_width");
 	//GLuint height = (GLuint)engine_->option<float>("display_height");
@@ -243,6 +278,8 @@ void OpenGLGraphics::check_video_mode() {
 		}
 		shadow_target_.clear();
 		particle_buffer_.reset();
+		quad_buffer_.reset();
+		texture_atlas_.reset();
 		on_init();
 	}
 	
@@ -309,6 +346,76 @@ void OpenGLGraphics::on_render() {
 	
 	// Swap back buffer to front
 	SDL_GL_SwapBuffers();
+	
+	// Evict resources that haven't been used recently if the memory 
+	// budget is exceeded
+	update_resource_budget();
+}
+
+void OpenGLGraphics::update_resource_budget() {
+	// Budgets are given in KB; a budget of 0 means there is no limit
+	size_t gpu_budget = (size_t)(engine_->option<float>("resource_gpu_budget") * 1024.0f);
+	size_t cpu_budget = (size_t)(engine_->option<float>("resource_cpu_budget") * 1024.0f);
+	uint32_t frame_id = engine_->frame_id();
+	
+	// Add up the memory used by each resource.  Resources that were used
+	// this frame are never evicted.
+	size_t gpu_bytes = 0;
+	size_t cpu_bytes = 0;
+	vector<ResidentResource> gpu_resident;
+	vector<ResidentResource> cpu_resident;
+	for (Iterator<pair<const string, TexturePtr> > i = engine_->textures(); i; i++) {
+		OpenGLTexture* texture = static_cast<OpenGLTexture*>(i->second.get());
+		gpu_bytes += texture->gpu_bytes();
+		cpu_bytes += texture->cpu_bytes();
+		if (texture->last_used() == frame_id) {
+			continue;
+		}
+		if (texture->gpu_bytes()) {
+			gpu_resident.push_back(ResidentResource(texture->last_used(), texture->gpu_bytes(), texture, 0));
+		}
+		if (texture->cpu_bytes() && !texture->loading()) {
+			cpu_resident.push_back(ResidentResource(texture->last_used(), texture->cpu_bytes(), texture, 0));
+		}
+	}
+	for (Iterator<pair<const string, MeshPtr> > i = engine_->meshes(); i; i++) {
+		OpenGLMesh* mesh = static_cast<OpenGLMesh*>(i->second.get());
+		gpu_bytes += mesh->gpu_bytes();
+		cpu_bytes += mesh->cpu_bytes();
+		if (mesh->last_used() != frame_id && mesh->gpu_bytes()) {
+			gpu_resident.push_back(ResidentResource(mesh->last_used(), mesh->gpu_bytes(), 0, mesh));
+		}
+	}
+	
+	// Evict hardware buffers and textures, least recently used first.  
+	// Evicted resources stay in memory, so they can be uploaded again 
+	// quickly.
+	if (gpu_budget && gpu_bytes > gpu_budget) {
+		sort(gpu_resident.begin(), gpu_resident.end());
+		for (vector<ResidentResource>::iterator i = gpu_resident.begin(); i != gpu_resident.end() && gpu_bytes > gpu_budget; i++) {
+			if (i->texture) {
+				i->texture->state(RS_CACHED);
+			} else {
+				i->mesh->state(RS_CACHED);
+			}
+			gpu_bytes -= i->bytes;
+		}
+	}
+	
+	// Evict decoded images from system memory.  Mesh data is kept, because
+	// physics and fracturing read it, and meshes that were created by hand
+	// can't be reloaded from a file.
+	if (cpu_budget && cpu_bytes > cpu_budget) {
+		sort(cpu_resident.begin(), cpu_resident.end());
+		for (vector<ResidentResource>::iterator i = cpu_resident.begin(); i != cpu_resident.end() && cpu_bytes > cpu_budget; i++) {
+			gpu_bytes -= i->texture->gpu_bytes();
+			i->texture->state(RS_UNLOADED);
+			cpu_bytes -= i->bytes;
+		}
+	}
+	
+	engine_->option("stat_gpu_memory", gpu_bytes / 1024.0f);
+	engine_->option("stat_cpu_memory", cpu_bytes / 1024.0f);
 }
 
 void OpenGLGraphics::generate_shadow_map(CoreLight* light) {    
@@ -393,7 +500,7 @@ void OpenGLGraphics::generate_shadow_map(CoreLight* light) {
 
 void OpenGLGraphics::render_final(CoreLight* light) {	
 	CoreCameraPtr camera = static_cast<CoreCamera*>(engine_->camera());
-	Matrix matrix = camera->parent()->matrix();
+	Matrix matrix = camera->parent()->render_matrix();
 	float width = engine_->option<float>("display_width");
 	float height = engine_->option<float>("display_height");
 	
@@ -454,7 +561,7 @@ void OpenGLGraphics::render_shadow_casters() {
 			// matrix
 			glMatrixMode(GL_MODELVIEW);
 			glPushMatrix();
-			glMultMatrixf(mesh_object->parent()->matrix());
+			glMultMatrixf(mesh_object->parent()->render_matrix());
 			
 			// Render the object with no materials/shaders for speed
 			mesh->render(0);
@@ -474,7 +581,7 @@ void OpenGLGraphics::render_visible_mesh_objects() {
 	for (vector<CoreMeshObjectPtr>::iterator i = mesh_objects_.begin(); i != mesh_objects_.end(); i++) {
 		CoreMeshObject* mesh_object = i->get();
 		OpenGLMesh* mesh = static_cast<OpenGLMesh*>(mesh_object->mesh());
-		const Matrix& matrix = mesh_object->parent()->matrix();
+		const Matrix& matrix = mesh_object->parent()->render_matrix();
 		
 		// Switch materials if necessary
         OpenGLMaterial* next_material = static_cast<OpenGLMaterial*>(mesh_object->material());
@@ -539,8 +646,6 @@ void OpenGLGraphics::render_visible_particle_systems() {
 }
 
 void OpenGLGraphics::render_visible_quad_sets() {
-	OpenGLTexture* texture = 0;
-
 	glDisable(GL_LIGHTING);
 	glDisable(GL_CULL_FACE);
 	glEnable(GL_BLEND);
@@ -549,34 +654,22 @@ void OpenGLGraphics::render_visible_quad_sets() {
 	glColor3f(1.0f, 1.0f, 1.0f);
 
 
-	// Render all quad sets
+	// Render all quad sets.  The vertices are transformed on the CPU, so
+	// that consecutive quad sets with the same texture go into one draw 
+	// call.  Quad sets are drawn in the scene, usually minified, so their
+	// textures are bound by themselves to keep the mip levels.
+	quad_buffer_->color(Color(1.0f, 1.0f, 1.0f, 1.0f));
 	for (vector<CoreQuadSetPtr>::iterator i = quad_sets_.begin(); i != quad_sets_.end(); i++) {
-		// Switch textures if necessary
 		CoreQuadSet* quad_set = i->get();
-		OpenGLTexture* next_texture = static_cast<OpenGLTexture*>(quad_set->texture());
-		if (texture != next_texture) {
-			texture = next_texture;
-			texture->sampler(TS_DIFFUSE);
-		}
-
-		// Transform the modelview an dtexture matrics
-		glMatrixMode(GL_MODELVIEW);
-		glPushMatrix();
-		glMultMatrixf(quad_set->parent()->matrix());
+		const Matrix& matrix = quad_set->parent()->render_matrix();
+		quad_buffer_->texture(static_cast<OpenGLTexture*>(quad_set->texture()), false);
 
-		glBegin(GL_QUADS);
 		for (size_t i = 0; i < quad_set->vertex_count(); i++) {
 			const Vertex& v = quad_set->vertex_data()[i];
-			glNormal3fv(v.normal);
-			glTexCoord2fv(v.texcoord);
-			glVertex3fv(v.position);
+			quad_buffer_->vertex(matrix * v.position, v.texcoord);
 		}
-		glEnd();
-
-		// Set the matrix mode
-		glMatrixMode(GL_MODELVIEW);
-		glPopMatrix();
 	}
+	quad_buffer_->flush();
 
 	glEnable(GL_LIGHTING);
 	glEnable(GL_CULL_FACE);
@@ -606,7 +699,8 @@ void OpenGLGraphics::render_overlays() {
 	//glActiveTexture(GL_TEXTURE0);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	
-	render_overlay(static_cast<CoreOverlay*>(engine_->screen()));
+	render_overlay(static_cast<CoreOverlay*>(engine_->screen()), 0.0f, 0.0f);
+	quad_buffer_->flush();
     
 	
 	glMatrixMode(GL_PROJECTION);
@@ -653,52 +747,42 @@ void OpenGLGraphics::render_fullscreen_quad() {
     
 }
 
-void OpenGLGraphics::render_overlay(CoreOverlay* overlay) {
+void OpenGLGraphics::render_overlay(CoreOverlay* overlay, float x, float y) {
     if (!overlay->visible()) {
         return;
     }
     
-    float x = overlay->corner_x();
-    float y = overlay->corner_y(); 
+    // Offset the top-left corner of the overlay by the parent's corner
+    x += overlay->corner_x();
+    y += overlay->corner_y(); 
     
-    // Now translate to the top-left corner of the overlay, and render
-    // the text and background image
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glTranslatef(x, y, 0.0f);
-    
-    // Render the background as a single quad
+    // Add the background to the quad buffer as a single quad.  Overlays 
+    // are drawn at screen size with texcoords in [0, 1], so the background
+    // can be packed into the atlas.
     OpenGLTexture* background = static_cast<OpenGLTexture*>(overlay->background());
     if (background) {
-        background->sampler(0);        
-        glBegin(GL_QUADS);
-        glTexCoord2f(0.0f, 0.0f);
-        glVertex2f(0.0f, 0.0f);
-        glTexCoord2f(1.0f, 0.0f);
-        glVertex2f(overlay->width(), 0.0f);
-        glTexCoord2f(1.0f, 1.0f);
-        glVertex2f(overlay->width(), overlay->height());
-        glTexCoord2f(0.0f, 1.0f);
-        glVertex2f(0.0f, overlay->height());    
-        glEnd();
+        float width = overlay->width();
+        float height = overlay->height();
+        quad_buffer_->texture(background);
+        quad_buffer_->color(Color(1.0f, 1.0f, 1.0f, 1.0f));
+        quad_buffer_->vertex(Vector(x, y, 0.0f), Texcoord(0.0f, 0.0f));
+        quad_buffer_->vertex(Vector(x + width, y, 0.0f), Texcoord(1.0f, 0.0f));
+        quad_buffer_->vertex(Vector(x + width, y + height, 0.0f), Texcoord(1.0f, 1.0f));
+        quad_buffer_->vertex(Vector(x, y + height, 0.0f), Texcoord(0.0f, 1.0f));
     }
     
-    // Now render the text
+    // Now add the text.  Glyphs are stored in the texture atlas, so text
+    // and backgrounds usually end up in the same batch.
     OpenGLFont* font = static_cast<OpenGLFont*>(overlay->font());
     if (!overlay->text().empty() && font) {
-        glColor4fv(overlay->text_color());
-        glPushMatrix();
-        glTranslatef(0, (float)font->height(), 0);
-        font->render(overlay->text());
-        glPopMatrix();
+        quad_buffer_->color(overlay->text_color());
+        font->render(quad_buffer_.get(), overlay->text(), x, y + (float)font->height());
     }
     
     // Render all the children
     for (Iterator<CoreOverlayPtr> i = overlay->children(); i; i++) {
-        render_overlay(i->get());
+        render_overlay(i->get(), x, y);
     }
-    
-    glPopMatrix();
 }
 
 void OpenGLGraphics::generate_render_list(CoreNode* node) {
@@ -753,7 +837,7 @@ void OpenGLGraphics::render_skysphere() {
     OpenGLCubemap* cubemap = static_cast<OpenGLCubemap*>(engine_->cubemap(texture));
     OpenGLMesh* mesh = static_cast<OpenGLMesh*>(engine_->mesh("Sphere.obj"));
     OpenGLShader* shader = static_cast<OpenGLShader*>(engine_->shader("Sky"));
-    const Vector& eye = camera->parent()->matrix().origin();
+    const Vector& eye = camera->parent()->render_matrix().origin();
     
     
     glMatrixMode(GL_MODELVIEW);
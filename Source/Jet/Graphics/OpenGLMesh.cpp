@@ -24,6 +24,7 @@
 #include <Jet/Graphics/OpenGLShader.hpp>
 #include <Jet/Core/CoreEngine.hpp>
 #include <Jet/Core/CoreMeshLoader.hpp>
+#include <Jet/Utility.hpp>
 #include <stdexcept>
 
 using namespace Jet;
@@ -63,10 +64,15 @@ void OpenGLMesh::state(ResourceState state) {
 	if (RS_UNLOADED == state) {
 		vertex_.clear();
 		index_.clear();
+		geometry_hash_valid_ = false;
 	}
 	
-	// Update the geometry
-	geometry_->state(state);
+	// Update the geometry.  The collision shape doesn't use any video 
+	// memory, so it stays loaded when the hardware buffers are evicted; 
+	// otherwise the hull would be rebuilt when the mesh is reloaded.
+	if (RS_CACHED != state || RS_LOADED != geometry_->state()) {
+		geometry_->state(state);
+	}
 	state_ = state;
 }
 
@@ -74,11 +80,7 @@ void OpenGLMesh::free_hardware_buffers() {
 	assert(vbuffer_ && !ibuffer_.empty());
 	
 	// Free the vertex buffers
-	if (!parent_) {
-		// If the mesh has no parent, then the vertex buffer is owned by
-		// this mesh.
-		glDeleteBuffers(1, &vbuffer_);
-	}
+	glDeleteBuffers(1, &vbuffer_);
 	glDeleteBuffers(ibuffer_.size(), &ibuffer_[0]);
 	vbuffer_ = 0;
 }
@@ -95,16 +97,11 @@ void OpenGLMesh::init_hardware_buffers() {
 		mode = GL_DYNAMIC_DRAW;
 	}
 	
-	if (!parent_) {
-		// Copy vertex data to graphics card
-		glGenBuffers(1, &vbuffer_);
-		glBindBuffer(GL_ARRAY_BUFFER, vbuffer_);
-		glBufferData(GL_ARRAY_BUFFER, vertex_count()*sizeof(Vertex), vertex_data(), mode);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-	} else {
-		parent_->state(RS_LOADED);
-		vbuffer_ = parent_->vbuffer_;
-	}
+	// Copy vertex data to graphics card
+	glGenBuffers(1, &vbuffer_);
+	glBindBuffer(GL_ARRAY_BUFFER, vbuffer_);
+	glBufferData(GL_ARRAY_BUFFER, vertex_count()*sizeof(Vertex), vertex_data(), mode);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	// Copy index data to graphics card
 	glGenBuffers(ibuffer_.size(), &ibuffer_[0]);
@@ -117,46 +114,42 @@ void OpenGLMesh::init_hardware_buffers() {
 
 //! Updates tangent vectors for the mesh
 void OpenGLMesh::update_tangents() {
-	// Only update tangents if the node owns the vertex buffer,
-	// i.e., if it doesn't have a parent.
-	if (!parent_) {
-		// Initialize all tangents to zero for the whole mesh
-		for (size_t i = 0; i < vertex_.size(); i++) {
-			vertex_[i].tangent = Vector();
-		}
-		
-		// Iterate through faces and add each face's contribution to
-		// the tangents of its vertices
-		for (size_t g = 0; g < group_count(); g++) {
-			for (size_t i = 2; i < index_.size(); i += 3) {
-				Vertex& p0 = vertex_[index_[g][i-2]];
-				Vertex& p1 = vertex_[index_[g][i-1]];
-				Vertex& p2 = vertex_[index_[g][i-0]];
-				
-				// Tangent calculation
-				Vector d1 = p1.position - p0.position;
-				Vector d2 = p2.position - p1.position;
-				const Texcoord& tex0 = p0.texcoord;
-				const Texcoord& tex1 = p1.texcoord;
-				const Texcoord& tex2 = p2.texcoord;
-				float s1 = tex1.u - tex0.u;
-				float t1 = tex1.v - tex0.v;
-				float s2 = tex2.u - tex0.u;
-				float t2 = tex2.v - tex0.v;
-				float a = 1/(s1*t2 - s2*t1);
-				
-				// Add tangent contribution
-				p0.tangent += ((d1*t2 - d2*t1)*a).unit();
-				p1.tangent += ((d1*t2 - d2*t1)*a).unit();
-				p2.tangent += ((d1*t2 - d2*t1)*a).unit();
-			}
-		}
-		
-		// Normalize all the tangents
-		for (size_t i = 0; i < vertex_.size(); i++) {
-			vertex_[i].tangent = vertex_[i].tangent.unit();
+	// Initialize all tangents to zero for the whole mesh
+	for (size_t i = 0; i < vertex_.size(); i++) {
+		vertex_[i].tangent = Vector();
+	}
+	
+	// Iterate through faces and add each face's contribution to
+	// the tangents of its vertices
+	for (size_t g = 0; g < group_count(); g++) {
+		for (size_t i = 2; i < index_.size(); i += 3) {
+			Vertex& p0 = vertex_[index_[g][i-2]];
+			Vertex& p1 = vertex_[index_[g][i-1]];
+			Vertex& p2 = vertex_[index_[g][i-0]];
+			
+			// Tangent calculation
+			Vector d1 = p1.position - p0.position;
+			Vector d2 = p2.position - p1.position;
+			const Texcoord& tex0 = p0.texcoord;
+			const Texcoord& tex1 = p1.texcoord;
+			const Texcoord& tex2 = p2.texcoord;
+			float s1 = tex1.u - tex0.u;
+			float t1 = tex1.v - tex0.v;
+			float s2 = tex2.u - tex0.u;
+			float t2 = tex2.v - tex0.v;
+			float a = 1/(s1*t2 - s2*t1);
+			
+			// Add tangent contribution
+			p0.tangent += ((d1*t2 - d2*t1)*a).unit();
+			p1.tangent += ((d1*t2 - d2*t1)*a).unit();
+			p2.tangent += ((d1*t2 - d2*t1)*a).unit();
 		}
 	}
+	
+	// Normalize all the tangents
+	for (size_t i = 0; i < vertex_.size(); i++) {
+		vertex_[i].tangent = vertex_[i].tangent.unit();
+	}
 }
 
 void OpenGLMesh::read_mesh_data() {
@@ -173,13 +166,30 @@ void OpenGLMesh::read_mesh_data() {
 	CoreMeshLoader(this, file);
 }
 
+size_t OpenGLMesh::gpu_bytes() const {
+	if (RS_LOADED != state_) {
+		return 0;
+	}
+	size_t bytes = vertex_.size()*sizeof(Vertex);
+	for (size_t g = 0; g < index_.size(); g++) {
+		bytes += index_[g].size()*sizeof(uint32_t);
+	}
+	return bytes;
+}
+
+size_t OpenGLMesh::cpu_bytes() const {
+	size_t bytes = vertex_.size()*sizeof(Vertex);
+	for (size_t g = 0; g < index_.size(); g++) {
+		bytes += index_[g].size()*sizeof(uint32_t);
+	}
+	return bytes;
+}
+
 void OpenGLMesh::render(OpenGLShader* shader) {
 	
 	// Make sure that all vertex data is synchronized
 	state(RS_LOADED);
-	if (parent_) {
-		parent_->state(RS_LOADED);
-	}
+	last_used_ = engine_->frame_id();
 	
 	// Bind and enable the vertex and index buffers
 	glBindBuffer(GL_ARRAY_BUFFER, vbuffer_);
@@ -213,14 +223,11 @@ void OpenGLMesh::render(OpenGLShader* shader) {
 }
 
 void OpenGLMesh::vertex(size_t i, const Vertex& vertex) {
-	if (parent_) {
-		throw std::runtime_error("Vertex data is read-only");
-	} else {
-		if (i >= vertex_.size()) {
-			vertex_count(i + 1);
-		}
-		vertex_[i] = vertex;
+	if (i >= vertex_.size()) {
+		vertex_count(i + 1);
 	}
+	vertex_[i] = vertex;
+	geometry_hash_valid_ = false;
 }
 
 void OpenGLMesh::index(size_t group, size_t i, uint32_t index) {
@@ -231,6 +238,7 @@ void OpenGLMesh::index(size_t group, size_t i, uint32_t index) {
 		index_count(group, i + 1);
 	}
 	index_[group][i] = index;
+	geometry_hash_valid_ = false;
 }
 
 void OpenGLMesh::index_count(size_t group, size_t size) {
@@ -239,32 +247,25 @@ void OpenGLMesh::index_count(size_t group, size_t size) {
 	}
 	if (size != index_[group].size()) {
 		index_[group].resize(size);
+		geometry_hash_valid_ = false;
 	}
 }
 
 void OpenGLMesh::vertex_count(size_t size) {
-	if (parent_) {
-		throw runtime_error("Vertex data is read-only");
-	}
 	if (size != vertex_.size()) {
 		vertex_.resize(size);
+		geometry_hash_valid_ = false;
 	}
 }
 
 const Vertex& OpenGLMesh::vertex(size_t i) const {
-	if (parent_) {
-		return parent_->vertex(i);
-	} else {
-		return vertex_[i];
-	}
+	return vertex_[i];
 }
 
 Vertex& OpenGLMesh::vertex(size_t i) {
-	if (parent_) {
-		return parent_->vertex(i);
-	} else {
-		return vertex_[i];
-	}
+	// The caller may change the vertex through the reference
+	geometry_hash_valid_ = false;
+	return vertex_[i];
 }
 
 uint32_t OpenGLMesh::index(size_t group, size_t i) const {
@@ -279,14 +280,19 @@ void OpenGLMesh::group_count(size_t group) {
 	group_.resize(group);
 	index_.resize(group);
 	ibuffer_.resize(group);
+	geometry_hash_valid_ = false;
 }
 
-const Vertex* OpenGLMesh::vertex_data() const {
-	if (parent_) {
-		return parent_->vertex_data();
-	} else {
-		return vertex_.size() ? &vertex_.front() : 0;
+uint64_t OpenGLMesh::geometry_hash() const {
+	if (!geometry_hash_valid_) {
+		geometry_hash_ = hash(this);
+		geometry_hash_valid_ = true;
 	}
+	return geometry_hash_;
+}
+
+const Vertex* OpenGLMesh::vertex_data() const {
+	return vertex_.size() ? &vertex_.front() : 0;
 }
 
 const uint32_t* OpenGLMesh::index_data(size_t group) const {
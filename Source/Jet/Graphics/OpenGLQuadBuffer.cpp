@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Graphics/OpenGLQuadBuffer.hpp>
+#include <Jet/Graphics/OpenGLTexture.hpp>
+
+using namespace Jet;
+using namespace std;
+
+OpenGLQuadBuffer::OpenGLQuadBuffer(CoreEngine* engine, OpenGLTextureAtlas* atlas, size_t size, size_t buffers) :
+    engine_(engine),
+    atlas_(atlas),
+    page_(0),
+    atlased_(false),
+    mapped_(false),
+    skip_(false),
+    color_(1.0f, 1.0f, 1.0f, 1.0f),
+    size_(size * 4),
+    current_buffer_(0) {
+
+    vbuffer_.resize(buffers);
+    vertex_.reserve(size_);
+
+    glGenBuffers(vbuffer_.size(), &vbuffer_.front());
+    for (size_t i = 0; i < vbuffer_.size(); i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbuffer_[i]);
+        glBufferData(GL_ARRAY_BUFFER, size_*sizeof(QuadVertex), 0, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+OpenGLQuadBuffer::~OpenGLQuadBuffer() {
+    glDeleteBuffers(vbuffer_.size(), &vbuffer_.front());
+}
+
+void OpenGLQuadBuffer::texture(OpenGLTexture* texture, bool packed) {
+    if (!texture) {
+        return;
+    }
+    
+    // Skip quads that use a texture that is still being decoded, rather 
+    // than drawing them untextured
+    if (RS_UNLOADED == texture->state()) {
+        texture->state(RS_CACHED);
+    }
+    skip_ = !texture->ready();
+    if (skip_) {
+        return;
+    }
+
+    // Look up the texture in the atlas.  Textures that are too large for
+    // the atlas are bound by themselves.
+    OpenGLAtlasRegion region;
+    if (packed && atlas_->region(texture, region)) {
+        if (!atlased_ || page_ != region.page) {
+            flush();
+        }
+        atlased_ = true;
+        page_ = region.page;
+        texture_.reset();
+    } else {
+        if (atlased_ || texture_ != texture) {
+            flush();
+        }
+        atlased_ = false;
+        texture_ = texture;
+        region = OpenGLAtlasRegion();
+        region.max = Texcoord(1.0f, 1.0f);
+    }
+    region_ = region;
+    mapped_ = true;
+}
+
+void OpenGLQuadBuffer::page(size_t page) {
+    if (!atlased_ || page_ != page) {
+        flush();
+    }
+    atlased_ = true;
+    page_ = page;
+    mapped_ = false;
+    skip_ = false;
+    texture_.reset();
+}
+
+void OpenGLQuadBuffer::vertex(const Vector& position, const Texcoord& texcoord) {
+    if (skip_) {
+        return;
+    }
+    vertex_.push_back(QuadVertex());
+    QuadVertex& vertex = vertex_.back();
+    vertex.position = position;
+    vertex.texcoord = mapped_ ? region_.map(texcoord) : texcoord;
+    vertex.color = color_;
+
+    // Only flush on a quad boundary; the buffer size is always a multiple
+    // of four vertices
+    if (vertex_.size() >= size_) {
+        flush();
+    }
+}
+
+void OpenGLQuadBuffer::flush() {
+    if (vertex_.empty()) {
+        return;
+    }
+
+    // Bind the atlas page or the standalone texture
+    if (atlased_) {
+        atlas_->sampler(page_, TS_DIFFUSE);
+    } else if (texture_) {
+        texture_->sampler(TS_DIFFUSE);
+    } else {
+        vertex_.clear();
+        return;
+    }
+
+    // Bind and fill the vertex buffer.  Use the current buffer.
+    glBindBuffer(GL_ARRAY_BUFFER, vbuffer_[current_buffer_]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_.size()*sizeof(QuadVertex), &vertex_.front());
+
+    // Quads have no normals, but they do have a per-vertex color
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(QuadVertex), (void*)0);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(QuadVertex), (void*)(3*sizeof(GLfloat)));
+    glColorPointer(4, GL_FLOAT, sizeof(QuadVertex), (void*)(5*sizeof(GLfloat)));
+
+    glDrawArrays(GL_QUADS, 0, vertex_.size());
+
+    // Restore the client states used by the mesh renderer
+    glDisableClientState(GL_COLOR_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+    vertex_.clear();
+
+    // Rotate the buffers so that we can pipeline updates to the underlying
+    // hardware buffer
+    current_buffer_ = (current_buffer_ + 1) % vbuffer_.size();
+}
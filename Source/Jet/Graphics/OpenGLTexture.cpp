@@ -22,8 +22,13 @@
 
 #include <Jet/Graphics/OpenGLTexture.hpp>
 #include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Core/CoreWorkerPool.hpp>
+#include <Jet/Core/CoreTextureCodec.hpp>
 #include <SDL/SDL_image.h>
+#include <boost/bind.hpp>
 #include <stdexcept>
+#include <algorithm>
+#include <cstring>
 
 using namespace Jet;
 using namespace std;
@@ -37,86 +42,252 @@ void OpenGLTexture::state(ResourceState state) {
 		return;
 	}
 	
-	// Leaving the RS_UNLOADED state
+	// Leaving the RS_UNLOADED state.  This starts decoding the image, 
+	// which may finish later on a worker thread.
 	if (RS_UNLOADED == state_) {
 		read_texture_data();
 	}
 	
 	// Entering the RS_LOADED state
 	if (RS_LOADED == state) {
+		finish_texture_data(true);
 		init_texture();
 	}
 	
-	// Leaving the RS_LOADED state
+	// Leaving the RS_LOADED state.  The base level is still in memory, so
+	// the texture can be uploaded again without going back to the file.
 	if (RS_LOADED == state_) {
 		glDeleteTextures(1, &texture_);
 		texture_ = 0;
+		gpu_bytes_ = 0;
 	}
 	
-	// Entering the RS_UNLOADED state
+	// Entering the RS_UNLOADED state.  If the image is still being decoded,
+	// the worker thread's results are simply dropped.
 	if (RS_UNLOADED == state) {
+		pending_.reset();
+		task_.reset();
 		data_.clear();
+		mipmap_.clear();
+		mipmap_freed_ = false;
 	}
 	
 	state_ = state;
 }
 
+bool OpenGLTexture::ready() {
+	if (RS_UNLOADED == state_) {
+		return false;
+	}
+	last_used_ = engine_->frame_id();
+	return finish_texture_data(false);
+}
+
+size_t OpenGLTexture::cpu_bytes() const {
+	size_t bytes = data_.size();
+	for (size_t i = 0; i < mipmap_.size(); i++) {
+		bytes += mipmap_[i].size();
+	}
+	return bytes;
+}
+
 void OpenGLTexture::read_texture_data() {
-	// Load the image data
-	string file = engine_->resource_path(name_);
-	SDL_Surface* surface = IMG_Load(file.c_str());
+	// Resolve the path on this thread, because the search folders belong
+	// to the engine
+	pending_.reset(new TextureData);
+	pending_->path = engine_->resource_path(name_);
+	
+	boost::function<void ()> decode = boost::bind(&OpenGLTexture::decode_texture_data, pending_);
+	if (engine_->option<bool>("texture_async_loading")) {
+		task_ = engine_->worker_pool()->task(decode);
+	} else {
+		task_.reset(new CoreWorkerTask(decode));
+		task_->run();
+	}
+}
+
+void OpenGLTexture::decode_texture_data(boost::shared_ptr<TextureData> data) {
+	// This runs on a worker thread, so it must only touch the TextureData
+	// object.  Errors are thrown back to the thread that waits on the task.
+	// Block-compressed DDS files already contain the whole mip chain, so
+	// they are uploaded as-is.
+	static const string ext = ".dds";
+	size_t pos = data->path.rfind(ext);
+	if (pos != string::npos && (data->path.length() - pos) == ext.length()) {
+		TextureCodecFormat format;
+		CoreTextureCodec::read_dds(data->path, format, data->width, data->height, data->level);
+		switch (format) {
+			case TCF_BC1: data->texture_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+			case TCF_BC3: data->texture_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+			case TCF_BC5: data->texture_format = GL_COMPRESSED_RG_RGTC2; break;
+		}
+		return;
+	}
 	
-	// Check to make sure the image was supported
+	// Load the image data.  SDL keeps its error message in global state, 
+	// which other threads may be writing to, so don't use IMG_GetError()
+	// here.
+	SDL_Surface* surface = IMG_Load(data->path.c_str());
 	if (!surface) {
-		throw runtime_error(IMG_GetError());
+		throw runtime_error("Could not load image: " + data->path);
 	}
 	
-	// Check image format
-	bytes_per_pixel_ = surface->format->BytesPerPixel;
-	if (4 == surface->format->BytesPerPixel) {
-		if (0xff == surface->format->Rmask) {
-			texture_format_ = GL_RGBA;
-		} else {
-			texture_format_ = GL_BGRA;
-		}
-	} else if (3 == surface->format->BytesPerPixel) {
-		if (0xff == surface->format->Rmask) {
-			texture_format_ = GL_RGB;
-		} else {
-			texture_format_ = GL_BGR;
-		}
+	// Check to make sure the image format is supported
+	size_t bpp = surface->format->BytesPerPixel;
+	if (4 != bpp && 3 != bpp) {
+		SDL_FreeSurface(surface);
+		throw runtime_error("Invalid image format: " + data->path);
+	}
+	bool rgb = (0xff == surface->format->Rmask);
+	if (4 == bpp) {
+		data->texture_format = rgb ? GL_RGBA : GL_BGRA;
 	} else {
+		data->texture_format = rgb ? GL_RGB : GL_BGR;
+	}
+	data->bytes_per_pixel = bpp;
+	data->width = surface->w;
+	data->height = surface->h;
+	
+	// Copy the texture data row by row, dropping the padding at the end
+	// of each row of the surface
+	try {
+		size_t pitch = bpp*data->width;
+		data->level.push_back(vector<uint8_t>(pitch*data->height));
+		uint8_t* out = &data->level.back().front();
+		for (size_t y = 0; y < data->height; y++) {
+			memcpy(out + y*pitch, (const uint8_t*)surface->pixels + y*surface->pitch, pitch);
+		}
+	} catch (...) {
 		SDL_FreeSurface(surface);
-		throw runtime_error("Invalid image format: " + name_);
+		throw;
 	}
+	SDL_FreeSurface(surface);
+	
+	build_mipmap(data->level, data->width, data->height, bpp);
+}
 
-	// Set the width and height of the texture, then copy all the texture data
-	width(surface->w);
-	height(surface->h);
-	memcpy(data(), surface->pixels, data_.size());
+void OpenGLTexture::build_mipmap(vector<vector<uint8_t> >& level, size_t width, size_t height, size_t bpp) {
+	// Generate the rest of the mip chain down to 1x1, starting from the
+	// last level in the list
+	while (width > 1 || height > 1) {
+		size_t next_width = max(width/2, (size_t)1);
+		size_t next_height = max(height/2, (size_t)1);
+		level.push_back(vector<uint8_t>(bpp*next_width*next_height));
+		const vector<uint8_t>& prev = level[level.size()-2];
+		CoreTextureCodec::downsample(&prev.front(), width, height, &level.back().front(), bpp);
+		width = next_width;
+		height = next_height;
+	}
+}
 
-	SDL_FreeSurface(surface);
+bool OpenGLTexture::finish_texture_data(bool wait) {
+	if (!pending_) {
+		return true;
+	}
+	
+	// Check to see if the worker thread is done with the image.  If wait is
+	// set, then block until the image is ready.  An exception thrown while
+	// decoding the image is rethrown here, and the texture goes back to
+	// the unloaded state, so it is never used without its data.
+	if (!wait && !task_->done()) {
+		return false;
+	}
+	try {
+		task_->wait();
+	} catch (...) {
+		pending_.reset();
+		task_.reset();
+		state_ = RS_UNLOADED;
+		throw;
+	}
+	boost::shared_ptr<TextureData> data;
+	data.swap(pending_);
+	task_.reset();
+	
+	// Copy the results over.  The first level is the texture data; the
+	// rest are kept for uploading the mip chain.
+	bytes_per_pixel_ = data->bytes_per_pixel;
+	texture_format_ = data->texture_format;
+	width_ = data->width;
+	height_ = data->height;
+	data_.swap(data->level.front());
+	mipmap_.assign(data->level.begin() + 1, data->level.end());
+	mipmap_freed_ = false;
+	return true;
 }
 
 void OpenGLTexture::init_texture() {
 	
+	// Rebuild the mip chain from the base level if it was freed after the
+	// last upload
+	if (mipmap_freed_) {
+		vector<vector<uint8_t> > level(1);
+		level.front().swap(data_);
+		build_mipmap(level, width_, height_, bytes_per_pixel_);
+		data_.swap(level.front());
+		mipmap_.assign(level.begin() + 1, level.end());
+		mipmap_freed_ = false;
+	}
+	
 	// Initialize the texture
 	glGenTextures(1, &texture_);
 	glBindTexture(GL_TEXTURE_2D, texture_);
 	
-	//! Set texture sampling parameters; we use mip filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+	//! Set texture sampling parameters; we use mip filtering if the mip
+	//! levels were generated
+	GLint min_filter = mipmap_.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_NEAREST;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 6.0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipmap_.size());
 	
-	// Load the image
-	gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGBA, width(), height(), texture_format_, GL_UNSIGNED_BYTE, data());
+	// Upload the prepared levels; no resampling is done here.  Compressed
+	// levels are passed straight through to the driver.
+	GLint internal_format = (3 == bytes_per_pixel_) ? GL_RGB : GL_RGBA;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (compressed()) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, texture_format_, width(), height(), 0, data_.size(), data());
+	} else {
+		glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width(), height(), 0, texture_format_, GL_UNSIGNED_BYTE, data());
+	}
+	size_t width = width_;
+	size_t height = height_;
+	for (size_t i = 0; i < mipmap_.size(); i++) {
+		width = max(width/2, (size_t)1);
+		height = max(height/2, (size_t)1);
+		if (compressed()) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, i+1, texture_format_, width, height, 0, mipmap_[i].size(), &mipmap_[i].front());
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, i+1, internal_format, width, height, 0, texture_format_, GL_UNSIGNED_BYTE, &mipmap_[i].front());
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 	glBindTexture(GL_TEXTURE_2D, 0);
+	
+	// Every level is stored in video memory in the same format as the data
+	// in system memory.  The mip chain isn't needed in system memory once
+	// it has been uploaded.  Compressed chains are kept, because they 
+	// can't be rebuilt from the base level.
+	gpu_bytes_ = cpu_bytes();
+	if (!compressed() && !mipmap_.empty()) {
+		vector<vector<uint8_t> >().swap(mipmap_);
+		mipmap_freed_ = true;
+	}
 }
 
 void OpenGLTexture::sampler(uint32_t sampler) {
+	// Start loading the texture if necessary.  Nothing is bound to the
+	// sampler until the worker thread has finished decoding the image.
+	if (RS_UNLOADED == state_) {
+		state(RS_CACHED);
+	}
+	if (!ready()) {
+		glActiveTexture(GL_TEXTURE0 + sampler);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return;
+	}
 	state(RS_LOADED);
 	glActiveTexture(GL_TEXTURE0 + sampler);
 	glBindTexture(GL_TEXTURE_2D, texture_);
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Graphics/OpenGLTextureAtlas.hpp>
+#include <Jet/Graphics/OpenGLTexture.hpp>
+#include <algorithm>
+#include <limits>
+
+using namespace Jet;
+using namespace std;
+
+// Width of the border around each image.  The border repeats the edge
+// pixels of the image, so that linear filtering doesn't bleed neighboring
+// images into each other.
+#define ATLAS_PADDING 1
+
+OpenGLTextureAtlas::OpenGLTextureAtlas(CoreEngine* engine, size_t size, size_t max_texture_size) :
+    engine_(engine),
+    size_(size),
+    max_texture_size_(min(max_texture_size, size - 2*ATLAS_PADDING)) {
+
+}
+
+OpenGLTextureAtlas::~OpenGLTextureAtlas() {
+    for (size_t i = 0; i < page_.size(); i++) {
+        glDeleteTextures(1, &page_[i].texture);
+    }
+}
+
+bool OpenGLTextureAtlas::region(OpenGLTexture* texture, OpenGLAtlasRegion& region) {
+    // Check to see if the texture was already packed
+    map<string, OpenGLAtlasRegion>::iterator i = region_.find(texture->name());
+    if (i != region_.end()) {
+        region = i->second;
+        return true;
+    }
+
+    // Make sure the texture data is in memory.  The texture never needs
+    // to be loaded into its own hardware texture if it is packed.  If the
+    // image is still being decoded, it can't be packed yet.
+    if (RS_UNLOADED == texture->state()) {
+        texture->state(RS_CACHED);
+    }
+    if (!texture->ready() || texture->compressed()) {
+        return false;
+    }
+    size_t width = texture->width();
+    size_t height = texture->height();
+    if (width > max_texture_size_ || height > max_texture_size_) {
+        return false;
+    }
+
+    // Convert the texture data to RGBA, which is the format used by all
+    // the atlas pages
+    const uint8_t* in = texture->data();
+    size_t bpp = texture->bytes_per_pixel();
+    bool bgr = (GL_BGRA == texture->texture_format() || GL_BGR == texture->texture_format());
+    scratch_.resize(width * height * 4);
+    for (size_t j = 0; j < width * height; j++) {
+        scratch_[4*j+0] = bgr ? in[bpp*j+2] : in[bpp*j+0];
+        scratch_[4*j+1] = in[bpp*j+1];
+        scratch_[4*j+2] = bgr ? in[bpp*j+0] : in[bpp*j+2];
+        scratch_[4*j+3] = (4 == bpp) ? in[bpp*j+3] : 0xff;
+    }
+
+    bool ok = insert(width, height, &scratch_.front(), region);
+    if (ok) {
+        region_.insert(make_pair(texture->name(), region));
+    }
+    return ok;
+}
+
+bool OpenGLTextureAtlas::insert(size_t width, size_t height, const uint8_t* data, OpenGLAtlasRegion& region) {
+    size_t padded_width = width + 2*ATLAS_PADDING;
+    size_t padded_height = height + 2*ATLAS_PADDING;
+    if (padded_width > size_ || padded_height > size_) {
+        return false;
+    }
+
+    // Try to fit the image into the existing pages; if it doesn't fit,
+    // then open up a new page
+    size_t x = 0, y = 0, page = 0;
+    for (page = 0; page < page_.size(); page++) {
+        if (pack(page_[page], padded_width, padded_height, x, y)) {
+            break;
+        }
+    }
+    if (page == page_.size()) {
+        new_page();
+        pack(page_.back(), padded_width, padded_height, x, y);
+    }
+
+    // Copy the image into a temporary buffer with the border pixels
+    // duplicated from the edges of the image
+    vector<uint8_t> block(padded_width * padded_height * 4);
+    for (size_t j = 0; j < padded_height; j++) {
+        size_t sy = min(max(j, (size_t)ATLAS_PADDING) - ATLAS_PADDING, height - 1);
+        for (size_t i = 0; i < padded_width; i++) {
+            size_t sx = min(max(i, (size_t)ATLAS_PADDING) - ATLAS_PADDING, width - 1);
+            const uint8_t* src = data + 4*(sy*width + sx);
+            uint8_t* dst = &block[4*(j*padded_width + i)];
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = src[3];
+        }
+    }
+
+    // Upload the block into the page texture
+    glBindTexture(GL_TEXTURE_2D, page_[page].texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, padded_width, padded_height, GL_RGBA, GL_UNSIGNED_BYTE, &block.front());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    float scale = 1.0f / size_;
+    region.page = page;
+    region.min = Texcoord((x + ATLAS_PADDING) * scale, (y + ATLAS_PADDING) * scale);
+    region.max = Texcoord((x + ATLAS_PADDING + width) * scale, (y + ATLAS_PADDING + height) * scale);
+    return true;
+}
+
+void OpenGLTextureAtlas::sampler(size_t page, uint32_t sampler) {
+    glActiveTexture(GL_TEXTURE0 + sampler);
+    glBindTexture(GL_TEXTURE_2D, page_[page].texture);
+}
+
+bool OpenGLTextureAtlas::fit(const Page& page, size_t index, size_t width, size_t height, size_t& y) const {
+    // Checks to see if a rectangle with its bottom-left corner at the
+    // left edge of the given skyline segment fits.  The rectangle rests
+    // on the highest segment that it spans.
+    size_t x = page.skyline[index].x;
+    if (x + width > size_) {
+        return false;
+    }
+
+    y = page.skyline[index].y;
+    size_t width_left = width;
+    for (size_t i = index; width_left > 0; i++) {
+        y = max(y, page.skyline[i].y);
+        if (y + height > size_) {
+            return false;
+        }
+        width_left -= min(width_left, page.skyline[i].width);
+    }
+    return true;
+}
+
+bool OpenGLTextureAtlas::pack(Page& page, size_t width, size_t height, size_t& x, size_t& y) {
+    // Find the skyline segment that results in the lowest top edge for the
+    // new rectangle.  Break ties using the narrowest segment.
+    size_t best_index = numeric_limits<size_t>::max();
+    size_t best_top = numeric_limits<size_t>::max();
+    size_t best_width = numeric_limits<size_t>::max();
+    for (size_t i = 0; i < page.skyline.size(); i++) {
+        size_t top = 0;
+        if (fit(page, i, width, height, top)) {
+            top += height;
+            if (top < best_top || (top == best_top && page.skyline[i].width < best_width)) {
+                best_index = i;
+                best_top = top;
+                best_width = page.skyline[i].width;
+                x = page.skyline[i].x;
+                y = top - height;
+            }
+        }
+    }
+    if (best_index == numeric_limits<size_t>::max()) {
+        return false;
+    }
+
+    // Insert the new segment, then shrink or remove the segments that
+    // are now covered by the rectangle
+    page.skyline.insert(page.skyline.begin() + best_index, SkylineNode(x, y + height, width));
+    for (size_t i = best_index + 1; i < page.skyline.size(); i++) {
+        SkylineNode& prev = page.skyline[i - 1];
+        SkylineNode& node = page.skyline[i];
+        if (node.x >= prev.x + prev.width) {
+            break;
+        }
+        size_t shrink = prev.x + prev.width - node.x;
+        if (node.width <= shrink) {
+            page.skyline.erase(page.skyline.begin() + i);
+            i--;
+        } else {
+            node.x += shrink;
+            node.width -= shrink;
+            break;
+        }
+    }
+
+    // Merge neighboring segments that are at the same height
+    for (size_t i = 0; i + 1 < page.skyline.size(); i++) {
+        if (page.skyline[i].y == page.skyline[i + 1].y) {
+            page.skyline[i].width += page.skyline[i + 1].width;
+            page.skyline.erase(page.skyline.begin() + i + 1);
+            i--;
+        }
+    }
+    return true;
+}
+
+void OpenGLTextureAtlas::new_page() {
+    page_.push_back(Page());
+    Page& page = page_.back();
+    page.skyline.push_back(SkylineNode(0, 0, size_));
+
+    // Allocate the page texture.  Atlas pages are not mipmapped, because
+    // the mip levels would blend neighboring images together.
+    glGenTextures(1, &page.texture);
+    glBindTexture(GL_TEXTURE_2D, page.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size_, size_, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
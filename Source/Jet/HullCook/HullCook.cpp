@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <Jet/Core/CoreMeshLoader.hpp>
+#include <Jet/Core/CoreShatterCache.hpp>
+#include <Jet/Physics/BulletHullCache.hpp>
+#include <Jet/Resources/Mesh.hpp>
+#include <Jet/Types/Vertex.hpp>
+#include <Jet/Utility.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace Jet;
+using namespace std;
+
+// Builds the convex hulls used for collision shapes, and writes them next
+// to the mesh files (e.g., "Ship.obj.hull").  With -shatter, the tool also
+// breaks each mesh into that many pieces for FractureObject::shatter, and
+// writes the pieces next to the mesh (e.g., "Ship.obj.8.shatter").  The 
+// engine only reads these files, so data that isn't cooked is computed 
+// again every time the game runs.
+//
+// Usage: HullCook [-max-vertices <n>] [-shatter <count>]... <mesh.obj>...
+//
+// The vertex limit must match the "physics_hull_max_vertices" option, and
+// the shatter count must match the object's shatter_count, or the engine 
+// will ignore the cooked file.
+
+// Default for -max-vertices; this matches the engine's default option
+#define DEFAULT_MAX_VERTICES 32
+
+// Mesh that only holds the geometry from the OBJ file, so that hulls can
+// be cooked without a renderer.
+class CookMesh : public Mesh {
+public:
+	CookMesh(const string& name) :
+		name_(name),
+		state_(RS_UNLOADED),
+		sync_mode_(SM_STATIC) {
+	}
+
+	void vertex(size_t i, const Vertex& vertex) {
+		if (i >= vertex_.size()) {
+			vertex_.resize(i + 1);
+		}
+		vertex_[i] = vertex;
+	}
+
+	void index(size_t group, size_t i, uint32_t index) {
+		if (group >= index_.size()) {
+			group_count(group + 1);
+		}
+		if (i >= index_[group].size()) {
+			index_[group].resize(i + 1);
+		}
+		index_[group][i] = index;
+	}
+
+	void state(ResourceState state) { state_ = state; }
+	void sync_mode(SyncMode mode) { sync_mode_ = mode; }
+	void vertex_count(size_t size) { vertex_.resize(size); }
+	void index_count(size_t group, size_t size) { index_[group].resize(size); }
+
+	void group_count(size_t size) {
+		index_.resize(size);
+		group_.resize(size);
+	}
+
+	void group(size_t index, const string& name) { group_[index] = name; }
+	const Vertex& vertex(size_t i) const { return vertex_[i]; }
+	uint32_t index(size_t group, size_t i) const { return index_[group][i]; }
+	ResourceState state() const { return state_; }
+	SyncMode sync_mode() const { return sync_mode_; }
+	const string& name() const { return name_; }
+	const Vertex* vertex_data() const { return vertex_.empty() ? 0 : &vertex_.front(); }
+	const uint32_t* index_data(size_t group) const { return index_[group].empty() ? 0 : &index_[group].front(); }
+	size_t vertex_count() const { return vertex_.size(); }
+	size_t index_count(size_t group) const { return index_[group].size(); }
+	size_t group_count() const { return index_.size(); }
+	const string& group(size_t index) const { return group_[index]; }
+
+	size_t group(const string& name) const {
+		for (size_t i = 0; i < group_.size(); i++) {
+			if (group_[i] == name) {
+				return i;
+			}
+		}
+		throw range_error("Group not found: " + name);
+	}
+
+	Geometry* geometry() const { return 0; }
+	uint64_t geometry_hash() const { return hash(this); }
+
+private:
+	string name_;
+	ResourceState state_;
+	SyncMode sync_mode_;
+	vector<Vertex> vertex_;
+	vector<vector<uint32_t> > index_;
+	vector<string> group_;
+};
+
+int main(int argc, char** argv) {
+	size_t max_vertices = DEFAULT_MAX_VERTICES;
+	vector<size_t> shatter_count;
+	vector<string> files;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if ("-max-vertices" == arg && i + 1 < argc) {
+			max_vertices = boost::lexical_cast<size_t>(argv[++i]);
+		} else if ("-shatter" == arg && i + 1 < argc) {
+			shatter_count.push_back(boost::lexical_cast<size_t>(argv[++i]));
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (files.empty()) {
+		cerr << "Usage: HullCook [-max-vertices <n>] [-shatter <count>]... <mesh.obj>..." << endl;
+		return 1;
+	}
+
+	try {
+		for (size_t i = 0; i < files.size(); i++) {
+			MeshPtr mesh(new CookMesh(files[i]));
+			CoreMeshLoader(mesh.get(), files[i]);
+			BulletHullCache::cook(mesh.get(), max_vertices, files[i] + ".hull");
+			cout << files[i] << ".hull" << endl;
+			for (size_t j = 0; j < shatter_count.size(); j++) {
+				string path = files[i] + "." + boost::lexical_cast<string>(shatter_count[j]) + ".shatter";
+				CoreShatterCache::cook(mesh.get(), shatter_count[j], path);
+				cout << path << endl;
+			}
+		}
+		return 0;
+	} catch (std::exception& ex) {
+		cerr << ex.what() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Network/BSockNetwork.hpp>
+#include <Jet/Network/BSockSocket.hpp>
+#include <Jet/Network/BSockConnection.hpp>
+#include <Jet/Network/BSockWriter.hpp>
+#include <Jet/Network/BSockReader.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <map>
+
+using namespace Jet;
+using namespace std;
+using namespace boost::posix_time;
+
+// Sends packets from one UDP socket to another over loopback, and measures
+// how many packets per second get through.  Each round, the sender queues
+// a window of packets and flushes them, and then the receiver drains its 
+// socket, the same way the network does once per frame.  The test is run
+// with a batch size of 1, which sends and receives each datagram with its
+// own sendto() and recvfrom() call (how the sockets worked before 
+// batching), and then with full batches, which use sendmmsg() and 
+// recvmmsg() where the platform has them.
+//
+// With -reliable, the test sends reliable messages between two 
+// connections over loopback instead, through the network simulator (the
+// -loss, -latency, etc. options only apply to this test), and
+// checks that every message on each channel arrives once and in order.
+// Both sockets run the simulator, so each packet goes through it twice.
+// Time is simulated at 60 frames per second, so a run is the same every
+// time for a given seed.
+//
+// Usage: NetBench [-packets <n>] [-size <bytes>] [-window <n>]
+//                 [-reliable <messages>] [-loss <fraction>] 
+//                 [-latency <seconds>] [-jitter <seconds>] 
+//                 [-duplicate <fraction>] [-bandwidth <kbit/s>] 
+//                 [-seed <n>]
+
+static float run(CoreEngine* engine, size_t batch, size_t packets, size_t size, size_t window) {
+	engine->option("network_batch_size", (float)batch);
+	BSockNetwork* network = static_cast<BSockNetwork*>(engine->network());
+	BSockSocketPtr receiver(BSockSocket::datagram(engine, Address()));
+	Address address("127.0.0.1", receiver->address().port);
+	BSockSocketPtr sender(BSockSocket::datagram(engine, Address(), address));
+
+	size_t sent = 0;
+	size_t received = 0;
+	ptime start = microsec_clock::universal_time();
+	while (sent < packets) {
+		for (size_t i = 0; i < window && sent < packets; i++) {
+			BSockWriter writer(sender.get());
+			if (!writer.ok()) {
+				sender->poll_write();
+				break;
+			}
+			writer.integer(sent);
+			for (size_t j = sizeof(int); j < size; j++) {
+				writer.byte(0);
+			}
+			sent++;
+		}
+		sender->poll_write();
+
+		network->reactor()->poll();
+		while (true) {
+			BSockReader reader(receiver.get());
+			if (!reader.ok()) {
+				break;
+			}
+			received++;
+		}
+	}
+	float elapsed = (microsec_clock::universal_time() - start).total_microseconds() / 1e6f;
+	float rate = received / elapsed;
+
+	if (batch > 1) {
+		cout << "batches of " << batch << ": ";
+	} else {
+		cout << "one datagram per call: ";
+	}
+	cout << (size_t)rate << " packets/s, ";
+	cout << sent - received << " lost" << endl;
+	return rate;
+}
+
+// Hands the packets waiting on a socket to the connection
+static void receive(BSockSocket* socket, BSockConnection* connection) {
+	while (true) {
+		BSockReader reader(socket);
+		if (!reader.ok()) {
+			break;
+		}
+		connection->receive(&reader);
+	}
+}
+
+static bool run_reliable(CoreEngine* engine, size_t messages) {
+	BSockNetwork* network = static_cast<BSockNetwork*>(engine->network());
+	BSockSocketPtr socket_a(BSockSocket::datagram(engine, Address()));
+	BSockSocketPtr socket_b(BSockSocket::datagram(engine, Address()));
+	Address address_a("127.0.0.1", socket_a->address().port);
+	Address address_b("127.0.0.1", socket_b->address().port);
+	BSockConnectionPtr a(new BSockConnection(engine, socket_a.get(), address_b));
+	BSockConnectionPtr b(new BSockConnection(engine, socket_b.get(), address_a));
+
+	// Send a few messages each frame on both reliable channels, plus an 
+	// unreliable message, at 60 frames per second of simulated time
+	size_t sent = 0;
+	size_t expected[JET_CHANNEL_COUNT] = { 0 };
+	size_t unreliable = 0;
+	size_t frames = 0;
+	bool ok = true;
+	while ((expected[CT_SYSTEM] < messages || expected[CT_RPC] < messages) && frames < 100000) {
+		for (size_t i = 0; i < 4 && sent < messages; i++, sent++) {
+			BSockWriter system(a.get(), CT_SYSTEM);
+			system.integer(sent);
+			BSockWriter rpc(a.get(), CT_RPC);
+			rpc.integer(sent);
+			rpc.string("reliable");
+		}
+		{
+			BSockWriter writer(a.get(), CT_UNRELIABLE);
+			writer.integer(frames);
+		}
+		a->flush();
+		b->flush();
+		socket_a->poll_write();
+		socket_b->poll_write();
+
+		network->reactor()->poll();
+		receive(socket_a.get(), a.get());
+		receive(socket_b.get(), b.get());
+		while (true) {
+			BSockReader reader(b.get());
+			if (!reader.ok()) {
+				break;
+			}
+			size_t id = reader.integer();
+			if (CT_UNRELIABLE == reader.channel()) {
+				unreliable++;
+			} else if (id != expected[reader.channel()]++) {
+				ok = false;
+			}
+		}
+		a->update(1.0f/60.0f);
+		b->update(1.0f/60.0f);
+		socket_a->update(1.0f/60.0f);
+		socket_b->update(1.0f/60.0f);
+		frames++;
+	}
+	ok = ok && expected[CT_SYSTEM] == messages && expected[CT_RPC] == messages;
+
+	cout << "reliable, " << engine->option<float>("network_sim_loss") * 100.0f << "% loss: ";
+	cout << messages << " messages per channel in " << frames / 60.0f << "s, " << a->resent() << " resent, ";
+	cout << unreliable << "/" << frames << " unreliable arrived, rtt " << a->round_trip_time() * 1000.0f << "ms, ";
+	cout << (ok ? "in order" : "FAILED") << endl;
+	return ok;
+}
+
+int main(int argc, char** argv) {
+	size_t packets = 1000000;
+	size_t size = 64;
+	size_t window = 64;
+	size_t messages = 0;
+	map<string, float> sim;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			string arg = argv[i];
+			if ("-packets" == arg && i + 1 < argc) {
+				packets = boost::lexical_cast<size_t>(argv[++i]);
+			} else if ("-size" == arg && i + 1 < argc) {
+				size = boost::lexical_cast<size_t>(argv[++i]);
+			} else if ("-window" == arg && i + 1 < argc) {
+				window = boost::lexical_cast<size_t>(argv[++i]);
+			} else if ("-reliable" == arg && i + 1 < argc) {
+				messages = boost::lexical_cast<size_t>(argv[++i]);
+			} else if (("-loss" == arg || "-latency" == arg || "-jitter" == arg || "-duplicate" == arg 
+				|| "-bandwidth" == arg || "-seed" == arg) && i + 1 < argc) {
+				sim["network_sim_" + arg.substr(1)] = boost::lexical_cast<float>(argv[++i]);
+			} else {
+				cerr << "Usage: NetBench [-packets <n>] [-size <bytes>] [-window <n>]" << endl;
+				cerr << "                [-reliable <messages>] [-loss <fraction>]" << endl;
+				cerr << "                [-latency <seconds>] [-jitter <seconds>]" << endl;
+				cerr << "                [-duplicate <fraction>] [-bandwidth <kbit/s>]" << endl;
+				cerr << "                [-seed <n>]" << endl;
+				return 1;
+			}
+		}
+		size = max(size, sizeof(int));
+		window = max(window, (size_t)1);
+
+		EnginePtr engine(Engine::create_custom());
+		CoreEngine* core = static_cast<CoreEngine*>(engine.get());
+		core->network(new BSockNetwork(core));
+
+		// The simulator options must be set before the sockets are 
+		// created, which is when the seed is read
+		if (messages) {
+			for (map<string, float>::iterator i = sim.begin(); i != sim.end(); i++) {
+				core->option(i->first, i->second);
+			}
+			return run_reliable(core, messages) ? 0 : 1;
+		}
+
+		cout << packets << " packets, " << size << " bytes each, " << window << " per round" << endl;
+		float before = run(core, 1, packets, size, window);
+		float after = run(core, JET_DATAGRAM_BATCH, packets, size, window);
+		cout << "speedup: " << after / before << "x" << endl;
+		return 0;
+	} catch (std::exception& ex) {
+		cerr << ex.what() << endl;
+		return 1;
+	}
+}
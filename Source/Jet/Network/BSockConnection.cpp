@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Network/BSockConnection.hpp>
+#include <Jet/Network/BSockNetwork.hpp>
+#include <Jet/Network/BSockWriter.hpp>
+#include <Jet/Network/BSockReader.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace Jet;
+using namespace std;
+
+// Size of the connection header: the packet's sequence number, the newest
+// sequence number received from the peer, and the bit field for the 32 
+// packets before it
+#define PACKET_HEADER 8
+
+// Size of each message header: the channel, the message ID (sent even 
+// for unreliable messages, so every header is the same size) and the 
+// length
+#define MESSAGE_HEADER 5
+
+// A packet is sent at least this often, even if there is nothing to send,
+// so that the peer doesn't time out
+#define KEEPALIVE_TIME 0.5f
+
+BSockConnection::BSockConnection(CoreEngine* engine, BSockSocket* socket, const Address& address) :
+    engine_(engine),
+    pool_(&static_cast<BSockNetwork*>(engine->network())->packet_pool_),
+    socket_(socket),
+    address_(address),
+    capacity_(JET_MAX_PACKET_SIZE - PACKET_HEADER - MESSAGE_HEADER),
+    sequence_(0),
+    remote_sequence_(0xffff),
+    remote_mask_(0),
+    ack_pending_(false),
+    time_(0.0f),
+    send_time_(0.0f),
+    receive_time_(0.0f),
+    round_trip_time_(0.0f),
+    resend_time_(engine->option<float>("network_resend_time")),
+    timeout_(engine->option<float>("network_timeout")),
+    resent_(0) {
+
+    for (size_t i = 0; i < JET_CHANNEL_COUNT; i++) {
+        Channel& channel = channel_[i];
+        memset(channel.sent, 0, sizeof(channel.sent));
+        memset(channel.received, 0, sizeof(channel.received));
+        channel.oldest = 0;
+        channel.next = 0;
+        channel.expected = 0;
+    }
+
+    // None of the history entries are real packets yet, so mark them as
+    // already acknowledged
+    for (size_t i = 0; i < JET_PACKET_HISTORY; i++) {
+        sent_[i].sequence = 0;
+        sent_[i].acked = true;
+        sent_[i].time = 0.0f;
+    }
+}
+
+BSockConnection::~BSockConnection() {
+    // Give queued messages (e.g., a goodbye message) one chance to get out
+    try {
+        flush();
+    } catch (std::exception&) {
+    }
+
+    for (size_t i = 0; i < JET_CHANNEL_COUNT; i++) {
+        Channel& channel = channel_[i];
+        pool_->release(channel.queued);
+        for (size_t j = 0; j < JET_RELIABLE_WINDOW; j++) {
+            pool_->release(channel.sent[j]);
+            pool_->release(channel.received[j]);
+        }
+    }
+    pool_->release(delivered_);
+}
+
+bool BSockConnection::opens(BSockReader* reader, ChannelType channel, int type) {
+    // Reliable messages that are due are written first, oldest first, so
+    // the first message a peer sends leads its first packet, and every 
+    // packet that resends it
+    reader->bits(16);
+    reader->bits(16);
+    reader->bits(32);
+    size_t index = reader->byte();
+    uint16_t id = (uint16_t)reader->bits(16);
+    size_t length = reader->bits(16);
+    int value = reader->integer();
+    bool ok = reader->ok() && channel == index && !id && length >= sizeof(value) && type == value;
+    reader->rewind();
+    return ok;
+}
+
+bool BSockConnection::acknowledged() const {
+    for (size_t i = CT_UNRELIABLE + 1; i < JET_CHANNEL_COUNT; i++) {
+        if (!channel_[i].queued.empty() || channel_[i].oldest != channel_[i].next) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BSockConnection::update(float delta) {
+    time_ += delta;
+}
+
+void BSockConnection::receive(BSockReader* reader) {
+    uint16_t sequence = (uint16_t)reader->bits(16);
+    uint16_t ack = (uint16_t)reader->bits(16);
+    uint32_t mask = reader->bits(32);
+    if (!reader->ok() || !received(sequence)) {
+        return;
+    }
+    receive_time_ = time_;
+    ack_pending_ = true;
+
+    // Each packet acknowledges the newest packet the peer has received, 
+    // and the packets before it that are set in the mask
+    acknowledge(ack);
+    for (size_t i = 0; i < 32; i++) {
+        if (mask & (1u << i)) {
+            acknowledge((uint16_t)(ack - i - 1));
+        }
+    }
+
+    // Read the messages.  A message that runs past the end of the packet 
+    // means the packet is corrupt, so the rest of it is dropped.
+    while (reader->remaining() > 0) {
+        size_t channel = reader->byte();
+        uint16_t id = (uint16_t)reader->bits(16);
+        size_t length = reader->bits(16);
+        const char* data = reader->bytes(length);
+        if (!reader->ok() || channel >= JET_CHANNEL_COUNT || length + sizeof(size_t) > JET_MAX_PACKET_SIZE) {
+            return;
+        }
+        deliver(channel, id, data, length);
+    }
+}
+
+void BSockConnection::flush() {
+    // Send packets until there's nothing left to send.  Even if there are
+    // no messages, send one packet to acknowledge the packets received 
+    // since the last flush, or to keep the connection alive.
+    bool keepalive = time_ - send_time_ >= KEEPALIVE_TIME;
+    while (ack_pending_ || keepalive || pending()) {
+        BSockWriter writer(socket_.get(), address_);
+        if (!writer.ok()) {
+            return;
+        }
+
+        uint16_t sequence = sequence_++;
+        writer.bits(sequence, 16);
+        writer.bits(remote_sequence_, 16);
+        writer.bits(remote_mask_, 32);
+
+        SentPacket& sent = sent_[sequence % JET_PACKET_HISTORY];
+        sent.sequence = sequence;
+        sent.acked = false;
+        sent.time = time_;
+        sent.message.clear();
+
+        // Send the reliable messages that are due first, oldest first.  A
+        // message that doesn't fit waits for the next packet.
+        for (size_t i = CT_UNRELIABLE + 1; i < JET_CHANNEL_COUNT; i++) {
+            Channel& channel = channel_[i];
+            for (uint16_t id = channel.oldest; id != channel.next; id++) {
+                size_t slot = id % JET_RELIABLE_WINDOW;
+                BSockPacket* message = channel.sent[slot];
+                if (!due(i, id)) {
+                    continue;
+                }
+                size_t length = message->size - sizeof(size_t);
+                if (writer.size() + MESSAGE_HEADER + length > JET_MAX_PACKET_SIZE) {
+                    break;
+                }
+                writer.byte((uint8_t)i);
+                writer.bits(id, 16);
+                writer.bits(length, 16);
+                writer.bytes(message->data + sizeof(size_t), length);
+                if (channel.sent_time[slot] >= 0.0f) {
+                    resent_++;
+                }
+                channel.sent_time[slot] = time_;
+                sent.message.push_back((i << 16) | id);
+            }
+        }
+
+        // Fill the rest of the packet with unreliable messages, which are
+        // dropped once they have been sent
+        BSockPacketQueue& queued = channel_[CT_UNRELIABLE].queued;
+        while (BSockPacket* message = queued.front()) {
+            size_t length = message->size - sizeof(size_t);
+            if (writer.size() + MESSAGE_HEADER + length > JET_MAX_PACKET_SIZE) {
+                break;
+            }
+            writer.byte(CT_UNRELIABLE);
+            writer.bits(0, 16);
+            writer.bits(length, 16);
+            writer.bytes(message->data + sizeof(size_t), length);
+            pool_->release(queued.pop());
+        }
+
+        ack_pending_ = false;
+        keepalive = false;
+        send_time_ = time_;
+    }
+}
+
+BSockPacket* BSockConnection::read_packet() {
+    return delivered_.pop();
+}
+
+BSockPacket* BSockConnection::write_packet(ChannelType channel) {
+    // Unreliable messages are dropped if too many are waiting to be sent,
+    // the same way a datagram socket drops packets.  Reliable messages are
+    // always queued.
+    if (CT_UNRELIABLE == channel && channel_[channel].queued.size() >= JET_RELIABLE_WINDOW) {
+        return 0;
+    } else {
+        return pool_->acquire();
+    }
+}
+
+void BSockConnection::send(BSockPacket* packet, ChannelType channel) {
+    channel_[channel].queued.push(packet);
+    if (CT_UNRELIABLE != channel) {
+        advance(channel);
+    }
+}
+
+void BSockConnection::release(BSockPacket* packet) {
+    pool_->release(packet);
+}
+
+bool BSockConnection::pending() const {
+    // Returns true if there are unreliable messages, or reliable messages
+    // that are due to be sent
+    if (!channel_[CT_UNRELIABLE].queued.empty()) {
+        return true;
+    }
+    for (size_t i = CT_UNRELIABLE + 1; i < JET_CHANNEL_COUNT; i++) {
+        for (uint16_t id = channel_[i].oldest; id != channel_[i].next; id++) {
+            if (due(i, id)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool BSockConnection::due(size_t channel, uint16_t id) const {
+    // A message is due if it has never been sent, or if it hasn't been 
+    // acknowledged within the resend time.  The resend time backs off to
+    // twice the round-trip time on slow connections.  A message is never
+    // sent twice in one flush.
+    size_t slot = id % JET_RELIABLE_WINDOW;
+    if (!channel_[channel].sent[slot]) {
+        return false;
+    }
+    float sent_time = channel_[channel].sent_time[slot];
+    if (sent_time < 0.0f) {
+        return true;
+    }
+    return time_ > sent_time && time_ - sent_time >= max(resend_time_, 2.0f * round_trip_time_);
+}
+
+bool BSockConnection::received(uint16_t sequence) {
+    // Records the sequence number of a packet from the peer.  Returns false
+    // if the packet is a duplicate, or too old to acknowledge.
+    uint16_t distance = sequence - remote_sequence_;
+    if (distance && distance < 0x8000) {
+        // Newer packet: shift the mask, and add the old newest packet
+        remote_mask_ = (distance < 32) ? (remote_mask_ << distance) : 0;
+        if (distance <= 32) {
+            remote_mask_ |= 1u << (distance - 1);
+        }
+        remote_sequence_ = sequence;
+        return true;
+    }
+
+    distance = remote_sequence_ - sequence;
+    if (!distance || distance > 32 || (remote_mask_ & (1u << (distance - 1)))) {
+        return false;
+    }
+    remote_mask_ |= 1u << (distance - 1);
+    return true;
+}
+
+void BSockConnection::acknowledge(uint16_t sequence) {
+    SentPacket& sent = sent_[sequence % JET_PACKET_HISTORY];
+    if (sent.sequence != sequence || sent.acked) {
+        return;
+    }
+    sent.acked = true;
+
+    // Update the round-trip time with an exponential moving average
+    float sample = time_ - sent.time;
+    if (round_trip_time_ > 0.0f) {
+        round_trip_time_ += 0.1f * (sample - round_trip_time_);
+    } else {
+        round_trip_time_ = sample;
+    }
+
+    // Release the messages that the packet carried.  A message may have 
+    // been acknowledged already by another packet that carried it.
+    for (size_t i = 0; i < sent.message.size(); i++) {
+        size_t index = sent.message[i] >> 16;
+        uint16_t id = (uint16_t)(sent.message[i] & 0xffff);
+        Channel& channel = channel_[index];
+        if ((uint16_t)(id - channel.oldest) < (uint16_t)(channel.next - channel.oldest)) {
+            size_t slot = id % JET_RELIABLE_WINDOW;
+            pool_->release(channel.sent[slot]);
+            channel.sent[slot] = 0;
+        }
+    }
+    for (size_t i = CT_UNRELIABLE + 1; i < JET_CHANNEL_COUNT; i++) {
+        advance(i);
+    }
+}
+
+void BSockConnection::advance(size_t index) {
+    // Slide the window past the acknowledged messages, and then move 
+    // queued messages into the window
+    Channel& channel = channel_[index];
+    while (channel.oldest != channel.next && !channel.sent[channel.oldest % JET_RELIABLE_WINDOW]) {
+        channel.oldest++;
+    }
+    while (!channel.queued.empty() && (uint16_t)(channel.next - channel.oldest) < JET_RELIABLE_WINDOW) {
+        size_t slot = channel.next % JET_RELIABLE_WINDOW;
+        channel.sent[slot] = channel.queued.pop();
+        channel.sent_time[slot] = -1.0f;
+        channel.next++;
+    }
+}
+
+void BSockConnection::deliver(size_t index, uint16_t id, const char* data, size_t length) {
+    // Buffer reliable messages that arrive ahead of a lost message, and 
+    // drop messages that have already been delivered.  The sender never 
+    // has more than a window of messages in flight, so a message ID past
+    // the window is a stale duplicate.
+    Channel& channel = channel_[index];
+    size_t slot = id % JET_RELIABLE_WINDOW;
+    if (CT_UNRELIABLE != index) {
+        if ((uint16_t)(id - channel.expected) >= JET_RELIABLE_WINDOW || channel.received[slot]) {
+            return;
+        }
+    }
+
+    // Copy the message into its own packet, so that readers can read it 
+    // like any other packet
+    BSockPacket* message = pool_->acquire();
+    message->size = length + sizeof(size_t);
+    message->channel = (ChannelType)index;
+    memcpy(message->data + sizeof(size_t), data, length);
+
+    if (CT_UNRELIABLE == index) {
+        delivered_.push(message);
+        return;
+    }
+    channel.received[slot] = message;
+    while (BSockPacket* next = channel.received[channel.expected % JET_RELIABLE_WINDOW]) {
+        channel.received[channel.expected % JET_RELIABLE_WINDOW] = 0;
+        delivered_.push(next);
+        channel.expected++;
+    }
+}
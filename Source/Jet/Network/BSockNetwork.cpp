@@ -39,6 +39,7 @@ using namespace std;
 
 BSockNetwork::BSockNetwork(CoreEngine* engine) :
     engine_(engine),
+	snapshot_codec_(engine),
     accumulator_(0.0f),
 	state_(NS_DISABLED),
 	tx_bytes_(0),
@@ -52,8 +53,20 @@ BSockNetwork::BSockNetwork(CoreEngine* engine) :
 	engine_->option("network_smoothness", 0.5f);
 	engine_->option("input_delay", (float)12); // Delay input by 12 ticks before processing
 	engine_->option("network_packet_rate", (float)6); // Send 1 packet every 6 ticks
+	engine_->option("network_batch_size", (float)JET_DATAGRAM_BATCH); // Datagrams per send/receive call
+	engine_->option("network_resend_time", 0.1f); // Resend reliable messages after 100ms
+	engine_->option("network_timeout", 5.0f); // Drop connections after 5s of silence
+	// Simulated network conditions.  Each datagram socket applies them to
+	// the packets it sends and again to the packets it receives.
+	engine_->option("network_sim_latency", 0.0f); // Simulated delay, in seconds
+	engine_->option("network_sim_jitter", 0.0f); // Simulated random extra delay, in seconds
+	engine_->option("network_sim_loss", 0.0f); // Fraction of packets dropped
+	engine_->option("network_sim_duplicate", 0.0f); // Fraction of packets duplicated
+	engine_->option("network_sim_bandwidth", 0.0f); // Simulated bandwidth cap in kbit/s (0 for none)
+	engine_->option("network_sim_seed", 1.0f); // Seed for the simulator's random numbers
 	engine_->option("stat_tx_rate", (float)0);
 	engine_->option("stat_rx_rate", (float)0);
+	engine_->option("stat_packet_buffers", (float)0);
     
 #ifdef WINDOWS
     WSAData data;
@@ -82,12 +95,17 @@ void BSockNetwork::on_tick() {
 			
 			// Send and packet every 6th physics tick (i.e., every 100ms)
 			if (NS_HOST == state_) {
-				rpc_node_state(datagram_.get());
+				rpc_node_state();
 			}
 
-			// Send input to other hosts
+			// Send input to other hosts.  Clients only have a connection to
+			// the host, which forwards the input to the other clients.
 			if (NS_HOST == state_ || NS_CLIENT == state_) {
-				rpc_input(datagram_.get());
+				for (size_t i = 0; i < connection_.size(); i++) {
+					if (connection_[i]) {
+						rpc_input(connection_[i].get());
+					}
+				}
 			}
 		}
 
@@ -105,6 +123,8 @@ void BSockNetwork::on_tick() {
 			}
 		}
 
+		flush_sockets();
+
 	} catch (std::exception&) {
 		engine_->module()->on_network_error();
 	}
@@ -112,12 +132,31 @@ void BSockNetwork::on_tick() {
 
 void BSockNetwork::on_update() {
 	try {
+		// Advance the clocks that time resends, timeouts and simulated
+		// network conditions
+		for (size_t i = 0; i < connection_.size(); i++) {
+			if (connection_[i]) {
+				connection_[i]->update(engine_->frame_delta());
+			}
+		}
+		for (size_t i = 0; i < closing_.size(); i++) {
+			closing_[i]->update(engine_->frame_delta());
+		}
+		if (datagram_) {
+			datagram_->update(engine_->frame_delta());
+		}
+		if (multicast_) {
+			multicast_->update(engine_->frame_delta());
+		}
+
 		switch (state_) {
 			case NS_DISCOVER: do_discover(); break;
 			case NS_HOST: do_host(); break;
 			case NS_CLIENT: do_client(); break;
 			default: break;
 		}
+		do_closing();
+		flush_sockets();
 	} catch (std::exception&) {
 		if (engine_->module()) {
 			engine_->module()->on_network_error();
@@ -127,14 +166,32 @@ void BSockNetwork::on_update() {
 	update_stats();
 }
 
+void BSockNetwork::flush_sockets() {
+	// Pack the messages queued during this frame into packets, and then 
+	// send the datagrams in one batch
+	for (size_t i = 0; i < connection_.size(); i++) {
+		if (connection_[i]) {
+			connection_[i]->flush();
+		}
+	}
+	if (datagram_) {
+		datagram_->poll_write();
+	}
+	if (multicast_) {
+		multicast_->poll_write();
+	}
+}
+
 void BSockNetwork::do_discover() {
-    // Read in a game structure from the user
-    read_rpcs(multicast_.get());
+    // Read in a game structure from the user.  The socket is read every 
+	// frame, because the simulator may be holding packets back; it only 
+	// makes a system call once the reactor has reported it ready.
+    reactor_.poll();
+	read_rpcs(multicast_.get());
 }
 
 void BSockNetwork::do_host() {
 	do_host_hello();
-	do_host_incoming_connections();
 	do_host_poll_sockets();
 }
 
@@ -143,68 +200,178 @@ void BSockNetwork::do_host_hello() {
     accumulator_ += engine_->frame_delta();
     if (accumulator_ > 1.0f/engine_->option<float>("broadcast_rate")) {
         rpc_match_info(multicast_.get());
-		rpc_sync_tick(datagram_.get());
+		for (size_t i = 0; i < connection_.size(); i++) {
+			if (connection_[i]) {
+				rpc_sync_tick(connection_[i].get(), CT_UNRELIABLE);
+			}
+		}
 		accumulator_ = 0.0f;
     }
 }
 
-void BSockNetwork::do_host_incoming_connections() {
-    // Check for incoming connections
-    if (BSockSocketPtr socket = server_->socket()) {
-        // If there is an open slot, then assign the newly accepted socket 
-		// to it.  Otherwise, the socket will close.
-        for (size_t i = 1; i < player_.size(); i++) {
-            if (!stream_[i]) {
-				// Set up the new socket and player
-				stream_[i].reset(socket.get());
-                player_[i].timestamp = engine_->frame_time();
-				rpc_sync_tick(socket.get());
-				break;
-			}
-        }
+void BSockNetwork::do_host_poll_sockets() {
+    
+    // Send packets if the datagram socket has pending I/O.  The discovery
+	// multicast socket is only written to while hosting.  The datagram 
+	// socket is read every frame, because the simulator may be holding
+	// packets back.
+	for (size_t i = 0, count = reactor_.poll(); i < count; i++) {
+		BSockSocketPtr socket = reactor_.ready(i);
+		if (socket && socket == datagram_) {
+			datagram_->poll_write();
+		}
     }
+	read_datagrams();
+
+	// Handle the messages that the connections have delivered, and drop
+	// the players that have gone quiet.  A handler may drop a player, so
+	// check each slot again before using it.
+	for (size_t i = 0; i < connection_.size(); i++) {
+		if (connection_[i] && connection_[i]->timed_out()) {
+			do_host_drop_player(i);
+		} else if (connection_[i]) {
+			read_rpcs(connection_[i].get());
+		}
+	}
 }
 
-void BSockNetwork::do_host_poll_sockets() {
-    
-    // Update the sockets
-	for (size_t i = 0; i < player_.size(); i++) {
-		if (!stream_[i]) {
-			continue;
+BSockConnection* BSockNetwork::do_host_accept(const Address& address) {
+	// If there is an open slot, then assign a new connection to it.  
+	// Otherwise, the packet is dropped.
+	for (size_t i = 1; i < connection_.size(); i++) {
+		if (!connection_[i]) {
+			connection_[i].reset(new BSockConnection(engine_, datagram_.get(), address));
+			player_[i].timestamp = engine_->frame_time();
+			rpc_sync_tick(connection_[i].get(), CT_SYSTEM);
+			return connection_[i].get();
 		}
+	}
+	return 0;
+}
+
+void BSockNetwork::do_host_drop_player(size_t index) {
+	// Close the connection, and notify the other players that the 
+	// player has disconnected.  The connection keeps acknowledging the
+	// player's packets for a while, in case the acknowledgement for the 
+	// leave message is lost.
+	closing_.push_back(connection_[index]);
+	connection_[index] = 0;
+	player_[index] = Player();
+	if (engine_->module()) {
+		engine_->module()->on_player_list_update();
+	}
+	rpc_player_list_all();
+}
 
-		try {
-			// Try to send data and/or receive RPCs on the stream socket
-			stream_[i]->poll_write();
-			read_rpcs(stream_[i].get());
-		} catch (std::exception&) {
-			// Erase the socket if an error occurs
-			stream_[i] = 0;
-			player_[i] = Player();
-
-			// Notify the other players that the player has
-			// disconnected
-			if (engine_->module()) {
-				engine_->module()->on_player_list_update();
+void BSockNetwork::do_client() {
+    // Send buffered input keystrokes if the socket is ready, and check for
+	// incoming packets on the UDP socket
+	for (size_t i = 0, count = reactor_.poll(); i < count; i++) {
+		BSockSocketPtr socket = reactor_.ready(i);
+		if (socket && socket == datagram_) {
+			datagram_->poll_write();
+		}
+	}
+	read_datagrams();
+	
+	// The host has gone away if it hasn't sent anything for a while
+	if (connection_[0]->timed_out()) {
+		throw runtime_error("Connection timed out");
+	}
+	read_rpcs(connection_[0].get());
+}
+
+void BSockNetwork::do_closing() {
+	// Closing connections on the current datagram socket get their packets
+	// from read_datagrams().  The others outlived the state that owned 
+	// their socket, so read and flush the socket here.
+	vector<BSockSocketPtr> socket;
+	for (size_t i = 0; i < closing_.size(); i++) {
+		BSockSocketPtr s(closing_[i]->socket());
+		if (s != datagram_ && find(socket.begin(), socket.end(), s) == socket.end()) {
+			socket.push_back(s);
+		}
+	}
+
+	try {
+		if (!socket.empty()) {
+			reactor_.poll();
+		}
+		for (size_t i = 0; i < socket.size(); i++) {
+			socket[i]->update(engine_->frame_delta());
+			while (true) {
+				BSockReader reader(socket[i].get());
+				if (!reader.ok()) {
+					break;
+				}
+				for (size_t j = 0; j < closing_.size(); j++) {
+					if (closing_[j]->socket() == socket[i].get() && closing_[j]->address() == reader.address()) {
+						closing_[j]->receive(&reader);
+						break;
+					}
+				}
 			}
-			rpc_player_list_all();
 		}
-    }
 
-	// Check for messages on the UDP socket
-	datagram_->poll_write();
-	read_rpcs(datagram_.get());
+		// Messages that arrive on a closing connection are dropped.  Once
+		// the peer has acknowledged everything, or has gone quiet, the 
+		// connection is released, which sends the last acknowledgements.
+		for (size_t i = 0; i < closing_.size();) {
+			BSockConnection* connection = closing_[i].get();
+			while (true) {
+				BSockReader reader(connection);
+				if (!reader.ok()) {
+					break;
+				}
+			}
+			if (connection->acknowledged() || connection->timed_out()) {
+				closing_.erase(closing_.begin() + i);
+			} else {
+				connection->flush();
+				i++;
+			}
+		}
+		for (size_t i = 0; i < socket.size(); i++) {
+			socket[i]->poll_write();
+		}
+	} catch (std::exception&) {
+		// The game has moved on, so errors on a closing connection aren't
+		// reported; the connections are just dropped
+		closing_.clear();
+	}
 }
 
-void BSockNetwork::do_client() {
-    // Check for incoming messages from the server, send buffered input 
-	// keystrokes here if possible
-    stream_[0]->poll_write();
-    read_rpcs(stream_[0].get());
+void BSockNetwork::read_datagrams() {
+	// Hand each packet to the connection for the peer that sent it.  The
+	// host accepts new peers while there are open slots, but only when 
+	// they open with a join request, so that stray packets (e.g., from a 
+	// player that has just left) don't take up a slot.  Clients only 
+	// accept packets from the host.
+	while (true) {
+		BSockReader reader(datagram_.get());
+		if (!reader.ok()) {
+			break;
+		}
 
-	// Check for incoming messages from the UDP socket
-	datagram_->poll_write();
-	read_rpcs(datagram_.get());
+		Address address = reader.address();
+		BSockConnection* connection = 0;
+		for (size_t i = 0; i < connection_.size() && !connection; i++) {
+			if (connection_[i] && connection_[i]->address() == address) {
+				connection = connection_[i].get();
+			}
+		}
+		for (size_t i = 0; i < closing_.size() && !connection; i++) {
+			if (closing_[i]->socket() == datagram_.get() && closing_[i]->address() == address) {
+				connection = closing_[i].get();
+			}
+		}
+		if (!connection && NS_HOST == state_ && BSockConnection::opens(&reader, CT_SYSTEM, PT_PLAYER_JOIN)) {
+			connection = do_host_accept(address);
+		}
+		if (connection) {
+			connection->receive(&reader);
+		}
+	}
 }
 
 void BSockNetwork::state(NetworkState state) {    
@@ -212,29 +379,38 @@ void BSockNetwork::state(NetworkState state) {
         return;
 	}
     
-	// Destroy the old client state
+	// Destroy the old client state.  The connection is kept until the
+	// host acknowledges the goodbye message, so that it is resent if it 
+	// gets lost.
     if (NS_CLIENT == state_) {
 		try {
-			rpc_player_leave(stream_[0].get());
+			rpc_player_leave(connection_[0].get());
 		} catch (std::exception&) {
 		}
-		stream_.clear();
+		closing_.push_back(connection_[0]);
+		connection_.clear();
 		datagram_.reset();
     } else if (NS_HOST == state_) {
-        // Notify all that the match is destroyed
+        // Notify all that the match is destroyed, and keep the connections
+		// until the clients acknowledge it
 		try {
 			rpc_match_destroy(multicast_.get());
 			rpc_match_destroy_all();
 		} catch (std::exception&) {
 		}
-        server_.reset();
+		for (size_t i = 0; i < connection_.size(); i++) {
+			if (connection_[i]) {
+				closing_.push_back(connection_[i]);
+			}
+		}
+		connection_.clear();
 		datagram_.reset();
-		stream_.clear();
 	} else if (NS_DISCOVER != state_) {
 		multicast_.reset();
 	}
 	
 	// Initialize the new state
+	snapshot_codec_.reset();
 	if (NS_CLIENT == state) {
         enter_client();
 	} else if (NS_HOST == state) {
@@ -258,17 +434,13 @@ void BSockNetwork::enter_discover() {
 }
 
 void BSockNetwork::enter_host() {
-    
-    // Initialize the server socket
-    server_.reset(BSockServerSocket::server(engine_, 0));
 
 	// Seed the random number generator
 	::srand((uint32_t)time(NULL));
 
-	// Initialize the datagram socket to send and receive on a random port 
-	// with a random multicast group
-	uint32_t rand_ip = 0xE4000100 | (::rand() & 0xFF);
-	datagram_.reset(BSockSocket::multicast(engine_, Address(rand_ip, 0)));
+	// Initialize the datagram socket to send and receive on a random port.
+	// The port is advertised in the match info.
+	datagram_.reset(BSockSocket::datagram(engine_, Address()));
     
     // Initialize the discover multicast socket
     string ip = engine_->option<string>("discover_ip");
@@ -283,9 +455,9 @@ void BSockNetwork::enter_host() {
     player_.resize((size_t)engine_->option<float>("max_players"));
     player_[0] = current_player_;
 
-	// Clear out client sockets
-	stream_.clear();
-	stream_.resize(player_.size());
+	// Clear out client connections
+	connection_.clear();
+	connection_.resize(player_.size());
     
     // Update the player list
     if (engine_->module()) {
@@ -295,240 +467,291 @@ void BSockNetwork::enter_host() {
 }
 
 void BSockNetwork::enter_client() {
-	// Resize the stream sockets
-	stream_.clear();
-	stream_.resize(1);
-    
-    // Create a new client socket to connect to the server
-	stream_[0].reset(BSockSocket::client(engine_, current_match_.stream_address));
-	
-	// Initialize the datagram socket to send to the server's multicast address
-	datagram_.reset(BSockSocket::multicast(engine_, current_match_.datagram_address));
-	rpc_player_join(stream_[0].get());
+	// Initialize the datagram socket on any port, and connect to the 
+	// host's datagram socket
+	datagram_.reset(BSockSocket::datagram(engine_, Address(), current_match_.datagram_address));
+	connection_.clear();
+	connection_.push_back(new BSockConnection(engine_, datagram_.get(), current_match_.datagram_address));
+	rpc_player_join(connection_[0].get());
 }
 
 void BSockNetwork::unreliable_rpc(const string& name, const vector<boost::any>& args) {
+	// Clients only have a connection to the host, which forwards the RPC
+	// to the other clients on behalf of the client.
 	if (NS_CLIENT == state_ || NS_HOST == state_) {
-		rpc_user_rpc(datagram_.get(), name, args);
+		for (size_t i = 0; i < connection_.size(); i++) {
+			if (connection_[i]) {
+				rpc_user_rpc(connection_[i].get(), CT_UNRELIABLE, name, args);
+			}
+		}
 	}
 }
 
 void BSockNetwork::reliable_rpc(const string& name, const vector<boost::any>& args) {
-	if (NS_CLIENT == state_) {
-		// Send the RPC to the server, which will forward the RPC to the other
-		// clients on behalf of the client.
-		rpc_user_rpc(stream_[0].get(), name, args);
-	} else if (NS_HOST == state_) {
-		// Send one packet to each client
-		for (size_t i = 0; i < stream_.size(); i++) {
-			if (stream_[i]) {
-				rpc_user_rpc(stream_[i].get(), name, args);
+	if (NS_CLIENT == state_ || NS_HOST == state_) {
+		for (size_t i = 0; i < connection_.size(); i++) {
+			if (connection_[i]) {
+				rpc_user_rpc(connection_[i].get(), CT_RPC, name, args);
 			}
 		}
-	} else {
-		// Client is not connected; discard the RPC
-		return;
 	}
 }
 
 void BSockNetwork::read_rpcs(BSockSocket* socket) {
-    while (BSockReaderPtr reader = socket->reader()) {
-        PacketType rpc = static_cast<PacketType>(reader->integer());
-
-		switch (rpc) {
-			case PT_MATCH_INFO: on_match_info(reader.get()); break;
-			case PT_MATCH_DESTROY: on_match_destroy(reader.get()); break;
-			case PT_PLAYER_JOIN: on_player_join(reader.get()); break;
-			case PT_PLAYER_LEAVE: on_player_leave(reader.get()); break;
-			case PT_PLAYER_LIST: on_player_list(reader.get()); break;
-			case PT_STATE: on_node_state(reader.get()); break;
-			case PT_PING: on_ping(reader.get()); break;
-			case PT_SYNC: on_sync_tick(reader.get()); break;
-			case PT_INPUT: on_input(reader.get()); break;
-			case PT_USER_RPC: on_user_rpc(reader.get()); break;
-		}
+    // Hold a reference to the socket, because a handler may drop the 
+    // network's reference to it
+    BSockSocketPtr hold(socket);
+    while (true) {
+        BSockReader reader(socket);
+        if (!reader.ok()) {
+            break;
+        }
+        read_rpc(&reader);
     }
 }
 
+void BSockNetwork::read_rpcs(BSockConnection* connection) {
+    // Hold a reference to the connection, because a handler may drop the 
+    // network's reference to it (e.g., when a player leaves)
+    BSockConnectionPtr hold(connection);
+    while (true) {
+        BSockReader reader(connection);
+        if (!reader.ok()) {
+            break;
+        }
+        read_rpc(&reader);
+    }
+}
+
+void BSockNetwork::read_rpc(BSockReader* reader) {
+	PacketType rpc = static_cast<PacketType>(reader->integer());
+
+	switch (rpc) {
+		case PT_MATCH_INFO: on_match_info(reader); break;
+		case PT_MATCH_DESTROY: on_match_destroy(reader); break;
+		case PT_PLAYER_JOIN: on_player_join(reader); break;
+		case PT_PLAYER_LEAVE: on_player_leave(reader); break;
+		case PT_PLAYER_LIST: on_player_list(reader); break;
+		case PT_STATE: on_node_state(reader); break;
+		case PT_PING: on_ping(reader); break;
+		case PT_SYNC: on_sync_tick(reader); break;
+		case PT_INPUT: on_input(reader); break;
+		case PT_USER_RPC: on_user_rpc(reader); break;
+	}
+}
+
 void BSockNetwork::rpc_match_info(BSockSocket* socket) {
-    if (BSockWriterPtr writer = socket->writer()) {
-        writer->integer(PT_MATCH_INFO);
-        writer->string(current_match_.name);
-        writer->integer(server_->address().address);
-        writer->integer(server_->address().port); // Port
-        writer->integer(datagram_->address().address);
-        writer->integer(datagram_->address().port); // Multicast port
-        writer->integer(current_match_.uuid);     
+    // Clients send to the address that the match info came from, on the
+    // datagram socket's port
+    BSockWriter writer(socket);
+    if (writer.ok()) {
+        writer.integer(PT_MATCH_INFO);
+        writer.string(current_match_.name);
+        writer.integer(datagram_->address().port);
+        writer.integer(current_match_.uuid);     
     }
 }
 
 void BSockNetwork::rpc_match_destroy(BSockSocket* socket) {
-    if (BSockWriterPtr writer = socket->writer()) {
-        writer->integer(PT_MATCH_DESTROY);
-        writer->integer(current_match_.uuid);
+    BSockWriter writer(socket);
+    if (writer.ok()) {
+        writer.integer(PT_MATCH_DESTROY);
+        writer.integer(current_match_.uuid);
     }
 }
 
-void BSockNetwork::rpc_player_join(BSockSocket* socket) {
-    if (BSockWriterPtr writer = socket->writer()) {
-        writer->integer(PT_PLAYER_JOIN);
-        writer->string(current_player_.name);
-        writer->integer(current_player_.uuid);
+void BSockNetwork::rpc_match_destroy(BSockConnection* connection) {
+    BSockWriter writer(connection, CT_SYSTEM);
+    if (writer.ok()) {
+        writer.integer(PT_MATCH_DESTROY);
+        writer.integer(current_match_.uuid);
     }
 }
 
-void BSockNetwork::rpc_player_leave(BSockSocket* socket) {
-    if (BSockWriterPtr writer = socket->writer()) {
-        writer->integer(PT_PLAYER_LEAVE);
-        writer->integer(current_player_.uuid);
+void BSockNetwork::rpc_player_join(BSockConnection* connection) {
+    BSockWriter writer(connection, CT_SYSTEM);
+    if (writer.ok()) {
+        writer.integer(PT_PLAYER_JOIN);
+        writer.string(current_player_.name);
+        writer.integer(current_player_.uuid);
     }
 }
 
-void BSockNetwork::rpc_player_list(BSockSocket* socket) {
-    if (BSockWriterPtr writer = socket->writer()) {
-        writer->integer(PT_PLAYER_LIST);
-        writer->integer(player_.size());
+void BSockNetwork::rpc_player_leave(BSockConnection* connection) {
+    BSockWriter writer(connection, CT_SYSTEM);
+    if (writer.ok()) {
+        writer.integer(PT_PLAYER_LEAVE);
+        writer.integer(current_player_.uuid);
+    }
+}
+
+void BSockNetwork::rpc_player_list(BSockConnection* connection) {
+    BSockWriter writer(connection, CT_SYSTEM);
+    if (writer.ok()) {
+        writer.integer(PT_PLAYER_LIST);
+        writer.integer(player_.size());
         for (size_t i = 0; i < player_.size(); i++) {
-            writer->string(player_[i].name);
-            writer->integer(player_[i].uuid);
+            writer.string(player_[i].name);
+            writer.integer(player_[i].uuid);
         }
     }
 }
 
-void BSockNetwork::rpc_node_state(BSockSocket* socket) {
-	if (BSockWriterPtr writer = socket->writer()) {
+void BSockNetwork::rpc_node_state() {
+	// Build a snapshot with the state of each actor in the network.  The
+	// monitors are sorted by hash, which the snapshot codec requires.
+	snapshot_codec_.clear();
+	for (map<uint32_t, BSockNetworkMonitorPtr>::iterator i = network_monitor_.begin(); i != network_monitor_.end();) {
 		
-		writer->integer(PT_STATE); // Write the packet type
-		writer->integer(engine_->tick_id()); // Tick this state was sent on
-		writer->integer(current_player_.uuid);
+		// Increment the iterator in case we need to delete the node.
+		// This prevents the iterator from being invalidated.
+		map<uint32_t, BSockNetworkMonitorPtr>::iterator j = i++;
+		CoreNode* node = j->second->parent();
+		uint32_t uuid = j->second->player_uuid();
 		
-		// Write state for each actor in the network
-		for (map<uint32_t, BSockNetworkMonitorPtr>::iterator i = network_monitor_.begin(); i != network_monitor_.end();) {
-			
-			// Increment the iterator in case we need to delete the node.
-			// This prevents the iterator from being invalidated.
-			map<uint32_t, BSockNetworkMonitorPtr>::iterator j = i++;
-			CoreNode* node = j->second->parent();
-			uint32_t uuid = j->second->player_uuid();
-			
-			// Write the most current state information for the node. This includes 
-			// position, velocity,  and rotation.  If a UDP socket is used, and the
-			// previous buffer has not already been sent, then this will overwrite 
-			// the waiting buffer.  There's no point in sending data that is out
-			// of date.
-			if (!node) {
-				// The node has been destroyed, so erase the network monitor.
-				// This releases the reference on the monitor, thus freeing it.
-				network_monitor_.erase(j);
-			} else if (node->visible() && (!uuid || uuid == current_player_.uuid)) {
-				// If the node is visible and owned by the local player, then broadcast
-				// information about the node to all other players
-				
-				writer->integer(j->first); // Node hash (for ID)
-				writer->integer(node->actor()->state_hash()) ;// Write state hash 
-
-				// Write the rigid body state
-				writer->vector(node->position());
-				writer->quaternion(node->rotation());
-				writer->vector(node->linear_velocity());
-				writer->vector(node->angular_velocity());
-			}
+		// Write the most current state information for the node. This includes 
+		// position, velocity,  and rotation.
+		if (!node) {
+			// The node has been destroyed, so erase the network monitor.
+			// This releases the reference on the monitor, thus freeing it.
+			network_monitor_.erase(j);
+		} else if (node->visible() && (!uuid || uuid == current_player_.uuid)) {
+			// If the node is visible and owned by the local player, then broadcast
+			// information about the node to all other players
+			snapshot_codec_.node(j->first, node->actor()->state_hash(), node->position(), 
+				node->rotation(), node->linear_velocity(), node->angular_velocity());
 		}
+	}
 
-		// Write the end-of-packet marker: a zero word
-		writer->integer(0);
+	// Write the snapshot once, for the first client, and copy it for the
+	// other clients
+	size_t first = 0;
+	while (first < connection_.size() && !connection_[first]) {
+		first++;
+	}
+	if (first == connection_.size()) {
+		return;
+	}
+	BSockWriter writer(connection_[first].get(), CT_UNRELIABLE);
+	if (writer.ok()) {
+		
+		writer.integer(PT_STATE); // Write the packet type
+		writer.integer(engine_->tick_id()); // Tick this state was sent on
+		writer.integer(current_player_.uuid);
+
+		// Delta-compress the snapshot against the newest one that all the
+		// connected players have acknowledged
+		vector<uint32_t> peer;
+		for (size_t i = 0; i < player_.size(); i++) {
+			if (player_[i].uuid && player_[i].uuid != current_player_.uuid) {
+				peer.push_back(player_[i].uuid);
+			}
+		}
+		snapshot_codec_.write(&writer, engine_->tick_id(), peer);
+	}
+	for (size_t i = first + 1; i < connection_.size() && writer.ok(); i++) {
+		if (connection_[i]) {
+			BSockWriter copy(connection_[i].get(), CT_UNRELIABLE);
+			copy.packet(&writer);
+		}
 	}
 }
 
-void BSockNetwork::rpc_input(BSockSocket* socket) {
-	if (BSockWriterPtr writer = socket->writer()) {
+void BSockNetwork::rpc_input(BSockConnection* connection) {
+	BSockWriter writer(connection, CT_UNRELIABLE);
+	if (writer.ok()) {
 		const InputState& state = engine_->input()->input_state();
 
-		writer->integer(PT_INPUT);
-		writer->integer(state.player_uuid); // Write the player UUID
-		writer->integer(state.tick); // Active tick
-		writer->integer(state.mouse_button);
-		writer->real(state.mouse.x);
-		writer->real(state.mouse.y);
+		writer.integer(PT_INPUT);
+		writer.integer(state.player_uuid); // Write the player UUID
+		writer.integer(state.tick); // Active tick
+		writer.varint(state.mouse_button);
+		writer.real(state.mouse.x);
+		writer.real(state.mouse.y);
 
-		uint32_t words = (uint32_t)ceil((float)state.key.size()/(float)32);
-		writer->integer(words);
-
-		// Compress the key state by sending a bitset instead of
+		// Compress the key state by sending one bit per key instead of
 		// the whole array of byte-flags
-		uint32_t word = 0;
-		size_t i;
-		for (i = 0; i < state.key.size(); i++) {
-			uint32_t bit = i % 32;		
-			if (state.key[i]) {
-				word |= 1 << bit;
-			}
-			if ((i % 32) ==  31) {
-				writer->integer(word);
-				word = 0;
-			}
-		}
-		if ((i % 32) != 0) {
-			writer->integer(word);
+		writer.varint(state.key.size());
+		for (size_t i = 0; i < state.key.size(); i++) {
+			writer.boolean(state.key[i] != 0);
 		}
+
+		// Tell the host which state snapshots have arrived, so that it can
+		// send deltas against them
+		writer.integer(snapshot_codec_.ack().sequence);
+		writer.bits(snapshot_codec_.ack().mask, 32);
 	}
 }
 
-void BSockNetwork::rpc_ping(BSockSocket* socket) {
-	if (BSockWriterPtr writer = socket->writer()) {
+void BSockNetwork::rpc_ping(BSockConnection* connection) {
+	BSockWriter writer(connection, CT_UNRELIABLE);
+	if (writer.ok()) {
 		cout << "Sending ping" << endl;
-		writer->integer(PT_PING);
+		writer.integer(PT_PING);
 	}
 }
 
-void BSockNetwork::rpc_sync_tick(BSockSocket* socket) {
-	if (BSockWriterPtr writer = socket->writer()) {
-		writer->integer(PT_SYNC);
-		writer->integer(engine_->tick_id());
+void BSockNetwork::rpc_sync_tick(BSockConnection* connection, ChannelType channel) {
+	BSockWriter writer(connection, channel);
+	if (writer.ok()) {
+		writer.integer(PT_SYNC);
+		writer.integer(engine_->tick_id());
 	}
 }
 
-void BSockNetwork::rpc_user_rpc(BSockSocket* socket, const string& name, const vector<boost::any>& args) {
-	if (BSockWriterPtr writer = socket->writer()) {
-		writer->integer(PT_USER_RPC);
-		writer->integer(current_player_.uuid); // Player UUID
-		writer->string(name); // Name of the RPC function to be called
-		writer->integer(args.size()); // Number of parameters
+void BSockNetwork::rpc_user_rpc(BSockConnection* connection, ChannelType channel, const string& name, const vector<boost::any>& args) {
+	BSockWriter writer(connection, channel);
+	if (writer.ok()) {
+		writer.integer(PT_USER_RPC);
+		writer.integer(current_player_.uuid); // Player UUID
+		writer.string(name); // Name of the RPC function to be called
+		writer.integer(args.size()); // Number of parameters
 
 		// Iterate through the list and serialize the argument list to
 		// the socket.  N.B.: Efficiency in terms of bytes used to marshall
 		// the parameters could probably be better here.
 		for (size_t i = 0; i < args.size(); i++) {
 			if (typeid(float) == args[i].type()) {
-				writer->byte(DT_NUMBER);
-				writer->real(boost::any_cast<float>(args[i]));
+				writer.byte(DT_NUMBER);
+				writer.real(boost::any_cast<float>(args[i]));
 			} else if (typeid(string) == args[i].type()) {
-				writer->byte(DT_STRING);
-				writer->string(boost::any_cast<string>(args[i]));
+				writer.byte(DT_STRING);
+				writer.string(boost::any_cast<string>(args[i]));
 			} else if (typeid(bool) == args[i].type()) {
-				writer->byte(DT_BOOL);
-				writer->byte(boost::any_cast<bool>(args[i]));
+				writer.byte(DT_BOOL);
+				writer.byte(boost::any_cast<bool>(args[i]));
 			} else {
-				writer->byte(DT_NIL);
+				writer.byte(DT_NIL);
 			}
 		}
 	}
 }
 
+void BSockNetwork::rpc_forward(BSockReader* reader) {
+	// Copy a message from one client to all the other clients, on the 
+	// channel that it came in on
+	for (size_t i = 0; i < connection_.size(); i++) {
+		if (connection_[i] && connection_[i] != reader->connection()) {
+			BSockWriter writer(connection_[i].get(), reader->channel());
+			writer.packet(reader);
+		}
+	}
+}
+
 void BSockNetwork::rpc_player_list_all() {      
     // Update the player list for all the players
-	for (size_t i = 0; i < stream_.size(); i++) {
-		if (stream_[i]) {
-			rpc_player_list(stream_[i].get());
+	for (size_t i = 0; i < connection_.size(); i++) {
+		if (connection_[i]) {
+			rpc_player_list(connection_[i].get());
 		}
     }
 }
 
 void BSockNetwork::rpc_match_destroy_all() {
 	// Destroy the match
-	for (size_t i = 0; i < player_.size(); i++) {
-		if (stream_[i]) {
-			rpc_match_destroy(stream_[i].get());
+	for (size_t i = 0; i < connection_.size(); i++) {
+		if (connection_[i]) {
+			rpc_match_destroy(connection_[i].get());
 		}
 	}
 }
@@ -536,12 +759,13 @@ void BSockNetwork::rpc_match_destroy_all() {
 void BSockNetwork::on_match_info(BSockReader* reader) {
     NetworkMatch match;
     match.name = reader->string();
-    match.stream_address.address = reader->integer();
-    match.stream_address.port = (uint16_t)reader->integer();
-    match.datagram_address.address = reader->integer();
+    match.datagram_address.address = reader->address().address;
     match.datagram_address.port = (uint16_t)reader->integer();
     match.uuid = reader->integer();
     match.timestamp = engine_->frame_time();
+    if (!reader->ok()) {
+        return;
+    }
 
     // Search for and update/add the match to the list
     vector<NetworkMatch>::iterator i = find(match_.begin(), match_.end(), match);
@@ -559,6 +783,9 @@ void BSockNetwork::on_match_info(BSockReader* reader) {
 void BSockNetwork::on_match_destroy(BSockReader* reader) {
     NetworkMatch match;
     match.uuid = reader->integer();
+    if (!reader->ok()) {
+        return;
+    }
     
     // Search for and erase the match
     vector<NetworkMatch>::iterator i = find(match_.begin(), match_.end(), match);
@@ -575,11 +802,19 @@ void BSockNetwork::on_match_destroy(BSockReader* reader) {
 }
 
 void BSockNetwork::on_player_join(BSockReader* reader) {
-    vector<BSockSocketPtr>::iterator j = find(stream_.begin(), stream_.end(), reader->socket());
-	if (j != stream_.end()) {
-		size_t i = j - stream_.begin();
-		player_[i].name = reader->string();
-		player_[i].uuid = reader->integer();
+	if (NS_HOST != state_ || !reader->connection()) {
+		return;
+	}
+    vector<BSockConnectionPtr>::iterator j = find(connection_.begin(), connection_.end(), reader->connection());
+	if (j != connection_.end()) {
+		size_t i = j - connection_.begin();
+		string name = reader->string();
+		uint32_t uuid = reader->integer();
+		if (!reader->ok()) {
+			return;
+		}
+		player_[i].name = name;
+		player_[i].uuid = uuid;
 		player_[i].timestamp = engine_->frame_time();
 		if (engine_->module()) {
 			engine_->module()->on_player_list_update();
@@ -589,25 +824,35 @@ void BSockNetwork::on_player_join(BSockReader* reader) {
 }
 
 void BSockNetwork::on_player_leave(BSockReader* reader) {
-    // Read which player quic, and notify the GUI
-    vector<BSockSocketPtr>::iterator j = find(stream_.begin(), stream_.end(), reader->socket());
-	if (j != stream_.end()) {
-		size_t i = j - stream_.begin();
-		stream_[i] = 0;
-		player_[i] = Player();
-		if (engine_->module()) {
-			engine_->module()->on_player_list_update();
-		}
-		rpc_player_list_all();
+    // Read which player quit, and notify the GUI
+	if (NS_HOST != state_ || !reader->connection()) {
+		return;
+	}
+    vector<BSockConnectionPtr>::iterator j = find(connection_.begin(), connection_.end(), reader->connection());
+	if (j != connection_.end()) {
+		do_host_drop_player(j - connection_.begin());
 	}
 }
 
 void BSockNetwork::on_player_list(BSockReader* reader) {
-    player_.resize(reader->integer());
+    // Each player takes at least 5 bytes (an empty name and a UUID), which
+    // bounds the count before anything is allocated
+    size_t count = reader->integer();
+    if (count > reader->remaining()/5) {
+        return;
+    }
+    vector<Player> player(count);
+    for (size_t i = 0; i < player.size(); i++) {
+        player[i].name = reader->string();
+        player[i].uuid = reader->integer();
+        player[i].timestamp = engine_->frame_time();
+    }
+    if (!reader->ok()) {
+        return;
+    }
+    
+    player_.swap(player);
     for (size_t i = 0; i < player_.size(); i++) {
-        player_[i].name = reader->string();
-        player_[i].uuid = reader->integer();
-        player_[i].timestamp = engine_->frame_time();
         if (engine_->module()) {
             engine_->module()->on_player_list_update();
         }
@@ -622,27 +867,30 @@ void BSockNetwork::on_node_state(BSockReader* reader) {
 		return;
 	}
 
-	while (uint32_t hash = reader->integer()) {
-		// Read all the state data in for this node
-		uint32_t state_hash = reader->integer();
-
-		// Rigid body state information
-		Vector position = reader->vector();
-		Quaternion rotation = reader->quaternion();
-		Vector linear_velocity = reader->vector();
-		Vector angular_velocity = reader->vector();
+	// Drop the snapshot if the baseline it was compressed against never 
+	// arrived.  The host will switch to an older baseline once it stops 
+	// getting acknowledgements for the newer ones.
+	if (!snapshot_codec_.read(reader, tick)) {
+		return;
+	}
 
-		map<uint32_t, BSockNetworkMonitorPtr>::iterator i = network_monitor_.find(hash);
+	const BSockSnapshot& snapshot = snapshot_codec_.snapshot();
+	for (size_t j = 0; j < snapshot.node.size(); j++) {
+		const BSockNodeState& state = snapshot.node[j];
+		map<uint32_t, BSockNetworkMonitorPtr>::iterator i = network_monitor_.find(state.hash);
 		if (i != network_monitor_.end()) {
 			BSockNetworkMonitorPtr network_monitor = i->second;
-			network_monitor->state_hash(tick, state_hash);
-			network_monitor->position(tick, position, linear_velocity);
-			network_monitor->rotation(tick, rotation, angular_velocity);
+			network_monitor->state_hash(tick, state.state_hash);
+			network_monitor->position(tick, snapshot_codec_.position(state), snapshot_codec_.linear_velocity(state));
+			network_monitor->rotation(tick, snapshot_codec_.rotation(state), snapshot_codec_.angular_velocity(state));
 		}
 	}
 }
 
 void BSockNetwork::on_input(BSockReader* reader) {
+	if (NS_HOST == state_) {
+		rpc_forward(reader);
+	}
 
 	InputState state;
 	state.player_uuid = reader->integer();
@@ -651,21 +899,28 @@ void BSockNetwork::on_input(BSockReader* reader) {
 	}
 
 	state.tick = reader->integer();
-	state.mouse_button = reader->integer();
+	state.mouse_button = reader->varint();
 	state.mouse.x = reader->real();
 	state.mouse.y = reader->real();
 
-	state.key.resize(reader->integer() * 32);
-
-	uint32_t word;
+	// There is one bit per key, which bounds the key count
+	uint32_t keys = reader->varint();
+	if (keys > reader->remaining() * 8) {
+		return;
+	}
+	state.key.resize(keys);
 	for (size_t i = 0; i < state.key.size(); i++) {
-		if (i % 32 == 0) {
-			word = reader->integer();
-		}
-		uint32_t bit = i % 32;
-		if (word & (1 << bit)) {
-			state.key[i] = 1;
-		}
+		state.key[i] = reader->boolean() ? 1 : 0;
+	}
+
+	BSockSnapshotAck ack;
+	ack.sequence = reader->integer();
+	ack.mask = reader->bits(32);
+	if (!reader->ok()) {
+		return;
+	}
+	if (NS_HOST == state_) {
+		snapshot_codec_.ack(state.player_uuid, ack);
 	}
 
 	engine_->input()->input_state(state);
@@ -678,7 +933,9 @@ void BSockNetwork::on_ping(BSockReader* reader) {
 
 void BSockNetwork::on_sync_tick(BSockReader* reader) {
 	uint32_t tick = reader->integer();
-	engine_->tick_id(tick);
+	if (reader->ok()) {
+		engine_->tick_id(tick);
+	}
 
 }
 
@@ -688,16 +945,9 @@ void BSockNetwork::on_user_rpc(BSockReader* reader) {
 		return;
 	}
 
-	// Forward the RPC to other clients if we are in server
-	// mode and using the stream socket
-	if (ST_STREAM == reader->socket_type() && NS_HOST == state_) {
-		for (size_t i = 0; i < stream_.size(); i++) {
-			if (stream_[i]) {
-				// Copy the whole packet over to the outgoing socket
-				BSockWriterPtr writer = stream_[i]->writer();
-				writer->packet(reader);
-			}
-		}
+	// Forward the RPC to the other clients if we are in server mode
+	if (NS_HOST == state_) {
+		rpc_forward(reader);
 	}
 
 	// Only read the packet if the local player didn't send it
@@ -705,8 +955,11 @@ void BSockNetwork::on_user_rpc(BSockReader* reader) {
 		// Prepare a vector to hold the incoming arguments
 		vector<boost::any> args;
 		string name = reader->string();
-		args.resize(reader->integer());
-
+		size_t count = reader->integer();
+		if (count > reader->remaining()) {
+			return;
+		}
+		args.resize(count);
 		
 		// Read all of the marshalled arguments into the list of values
 		for (size_t i = 0; i < args.size(); i++) {
@@ -726,8 +979,11 @@ void BSockNetwork::on_user_rpc(BSockReader* reader) {
 			}
 		}
 
-		// Invoke the RPC on the local machine
-		engine_->module()->on_rpc(name, args);
+		// Invoke the RPC on the local machine, unless the packet was cut 
+		// short
+		if (reader->ok()) {
+			engine_->module()->on_rpc(name, args);
+		}
 	}
 }
 
@@ -736,6 +992,7 @@ void BSockNetwork::update_stats() {
 	if (stats_elapsed_time_ > 0.5f) {
 		engine_->option("stat_rx_rate", (float)rx_bytes_/stats_elapsed_time_*8.0f/1000.0f);
 		engine_->option("stat_tx_rate", (float)tx_bytes_/stats_elapsed_time_*8.0f/1000.0f);
+		engine_->option("stat_packet_buffers", (float)packet_pool_.allocated());
 		rx_bytes_ = 0;
 		tx_bytes_ = 0;
 		stats_elapsed_time_ = 0.0f;
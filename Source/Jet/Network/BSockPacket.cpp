@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Network/BSockPacket.hpp>
+
+using namespace Jet;
+using namespace std;
+
+BSockPacketPool::BSockPacketPool() :
+    allocated_(0) {
+
+}
+
+BSockPacketPool::~BSockPacketPool() {
+    while (BSockPacket* packet = free_.pop()) {
+        delete packet;
+    }
+}
+
+BSockPacket* BSockPacketPool::acquire() {
+    BSockPacket* packet = free_.pop();
+    if (!packet) {
+        packet = new BSockPacket;
+        allocated_++;
+    }
+    packet->next = 0;
+    packet->size = 0;
+    packet->offset = 0;
+    packet->channel = CT_UNRELIABLE;
+    return packet;
+}
+
+void BSockPacketPool::release(BSockPacket* packet) {
+    if (packet) {
+        free_.push(packet);
+    }
+}
+
+void BSockPacketPool::release(BSockPacketQueue& queue) {
+    while (BSockPacket* packet = queue.pop()) {
+        free_.push(packet);
+    }
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Network/BSockReactor.hpp>
+#include <Jet/Network/BSockSocket.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace Jet;
+using namespace std;
+
+BSockReactor::BSockReactor() {
+#ifdef JET_EPOLL
+    epoll_ = epoll_create(64);
+    if (epoll_ < 0) {
+        throw runtime_error(socket_errmsg());
+    }
+    event_.resize(64);
+#endif
+}
+
+BSockReactor::~BSockReactor() {
+#ifdef JET_EPOLL
+    close(epoll_);
+#endif
+}
+
+void BSockReactor::add(BSockSocket* socket) {
+    socket->write_interest_ = write_interest(socket);
+#ifdef JET_EPOLL
+    epoll_event event;
+    event.events = EPOLLIN | (socket->write_interest_ ? EPOLLOUT : 0);
+    event.data.ptr = socket;
+    if (epoll_ctl(epoll_, EPOLL_CTL_ADD, socket->socket_, &event) < 0) {
+        throw runtime_error(socket_errmsg());
+    }
+#else
+    socket_.push_back(socket);
+#endif
+}
+
+void BSockReactor::remove(BSockSocket* socket) {
+#ifdef JET_EPOLL
+    // Older kernels require a non-null event, even though it's ignored
+    epoll_event event;
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, socket->socket_, &event);
+#else
+    socket_.erase(std::remove(socket_.begin(), socket_.end(), socket), socket_.end());
+#endif
+
+    // The socket may be destroyed while the network is handling the ready
+    // list, so make sure the network doesn't see it again
+    replace(ready_.begin(), ready_.end(), socket, (BSockSocket*)0);
+}
+
+void BSockReactor::update(BSockSocket* socket) {
+    bool interest = write_interest(socket);
+    if (interest == socket->write_interest_) {
+        return;
+    }
+    socket->write_interest_ = interest;
+#ifdef JET_EPOLL
+    epoll_event event;
+    event.events = EPOLLIN | (interest ? EPOLLOUT : 0);
+    event.data.ptr = socket;
+    if (epoll_ctl(epoll_, EPOLL_CTL_MOD, socket->socket_, &event) < 0) {
+        throw runtime_error(socket_errmsg());
+    }
+#endif
+}
+
+size_t BSockReactor::poll() {
+    ready_.clear();
+
+#ifdef JET_EPOLL
+    int count = epoll_wait(epoll_, &event_[0], event_.size(), 0);
+    if (count < 0) {
+        if (EINTR == errno) {
+            return 0;
+        }
+        throw runtime_error(socket_errmsg());
+    }
+
+    // Errors and hangups are reported as both readable and writable, so 
+    // that the next read or write on the socket picks up the error
+    for (int i = 0; i < count; i++) {
+        BSockSocket* socket = static_cast<BSockSocket*>(event_[i].data.ptr);
+        uint32_t events = event_[i].events;
+        if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+            socket->readable_ = true;
+        }
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            socket->writable_ = true;
+        }
+        ready_.push_back(socket);
+    }
+
+    // If the event buffer filled up, the rest of the events are reported
+    // on the next poll, because epoll is level-triggered.  Grow the buffer
+    // so that doesn't keep happening.
+    if (count == (int)event_.size()) {
+        event_.resize(2 * event_.size());
+    }
+#else
+    fd_set read;
+    fd_set write;
+    FD_ZERO(&read);
+    FD_ZERO(&write);
+    int max_socket = 0;
+    for (size_t i = 0; i < socket_.size(); i++) {
+        FD_SET(socket_[i]->socket_, &read);
+        if (socket_[i]->write_interest_) {
+            FD_SET(socket_[i]->socket_, &write);
+        }
+        max_socket = std::max(max_socket, (int)socket_[i]->socket_);
+    }
+    timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+
+    if (socket_.empty() || select(max_socket + 1, &read, &write, 0, &tv) <= 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < socket_.size(); i++) {
+        BSockSocket* socket = socket_[i];
+        bool readable = FD_ISSET(socket->socket_, &read) != 0;
+        bool writable = FD_ISSET(socket->socket_, &write) != 0;
+        if (readable) {
+            socket->readable_ = true;
+        }
+        if (writable) {
+            socket->writable_ = true;
+        }
+        if (readable || writable) {
+            ready_.push_back(socket);
+        }
+    }
+#endif
+    return ready_.size();
+}
+
+bool BSockReactor::write_interest(BSockSocket* socket) const {
+    return !socket->out_.empty();
+}
@@ -18,29 +18,57 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.
- */
+ */  
 
 #include <Jet/Network/BSockReader.hpp>
 #include <Jet/Types/Quaternion.hpp>
+#include <cstring>
 
 using namespace Jet;
 using namespace std;
 
 BSockReader::BSockReader(BSockSocket* socket) :
     socket_(socket),
-    bytes_read_(sizeof(size_t)) {
+    packet_(socket->read_packet()),
+    bytes_read_(sizeof(size_t)),
+    bit_offset_(0),
+    underflow_(!packet_) {
 
-	// Swap our vector with the vector that was read from the socket
-	// so that the socket has an empty buffer to work with while we
-	// process this buffer
-	in_.reserve(2048);
-	in_.swap(socket_->in_);
+	// The socket gives up the packet, so that it can start reading the
+	// next one while we process this one.  A packet that is too short to
+	// hold its own header has nothing in it.
+	if (packet_ && packet_->size < bytes_read_) {
+		bytes_read_ = packet_->size;
+		underflow_ = true;
+	}
+}
+
+BSockReader::BSockReader(BSockConnection* connection) :
+    connection_(connection),
+    packet_(connection->read_packet()),
+    bytes_read_(sizeof(size_t)),
+    bit_offset_(0),
+    underflow_(!packet_) {
+
+}
+
+void BSockReader::rewind() {
+	bytes_read_ = sizeof(size_t);
+	bit_offset_ = 0;
+	underflow_ = !packet_;
+	if (packet_ && packet_->size < bytes_read_) {
+		bytes_read_ = packet_->size;
+		underflow_ = true;
+	}
 }
 
 BSockReader::~BSockReader() {
-    // Clear the buffer so that the next packet can be read.
-    socket_->in_.clear();
-	socket_->read_bytes_ = 0;
+    // Return the packet to the pool.
+    if (connection_) {
+        connection_->release(packet_);
+    } else {
+        socket_->release(packet_);
+    }
 }
 
 Vector BSockReader::vector() {
@@ -61,44 +89,115 @@ Quaternion BSockReader::quaternion() {
 }
 
 float BSockReader::real() {
-    if (in_.size() - bytes_read_ < sizeof(float)) {
-        throw std::runtime_error("No more data in packet");
+    float real = 0.0f;
+    if (const char* in = consume(sizeof(real))) {
+        memcpy(&real, in, sizeof(real));
     }
-    
-    float real = *(float*)&in_[bytes_read_];
-    bytes_read_ += sizeof(real);
-    
     return real;
 }
 
 int BSockReader::integer() {
-    if (in_.size() - bytes_read_ < sizeof(int)) {
-        throw std::runtime_error("No more data in packet");
+    int integer = 0;
+    if (const char* in = consume(sizeof(integer))) {
+        memcpy(&integer, in, sizeof(integer));
+        integer = ntohl(integer);
     }
-    
-    int integer = ntohl(*(int*)&in_[bytes_read_]);
-    bytes_read_ += sizeof(integer);
-    
     return integer;
 }
 
 uint8_t BSockReader::byte() {
-    if (in_.size() - bytes_read_ < sizeof(uint8_t)) {
-        throw std::runtime_error("No more data in packet");
-    }
-    
-    uint8_t byte = *(uint8_t*)&in_[bytes_read_];
-    bytes_read_ += sizeof(byte);
-    
-    return byte;
+    const char* in = consume(sizeof(uint8_t));
+    return in ? (uint8_t)*in : 0;
 } 
 
+uint32_t BSockReader::bits(size_t count) {
+	uint32_t value = 0;
+	size_t shift = 0;
+	while (count > 0) {
+		if (!bit_offset_ && !consume(1)) {
+			return 0;
+		}
+		size_t n = min(count, 8 - bit_offset_);
+		uint32_t chunk = ((uint8_t)packet_->data[bytes_read_ - 1] >> bit_offset_) & ((1 << n) - 1);
+		value |= chunk << shift;
+		shift += n;
+		count -= n;
+		bit_offset_ = (bit_offset_ + n) % 8;
+	}
+	return value;
+}
+
+uint32_t BSockReader::varint(size_t group) {
+	uint32_t mask = (1 << group) - 1;
+	uint32_t value = 0;
+	for (size_t shift = 0; shift < 32; shift += group) {
+		uint32_t chunk = bits(group + 1);
+		value |= (chunk & mask) << shift;
+		if (!(chunk >> group)) {
+			break;
+		}
+	}
+	return value;
+}
+
+int32_t BSockReader::ranged(int32_t min, int32_t max) {
+	uint32_t range = (uint32_t)max - (uint32_t)min;
+	size_t count = 0;
+	while (count < 32 && (range >> count)) {
+		count++;
+	}
+	int32_t value = (int32_t)((uint32_t)min + bits(count));
+	return std::max(std::min(value, max), min);
+}
+
+float BSockReader::quantized(float min, float max, size_t count) {
+	if (!count) {
+		return min;
+	}
+	count = std::min(count, (size_t)32);
+	double steps = (count >= 32) ? 4294967295.0 : (double)((1u << count) - 1);
+	return (float)(min + ((double)max - min) * (bits(count) / steps));
+}
+
+bool BSockReader::boolean() {
+	return bits(1) != 0;
+}
+
 std::string BSockReader::string() {
-    if (in_.size() - bytes_read_ == 0) {
-        throw std::runtime_error("No more data in packet");
+    // The string must be terminated inside the packet
+    const char* begin = packet_ ? packet_->data + bytes_read_ : 0;
+    const char* end = begin ? (const char*)memchr(begin, 0, remaining()) : 0;
+    if (!end) {
+        consume(remaining() + 1);
+        return std::string();
     }
-    
-    std::string string(&in_[bytes_read_], 0, in_.size() - bytes_read_);
-    bytes_read_ += string.length() + 1;
-    return string; 
-}
\ No newline at end of file
+    consume(end - begin + 1);
+    return std::string(begin, end);
+}
+
+const char* BSockReader::bytes(size_t length) {
+	return consume(length);
+}
+
+Address BSockReader::address() const {
+	if (connection_) {
+		return connection_->address();
+	} else if (packet_) {
+		return Address(ntohl(packet_->address.sin_addr.s_addr), ntohs(packet_->address.sin_port));
+	} else {
+		return Address();
+	}
+}
+
+const char* BSockReader::consume(size_t bytes) {
+	// Returns the next field, and moves on to a new byte for bit fields.
+	// Once a read fails, all reads after it fail too.
+	bit_offset_ = 0;
+	if (underflow_ || bytes > remaining()) {
+		underflow_ = true;
+		return 0;
+	}
+	const char* data = packet_->data + bytes_read_;
+	bytes_read_ += bytes;
+	return data;
+}
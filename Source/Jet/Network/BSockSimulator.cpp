@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Network/BSockSimulator.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace Jet;
+using namespace std;
+
+// Bytes of IP and UDP header counted against the bandwidth cap for each
+// datagram
+#define SIM_PACKET_OVERHEAD 28
+
+// Longest time that a packet can wait for the link when the bandwidth cap
+// is reached.  Packets that would wait longer are dropped, like a router
+// with a full queue would do.
+#define SIM_MAX_BACKLOG 0.5
+
+BSockSimulator::BSockSimulator(CoreEngine* engine, BSockPacketPool* pool) :
+    engine_(engine),
+    pool_(pool),
+    time_(0.0),
+    random_((uint32_t)engine->option<float>("network_sim_seed")),
+    latency_(0.0f),
+    jitter_(0.0f),
+    loss_(0.0f),
+    duplicate_(0.0f),
+    bandwidth_(0.0f),
+    enabled_(false) {
+
+    memset(&out_, 0, sizeof(out_));
+    memset(&in_, 0, sizeof(in_));
+    update(0.0f);
+}
+
+BSockSimulator::~BSockSimulator() {
+    while (BSockPacket* packet = out_.head) {
+        out_.head = packet->next;
+        pool_->release(packet);
+    }
+    while (BSockPacket* packet = in_.head) {
+        in_.head = packet->next;
+        pool_->release(packet);
+    }
+}
+
+void BSockSimulator::update(float delta) {
+    time_ += delta;
+
+    // Reload the options every frame, so that the conditions can be 
+    // changed while the game is running
+    latency_ = max(0.0f, engine_->option<float>("network_sim_latency"));
+    jitter_ = max(0.0f, engine_->option<float>("network_sim_jitter"));
+    loss_ = max(0.0f, engine_->option<float>("network_sim_loss"));
+    duplicate_ = max(0.0f, engine_->option<float>("network_sim_duplicate"));
+    bandwidth_ = max(0.0f, engine_->option<float>("network_sim_bandwidth"));
+    enabled_ = latency_ > 0.0f || jitter_ > 0.0f || loss_ > 0.0f || duplicate_ > 0.0f || bandwidth_ > 0.0f;
+}
+
+void BSockSimulator::send(BSockPacket* packet) {
+    transmit(out_, packet, packet->size);
+}
+
+void BSockSimulator::receive(BSockPacket* packet) {
+    transmit(in_, packet, packet->offset);
+}
+
+BSockPacket* BSockSimulator::sent() {
+    return release(out_);
+}
+
+BSockPacket* BSockSimulator::received() {
+    return release(in_);
+}
+
+void BSockSimulator::flush() {
+    if (out_.tail) {
+        time_ = max(time_, out_.tail->time);
+    }
+}
+
+void BSockSimulator::transmit(Link& link, BSockPacket* packet, size_t size) {
+    // Roll for loss, and then for a duplicate.  The duplicate is delayed
+    // separately, so it may arrive before the original.
+    if (random() < loss_) {
+        pool_->release(packet);
+        return;
+    }
+    if (random() < duplicate_) {
+        BSockPacket* copy = pool_->acquire();
+        copy->size = packet->size;
+        copy->offset = packet->offset;
+        copy->address = packet->address;
+        memcpy(copy->data, packet->data, max(packet->size, packet->offset));
+        delay(link, copy, size);
+    }
+    delay(link, packet, size);
+}
+
+void BSockSimulator::delay(Link& link, BSockPacket* packet, size_t size) {
+    // With a bandwidth cap, each packet has to wait until the packets in 
+    // front of it have gone out over the link.  The cap is in kbit/s.
+    double departure = time_;
+    if (bandwidth_ > 0.0f) {
+        departure = max(time_, link.free);
+        if (departure - time_ > SIM_MAX_BACKLOG) {
+            pool_->release(packet);
+            return;
+        }
+        link.free = departure + (size + SIM_PACKET_OVERHEAD) * 8.0 / (bandwidth_ * 1000.0);
+    }
+    packet->time = departure + latency_ + jitter_ * random();
+
+    // Insert the packet after every packet that is let go at the same 
+    // time or earlier, so that packets with the same delay stay in order.
+    // Without jitter, packets go on the end of the list.
+    packet->next = 0;
+    if (!link.head || link.tail->time <= packet->time) {
+        if (link.tail) {
+            link.tail->next = packet;
+        } else {
+            link.head = packet;
+        }
+        link.tail = packet;
+    } else if (packet->time < link.head->time) {
+        packet->next = link.head;
+        link.head = packet;
+    } else {
+        BSockPacket* prev = link.head;
+        while (prev->next->time <= packet->time) {
+            prev = prev->next;
+        }
+        packet->next = prev->next;
+        prev->next = packet;
+    }
+}
+
+BSockPacket* BSockSimulator::release(Link& link) {
+    BSockPacket* packet = link.head;
+    if (!packet || packet->time > time_) {
+        return 0;
+    }
+    link.head = packet->next;
+    if (!link.head) {
+        link.tail = 0;
+    }
+    packet->next = 0;
+    return packet;
+}
+
+float BSockSimulator::random() {
+    // Linear congruential generator; the high bits are the most random
+    random_ = random_ * 1664525u + 1013904223u;
+    return (random_ >> 8) / 16777216.0f;
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Network/BSockSnapshotCodec.hpp>
+#include <Jet/Network/BSockWriter.hpp>
+#include <Jet/Network/BSockReader.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace Jet;
+using namespace std;
+
+// Fields that are sent for a node when they differ from the baseline
+enum SnapshotField {
+    SF_STATE_HASH = 0x1,
+    SF_POSITION = 0x2,
+    SF_ROTATION = 0x4,
+    SF_LINEAR_VELOCITY = 0x8,
+    SF_ANGULAR_VELOCITY = 0x10
+};
+
+#define SNAPSHOT_FIELD_BITS 5
+#define SNAPSHOT_VARINT_BITS 4
+#define SNAPSHOT_AGE_BITS 5
+#define SNAPSHOT_MAX_QUANTIZED 1.0e9f
+
+// Quantizes a value to an integer multiple of the given precision.  Values
+// that are out of range are clamped.
+static int32_t quantize(float value, float precision) {
+    float q = floorf(value / precision + 0.5f);
+    return (int32_t)max(min(q, SNAPSHOT_MAX_QUANTIZED), -SNAPSHOT_MAX_QUANTIZED);
+}
+
+// Differences are taken modulo 2^32, so that they wrap the same way on 
+// every machine
+static uint32_t zigzag(int32_t a, int32_t b) {
+    int32_t delta = (int32_t)((uint32_t)a - (uint32_t)b);
+    return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+static int32_t unzigzag(int32_t b, uint32_t value) {
+    uint32_t delta = (value >> 1) ^ (~(value & 1) + 1);
+    return (int32_t)((uint32_t)b + delta);
+}
+
+BSockSnapshotCodec::BSockSnapshotCodec(CoreEngine* engine) :
+    engine_(engine),
+    position_precision_(0.01f),
+    velocity_precision_(0.01f),
+    rotation_bits_(10),
+    velocity_scale_(0),
+    sequence_(1) {
+
+    engine_->option("network_position_precision", position_precision_);
+    engine_->option("network_velocity_precision", velocity_precision_);
+    engine_->option("network_rotation_bits", (float)rotation_bits_);
+}
+
+void BSockSnapshotCodec::reset() {
+    sequence_ = 1;
+    current_ = BSockSnapshot();
+    for (size_t i = 0; i < JET_SNAPSHOT_HISTORY; i++) {
+        history_[i] = BSockSnapshot();
+    }
+    ack_ = BSockSnapshotAck();
+    peer_ack_.clear();
+}
+
+void BSockSnapshotCodec::clear() {
+    update_options();
+    current_.node.clear();
+}
+
+void BSockSnapshotCodec::node(uint32_t hash, uint32_t state_hash, const Vector& position, const Quaternion& rotation, const Vector& linear_velocity, const Vector& angular_velocity) {
+    current_.node.push_back(BSockNodeState());
+    BSockNodeState& state = current_.node.back();
+    state.hash = hash;
+    state.state_hash = state_hash;
+    state.position[0] = quantize(position.x, position_precision_);
+    state.position[1] = quantize(position.y, position_precision_);
+    state.position[2] = quantize(position.z, position_precision_);
+    state.rotation = pack_rotation(rotation);
+    state.linear_velocity[0] = quantize(linear_velocity.x, velocity_precision_);
+    state.linear_velocity[1] = quantize(linear_velocity.y, velocity_precision_);
+    state.linear_velocity[2] = quantize(linear_velocity.z, velocity_precision_);
+    state.angular_velocity[0] = quantize(angular_velocity.x, velocity_precision_);
+    state.angular_velocity[1] = quantize(angular_velocity.y, velocity_precision_);
+    state.angular_velocity[2] = quantize(angular_velocity.z, velocity_precision_);
+}
+
+void BSockSnapshotCodec::write(BSockWriter* writer, uint32_t tick, const vector<uint32_t>& peer) {
+    current_.sequence = sequence_++;
+    current_.tick = tick;
+    const BSockSnapshot* base = baseline(peer);
+    uint32_t ticks = base ? tick - base->tick : 0;
+
+    writer->integer(current_.sequence);
+    writer->bits(base ? current_.sequence - base->sequence : 0, SNAPSHOT_AGE_BITS);
+    writer->varint(current_.node.size(), SNAPSHOT_VARINT_BITS);
+
+    // Nodes that are new since the baseline are sent with their full hash,
+    // and are delta-compressed against a node at rest at the origin.  All
+    // other nodes are identified by their position in the baseline.
+    BSockNodeState zero = BSockNodeState();
+    zero.rotation = pack_rotation(Quaternion());
+    size_t cursor = 0;
+    for (size_t i = 0; i < current_.node.size(); i++) {
+        const BSockNodeState& state = current_.node[i];
+        size_t skip = 0;
+        while (base && cursor + skip < base->node.size() && base->node[cursor + skip].hash < state.hash) {
+            skip++;
+        }
+        if (base && cursor + skip < base->node.size() && base->node[cursor + skip].hash == state.hash) {
+            writer->bits(1, 1);
+            writer->varint(skip, SNAPSHOT_VARINT_BITS);
+            write_node(writer, base->node[cursor + skip], state, ticks);
+            cursor += skip + 1;
+        } else {
+            writer->bits(0, 1);
+            writer->bits(state.hash, 32);
+            zero.hash = state.hash;
+            write_node(writer, zero, state, 0);
+        }
+    }
+
+    // A snapshot that didn't fit in the packet is never sent, so it can't
+    // be a baseline
+    if (writer->ok()) {
+        history_[current_.sequence % JET_SNAPSHOT_HISTORY] = current_;
+    }
+}
+
+bool BSockSnapshotCodec::read(BSockReader* reader, uint32_t tick) {
+    update_options();
+    current_.sequence = reader->integer();
+    current_.tick = tick;
+    current_.node.clear();
+
+    // Find the baseline.  If it was lost, or is too old, then the snapshot
+    // can't be decoded.
+    uint32_t age = reader->bits(SNAPSHOT_AGE_BITS);
+    const BSockSnapshot* base = 0;
+    if (age) {
+        base = &history_[(current_.sequence - age) % JET_SNAPSHOT_HISTORY];
+        if (base->sequence != current_.sequence - age) {
+            return false;
+        }
+    }
+    uint32_t ticks = base ? tick - base->tick : 0;
+
+    BSockNodeState zero = BSockNodeState();
+    zero.rotation = pack_rotation(Quaternion());
+    size_t cursor = 0;
+    size_t count = reader->varint(SNAPSHOT_VARINT_BITS);
+    for (size_t i = 0; i < count && reader->ok(); i++) {
+        current_.node.push_back(BSockNodeState());
+        BSockNodeState& state = current_.node.back();
+        if (reader->bits(1)) {
+            cursor += reader->varint(SNAPSHOT_VARINT_BITS);
+            if (!base || cursor >= base->node.size()) {
+                return false;
+            }
+            read_node(reader, base->node[cursor], state, ticks);
+            cursor++;
+        } else {
+            zero.hash = reader->bits(32);
+            read_node(reader, zero, state, 0);
+        }
+    }
+
+    if (!reader->ok()) {
+        return false;
+    }
+    history_[current_.sequence % JET_SNAPSHOT_HISTORY] = current_;
+
+    // Update the acknowledgement that is sent back to the host
+    if (!ack_.sequence) {
+        ack_.sequence = current_.sequence;
+        ack_.mask = 0;
+    } else if (current_.sequence > ack_.sequence) {
+        uint32_t shift = current_.sequence - ack_.sequence;
+        ack_.mask = (shift < 32) ? (ack_.mask << shift) : 0;
+        ack_.mask |= (shift <= 32) ? (1u << (shift - 1)) : 0;
+        ack_.sequence = current_.sequence;
+    } else if (current_.sequence < ack_.sequence) {
+        uint32_t shift = ack_.sequence - current_.sequence;
+        ack_.mask |= (shift <= 32) ? (1u << (shift - 1)) : 0;
+    }
+    return true;
+}
+
+void BSockSnapshotCodec::ack(uint32_t peer, const BSockSnapshotAck& ack) {
+    // Acknowledgements can arrive out of order, so only keep the newest
+    BSockSnapshotAck& current = peer_ack_[peer];
+    if (ack.sequence >= current.sequence) {
+        current = ack;
+    }
+}
+
+void BSockSnapshotCodec::write_node(BSockWriter* writer, const BSockNodeState& base, const BSockNodeState& state, uint32_t ticks) {
+    int32_t predicted[3];
+    uint32_t field = 0;
+    if (state.state_hash != base.state_hash) {
+        field |= SF_STATE_HASH;
+    }
+    if (state.rotation != base.rotation) {
+        field |= SF_ROTATION;
+    }
+    for (size_t k = 0; k < 3; k++) {
+        predicted[k] = predict(base.position[k], base.linear_velocity[k], ticks);
+        if (state.position[k] != predicted[k]) {
+            field |= SF_POSITION;
+        }
+        if (state.linear_velocity[k] != base.linear_velocity[k]) {
+            field |= SF_LINEAR_VELOCITY;
+        }
+        if (state.angular_velocity[k] != base.angular_velocity[k]) {
+            field |= SF_ANGULAR_VELOCITY;
+        }
+    }
+
+    writer->bits(field, SNAPSHOT_FIELD_BITS);
+    if (field & SF_STATE_HASH) {
+        writer->bits(state.state_hash, 32);
+    }
+    if (field & SF_POSITION) {
+        for (size_t k = 0; k < 3; k++) {
+            writer->varint(zigzag(state.position[k], predicted[k]), SNAPSHOT_VARINT_BITS);
+        }
+    }
+    if (field & SF_ROTATION) {
+        writer->bits(state.rotation, 2 + 3*rotation_bits_);
+    }
+    if (field & SF_LINEAR_VELOCITY) {
+        for (size_t k = 0; k < 3; k++) {
+            writer->varint(zigzag(state.linear_velocity[k], base.linear_velocity[k]), SNAPSHOT_VARINT_BITS);
+        }
+    }
+    if (field & SF_ANGULAR_VELOCITY) {
+        for (size_t k = 0; k < 3; k++) {
+            writer->varint(zigzag(state.angular_velocity[k], base.angular_velocity[k]), SNAPSHOT_VARINT_BITS);
+        }
+    }
+}
+
+void BSockSnapshotCodec::read_node(BSockReader* reader, const BSockNodeState& base, BSockNodeState& state, uint32_t ticks) {
+    // Fields that weren't sent keep the baseline value, except for the
+    // position, which keeps the predicted value
+    state = base;
+    for (size_t k = 0; k < 3; k++) {
+        state.position[k] = predict(base.position[k], base.linear_velocity[k], ticks);
+    }
+
+    uint32_t field = reader->bits(SNAPSHOT_FIELD_BITS);
+    if (field & SF_STATE_HASH) {
+        state.state_hash = reader->bits(32);
+    }
+    if (field & SF_POSITION) {
+        for (size_t k = 0; k < 3; k++) {
+            state.position[k] = unzigzag(state.position[k], reader->varint(SNAPSHOT_VARINT_BITS));
+        }
+    }
+    if (field & SF_ROTATION) {
+        state.rotation = reader->bits(2 + 3*rotation_bits_);
+    }
+    if (field & SF_LINEAR_VELOCITY) {
+        for (size_t k = 0; k < 3; k++) {
+            state.linear_velocity[k] = unzigzag(base.linear_velocity[k], reader->varint(SNAPSHOT_VARINT_BITS));
+        }
+    }
+    if (field & SF_ANGULAR_VELOCITY) {
+        for (size_t k = 0; k < 3; k++) {
+            state.angular_velocity[k] = unzigzag(base.angular_velocity[k], reader->varint(SNAPSHOT_VARINT_BITS));
+        }
+    }
+}
+
+const BSockSnapshot* BSockSnapshotCodec::baseline(const vector<uint32_t>& peer) const {
+    // Find the newest snapshot in the history that every peer has.  With 
+    // no peers, there's nobody to decode the delta, so send everything.
+    if (peer.empty()) {
+        return 0;
+    }
+    for (uint32_t age = 1; age < JET_SNAPSHOT_HISTORY && age < current_.sequence; age++) {
+        const BSockSnapshot& base = history_[(current_.sequence - age) % JET_SNAPSHOT_HISTORY];
+        if (base.sequence != current_.sequence - age) {
+            continue;
+        }
+        bool received = true;
+        for (size_t i = 0; i < peer.size() && received; i++) {
+            map<uint32_t, BSockSnapshotAck>::const_iterator j = peer_ack_.find(peer[i]);
+            received = (j != peer_ack_.end()) && acked(j->second, base.sequence);
+        }
+        if (received) {
+            return &base;
+        }
+    }
+    return 0;
+}
+
+int32_t BSockSnapshotCodec::predict(int32_t position, int32_t velocity, uint32_t ticks) const {
+    // Integer math, so that every machine predicts the same position.  The
+    // velocity scale is the number of position steps that one velocity 
+    // step moves in one tick, in 16.16 fixed point.
+    int64_t offset = (int64_t)velocity * (int64_t)ticks * velocity_scale_ / 65536;
+    return (int32_t)((uint32_t)position + (uint32_t)offset);
+}
+
+uint32_t BSockSnapshotCodec::pack_rotation(const Quaternion& rotation) const {
+    // Smallest-three encoding: leave out the largest component, and send
+    // its index instead.  The other three components are at most 1/sqrt(2)
+    // in magnitude, and the missing one is recovered from the fact that the
+    // quaternion has unit length.  Flipping the sign of the quaternion 
+    // gives the same rotation, so the largest component is always positive.
+    Quaternion q = rotation.unit();
+    float c[4] = { q.w, q.x, q.y, q.z };
+    size_t largest = 0;
+    for (size_t i = 1; i < 4; i++) {
+        if (fabsf(c[i]) > fabsf(c[largest])) {
+            largest = i;
+        }
+    }
+    float sign = (c[largest] < 0.0f) ? -1.0f : 1.0f;
+    float steps = (float)((1 << rotation_bits_) - 1);
+    uint32_t packed = largest;
+    for (size_t i = 0; i < 4; i++) {
+        if (i != largest) {
+            float value = (c[i] * sign * sqrtf(2.0f) + 1.0f) * 0.5f;
+            value = max(min(value, 1.0f), 0.0f);
+            packed = (packed << rotation_bits_) | (uint32_t)floorf(value * steps + 0.5f);
+        }
+    }
+    return packed;
+}
+
+Quaternion BSockSnapshotCodec::unpack_rotation(uint32_t rotation) const {
+    float steps = (float)((1 << rotation_bits_) - 1);
+    uint32_t mask = (1 << rotation_bits_) - 1;
+    size_t largest = (rotation >> (3*rotation_bits_)) & 0x3;
+    float c[4];
+    float sum = 0.0f;
+    for (size_t i = 4; i-- > 0;) {
+        if (i != largest) {
+            c[i] = ((rotation & mask) / steps * 2.0f - 1.0f) / sqrtf(2.0f);
+            sum += c[i] * c[i];
+            rotation >>= rotation_bits_;
+        }
+    }
+    c[largest] = sqrtf(max(1.0f - sum, 0.0f));
+    return Quaternion(c[0], c[1], c[2], c[3]).unit();
+}
+
+Vector BSockSnapshotCodec::position(const BSockNodeState& state) const {
+    return Vector(state.position[0], state.position[1], state.position[2]) * position_precision_;
+}
+
+Quaternion BSockSnapshotCodec::rotation(const BSockNodeState& state) const {
+    return unpack_rotation(state.rotation);
+}
+
+Vector BSockSnapshotCodec::linear_velocity(const BSockNodeState& state) const {
+    return Vector(state.linear_velocity[0], state.linear_velocity[1], state.linear_velocity[2]) * velocity_precision_;
+}
+
+Vector BSockSnapshotCodec::angular_velocity(const BSockNodeState& state) const {
+    return Vector(state.angular_velocity[0], state.angular_velocity[1], state.angular_velocity[2]) * velocity_precision_;
+}
+
+void BSockSnapshotCodec::update_options() {
+    position_precision_ = max(engine_->option<float>("network_position_precision"), 1.0e-6f);
+    velocity_precision_ = max(engine_->option<float>("network_velocity_precision"), 1.0e-6f);
+    rotation_bits_ = min(max((size_t)engine_->option<float>("network_rotation_bits"), (size_t)4), (size_t)10);
+    velocity_scale_ = (int64_t)floor(velocity_precision_ * engine_->timestep() / position_precision_ * 65536.0 + 0.5);
+}
+
+bool BSockSnapshotCodec::acked(const BSockSnapshotAck& ack, uint32_t sequence) {
+    if (sequence == ack.sequence) {
+        return true;
+    } else if (sequence > ack.sequence || ack.sequence - sequence > 32) {
+        return false;
+    } else {
+        return (ack.mask >> (ack.sequence - sequence - 1)) & 1;
+    }
+}
@@ -21,44 +21,21 @@
  */
 
 #include <Jet/Network/BSockSocket.hpp>
-#include <Jet/Network/BSockWriter.hpp>
-#include <Jet/Network/BSockReader.hpp>
 #include <Jet/Network/BSockNetwork.hpp>
 #include <stdexcept>
 #include <cstring>
 #include <iostream>
+#include <algorithm>
 
 using namespace Jet;
 using namespace std;
 
-BSockSocket* BSockSocket::server(CoreEngine* engine, const Address& address) {
-    sockaddr_in local;
-    local.sin_family = AF_INET;
-    local.sin_addr.s_addr = htonl(INADDR_ANY); // Choose any address
-    local.sin_port = htons(address.port); // Choose any port for TCP
-
-    sockaddr_in remote;
-    remote.sin_family = AF_INET;
-    remote.sin_addr.s_addr = htonl(INADDR_ANY);
-    remote.sin_port = 0;
-    
-    return new BSockSocket(engine, local, remote, ST_SERVER);
-}
-
-BSockSocket* BSockSocket::client(CoreEngine* engine, const Address& address) {
-    sockaddr_in local;
-    local.sin_family = AF_INET;
-    local.sin_addr.s_addr = htonl(INADDR_ANY); // Choose any address
-    local.sin_port = 0; // Choose any port for TCP
-
-    sockaddr_in remote;
-    remote.sin_family = AF_INET;
-    remote.sin_addr.s_addr = htonl(address.address);
-    remote.sin_port = htons(address.port);
-    
-    return new BSockSocket(engine, local, remote, ST_CLIENT);
-
-}
+// Send and receive batches of datagrams with one system call where the
+// platform supports it.  Define JET_NO_MMSG, or set network_batch_size to
+// 1, to use one call per datagram.
+#if defined(__linux__) && !defined(JET_NO_MMSG)
+#define JET_MMSG
+#endif
 
 BSockSocket* BSockSocket::multicast(CoreEngine* engine, const Address& address) {
     sockaddr_in local;
@@ -75,7 +52,7 @@ BSockSocket* BSockSocket::multicast(CoreEngine* engine, const Address& address)
 
 }
 
-BSockSocket* BSockSocket::datagram(CoreEngine* engine, const Address& address) {
+BSockSocket* BSockSocket::datagram(CoreEngine* engine, const Address& address, const Address& remote_address) {
     sockaddr_in local;
     local.sin_family = AF_INET;
     local.sin_addr.s_addr = htonl(INADDR_ANY); // Choose any address
@@ -83,27 +60,29 @@ BSockSocket* BSockSocket::datagram(CoreEngine* engine, const Address& address) {
 
     sockaddr_in remote;
     remote.sin_family = AF_INET;
-    remote.sin_addr.s_addr = 0;
-    remote.sin_port = 0;
+    remote.sin_addr.s_addr = htonl(remote_address.address);
+    remote.sin_port = htons(remote_address.port);
     
     return new BSockSocket(engine, local, remote, ST_DATAGRAM);
 }
 
-BSockSocket::BSockSocket(CoreEngine* engine, const sockaddr_in& local, const sockaddr_in& remote, SocketType type, int socket) :
+BSockSocket::BSockSocket(CoreEngine* engine, const sockaddr_in& local, const sockaddr_in& remote, SocketType type) :
     engine_(engine),
-	socket_(socket),
+    pool_(&static_cast<BSockNetwork*>(engine->network())->packet_pool_),
+    reactor_(&static_cast<BSockNetwork*>(engine->network())->reactor_),
+    simulator_(engine, pool_),
+	socket_(INVALID_SOCKET),
     local_(local),
     remote_(remote),
 	type_(type),
-    write_bytes_(0),
-    read_bytes_(0) {
+    batch_((size_t)max(1.0f, min((float)JET_DATAGRAM_BATCH, engine->option<float>("network_batch_size")))),
+    readable_(true),
+    writable_(true),
+    write_interest_(false) {
         
     switch (type_) {
         case ST_DATAGRAM: init_datagram(); break;
         case ST_MULTICAST: init_multicast(); break;
-        case ST_SERVER: init_server(); break;
-        case ST_CLIENT: init_client(); break;
-        default: return;
     }
     
 #ifdef WINDOWS
@@ -131,10 +110,24 @@ BSockSocket::BSockSocket(CoreEngine* engine, const sockaddr_in& local, const soc
 		address_.address = ntohl(local_.sin_addr.s_addr);
 	}
     address_.port = ntohs(local_.sin_port);
+
+    // Wait for events on the socket
+    reactor_->add(this);
 }
 
 BSockSocket::~BSockSocket() {	
+    // Send any datagrams that are still waiting for the end of the frame,
+    // or that the simulator is holding back
+    try {
+        simulator_.flush();
+        poll_write();
+    } catch (std::exception&) {
+    }
+    pool_->release(received_);
+    pool_->release(out_);
+
     if (socket_ != INVALID_SOCKET) {
+        reactor_->remove(this);
 #ifdef WINDOWS
 		shutdown(socket_, SD_BOTH);
 #endif
@@ -142,49 +135,6 @@ BSockSocket::~BSockSocket() {
     }
 }
 
-void BSockSocket::init_server() {
-    // Create a new TCP socket.  If the attempt fails, throw an exception.
-    socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (INVALID_SOCKET == socket_) {
-        throw runtime_error(socket_errmsg());
-    }
-    
-    // Attempt to bind the socket to any port.  If the attempt fails,
-    // clean close the socket and throw an exception.
-    if(::bind(socket_, (sockaddr*)&local_, sizeof(local_)) < 0) {
-        throw runtime_error(socket_errmsg());
-    }
-
-	// Listen for connections
-	if (::listen(socket_, 1) < 0) {
-		throw runtime_error(socket_errmsg());
-	}
-}
-
-void BSockSocket::init_client() {    
-    // Create a new TCP socket.  If the attempt fails, throw an exception.
-    socket_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (INVALID_SOCKET == socket_) {
-        throw runtime_error(socket_errmsg());
-    }
-    
-    // Attempt to bind the socket to any port.  If the attempt fails,
-    // clean close the socket and throw an exception.
-    if(::bind(socket_, (sockaddr*)&local_, sizeof(local_)) < 0) {
-        throw runtime_error(socket_errmsg());
-    }
-
-	// Attempt to bind the socket to the given port.  This is non-blocking,
-    // so the socket will return EWOULDBLOCK.  If an error would have happened
-    // for a blocking connect, then we will catch that error on the first read
-    // or write.
-    if (::connect(socket_, (sockaddr*)&remote_, sizeof(remote_)) < 0) {
-        if (EWOULDBLOCK != socket_errcode()) {
-            throw runtime_error(socket_errmsg());
-        }
-    }
-}
-
 void BSockSocket::init_multicast() {    
     ip_mreq mreq;
     mreq.imr_multiaddr.s_addr = remote_.sin_addr.s_addr;
@@ -253,44 +203,29 @@ void BSockSocket::init_datagram() {
 }
 
 void BSockSocket::poll_read() {
-    
-    // Attempt to accept the incoming connection
-    if (ST_SERVER == type_) {
-        accept();
-    } else if (ST_CLIENT == type_) {
-        connect();
+    // Read more packets once the received packets have been handled, but
+    // don't read until the reactor reports data on the socket
+    if (readable_ && received_.empty()) {
+        read_datagram();
     }
-    
-    // If the input buffer is empty or a read is in progress, then continue
-    // reading the packet if data is available.
-    if (in_.empty() || in_.size() != read_bytes_) {
-        if (ST_MULTICAST == type_ || ST_DATAGRAM == type_) {
-            read_datagram();
-        } else if (ST_STREAM == type_) {
-            read_stream();
-        }
+
+    // Hand over the datagrams that the simulator is done delaying
+    while (BSockPacket* packet = simulator_.received()) {
+        received_.push(packet);
     }
 }
 
 void BSockSocket::poll_write() {
-    // Attempt to accept the incoming connection
-    if (ST_SERVER == type_) {
-        accept();
-    } else if (ST_CLIENT == type_) {
-        connect();
+    // Queue the datagrams that the simulator is done delaying
+    while (BSockPacket* packet = simulator_.sent()) {
+        out_.push(packet);
     }
     
-    // Get the current queue length
-    size_t queue_length = out_.size();
-    
     // If the output buffer is not empty, then continue writing the packet
     // if writing is permissible.
-    while (!out_.empty()) {
-        if (ST_MULTICAST == type_ || ST_DATAGRAM == type_) {
-            write_datagram();
-        } else if (ST_STREAM == type_) {
-            write_stream();
-        }
+    while (!out_.empty() && writable_) {
+        size_t queue_length = out_.size();
+        write_datagram();
         
         // Failed to send a packet, so we will break and wait for the next
         // poll to happen
@@ -298,214 +233,218 @@ void BSockSocket::poll_write() {
             break;
         }
     } 
-}
 
-void BSockSocket::accept() {
-    // Attempt to accept a socket
-
-    socklen_t socklen = sizeof(remote_);
-	int sd = ::accept(socket_, (sockaddr*)&remote_, &socklen);
-	if (INVALID_SOCKET == sd) {
-		if (EWOULDBLOCK == socket_errcode()) {
-			return;
-		} else {
-			throw runtime_error(socket_errmsg());
-		}
-    }
-    
-    // Shut down the server socket, and start using the connection socket.
-    shutdown(socket_, SD_BOTH);
-    closesocket(socket_);
-    socket_ = sd;
-    type_ = ST_STREAM;
+    // Wait for write events only while there is data left to send
+    reactor_->update(this);
 }
 
-void BSockSocket::connect() {
-
-	fd_set write;
-	FD_ZERO(&write);
-	FD_SET(socket_, &write);
-	timeval tv;
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-
-	if (select(socket_ + 1, 0, &write, 0, &tv)) {
-		if (FD_ISSET(socket_, &write)) {
-			type_ = ST_STREAM;
-		}
-	}
+void BSockSocket::update(float delta) {
+    simulator_.update(delta);
 }
 
 void BSockSocket::write_datagram() {
-    int socklen = sizeof(remote_);
-    vector<char>& out = out_.front();
-    
-    // Write the length of the packet into the header.  This includes the
-    // length of the header itself.
-    *(size_t*)&out[0] = htonl(out.size());
-    
-    // Get the packet pointer and length
-    char* pkt = &out[0];
-    size_t len = out.size();
+    BSockNetwork* network = static_cast<BSockNetwork*>(engine_->network());
+    BSockPacket* out = out_.front();
+    int rt = 0;
+
+#ifdef JET_MMSG
+    // Send as many of the queued packets as possible with one call.  A 
+    // batch size of 1 uses sendto() below, one call per datagram.
+    mmsghdr msg[JET_DATAGRAM_BATCH];
+    iovec iov[JET_DATAGRAM_BATCH];
+    size_t count = 0;
+    if (batch_ > 1) {
+        for (BSockPacket* packet = out; packet && count < batch_; packet = packet->next) {
+            iov[count].iov_base = packet->data;
+            iov[count].iov_len = packet->size;
+            memset(&msg[count], 0, sizeof(msg[count]));
+            msg[count].msg_hdr.msg_name = &packet->address;
+            msg[count].msg_hdr.msg_namelen = sizeof(packet->address);
+            msg[count].msg_hdr.msg_iov = &iov[count];
+            msg[count].msg_hdr.msg_iovlen = 1;
+            count++;
+        }
+        rt = sendmmsg(socket_, msg, count, 0);
+    } else
+#endif
+    {
+        int socklen = sizeof(out->address);
         
-    // Write to the socket
-    int rt = sendto(socket_, pkt, len, 0, (sockaddr*)&remote_, socklen);
+        // Get the packet pointer and length
+        char* pkt = out->data;
+        size_t len = out->size;
+        
+        // Write to the socket
+        rt = sendto(socket_, pkt, len, 0, (sockaddr*)&out->address, socklen);
+    }
         
     // If an error occurred, or the socket is already closed, then throw
     // an exception
 	if (rt < 0) {
 		if (EWOULDBLOCK == socket_errcode()) {
+			writable_ = false;
 			return;
 		} else {
 			throw runtime_error(socket_errmsg());
 		}
-    } else if (rt != (int)len) {
+    }
+
+#ifdef JET_MMSG
+    // Remove the packets we just sent from the queue
+    if (count) {
+        for (int i = 0; i < rt; i++) {
+            if (msg[i].msg_len != iov[i].iov_len) {
+                throw runtime_error("Failed to send datagram");
+            }
+            network->tx_bytes_ += msg[i].msg_len;
+            pool_->release(out_.pop());
+        }
+        return;
+    }
+#endif
+    if (rt != (int)out->size) {
         throw runtime_error("Failed to send datagram");
 	}
-
-	BSockNetwork* network = static_cast<BSockNetwork*>(engine_->network());
 	network->tx_bytes_ += rt;
 
     // Remove the packet we just sent from the queue
-    out_.pop();
+    pool_->release(out_.pop());
 }
 
 void BSockSocket::read_datagram() {
-	sockaddr_in address;
-    socklen_t socklen = sizeof(address);
-
-    // Assume the packet will be 4096 bytes, max.
-    in_.resize(4096);
-    
-    // Get the packet pointer and length
-    char* pkt = &in_[0];
-    size_t len = in_.size();
-        
-    // Read from the socket, and capture the source addres.
-    int rt = recvfrom(socket_, pkt, len, 0, (sockaddr*)&address, &socklen);
+    BSockNetwork* network = static_cast<BSockNetwork*>(engine_->network());
+
+    // Read up to a batch of datagrams.  Datagrams are read whole, so each
+    // packet can be JET_MAX_PACKET_SIZE bytes, max.
+    BSockPacket* in[JET_DATAGRAM_BATCH];
+    size_t count = 0;
+    int rt = 0;
+#ifdef JET_MMSG
+    // A batch size of 1 uses recvfrom() below, one call per datagram
+    if (batch_ > 1) {
+        mmsghdr msg[JET_DATAGRAM_BATCH];
+        iovec iov[JET_DATAGRAM_BATCH];
+        for (size_t i = 0; i < batch_; i++) {
+            in[i] = pool_->acquire();
+            iov[i].iov_base = in[i]->data;
+            iov[i].iov_len = JET_MAX_PACKET_SIZE;
+            memset(&msg[i], 0, sizeof(msg[i]));
+            msg[i].msg_hdr.msg_name = &in[i]->address;
+            msg[i].msg_hdr.msg_namelen = sizeof(in[i]->address);
+            msg[i].msg_hdr.msg_iov = &iov[i];
+            msg[i].msg_hdr.msg_iovlen = 1;
+        }
+        rt = recvmmsg(socket_, msg, batch_, 0, 0);
+        if (rt > 0) {
+            count = rt;
+            for (size_t i = 0; i < count; i++) {
+                in[i]->offset = msg[i].msg_len;
+            }
+        }
+        for (size_t i = count; i < batch_; i++) {
+            pool_->release(in[i]);
+        }
+    } else
+#endif
+    {
+        while (count < batch_) {
+            in[count] = pool_->acquire();
+            socklen_t socklen = sizeof(in[count]->address);
+
+            // Read from the socket, and capture the source addres.
+            rt = recvfrom(socket_, in[count]->data, JET_MAX_PACKET_SIZE, 0, (sockaddr*)&in[count]->address, &socklen);
+            if (rt < 0) {
+                pool_->release(in[count]);
+                break;
+            }
+            in[count]->offset = rt;
+            count++;
+        }
+    }
 
     // If an error occurred, or the socket is already closed, then throw an
     // exception.
-	if (rt < 0) {
-		if (EWOULDBLOCK == socket_errcode()) {
-			return;
-		} else {
-			throw runtime_error(socket_errmsg());
-		}
-    } else if (rt < (int)sizeof(size_t)) {
-        throw runtime_error("Invalid packet");
-	} else {
-		read_bytes_ += rt;
+	if (rt < 0 && EWOULDBLOCK != socket_errcode()) {
+        for (size_t i = 0; i < count; i++) {
+            pool_->release(in[i]);
+        }
+        throw runtime_error(socket_errmsg());
 	}
 
-	BSockNetwork* network = static_cast<BSockNetwork*>(engine_->network());
-	network->rx_bytes_ += rt;
-    
-    // Read the length of the packet from the beginning of the packet, as
-    // long as there are at least 4 bytes in the packet (size of an int).
-    in_.resize(ntohl(*(size_t*)&in_[0]));
-}
-
-void BSockSocket::write_stream() {
-    vector<char>& out = out_.front();
-        
-    // Write the length of the packet into the header.  This includes the
-    // length of the header itself.
-    if (!write_bytes_) {
-        *(size_t*)&out[0] = htonl(out.size());
-    }
-    
-    // Attempt to send any bytes remaining in the buffer.
-    char* pkt = &out[write_bytes_];
-    size_t len = out.size() - write_bytes_;
-    
-    // Write to the socket
-    int rt = send(socket_, pkt, len, 0);
-    
-    // If an error occurred, or the socket is already closed, then throw
-    // an exception
-	if (rt < 0) {
-		if (EWOULDBLOCK == socket_errcode()) {
-			return;
-		} else {
-			throw runtime_error(socket_errmsg());
-		}
-    } else {
-        write_bytes_ += rt;
+    // A short batch means that the socket has been drained
+    if (count < batch_) {
+        readable_ = false;
     }
 
-	BSockNetwork* network = static_cast<BSockNetwork*>(engine_->network());
-	network->tx_bytes_ += rt;
-    
-    //!If the number of sent bytes equals the buffer size, then the packet
-    // is done sending.  Thus, we can reset the buffer.
-    if (write_bytes_ == out.size()) {
-        out_.pop();
-        write_bytes_ = 0;
+    for (size_t i = 0; i < count; i++) {
+        network->rx_bytes_ += in[i]->offset;
+
+        // Read the length of the packet from the beginning of the packet,
+        // and drop datagrams that are too short to hold the header.  Don't
+        // trust a length longer than what was actually received.
+        if (in[i]->offset < sizeof(size_t)) {
+            pool_->release(in[i]);
+            continue;
+        }
+        size_t size = ntohl(*(size_t*)in[i]->data);
+        in[i]->size = max(min(size, in[i]->offset), sizeof(size_t));
+        if (simulator_.enabled()) {
+            simulator_.receive(in[i]);
+        } else {
+            received_.push(in[i]);
+        }
     }
 }
 
-void BSockSocket::read_stream() {
-    // If the number of bytes received is zero, then resize buffer
-    // to hold 4096 bytes
-    if (!read_bytes_) {
-        in_.resize(sizeof(size_t));
+BSockPacket* BSockSocket::read_packet() {
+    // Return the next packet that has been read all the way, and give up 
+    // ownership of it.
+    if (received_.empty()) {
+        poll_read();
     }
-    
-    // Attempt to read the rest of the packet
-    char* pkt = &in_[read_bytes_];
-    size_t len = in_.size() - read_bytes_;   
-    
-    // Read from the socket, and capture the source addres.
-    int rt = recv(socket_, pkt, len, 0);
-    
-    // If an error occurred, or the socket is already closed, then throw an
-    // exception.
-	if (rt < 0) {
-		if (EWOULDBLOCK == socket_errcode()) {
-			return;
-		} else {
-			throw runtime_error(socket_errmsg());
-		}
-    } else if (rt == 0) {
-        throw runtime_error("BSockSocket is closed");
-    } else {
-        read_bytes_ += rt;
-    }
-
-	BSockNetwork* network = static_cast<BSockNetwork*>(engine_->network());
-	network->rx_bytes_ += rt;
-    
-    //! Check if all the bytes from the packet have been read.
-    if (read_bytes_ >= sizeof(size_t)) {
-        in_.resize(ntohl(*(size_t*)&in_[0]));
-	}
+    return received_.pop();
 }
 
-BSockWriter* BSockSocket::writer() {
-    // Return a socket writer if the buffer is empty.
-	poll_write();
+BSockPacket* BSockSocket::write_packet() {
+    // Make room in the queue by sending, if the queue is full
+    if (out_.size() >= batch_) {
+        poll_write();
+    }
 
-    // We can write to the socket if we're using a stream socket (reliable,
-    // so it always queues the messages) or if we're using a UDP socket
-    // (no queues to minimize latency, plus a UDP packet that doesn't get
-    // sent is no big deal...just drop it)
-    if (out_.empty() || ST_STREAM == type_) {
-        return new BSockWriter(this);
+    // We can write to the socket if there is room in the batch (no long 
+    // queues to minimize latency, plus a UDP packet that doesn't get sent
+    // is no big deal...just drop it).  Datagrams go to the socket's remote
+    // address unless the writer picks another one.
+    if (out_.size() < batch_) {
+        BSockPacket* packet = pool_->acquire();
+        packet->address = remote_;
+        return packet;
     } else {
         return 0;
     }
 }
 
-BSockReader* BSockSocket::reader() {
-    // Poll for more data from the socket.
-    poll_read();
-
-    // Return a socket reader if the buffer is not empty, and no packet read
-    // is currently in progress
-    if (!in_.empty() && in_.size() == read_bytes_) {
-        return new BSockReader(this);
-    } else {
-        return 0;
+void BSockSocket::send(BSockPacket* packet) {
+    // Write the length of the packet into the header.  This includes the
+    // length of the header itself.
+    *(size_t*)packet->data = htonl(packet->size);
+    packet->offset = 0;
+
+    // The simulator holds datagrams back until their delay is up, and then
+    // poll_write() sends them
+    if (simulator_.enabled()) {
+        simulator_.send(packet);
+        return;
     }
+    out_.push(packet);
+    
+    // Datagrams are sent in batches, once the batch is full or when the
+    // network flushes the socket at the end of the frame.
+    if (out_.size() >= batch_) {
+        poll_write();
+    }
+}
+
+void BSockSocket::release(BSockPacket* packet) {
+    pool_->release(packet);
 }
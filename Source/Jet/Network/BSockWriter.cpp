@@ -18,26 +18,74 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.
- */
+ */  
 
 #include <Jet/Network/BSockWriter.hpp>
 #include <Jet/Network/BSockReader.hpp>
 #include <Jet/Types/Quaternion.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 using namespace Jet;
 using namespace std;
 
 BSockWriter::BSockWriter(BSockSocket* socket) :
     socket_(socket),
-    bytes_written_(sizeof(size_t)) {
+    channel_(CT_UNRELIABLE),
+    packet_(socket->write_packet()),
+    capacity_(JET_MAX_PACKET_SIZE),
+    bytes_written_(sizeof(size_t)),
+    bit_offset_(0),
+    overflow_(!packet_) {
+
+}
+
+BSockWriter::BSockWriter(BSockSocket* socket, const Address& address) :
+    socket_(socket),
+    channel_(CT_UNRELIABLE),
+    packet_(socket->write_packet()),
+    capacity_(JET_MAX_PACKET_SIZE),
+    bytes_written_(sizeof(size_t)),
+    bit_offset_(0),
+    overflow_(!packet_) {
+
+    if (packet_) {
+        packet_->address.sin_family = AF_INET;
+        packet_->address.sin_addr.s_addr = htonl(address.address);
+        packet_->address.sin_port = htons(address.port);
+    }
+}
+
+BSockWriter::BSockWriter(BSockConnection* connection, ChannelType channel) :
+    connection_(connection),
+    channel_(channel),
+    packet_(connection->write_packet(channel)),
+    capacity_(connection->capacity()),
+    bytes_written_(sizeof(size_t)),
+    bit_offset_(0),
+    overflow_(!packet_) {
 
-	socket_->out_.push(std::vector<char>());
-    socket_->out_.back().resize(sizeof(size_t));
 }
 
 BSockWriter::~BSockWriter() {
-    // Send right away if possible.
-    socket_->poll_write();
+    // A packet that overflowed is incomplete, so drop it.
+    if (!packet_) {
+        return;
+    } else if (overflow_) {
+        if (connection_) {
+            connection_->release(packet_);
+        } else {
+            socket_->release(packet_);
+        }
+    } else {
+        packet_->size = bytes_written_;
+        if (connection_) {
+            connection_->send(packet_, channel_);
+        } else {
+            socket_->send(packet_);
+        }
+    }
 }
 
 void BSockWriter::quaternion(const Quaternion& quaternion) {
@@ -54,45 +102,120 @@ void BSockWriter::vector(const Vector& vector) {
 }
 
 void BSockWriter::real(float real) {
-	std::vector<char>& out = socket_->out_.back();
-    
-    out.resize(out.size() + sizeof(real));
-    *(float*)&out[bytes_written_] = real;
-    bytes_written_ += sizeof(real);
+    if (char* out = reserve(sizeof(real))) {
+        memcpy(out, &real, sizeof(real));
+    }
 }
 
 void BSockWriter::integer(int integer) {
-	std::vector<char>& out = socket_->out_.back();
-        
-    out.resize(out.size() + sizeof(integer));
-    *(int*)&out[bytes_written_] = htonl(integer);
-    bytes_written_ += sizeof(integer);
+    if (char* out = reserve(sizeof(integer))) {
+        integer = htonl(integer);
+        memcpy(out, &integer, sizeof(integer));
+    }
 }
 
 void BSockWriter::byte(uint8_t byte) {
-	std::vector<char>& out = socket_->out_.back();
-        
-    out.resize(out.size() + sizeof(byte));
-    *(uint8_t*)&out[bytes_written_] = byte;
-    bytes_written_ += sizeof(byte);
+    if (char* out = reserve(sizeof(byte))) {
+        *out = (char)byte;
+    }
+}
+
+void BSockWriter::bits(uint32_t value, size_t count) {
+	// Fill up the partial byte left by the last bit field, then start new
+	// bytes as needed.  Bits are stored least-significant first.
+	while (count > 0) {
+		if (!bit_offset_) {
+			char* out = reserve(1);
+			if (!out) {
+				return;
+			}
+			*out = 0;
+		}
+		size_t n = min(count, 8 - bit_offset_);
+		uint8_t chunk = (uint8_t)(value & ((1 << n) - 1));
+		packet_->data[bytes_written_ - 1] |= (char)(chunk << bit_offset_);
+		value >>= n;
+		count -= n;
+		bit_offset_ = (bit_offset_ + n) % 8;
+	}
+}
+
+void BSockWriter::varint(uint32_t value, size_t group) {
+	uint32_t mask = (1 << group) - 1;
+	do {
+		uint32_t chunk = value & mask;
+		value >>= group;
+		bits(chunk | (value ? (1 << group) : 0), group + 1);
+	} while (value);
+}
+
+void BSockWriter::ranged(int32_t value, int32_t min, int32_t max) {
+	// Count the bits needed to hold max - min
+	uint32_t range = (uint32_t)max - (uint32_t)min;
+	size_t count = 0;
+	while (count < 32 && (range >> count)) {
+		count++;
+	}
+	value = std::max(std::min(value, max), min);
+	bits((uint32_t)value - (uint32_t)min, count);
+}
+
+void BSockWriter::quantized(float value, float min, float max, size_t count) {
+	// Scale in double precision: a float can't hold 2^32 - 1 exactly, and
+	// rounding it up would overflow the 32-bit field
+	count = std::min(count, (size_t)32);
+	double steps = (count >= 32) ? 4294967295.0 : (double)((1u << count) - 1);
+	double t = (max > min) ? ((double)value - min) / ((double)max - min) : 0.0;
+	t = std::max(std::min(t, 1.0), 0.0);
+	bits((uint32_t)floor(t * steps + 0.5), count);
+}
+
+void BSockWriter::boolean(bool value) {
+	bits(value ? 1 : 0, 1);
 }
 
 void BSockWriter::string(const std::string& string) {
-	std::vector<char>& out = socket_->out_.back();
-    
     size_t length = string.length() + 1;
-    out.resize(out.size() + length);
-    
-    memcpy(&out[bytes_written_], string.c_str(), length);
-    bytes_written_ += length;
+    if (char* out = reserve(length)) {
+        memcpy(out, string.c_str(), length);
+    }
+}
+
+void BSockWriter::bytes(const char* data, size_t length) {
+	if (char* out = reserve(length)) {
+		memcpy(out, data, length);
+	}
 }
 
 void BSockWriter::packet(BSockReader* reader) {
-	std::vector<char>& out = socket_->out_.back();
+	// Copy everything after the other packet's header
+	if (!reader->packet_) {
+		return;
+	}
+	bytes(reader->packet_->data + sizeof(size_t), reader->packet_->size - sizeof(size_t));
+}
 
-	size_t length = reader->in_.size();
-	out.resize(out.size() + length);
+void BSockWriter::packet(BSockWriter* writer) {
+	if (!writer->packet_) {
+		return;
+	}
+	bytes(writer->packet_->data + sizeof(size_t), writer->bytes_written_ - sizeof(size_t));
+}
 
-	copy(reader->in_.begin(), reader->in_.end(), out.begin() + bytes_written_);
-	bytes_written_ += length;
-}	
\ No newline at end of file
+char* BSockWriter::reserve(size_t bytes) {
+	// Returns space for the next field, and starts a new byte for bit 
+	// fields.  Packets can't be bigger than the receive buffer on the 
+	// other end, and messages must leave room for the connection's 
+	// headers, so stop writing if the packet is full.
+	bit_offset_ = 0;
+	if (overflow_) {
+		return 0;
+	}
+	if (bytes_written_ + bytes > capacity_) {
+		overflow_ = true;
+		return 0;
+	}
+	char* data = packet_->data + bytes_written_;
+	bytes_written_ += bytes;
+	return data;
+}
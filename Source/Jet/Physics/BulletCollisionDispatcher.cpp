@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Physics/BulletCollisionDispatcher.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Core/CoreWorkerPool.hpp>
+#include <BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h>
+#include <BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+using namespace Jet;
+using namespace std;
+
+// Convex-convex algorithm with its own simplex solver.  The default 
+// algorithms all share the simplex solver that belongs to the collision
+// configuration, so two of them can't run at the same time.
+class BulletConvexAlgorithm : public btConvexConvexAlgorithm {
+public:
+    BulletConvexAlgorithm(const btCollisionAlgorithmConstructionInfo& info, btCollisionObject* body0, btCollisionObject* body1, btConvexConvexAlgorithm::CreateFunc* base) :
+        btConvexConvexAlgorithm(info.m_manifold, info, body0, body1, &simplex_solver_, base->m_pdSolver, base->m_numPerturbationIterations, base->m_minimumPointsPerturbationThreshold) {
+    }
+
+private:
+    btVoronoiSimplexSolver simplex_solver_;
+};
+
+class BulletCollisionDispatcher::ConvexCreateFunc : public btCollisionAlgorithmCreateFunc {
+public:
+    ConvexCreateFunc(btConvexConvexAlgorithm::CreateFunc* base) :
+        base_(base) {
+    }
+
+    btCollisionAlgorithm* CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& info, btCollisionObject* body0, btCollisionObject* body1) {
+        void* mem = info.m_dispatcher1->allocateCollisionAlgorithm(sizeof(BulletConvexAlgorithm));
+        return new(mem) BulletConvexAlgorithm(info, body0, body1, base_);
+    }
+
+private:
+    btConvexConvexAlgorithm::CreateFunc* base_;
+};
+
+// Orders manifolds by the broadphase IDs of their bodies.  Broadphase IDs 
+// are handed out in the order that bodies are added to the world, so the
+// order doesn't depend on memory addresses or thread timing.
+static bool manifold_less(btPersistentManifold* a, btPersistentManifold* b) {
+    const btCollisionObject* a0 = static_cast<const btCollisionObject*>(a->getBody0());
+    const btCollisionObject* a1 = static_cast<const btCollisionObject*>(a->getBody1());
+    const btCollisionObject* b0 = static_cast<const btCollisionObject*>(b->getBody0());
+    const btCollisionObject* b1 = static_cast<const btCollisionObject*>(b->getBody1());
+    int auid0 = a0->getBroadphaseHandle()->getUid();
+    int buid0 = b0->getBroadphaseHandle()->getUid();
+    if (auid0 != buid0) {
+        return auid0 < buid0;
+    }
+    return a1->getBroadphaseHandle()->getUid() < b1->getBroadphaseHandle()->getUid();
+}
+
+BulletCollisionDispatcher::BulletCollisionDispatcher(CoreEngine* engine, btCollisionConfiguration* config) :
+    btCollisionDispatcher(config),
+    engine_(engine),
+    info_(0) {
+
+    // Replace every use of the configuration's convex-convex algorithm
+    // with the thread-safe version
+    btCollisionAlgorithmCreateFunc* convex = config->getCollisionAlgorithmCreateFunc(CONVEX_HULL_SHAPE_PROXYTYPE, CONVEX_HULL_SHAPE_PROXYTYPE);
+    convex_create_func_.reset(new ConvexCreateFunc(static_cast<btConvexConvexAlgorithm::CreateFunc*>(convex)));
+    for (int i = 0; i < MAX_BROADPHASE_COLLISION_TYPES; i++) {
+        for (int j = 0; j < MAX_BROADPHASE_COLLISION_TYPES; j++) {
+            if (convex == m_doubleDispatch[i][j]) {
+                registerCollisionCreateFunc(i, j, convex_create_func_.get());
+            }
+        }
+    }
+}
+
+BulletCollisionDispatcher::~BulletCollisionDispatcher() {
+    
+}
+
+size_t BulletCollisionDispatcher::algorithm_size() {
+    return sizeof(BulletConvexAlgorithm);
+}
+
+btCollisionAlgorithm* BulletCollisionDispatcher::findAlgorithm(btCollisionObject* body0, btCollisionObject* body1, btPersistentManifold* manifold) {
+    // Compound and concave algorithms create child algorithms while they
+    // are being processed
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    return btCollisionDispatcher::findAlgorithm(body0, body1, manifold);
+}
+
+btPersistentManifold* BulletCollisionDispatcher::getNewManifold(void* body0, void* body1) {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    return btCollisionDispatcher::getNewManifold(body0, body1);
+}
+
+void BulletCollisionDispatcher::releaseManifold(btPersistentManifold* manifold) {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    btCollisionDispatcher::releaseManifold(manifold);
+}
+
+void* BulletCollisionDispatcher::allocateCollisionAlgorithm(int size) {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+}
+
+void BulletCollisionDispatcher::freeCollisionAlgorithm(void* ptr) {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+}
+
+void BulletCollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* pairs, const btDispatcherInfo& info, btDispatcher* dispatcher) {
+    if (!engine_->option<bool>("physics_parallel_narrowphase")) {
+        btCollisionDispatcher::dispatchAllCollisionPairs(pairs, info, dispatcher);
+        return;
+    }
+
+    // Look up the algorithm for each pair that needs one on this thread,
+    // so that the broadphase pair array isn't modified while the pairs are
+    // being processed
+    pair_.clear();
+    btBroadphasePairArray& array = pairs->getOverlappingPairArray();
+    for (int i = 0; i < array.size(); i++) {
+        btBroadphasePair& pair = array[i];
+        btCollisionObject* body0 = static_cast<btCollisionObject*>(pair.m_pProxy0->m_clientObject);
+        btCollisionObject* body1 = static_cast<btCollisionObject*>(pair.m_pProxy1->m_clientObject);
+        if (!needsCollision(body0, body1)) {
+            continue;
+        }
+        if (!pair.m_algorithm) {
+            pair.m_algorithm = findAlgorithm(body0, body1);
+        }
+        if (pair.m_algorithm) {
+            pair_.push_back(&pair);
+        }
+    }
+
+    // Split the pairs into a few chunks per thread, so that a chunk with
+    // several expensive pairs doesn't hold up the whole step
+    CoreWorkerPool* pool = engine_->worker_pool();
+    size_t grain = max(pair_.size() / (4 * (pool->thread_count() + 1)), (size_t)16);
+    info_ = &info;
+    pool->parallel_for(pair_.size(), grain, boost::bind(&BulletCollisionDispatcher::process_pairs, this, _1, _2));
+    info_ = 0;
+
+    if (engine_->option<bool>("physics_deterministic")) {
+        sort_manifolds();
+    }
+}
+
+void BulletCollisionDispatcher::process_pairs(size_t begin, size_t end) {
+    btNearCallback callback = getNearCallback();
+    for (size_t i = begin; i < end; i++) {
+        callback(*pair_[i], *this, *info_);
+    }
+}
+
+void BulletCollisionDispatcher::sort_manifolds() {
+    // Manifolds between the same pair of bodies keep their relative order.
+    // Each manifold stores its own index for fast removal, so fix up the
+    // indices afterwards.
+    int count = m_manifoldsPtr.size();
+    if (count <= 1) {
+        return;
+    }
+    btPersistentManifold** manifold = &m_manifoldsPtr[0];
+    stable_sort(manifold, manifold + count, manifold_less);
+    for (int i = 0; i < count; i++) {
+        manifold[i]->m_index1a = i;
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Physics/BulletConstraintSolver.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Core/CoreWorkerPool.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+using namespace Jet;
+using namespace std;
+
+// Sorts islands from the most contacts to the least, so that the biggest
+// islands start first and the small ones fill in around them.
+class IslandLess {
+public:
+    IslandLess(const vector<size_t>& size) : size_(size) {}
+
+    bool operator()(size_t a, size_t b) const {
+        return size_[a] > size_[b] || (size_[a] == size_[b] && a < b);
+    }
+
+private:
+    const vector<size_t>& size_;
+};
+
+BulletConstraintSolver::BulletConstraintSolver(CoreEngine* engine) :
+    engine_(engine),
+    island_count_(0),
+    groups_(0),
+    parallel_(false),
+    deterministic_(false),
+    info_(0),
+    debug_draw_(0),
+    dispatcher_(0) {
+
+}
+
+BulletConstraintSolver::~BulletConstraintSolver() {
+    for (map<boost::thread::id, ThreadSolver*>::iterator i = thread_solver_.begin(); i != thread_solver_.end(); i++) {
+        delete i->second;
+    }
+}
+
+void BulletConstraintSolver::prepareSolve(int bodies, int manifolds) {
+    parallel_ = engine_->option<bool>("physics_parallel_solver");
+    deterministic_ = engine_->option<bool>("physics_deterministic");
+    island_count_ = 0;
+    groups_ = 0;
+}
+
+btScalar BulletConstraintSolver::solveGroup(btCollisionObject** bodies, int nbodies, btPersistentManifold** manifolds, int nmanifolds, btTypedConstraint** constraints, int nconstraints, const btContactSolverInfo& info, btIDebugDraw* debug_draw, btStackAlloc* stack_alloc, btDispatcher* dispatcher) {
+    groups_++;
+    if (!parallel_) {
+        btSequentialImpulseConstraintSolver* solver = &thread_solver()->solver;
+        if (deterministic_) {
+            solver->setRandSeed(0);
+        }
+        return solver->solveGroup(bodies, nbodies, manifolds, nmanifolds, constraints, nconstraints, info, debug_draw, stack_alloc, dispatcher);
+    }
+
+    // Copy the island, because the arrays passed in by the world are 
+    // reused for the next island.  The islands are solved in allSolved().
+    if (island_count_ == island_.size()) {
+        island_.push_back(Island());
+    }
+    Island& island = island_[island_count_++];
+    island.body.assign(bodies, bodies + nbodies);
+    island.manifold.assign(manifolds, manifolds + nmanifolds);
+    island.constraint.assign(constraints, constraints + nconstraints);
+    debug_draw_ = debug_draw;
+    dispatcher_ = dispatcher;
+    return 0.0f;
+}
+
+void BulletConstraintSolver::allSolved(const btContactSolverInfo& info, btIDebugDraw* debug_draw, btStackAlloc* stack_alloc) {
+    if (!parallel_ || !island_count_) {
+        return;
+    }
+
+    vector<size_t> size(island_count_);
+    order_.resize(island_count_);
+    for (size_t i = 0; i < island_count_; i++) {
+        size[i] = island_[i].manifold.size() + island_[i].constraint.size();
+        order_[i] = i;
+    }
+    sort(order_.begin(), order_.end(), IslandLess(size));
+
+    info_ = &info;
+    engine_->worker_pool()->parallel_for(island_count_, 1, boost::bind(&BulletConstraintSolver::solve_islands, this, _1, _2));
+    info_ = 0;
+    island_count_ = 0;
+}
+
+void BulletConstraintSolver::reset() {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (map<boost::thread::id, ThreadSolver*>::iterator i = thread_solver_.begin(); i != thread_solver_.end(); i++) {
+        i->second->solver.reset();
+    }
+}
+
+BulletConstraintSolver::ThreadSolver* BulletConstraintSolver::thread_solver() {
+    // Each thread has its own solver and scratch stack, because the solver
+    // keeps scratch buffers for the island that it's working on.  They are
+    // kept in a map rather than in thread-local storage, so that reset()
+    // can reach all of them.
+    boost::mutex::scoped_lock lock(mutex_);
+    ThreadSolver*& solver = thread_solver_[boost::this_thread::get_id()];
+    if (!solver) {
+        solver = new ThreadSolver;
+    }
+    return solver;
+}
+
+void BulletConstraintSolver::solve_islands(size_t begin, size_t end) {
+    ThreadSolver* thread_solver = this->thread_solver();
+    btSequentialImpulseConstraintSolver* solver = &thread_solver->solver;
+    for (size_t i = begin; i < end; i++) {
+        Island& island = island_[order_[i]];
+        if (deterministic_) {
+            solver->setRandSeed(0);
+        }
+        btCollisionObject** bodies = island.body.empty() ? 0 : &island.body.front();
+        btPersistentManifold** manifolds = island.manifold.empty() ? 0 : &island.manifold.front();
+        btTypedConstraint** constraints = island.constraint.empty() ? 0 : &island.constraint.front();
+        solver->solveGroup(bodies, island.body.size(), manifolds, island.manifold.size(), constraints, island.constraint.size(), *info_, debug_draw_, &thread_solver->stack_alloc, dispatcher_);
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Physics/BulletDynamicsWorld.hpp>
+#include <Jet/Physics/BulletPhysics.hpp>
+#include <Jet/Core/CoreNode.hpp>
+
+using namespace Jet;
+using namespace std;
+
+BulletDynamicsWorld::BulletDynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* broadphase, btConstraintSolver* solver, btCollisionConfiguration* config) :
+    btDiscreteDynamicsWorld(dispatcher, broadphase, solver, config),
+    broadphase_time_(0),
+    narrowphase_time_(0),
+    solver_time_(0),
+    integration_time_(0) {
+
+}
+
+void BulletDynamicsWorld::reset_timers() {
+    broadphase_time_ = 0;
+    narrowphase_time_ = 0;
+    solver_time_ = 0;
+    integration_time_ = 0;
+}
+
+void BulletDynamicsWorld::count_bodies(size_t& active, size_t& sleeping) const {
+    active = 0;
+    sleeping = 0;
+    for (int i = 0; i < m_nonStaticRigidBodies.size(); i++) {
+        if (m_nonStaticRigidBodies[i]->isActive()) {
+            active++;
+        } else {
+            sleeping++;
+        }
+    }
+}
+
+void BulletDynamicsWorld::performDiscreteCollisionDetection() {
+    // Same as the base class, but with the broadphase and narrowphase 
+    // timed separately.  Updating the AABBs counts as broadphase time.
+    unsigned long start = clock_.getTimeMicroseconds();
+    updateAabbs();
+    getBroadphase()->calculateOverlappingPairs(getDispatcher());
+    unsigned long middle = clock_.getTimeMicroseconds();
+    getDispatcher()->dispatchAllCollisionPairs(getPairCache(), getDispatchInfo(), getDispatcher());
+    unsigned long end = clock_.getTimeMicroseconds();
+    broadphase_time_ += middle - start;
+    narrowphase_time_ += end - middle;
+}
+
+void BulletDynamicsWorld::predictUnconstraintMotion(btScalar step) {
+    unsigned long start = clock_.getTimeMicroseconds();
+    btDiscreteDynamicsWorld::predictUnconstraintMotion(step);
+    integration_time_ += clock_.getTimeMicroseconds() - start;
+}
+
+void BulletDynamicsWorld::integrateTransforms(btScalar step) {
+    unsigned long start = clock_.getTimeMicroseconds();
+    btDiscreteDynamicsWorld::integrateTransforms(step);
+    integration_time_ += clock_.getTimeMicroseconds() - start;
+}
+
+void BulletDynamicsWorld::calculateSimulationIslands() {
+    unsigned long start = clock_.getTimeMicroseconds();
+    btDiscreteDynamicsWorld::calculateSimulationIslands();
+    solver_time_ += clock_.getTimeMicroseconds() - start;
+}
+
+void BulletDynamicsWorld::solveConstraints(btContactSolverInfo& info) {
+    unsigned long start = clock_.getTimeMicroseconds();
+    btDiscreteDynamicsWorld::solveConstraints(info);
+    solver_time_ += clock_.getTimeMicroseconds() - start;
+}
+
+void BulletDynamicsWorld::synchronizeMotionStates() {
+    unsigned long start = clock_.getTimeMicroseconds();
+    // The non-static body array only holds dynamic and kinematic bodies, 
+    // so this loop never touches the (usually much larger) set of static 
+    // bodies.  Kinematic bodies are moved by the scene, so they are 
+    // skipped too.  The transform is interpolated by the time left over 
+    // after the last substep, the same way Bullet's motion states are.
+    for (int i = 0; i < m_nonStaticRigidBodies.size(); i++) {
+        btRigidBody* body = m_nonStaticRigidBodies[i];
+        if (!body->isActive() || body->isKinematicObject()) {
+            continue;
+        }
+
+        btTransform transform;
+        btTransformUtil::integrateTransform(
+            body->getInterpolationWorldTransform(),
+            body->getInterpolationLinearVelocity(),
+            body->getInterpolationAngularVelocity(),
+            m_localTime * body->getHitFraction(), transform);
+
+        const btQuaternion rotation = transform.getRotation();
+        const btVector3& position = transform.getOrigin();
+        CoreNode* node = static_cast<BulletRigidBody*>(body->getUserPointer())->parent();
+        node->raw_transform(
+            Vector(position.x(), position.y(), position.z()),
+            Quaternion(rotation.w(), rotation.x(), rotation.y(), rotation.z()));
+    }
+    integration_time_ += clock_.getTimeMicroseconds() - start;
+}
@@ -21,6 +21,7 @@
  */  
 
 #include <Jet/Physics/BulletGeometry.hpp>
+#include <Jet/Physics/BulletPhysics.hpp>
 #include <Jet/Resources/Mesh.hpp>
 #include <Jet/Types/Vertex.hpp>
 
@@ -48,31 +49,15 @@ void BulletGeometry::state(ResourceState state) {
 
 void BulletGeometry::update_collision_shape() {
 	shape_ = btConvexHullShape();
-	btTriangleIndexVertexArray vertex_array;
 
-    // Create a triangle array using the data loaded from the disk
+    // Building the hull is expensive, so it is shared by all geometry with
+    // the same vertices and indices (see BulletHullCache)
     MeshPtr mesh = BulletGeometry::mesh();
-	for (size_t g = 0; g < mesh->group_count(); g++) {
-		btIndexedMesh imesh;
-		imesh.m_numTriangles = mesh->index_count(g)/3;
-		imesh.m_triangleIndexBase = (uint8_t*)mesh->index_data(g);
-		imesh.m_triangleIndexStride = 3*sizeof(uint32_t);
-		imesh.m_numVertices = mesh->vertex_count();
-		imesh.m_vertexBase = (uint8_t*)mesh->vertex_data();
-		imesh.m_vertexStride = sizeof(Vertex);
-		vertex_array.addIndexedMesh(imesh);
+    BulletPhysics* physics = static_cast<BulletPhysics*>(engine_->physics());
+    vector<btVector3> point;
+    physics->hull_cache()->hull(mesh.get(), point);
+	for (size_t i = 0; i < point.size(); i++) {
+		shape_.addPoint(point[i]);
 	}
-	
-	//! Create a temporary shape to hold the vertice;
-	btConvexTriangleMeshShape temp_shape(&vertex_array);
-	btShapeHull shape_hull(&temp_shape);
-	btScalar margin = temp_shape.getMargin();
-	shape_hull.buildHull(margin);
-	temp_shape.setUserPointer(&shape_hull);
-	
-	// Awesome! Create a hull using the hull vertices.
-	for (int i = 0; i < shape_hull.numVertices(); i++) {
-		shape_.addPoint(shape_hull.getVertexPointer()[i]);
-	}
-	
+
 }
\ No newline at end of file
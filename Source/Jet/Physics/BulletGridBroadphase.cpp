@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Physics/BulletGridBroadphase.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace Jet;
+using namespace std;
+
+// Objects that cover more cells than this go in the list of large objects,
+// so that one big object doesn't fill the grid
+#define JET_GRID_MAX_CELLS 27
+
+// Objects farther out than this many cells are also treated as large, so
+// that the cell coordinates always fit in an int
+#define JET_GRID_MAX_COORDINATE 1e9f
+
+BulletGridBroadphase::BulletGridBroadphase(float cell_size) :
+    cell_size_(cell_size),
+    pair_cache_(new btHashedOverlappingPairCache),
+    next_uid_(2) {
+
+}
+
+BulletGridBroadphase::~BulletGridBroadphase() {
+    for (size_t i = 0; i < proxy_.size(); i++) {
+        delete proxy_[i];
+    }
+}
+
+btBroadphaseProxy* BulletGridBroadphase::createProxy(const btVector3& min, const btVector3& max, int shape_type, void* user, short int group, short int mask, btDispatcher* dispatcher, void* multi_sap_proxy) {
+    Proxy* proxy = new Proxy(min, max, user, group, mask, multi_sap_proxy);
+    proxy->m_uniqueId = next_uid_++;
+    proxy->index = proxy_.size();
+    proxy_.push_back(proxy);
+    return proxy;
+}
+
+void BulletGridBroadphase::destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher) {
+    pair_cache_->removeOverlappingPairsContainingProxy(proxy, dispatcher);
+
+    // Move the last proxy into the empty slot.  The grid still holds a 
+    // pointer to the proxy, so remove it from the grid too.
+    Proxy* grid_proxy = static_cast<Proxy*>(proxy);
+    proxy_[grid_proxy->index] = proxy_.back();
+    proxy_[grid_proxy->index]->index = grid_proxy->index;
+    proxy_.pop_back();
+    cell_.clear();
+    large_.clear();
+    delete grid_proxy;
+}
+
+void BulletGridBroadphase::setAabb(btBroadphaseProxy* proxy, const btVector3& min, const btVector3& max, btDispatcher* dispatcher) {
+    proxy->m_aabbMin = min;
+    proxy->m_aabbMax = max;
+}
+
+void BulletGridBroadphase::getAabb(btBroadphaseProxy* proxy, btVector3& min, btVector3& max) const {
+    min = proxy->m_aabbMin;
+    max = proxy->m_aabbMax;
+}
+
+void BulletGridBroadphase::rayTest(const btVector3& from, const btVector3& to, btBroadphaseRayCallback& callback, const btVector3& min, const btVector3& max) {
+    // Rays are only cast by queries, so check every proxy rather than 
+    // walking the grid.  The proxy's box is grown by the swept box, the
+    // same way the other broadphases do it.
+    for (size_t i = 0; i < proxy_.size(); i++) {
+        Proxy* proxy = proxy_[i];
+        btVector3 lo = proxy->m_aabbMin - max;
+        btVector3 hi = proxy->m_aabbMax - min;
+        btScalar t_min = 0.0f;
+        btScalar t_max = callback.m_lambda_max;
+        for (int axis = 0; axis < 3 && t_min <= t_max; axis++) {
+            btScalar t0 = (lo[axis] - from[axis]) * callback.m_rayDirectionInverse[axis];
+            btScalar t1 = (hi[axis] - from[axis]) * callback.m_rayDirectionInverse[axis];
+            if (t0 > t1) {
+                swap(t0, t1);
+            }
+            t_min = std::max(t_min, t0);
+            t_max = std::min(t_max, t1);
+        }
+        if (t_min <= t_max) {
+            callback.process(proxy);
+        }
+    }
+}
+
+void BulletGridBroadphase::aabbTest(const btVector3& min, const btVector3& max, btBroadphaseAabbCallback& callback) {
+    btBroadphaseProxy query;
+    query.m_aabbMin = min;
+    query.m_aabbMax = max;
+    for (size_t i = 0; i < proxy_.size(); i++) {
+        if (overlap(&query, proxy_[i])) {
+            callback.process(proxy_[i]);
+        }
+    }
+}
+
+void BulletGridBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher) {
+    // Remove the pairs that stopped overlapping.  Removing a pair moves the
+    // last pair into its slot, so walk the array backwards.
+    btBroadphasePairArray& pair = pair_cache_->getOverlappingPairArray();
+    for (int i = pair.size() - 1; i >= 0; i--) {
+        btBroadphaseProxy* a = pair[i].m_pProxy0;
+        btBroadphaseProxy* b = pair[i].m_pProxy1;
+        if (!overlap(a, b)) {
+            pair_cache_->removeOverlappingPair(a, b, dispatcher);
+        }
+    }
+
+    // Put each proxy into every cell that its box touches, then sort by 
+    // cell so that the proxies in each cell are next to each other
+    cell_.clear();
+    large_.clear();
+    for (size_t i = 0; i < proxy_.size(); i++) {
+        Proxy* proxy = proxy_[i];
+        int lo[3], hi[3];
+        proxy->large = !cell_range(proxy->m_aabbMin, proxy->m_aabbMax, lo, hi);
+        if (proxy->large) {
+            large_.push_back(proxy);
+            continue;
+        }
+        for (int x = lo[0]; x <= hi[0]; x++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int z = lo[2]; z <= hi[2]; z++) {
+                    cell_.push_back(Cell(cell_key(x, y, z), proxy));
+                }
+            }
+        }
+    }
+    sort(cell_.begin(), cell_.end());
+
+    // Test the proxies in each cell against each other.  Two proxies can
+    // share more than one cell, so the pair is only added by the cell that
+    // holds the low corner of the region where they overlap.  The pair 
+    // cache ignores pairs that it already has, and filters out pairs that
+    // shouldn't collide.
+    for (size_t begin = 0; begin < cell_.size();) {
+        size_t end = begin + 1;
+        while (end < cell_.size() && cell_[end].key == cell_[begin].key) {
+            end++;
+        }
+        for (size_t i = begin; i < end; i++) {
+            Proxy* a = cell_[i].proxy;
+            for (size_t j = i + 1; j < end; j++) {
+                Proxy* b = cell_[j].proxy;
+                if (!overlap(a, b)) {
+                    continue;
+                }
+                btVector3 corner = a->m_aabbMin;
+                corner.setMax(b->m_aabbMin);
+                if (cell_key(corner) == cell_[begin].key) {
+                    pair_cache_->addOverlappingPair(a, b);
+                }
+            }
+        }
+        begin = end;
+    }
+
+    // Large proxies are tested against everything.  Pairs of two large 
+    // proxies are only tested once.
+    for (size_t i = 0; i < large_.size(); i++) {
+        Proxy* a = large_[i];
+        for (size_t j = 0; j < proxy_.size(); j++) {
+            Proxy* b = proxy_[j];
+            if (a == b || (b->large && b->index < a->index)) {
+                continue;
+            }
+            if (overlap(a, b)) {
+                pair_cache_->addOverlappingPair(a, b);
+            }
+        }
+    }
+}
+
+btOverlappingPairCache* BulletGridBroadphase::getOverlappingPairCache() {
+    return pair_cache_.get();
+}
+
+const btOverlappingPairCache* BulletGridBroadphase::getOverlappingPairCache() const {
+    return pair_cache_.get();
+}
+
+void BulletGridBroadphase::getBroadphaseAabb(btVector3& min, btVector3& max) const {
+    min.setValue(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+    max.setValue(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+}
+
+bool BulletGridBroadphase::cell_range(const btVector3& min, const btVector3& max, int* lo, int* hi) const {
+    // Returns false if the box is too big to put in the grid
+    for (int axis = 0; axis < 3; axis++) {
+        float a = min[axis] / cell_size_;
+        float b = max[axis] / cell_size_;
+        if (!(b - a < JET_GRID_MAX_CELLS) || fabsf(a) > JET_GRID_MAX_COORDINATE || fabsf(b) > JET_GRID_MAX_COORDINATE) {
+            return false;
+        }
+        lo[axis] = (int)floorf(a);
+        hi[axis] = (int)floorf(b);
+    }
+    int count = (hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1);
+    return count <= JET_GRID_MAX_CELLS;
+}
+
+uint64_t BulletGridBroadphase::cell_key(const btVector3& point) const {
+    return cell_key(
+        (int)floorf(point.x() / cell_size_),
+        (int)floorf(point.y() / cell_size_),
+        (int)floorf(point.z() / cell_size_));
+}
+
+uint64_t BulletGridBroadphase::cell_key(int x, int y, int z) {
+    // Each coordinate gets 21 bits.  Cells that are far apart can wrap to
+    // the same key; that only costs a few extra box tests.
+    const uint64_t mask = 0x1fffff;
+    return (((uint64_t)x & mask) << 42) | (((uint64_t)y & mask) << 21) | ((uint64_t)z & mask);
+}
+
+bool BulletGridBroadphase::overlap(const btBroadphaseProxy* a, const btBroadphaseProxy* b) {
+    return a->m_aabbMin.x() <= b->m_aabbMax.x() && b->m_aabbMin.x() <= a->m_aabbMax.x()
+        && a->m_aabbMin.y() <= b->m_aabbMax.y() && b->m_aabbMin.y() <= a->m_aabbMax.y()
+        && a->m_aabbMin.z() <= b->m_aabbMax.z() && b->m_aabbMin.z() <= a->m_aabbMax.z();
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Physics/BulletHullCache.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Types/Vertex.hpp>
+#include <fstream>
+#include <cmath>
+
+using namespace Jet;
+using namespace std;
+
+#define HULL_MAGIC 0x4c55484a // "JHUL"
+#define HULL_VERSION 1
+#define HULL_HEADER_SIZE (5*sizeof(uint32_t) + sizeof(uint64_t))
+
+BulletHullCache::BulletHullCache(CoreEngine* engine) :
+    engine_(engine) {
+
+    engine_->option("physics_hull_max_vertices", 32.0f);
+    engine_->option("physics_hull_cache_size", 1024.0f);
+}
+
+void BulletHullCache::hull(Mesh* mesh, std::vector<btVector3>& point) {
+    // The geometry hash is kept by the mesh, so looking up a hull doesn't
+    // touch the vertex data.  A hull is thrown out if the vertex data has 
+    // changed since the hull was built, because the hash changes too.
+    size_t max_vertices = max((size_t)engine_->option<float>("physics_hull_max_vertices"), (size_t)4);
+    uint64_t hash = mesh->geometry_hash();
+    map<uint64_t, Hull>::iterator i = hull_.find(hash);
+    if (i != hull_.end() && i->second.max_vertices == max_vertices) {
+        point = i->second.point;
+        return;
+    }
+
+    // Only meshes that were loaded from a file can have a cooked hull
+    static const string ext = ".obj";
+    string path;
+    size_t pos = mesh->name().rfind(ext);
+    if (pos != string::npos && (mesh->name().length() - pos) == ext.length()) {
+        try {
+            path = engine_->resource_path(mesh->name() + ".hull");
+        } catch (std::exception&) {
+            path.clear();
+        }
+    }
+    
+    Hull hull;
+    if (path.empty() || !read_hull(path, hull) || hull.geometry_hash != hash || hull.max_vertices != max_vertices) {
+        hull.geometry_hash = hash;
+        hull.max_vertices = max_vertices;
+        build_hull(mesh, max_vertices, hull.point);
+    }
+    
+    insert(hash, hull);
+    point = hull.point;
+}
+
+void BulletHullCache::cook(Mesh* mesh, size_t max_vertices, const std::string& path) {
+    Hull hull;
+    hull.geometry_hash = mesh->geometry_hash();
+    hull.max_vertices = max(max_vertices, (size_t)4);
+    build_hull(mesh, hull.max_vertices, hull.point);
+    if (!write_hull(path, hull)) {
+        throw runtime_error("Could not write hull file: " + path);
+    }
+}
+
+void BulletHullCache::build_hull(Mesh* mesh, size_t max_vertices, std::vector<btVector3>& point) {
+    btTriangleIndexVertexArray vertex_array;
+    bool empty = true;
+
+    // Create a triangle array using the data loaded from the disk
+	for (size_t g = 0; g < mesh->group_count(); g++) {
+        if (!mesh->index_count(g)) {
+            continue;
+        }
+		btIndexedMesh imesh;
+		imesh.m_numTriangles = mesh->index_count(g)/3;
+		imesh.m_triangleIndexBase = (uint8_t*)mesh->index_data(g);
+		imesh.m_triangleIndexStride = 3*sizeof(uint32_t);
+		imesh.m_numVertices = mesh->vertex_count();
+		imesh.m_vertexBase = (uint8_t*)mesh->vertex_data();
+		imesh.m_vertexStride = sizeof(Vertex);
+		vertex_array.addIndexedMesh(imesh);
+        empty = false;
+	}
+    
+    point.clear();
+    if (empty) {
+        return;
+    }
+	
+	// Create a temporary shape to hold the vertices
+	btConvexTriangleMeshShape temp_shape(&vertex_array);
+	btShapeHull shape_hull(&temp_shape);
+	shape_hull.buildHull(temp_shape.getMargin());
+	point.assign(shape_hull.getVertexPointer(), shape_hull.getVertexPointer() + shape_hull.numVertices());
+    reduce_hull(max_vertices, point);
+}
+
+void BulletHullCache::reduce_hull(size_t max_vertices, std::vector<btVector3>& point) {
+    if (point.size() <= max_vertices) {
+        return;
+    }
+
+    // Keep the support point of the hull in evenly spaced directions 
+    // (a spiral over the unit sphere).  Support points are always hull
+    // vertices, so the reduced hull fits inside the original hull and 
+    // keeps its extents along each direction.
+    std::vector<btVector3> reduced;
+    std::vector<bool> used(point.size(), false);
+    float golden_angle = 3.14159265f * (3.0f - sqrtf(5.0f));
+    for (size_t i = 0; i < max_vertices; i++) {
+        float y = 1.0f - 2.0f * (i + 0.5f) / max_vertices;
+        float r = sqrtf(1.0f - y*y);
+        btVector3 direction(cosf(golden_angle*i) * r, y, sinf(golden_angle*i) * r);
+        
+        size_t best = 0;
+        for (size_t j = 1; j < point.size(); j++) {
+            if (point[j].dot(direction) > point[best].dot(direction)) {
+                best = j;
+            }
+        }
+        if (!used[best]) {
+            used[best] = true;
+            reduced.push_back(point[best]);
+        }
+    }
+    point.swap(reduced);
+}
+
+bool BulletHullCache::read_hull(const std::string& path, Hull& hull) {
+    ifstream in(path.c_str(), ios::binary);
+    uint32_t header[5];
+    if (!in.read((char*)header, sizeof(header))) {
+        return false;
+    }
+    if (HULL_MAGIC != header[0] || HULL_VERSION != header[1]) {
+        return false;
+    }
+    uint64_t hash = 0;
+    if (!in.read((char*)&hash, sizeof(hash))) {
+        return false;
+    }
+
+    // Don't trust the point count until it matches the size of the file
+    // and the vertex limit that the hull was reduced to
+    in.seekg(0, ios::end);
+    size_t size = (size_t)in.tellg();
+    in.seekg(HULL_HEADER_SIZE, ios::beg);
+    if (header[3] > header[2] || size != HULL_HEADER_SIZE + header[3]*3*sizeof(float)) {
+        return false;
+    }
+
+    hull.geometry_hash = hash;
+    hull.max_vertices = header[2];
+    hull.point.resize(header[3]);
+    for (size_t i = 0; i < hull.point.size(); i++) {
+        float xyz[3];
+        if (!in.read((char*)xyz, sizeof(xyz))) {
+            return false;
+        }
+        hull.point[i] = btVector3(xyz[0], xyz[1], xyz[2]);
+    }
+    return true;
+}
+
+bool BulletHullCache::write_hull(const std::string& path, const Hull& hull) {
+    ofstream out(path.c_str(), ios::binary);
+    if (!out) {
+        return false;
+    }
+    uint32_t header[5] = { HULL_MAGIC, HULL_VERSION, (uint32_t)hull.max_vertices, (uint32_t)hull.point.size(), 0 };
+    out.write((const char*)header, sizeof(header));
+    out.write((const char*)&hull.geometry_hash, sizeof(hull.geometry_hash));
+    for (size_t i = 0; i < hull.point.size(); i++) {
+        float xyz[3] = { hull.point[i].x(), hull.point[i].y(), hull.point[i].z() };
+        out.write((const char*)xyz, sizeof(xyz));
+    }
+    return out.good();
+}
+
+void BulletHullCache::insert(uint64_t key, const Hull& hull) {
+    // Throw out the oldest hulls first.  Most of the entries come from
+    // fractured pieces, which are usually only built once.
+    size_t max_size = max((size_t)engine_->option<float>("physics_hull_cache_size"), (size_t)1);
+    if (hull_.find(key) == hull_.end()) {
+        order_.push_back(key);
+    }
+    hull_[key] = hull;
+    while (order_.size() > max_size) {
+        hull_.erase(order_.front());
+        order_.pop_front();
+    }
+}
@@ -23,22 +23,50 @@
 #include <Jet/Physics/BulletPhysics.hpp>
 #include <Jet/Physics/BulletRigidBody.hpp>
 #include <Jet/Core/CoreNode.hpp>
+#include <algorithm>
 
 using namespace Jet;
 using namespace std;
 
 BulletPhysics::BulletPhysics(CoreEngine* engine) :
-    engine_(engine) {
+    engine_(engine),
+    hull_cache_(engine),
+    query_(engine),
+    contact_time_(0),
+    manifold_count_(0),
+    contact_count_(0) {
         
     engine_->listener(this);
 	engine_->option("gravity", 0.0f);
+    engine_->option("physics_parallel_narrowphase", false);
+    engine_->option("physics_parallel_solver", false);
+    engine_->option("physics_deterministic", true);
+    engine_->option("physics_ccd_max_radius", 1.0f);
+    engine_->option("physics_trace_file", string(""));
+    engine_->option("physics_broadphase", string("dbvt"));
+    engine_->option("physics_world_size", 10000.0f);
+    engine_->option("physics_grid_cell_size", 16.0f);
+    engine_->option("stat_physics_broadphase_time", 0.0f);
+    engine_->option("stat_physics_narrowphase_time", 0.0f);
+    engine_->option("stat_physics_solver_time", 0.0f);
+    engine_->option("stat_physics_integration_time", 0.0f);
+    engine_->option("stat_physics_contact_time", 0.0f);
+    engine_->option("stat_physics_active_bodies", 0.0f);
+    engine_->option("stat_physics_sleeping_bodies", 0.0f);
+    engine_->option("stat_physics_solver_groups", 0.0f);
+    engine_->option("stat_physics_manifolds", 0.0f);
+    engine_->option("stat_physics_contacts", 0.0f);
         
-    // Blah blah blah config blah blah
-    config_.reset(new btDefaultCollisionConfiguration);
-    dispatcher_.reset(new btCollisionDispatcher(config_.get()));
+    // The dispatcher and solver check the options every step, so that 
+    // the threading mode can be changed at any time.  The algorithm pool
+    // must be able to hold the dispatcher's convex-convex algorithm.
+    btDefaultCollisionConstructionInfo info;
+    info.m_customCollisionAlgorithmMaxElementSize = BulletCollisionDispatcher::algorithm_size();
+    config_.reset(new btDefaultCollisionConfiguration(info));
+    dispatcher_.reset(new BulletCollisionDispatcher(engine_, config_.get()));
     broadphase_.reset(new btDbvtBroadphase);
-    solver_.reset(new btSequentialImpulseConstraintSolver);
-	world_.reset(new btDiscreteDynamicsWorld(dispatcher_.get(), broadphase_.get(), solver_.get(), config_.get()));
+    solver_.reset(new BulletConstraintSolver(engine_));
+	world_.reset(new BulletDynamicsWorld(dispatcher_.get(), broadphase_.get(), solver_.get(), config_.get()));
 	world_->setGravity(btVector3(0.0f, -10.0f, 0.0f));
     
     // Enable the pre-tick callback
@@ -51,72 +79,241 @@ BulletPhysics::~BulletPhysics() {
     
 }
 
-void BulletPhysics::on_update() {
+void BulletPhysics::on_tick() {
     float gravity = engine_->option<float>("gravity");
     world_->setGravity(btVector3(0.0f, -gravity, 0.0f));
     
-    // Step simulation returns how many substeps were taken.  If at least one
-    // substep was taken, then we have to update matrices for our objects.
-	world_->stepSimulation(engine_->frame_delta(), 4, engine_->timestep());
+    // The engine runs the fixed-rate ticks, so take exactly one step per
+    // tick.  Bullet's own accumulator is always empty after the step, so 
+    // the transforms copied back to the nodes aren't extrapolated.
+	world_->stepSimulation(engine_->timestep(), 1, engine_->timestep());
+	
+	// Send out collision events now that the world is no longer being
+	// stepped
+    unsigned long start = clock_.getTimeMicroseconds();
+	dispatch_contacts();
+    contact_time_ += clock_.getTimeMicroseconds() - start;
+    
+    update_stats();
+}
+
+void BulletPhysics::update_stats() {
+    // Publish the counters for this tick as options.  Times are in 
+    // milliseconds.
+    size_t active = 0;
+    size_t sleeping = 0;
+    world_->count_bodies(active, sleeping);
+    float broadphase = world_->broadphase_time() / 1000.0f;
+    float narrowphase = world_->narrowphase_time() / 1000.0f;
+    float solver = world_->solver_time() / 1000.0f;
+    float integration = world_->integration_time() / 1000.0f;
+    float contact = contact_time_ / 1000.0f;
+    engine_->option("stat_physics_broadphase_time", broadphase);
+    engine_->option("stat_physics_narrowphase_time", narrowphase);
+    engine_->option("stat_physics_solver_time", solver);
+    engine_->option("stat_physics_integration_time", integration);
+    engine_->option("stat_physics_contact_time", contact);
+    engine_->option("stat_physics_active_bodies", (float)active);
+    engine_->option("stat_physics_sleeping_bodies", (float)sleeping);
+    engine_->option("stat_physics_solver_groups", (float)solver_->groups());
+    engine_->option("stat_physics_manifolds", (float)manifold_count_);
+    engine_->option("stat_physics_contacts", (float)contact_count_);
+    
+    // If a trace file is set, also write one line per tick to the file, so
+    // that spikes can be matched up with the tick they happened on
+    string path = engine_->option<string>("physics_trace_file");
+    if (path != trace_path_) {
+        trace_.close();
+        trace_.clear();
+        trace_path_ = path;
+        if (!trace_path_.empty()) {
+            trace_.open(trace_path_.c_str());
+            if (!trace_.good()) {
+                throw runtime_error("Could not open physics trace file: " + trace_path_);
+            }
+            trace_ << "tick,broadphase_ms,narrowphase_ms,solver_ms,integration_ms,contact_ms,";
+            trace_ << "active_bodies,sleeping_bodies,solver_groups,manifolds,contacts" << endl;
+        }
+    }
+    if (trace_.is_open()) {
+        trace_ << engine_->tick_id() << ',' << broadphase << ',' << narrowphase << ',';
+        trace_ << solver << ',' << integration << ',' << contact << ',';
+        trace_ << active << ',' << sleeping << ',' << solver_->groups() << ',';
+        trace_ << manifold_count_ << ',' << contact_count_ << '\n';
+    }
+    
+    world_->reset_timers();
+    contact_time_ = 0;
 }
 
 void BulletPhysics::on_init() {
     std::cout << "Initializing physics system" << std::endl;
+    init_broadphase();
 }
 
-void BulletPhysics::on_post_tick(btDynamicsWorld* world, btScalar step) {
-    BulletPhysics* system = static_cast<BulletPhysics*>(world->getWorldUserInfo());
-
-    // Update all engine listeners
-    for (Iterator<EngineListenerPtr> i = system->engine_->listeners(); i; i++) {
-        (*i)->on_tick();
+void BulletPhysics::init_broadphase() {
+    // The world is created with a DBVT broadphase, because the options 
+    // file hasn't been loaded yet when the constructor runs.  The sweep 
+    // and prune broadphase needs to know how big the world is, and the
+    // grid broadphase needs the size of a cell.
+    string type = engine_->option<string>("physics_broadphase");
+    auto_ptr<btBroadphaseInterface> broadphase;
+    if ("dbvt" == type) {
+        return;
+    } else if ("sweep" == type) {
+        float size = engine_->option<float>("physics_world_size");
+        broadphase.reset(new bt32BitAxisSweep3(btVector3(-size, -size, -size), btVector3(size, size, size)));
+    } else if ("grid" == type) {
+        broadphase.reset(new BulletGridBroadphase(engine_->option<float>("physics_grid_cell_size")));
+    } else {
+        throw runtime_error("Invalid broadphase: " + type);
     }
-
-}
-
-void BulletPhysics::on_pre_tick(btDynamicsWorld* world, btScalar step) {
     
-    // Clear force, and apply gravity to all rigid bodies
-    btCollisionObjectArray objects = world->getCollisionObjectArray();
-    //world->clearForces();
-    for (int i = 0; i < objects.size(); i++) {
-         btRigidBody* rigid_body = btRigidBody::upcast(objects[i]);
-         if (rigid_body) {
-            rigid_body->applyGravity();
-         }
+    // Move any objects that were already added to the world over to the 
+    // new broadphase
+    btCollisionObjectArray& objects = world_->getCollisionObjectArray();
+    vector<btCollisionObject*> object;
+    vector<pair<short, short> > filter;
+    while (objects.size() > 0) {
+        btCollisionObject* obj = objects[objects.size() - 1];
+        btBroadphaseProxy* proxy = obj->getBroadphaseHandle();
+        object.push_back(obj);
+        filter.push_back(make_pair(proxy->m_collisionFilterGroup, proxy->m_collisionFilterMask));
+        world_->removeCollisionObject(obj);
+    }
+    world_->setBroadphase(broadphase.get());
+    broadphase_ = broadphase;
+    for (size_t i = object.size(); i > 0; i--) {
+        btRigidBody* body = btRigidBody::upcast(object[i - 1]);
+        if (body) {
+            world_->addRigidBody(body, filter[i - 1].first, filter[i - 1].second);
+        } else {
+            world_->addCollisionObject(object[i - 1], filter[i - 1].first, filter[i - 1].second);
+        }
     }
+}
 
+void BulletPhysics::on_post_tick(btDynamicsWorld* world, btScalar step) {
     BulletPhysics* system = static_cast<BulletPhysics*>(world->getWorldUserInfo());
-
-    // Update the active module
-    if (system->engine_->module()) {
-        system->engine_->module()->on_tick();
-    }
-    
-    // Update the nodes
-    static_cast<CoreNode*>(system->engine_->root())->tick();
     
-    // Check for collisions
-    int nmanifolds = world->getDispatcher()->getNumManifolds();
+    // Record contacts found during this step
+    unsigned long start = system->clock_.getTimeMicroseconds();
+    system->gather_contacts();
+    system->contact_time_ += system->clock_.getTimeMicroseconds() - start;
+}
+
+void BulletPhysics::gather_contacts() {
+    // Mark each pair of nodes that is touching.  A pair of compound shapes 
+    // can have several manifolds, and the pair can touch during several 
+    // substeps, but it is only recorded once.
+    int nmanifolds = dispatcher_->getNumManifolds();
+    manifold_count_ = nmanifolds;
+    contact_count_ = 0;
     for (int i = 0; i < nmanifolds; i++) {
-        btPersistentManifold* manifold = world->getDispatcher()->getManifoldByIndexInternal(i);
+        btPersistentManifold* manifold = dispatcher_->getManifoldByIndexInternal(i);
+        if (manifold->getNumContacts() <= 0) {
+            continue;
+        }
+        contact_count_ += manifold->getNumContacts();
         btCollisionObject const* a = static_cast<btCollisionObject const*>(manifold->getBody0());
         btCollisionObject const* b = static_cast<btCollisionObject const*>(manifold->getBody1());
-
-        BulletRigidBody* ca = static_cast<BulletRigidBody*>(a->getUserPointer());
-        BulletRigidBody* cb = static_cast<BulletRigidBody*>(b->getUserPointer());
+        CoreNode* na = static_cast<BulletRigidBody*>(a->getUserPointer())->parent();
+        CoreNode* nb = static_cast<BulletRigidBody*>(b->getUserPointer())->parent();
         
-        if (manifold->getNumContacts() > 0) {
+        btVector3 pa = manifold->getContactPoint(0).getPositionWorldOnA();
+        btVector3 pb = manifold->getContactPoint(0).getPositionWorldOnB();
+        if (nb->serial() < na->serial()) {
+            swap(na, nb);
+            swap(pa, pb);
+        }
         
-            btVector3 pa = manifold->getContactPoint(0).getPositionWorldOnA();
-            btVector3 pb = manifold->getContactPoint(0).getPositionWorldOnB();
+        Contact& contact = contact_[ContactKey(na->serial(), nb->serial())];
+        if (!contact.node_a) {
+            contact.node_a = na;
+            contact.node_b = nb;
+        }
+        contact.position_a = Vector(pa.x(), pa.y(), pa.z());
+        contact.position_b = Vector(pb.x(), pb.y(), pb.z());
+        contact.touching = true;
+    }
+}
+
+void BulletPhysics::dispatch_contacts() {
+    // Convert the contacts into events.  Pairs that stopped touching are
+    // removed.
+    contact_event_.clear();
+    for (map<ContactKey, Contact>::iterator i = contact_.begin(); i != contact_.end();) {
+        Contact& contact = i->second;
+        if (contact.touching) {
+            contact_event_.push_back(ContactEvent(contact, contact.started ? CS_PERSIST : CS_BEGIN));
+            contact.touching = false;
+            contact.started = true;
+            i++;
+        } else {
+            contact_event_.push_back(ContactEvent(contact, CS_END));
+            contact_.erase(i++);
+        }
+    }
     
-            ca->parent()->collision(cb->parent(), Vector(pa.x(), pa.y(), pa.z()));
-            cb->parent()->collision(ca->parent(), Vector(pb.x(), pb.y(), pb.z()));
+    // Send the events to the actors in one batch.  The callbacks may add
+    // or destroy nodes, so the event buffer holds its own references.  A
+    // node that was destroyed, during this batch or before it, gets no 
+    // more events; the other node still does.
+    for (size_t i = 0; i < contact_event_.size(); i++) {
+        ContactEvent& event = contact_event_[i];
+        CoreNode* a = event.node_a.get();
+        CoreNode* b = event.node_b.get();
+        if (CS_END == event.state) {
+            if (!a->destroyed()) {
+                a->separation(b);
+            }
+            if (!b->destroyed()) {
+                b->separation(a);
+            }
+        } else {
+            if (!a->destroyed()) {
+                a->collision(b, event.position_a);
+            }
+            if (!b->destroyed()) {
+                b->collision(a, event.position_b);
+            }
         }
     }
+    contact_event_.clear();
+}
 
-	system->engine_->tick_id_inc();
+void BulletPhysics::queue_flush(BulletRigidBody* body) {
+    flush_body_.push_back(body);
+}
+
+void BulletPhysics::cancel_flush(BulletRigidBody* body) {
+    flush_body_.erase(remove(flush_body_.begin(), flush_body_.end(), body), flush_body_.end());
+}
+
+void BulletPhysics::flush_rigid_bodies() {
+    // Index the vector rather than using iterators, in case a flush 
+    // queues another body
+    for (size_t i = 0; i < flush_body_.size(); i++) {
+        flush_body_[i]->flush();
+    }
+    flush_body_.clear();
+}
+
+void BulletPhysics::on_pre_tick(btDynamicsWorld* world, btScalar step) {
+    BulletPhysics* system = static_cast<BulletPhysics*>(world->getWorldUserInfo());
+    
+    // Apply the shape and mass changes made during this tick all at once,
+    // so that a body is only rebuilt once no matter how many times it 
+    // was changed
+    system->flush_rigid_bodies();
     
-    return;
+    // Apply gravity to all rigid bodies.  This is done after the flush, so
+    // that bodies that just became dynamic fall during this step.
+    btCollisionObjectArray& objects = world->getCollisionObjectArray();
+    for (int i = 0; i < objects.size(); i++) {
+         btRigidBody* rigid_body = btRigidBody::upcast(objects[i]);
+         if (rigid_body) {
+            rigid_body->applyGravity();
+         }
+    }
 }
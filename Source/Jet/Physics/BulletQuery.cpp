@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a 
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */  
+
+#include <Jet/Physics/BulletQuery.hpp>
+#include <Jet/Physics/BulletPhysics.hpp>
+#include <Jet/Core/CoreEngine.hpp>
+#include <Jet/Core/CoreWorkerPool.hpp>
+#include <BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h>
+#include <BulletCollision/NarrowPhaseCollision/btSubSimplexConvexCast.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkConvexCast.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h>
+#include <BulletCollision/NarrowPhaseCollision/btPointCollector.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+using namespace Jet;
+using namespace std;
+
+// Batches smaller than this always run on the calling thread
+#define QUERY_PARALLEL_MIN 32
+
+// Collects every body whose bounding box is hit by a ray or overlaps a box.
+class CandidateCallback : public btBroadphaseRayCallback {
+public:
+    CandidateCallback(const PhysicsQuery& query, vector<btCollisionObject*>& candidate) :
+        ignore_(query.ignore),
+        candidate_(candidate) {
+
+        // Set up the ray the same way btCollisionWorld does
+        btVector3 direction(query.to.x - query.from.x, query.to.y - query.from.y, query.to.z - query.from.z);
+        btScalar length = direction.length();
+        if (length > 0.0f) {
+            direction /= length;
+        }
+        m_rayDirectionInverse[0] = direction[0] == 0.0f ? BT_LARGE_FLOAT : 1.0f / direction[0];
+        m_rayDirectionInverse[1] = direction[1] == 0.0f ? BT_LARGE_FLOAT : 1.0f / direction[1];
+        m_rayDirectionInverse[2] = direction[2] == 0.0f ? BT_LARGE_FLOAT : 1.0f / direction[2];
+        m_signs[0] = m_rayDirectionInverse[0] < 0.0f;
+        m_signs[1] = m_rayDirectionInverse[1] < 0.0f;
+        m_signs[2] = m_rayDirectionInverse[2] < 0.0f;
+        m_lambda_max = length;
+    }
+
+    bool process(const btBroadphaseProxy* proxy) {
+        btCollisionObject* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+        BulletRigidBody* body = static_cast<BulletRigidBody*>(object->getUserPointer());
+        if (body && body->parent() != ignore_) {
+            candidate_.push_back(object);
+        }
+        return true;
+    }
+
+private:
+    Node* ignore_;
+    vector<btCollisionObject*>& candidate_;
+};
+
+BulletQuery::BulletQuery(CoreEngine* engine) :
+    engine_(engine),
+    query_(0) {
+
+    engine_->option("physics_parallel_queries", true);
+}
+
+void BulletQuery::query(btCollisionWorld* world, const std::vector<PhysicsQuery>& query, std::vector<PhysicsHit>& hit) {
+    // Find the candidates for all queries first.  The candidates for query
+    // i are in candidate_[first_[i]] to candidate_[first_[i+1]].
+    btBroadphaseInterface* broadphase = world->getBroadphase();
+    candidate_.clear();
+    first_.resize(query.size() + 1);
+    for (size_t i = 0; i < query.size(); i++) {
+        const PhysicsQuery& q = query[i];
+        btVector3 from(q.from.x, q.from.y, q.from.z);
+        btVector3 to(q.to.x, q.to.y, q.to.z);
+        btVector3 extent(q.radius, q.radius, q.radius);
+        CandidateCallback callback(q, candidate_);
+        
+        first_[i] = candidate_.size();
+        if (QT_OVERLAP == q.type) {
+            broadphase->aabbTest(from - extent, from + extent, callback);
+        } else if (QT_SWEEP == q.type) {
+            broadphase->rayTest(from, to, callback, -extent, extent);
+        } else {
+            broadphase->rayTest(from, to, callback);
+        }
+    }
+    first_[query.size()] = candidate_.size();
+
+    // Each query writes to its own list of results, so that overlap tests
+    // running in parallel can return any number of bodies
+    if (result_.size() < query.size()) {
+        result_.resize(query.size());
+    }
+    query_ = &query;
+    if (engine_->option<bool>("physics_parallel_queries") && query.size() >= QUERY_PARALLEL_MIN) {
+        CoreWorkerPool* pool = engine_->worker_pool();
+        size_t grain = max(query.size() / (4 * (pool->thread_count() + 1)), (size_t)8);
+        pool->parallel_for(query.size(), grain, boost::bind(&BulletQuery::test_queries, this, _1, _2));
+    } else {
+        test_queries(0, query.size());
+    }
+    query_ = 0;
+
+    hit.clear();
+    for (size_t i = 0; i < query.size(); i++) {
+        hit.insert(hit.end(), result_[i].begin(), result_[i].end());
+    }
+}
+
+static bool deeper(const PhysicsHit& a, const PhysicsHit& b) {
+    return a.fraction < b.fraction;
+}
+
+void BulletQuery::test_queries(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        const PhysicsQuery& query = (*query_)[i];
+        vector<PhysicsHit>& result = result_[i];
+        PhysicsHit closest;
+        closest.query = i;
+        result.clear();
+        for (size_t j = first_[i]; j < first_[i + 1]; j++) {
+            btCollisionObject* object = candidate_[j];
+            Node* node = static_cast<BulletRigidBody*>(object->getUserPointer())->parent();
+            if (QT_OVERLAP == query.type) {
+                // Keep the deepest point on each body that overlaps
+                PhysicsHit hit;
+                hit.query = i;
+                test(query, node, object->getCollisionShape(), object->getWorldTransform(), hit);
+                if (hit.hit) {
+                    result.push_back(hit);
+                }
+            } else {
+                test(query, node, object->getCollisionShape(), object->getWorldTransform(), closest);
+            }
+        }
+        if (result.empty()) {
+            result.push_back(closest);
+        } else {
+            sort(result.begin(), result.end(), deeper);
+        }
+    }
+}
+
+void BulletQuery::test(const PhysicsQuery& query, Node* node, const btCollisionShape* shape, const btTransform& transform, PhysicsHit& hit) {
+    // Test each child of a compound shape separately
+    if (shape->isCompound()) {
+        const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+        for (int i = 0; i < compound->getNumChildShapes(); i++) {
+            test(query, node, compound->getChildShape(i), transform * compound->getChildTransform(i), hit);
+        }
+        return;
+    }
+    if (!shape->isConvex()) {
+        return;
+    }
+
+    // Every result is converted to a fraction, where a smaller fraction
+    // is a closer hit.  Only keep the closest hit on this body.
+    const btConvexShape* convex = static_cast<const btConvexShape*>(shape);
+    btVector3 from(query.from.x, query.from.y, query.from.z);
+    btVector3 to(query.to.x, query.to.y, query.to.z);
+    btVoronoiSimplexSolver simplex_solver;
+    if (QT_OVERLAP == query.type) {
+        // For overlap tests, the fraction is the distance from the center
+        // of the sphere to the body, over the radius
+        btSphereShape sphere(query.radius);
+        btGjkEpaPenetrationDepthSolver depth_solver;
+        btGjkPairDetector detector(&sphere, convex, &simplex_solver, &depth_solver);
+        btGjkPairDetector::ClosestPointInput input;
+        input.m_transformA = btTransform(btQuaternion::getIdentity(), from);
+        input.m_transformB = transform;
+        btPointCollector result;
+        detector.getClosestPoints(input, result, 0);
+        if (!result.m_hasResult || result.m_distance >= 0.0f || query.radius <= 0.0f) {
+            return;
+        }
+        float fraction = max(0.0f, (query.radius + result.m_distance) / query.radius);
+        if (fraction < hit.fraction) {
+            const btVector3& position = result.m_pointInWorld;
+            const btVector3& normal = result.m_normalOnBInWorld;
+            hit.hit = true;
+            hit.node = node;
+            hit.fraction = fraction;
+            hit.position = Vector(position.x(), position.y(), position.z());
+            hit.normal = Vector(normal.x(), normal.y(), normal.z());
+        }
+    } else {
+        btTransform from_transform(btQuaternion::getIdentity(), from);
+        btTransform to_transform(btQuaternion::getIdentity(), to);
+        btConvexCast::CastResult result;
+        result.m_fraction = hit.fraction;
+        bool ok = false;
+        if (QT_SWEEP == query.type) {
+            btSphereShape sphere(query.radius);
+            btGjkConvexCast cast(&sphere, convex, &simplex_solver);
+            ok = cast.calcTimeOfImpact(from_transform, to_transform, transform, transform, result);
+        } else {
+            btSphereShape point(0.0f);
+            point.setMargin(0.0f);
+            btSubsimplexConvexCast cast(&point, convex, &simplex_solver);
+            ok = cast.calcTimeOfImpact(from_transform, to_transform, transform, transform, result);
+        }
+        if (!ok || result.m_normal.length2() <= 0.0001f || result.m_fraction >= hit.fraction) {
+            return;
+        }
+        
+        // The hit point for rays is along the ray; for sweeps, it is the 
+        // contact point on the surface of the body
+        result.m_normal.normalize();
+        btVector3 position = (QT_RAY == query.type) ? from.lerp(to, result.m_fraction) : result.m_hitPoint;
+        hit.hit = true;
+        hit.node = node;
+        hit.fraction = result.m_fraction;
+        hit.position = Vector(position.x(), position.y(), position.z());
+        hit.normal = Vector(result.m_normal.x(), result.m_normal.y(), result.m_normal.z());
+    }
+}
@@ -31,11 +31,16 @@
 using namespace Jet;
 using namespace std;
 
-BulletRigidBody::BulletRigidBody(CoreEngine* engine, CoreNode* parent) :
+BulletRigidBody::BulletRigidBody(CoreEngine* engine, BulletPhysics* physics, CoreNode* parent) :
     engine_(engine),
+    physics_(physics),
     parent_(parent),
     mass_(0.0f),
-	active_(false) {
+	active_(false),
+    ccd_auto_(true),
+    shape_dirty_(false),
+    mass_dirty_(false),
+    queued_(false) {
         
     shape_.reset(new btCompoundShape);
     
@@ -51,6 +56,11 @@ BulletRigidBody::BulletRigidBody(CoreEngine* engine, CoreNode* parent) :
 }
 
 BulletRigidBody::~BulletRigidBody() {
+    // Use the physics system this body was created by, because the engine
+    // may already be tearing down its subsystems
+    if (queued_) {
+        physics_->cancel_flush(this);
+    }
 	active(false);
 }
 
@@ -63,17 +73,20 @@ void BulletRigidBody::getWorldTransform(btTransform& transform) const {
 }
 
 void BulletRigidBody::setWorldTransform(const btTransform& transform) {
-    // This function is called by Physics to push updates from Physics.
-    // Therefore, we set the rotation and position of our parent node
-    // accordingly.
+    // Normally, BulletDynamicsWorld copies transforms for all bodies at 
+    // once after each step, and this function isn't called.  It is kept so
+    // that the body still works as a motion state for any other world.
     const btQuaternion& rotation = transform.getRotation();
     const btVector3& position = transform.getOrigin();
     
-    parent_->raw_rotation(Quaternion(rotation.w(), rotation.x(), rotation.y(), rotation.z()));
-    parent_->raw_position(Vector(position.x(), position.y(), position.z()));
+    parent_->raw_transform(
+        Vector(position.x(), position.y(), position.z()),
+        Quaternion(rotation.w(), rotation.x(), rotation.y(), rotation.z()));
 }
 
 void BulletRigidBody::update_collision_shapes() {
+    shape_dirty_ = false;
+
     // Clear old shapes out, then update the new compound shape
     // with the shapes of all sub-objects in the node tree
     while (shape_->getNumChildShapes() > 0) {
@@ -82,8 +95,34 @@ void BulletRigidBody::update_collision_shapes() {
     
     // Clear old shapes
     component_.clear();
+    mesh_.clear();
 
     attach_node(btTransform::getIdentity(), parent_);
+    update_ccd();
+}
+
+void BulletRigidBody::update_ccd() {
+    if (!ccd_auto_) {
+        return;
+    }
+
+    // Small bodies can move farther than their own size in one step, and
+    // pass right through thin objects.  Turn on CCD for them, so that 
+    // Bullet sweeps a sphere along the path when they move that far.
+    // The sphere has to fit inside the body, or the body will stop short 
+    // of objects that it isn't really touching.
+    btVector3 center;
+    btScalar radius = 0.0f;
+    if (shape_->getNumChildShapes() > 0) {
+        shape_->getBoundingSphere(center, radius);
+    }
+    if (radius > 0.0f && radius <= engine_->option<float>("physics_ccd_max_radius")) {
+        body_->setCcdSweptSphereRadius(0.5f * radius);
+        body_->setCcdMotionThreshold(radius);
+    } else {
+        body_->setCcdSweptSphereRadius(0.0f);
+        body_->setCcdMotionThreshold(0.0f);
+    }
 }
 
 void BulletRigidBody::attach_node(const btTransform& transform, CoreNode* node) {
@@ -126,6 +165,12 @@ void BulletRigidBody::attach_mesh_object(const btTransform& transform, CoreMeshO
         // This is for triangle mesh shapes
         BulletGeometry* geometry = static_cast<BulletGeometry*>(mesh->geometry());
         shape_->addChildShape(transform, geometry->shape());
+
+        // The compound shape only has a raw pointer to the geometry's
+        // shape, so hold on to the mesh (which owns the geometry) until the
+        // shape is rebuilt.  Otherwise, an anonymous mesh could be freed
+        // while the body still collides with it.
+        mesh_.push_back(mesh);
     }
 }
 
@@ -161,35 +206,89 @@ void BulletRigidBody::apply_local_torque(const Vector& v) {
 }
 
 void BulletRigidBody::mass(float mass) {
+    // Mass and inertia are updated with the next flush, so that setting
+    // the mass and changing the shape in the same tick (e.g., when an
+    // object fractures) only updates the body once
     mass_ = mass;
+    mass_dirty_ = true;
+    queue_flush();
+}
+
+void BulletRigidBody::inertia(const Vector& inertia) {
+    inertia_ = inertia;
+    mass_dirty_ = true;
+    queue_flush();
+}
+
+void BulletRigidBody::invalidate_shape() {
+    shape_dirty_ = true;
+    queue_flush();
+}
+
+void BulletRigidBody::queue_flush() {
+    if (!queued_) {
+        queued_ = true;
+        physics_->queue_flush(this);
+    }
+}
+
+void BulletRigidBody::flush() {
+    queued_ = false;
+    
+    // The inertia depends on the shape, so rebuilding the shape also 
+    // updates the mass properties
+    if (shape_dirty_) {
+        update_collision_shapes();
+        mass_dirty_ = true;
+    }
+    if (mass_dirty_) {
+        update_mass();
+    }
+}
+
+void BulletRigidBody::update_mass() {
+    mass_dirty_ = false;
+    bool was_static = body_->isStaticObject();
+    // Bullet estimates the inertia of a compound shape from its bounding
+    // box, so use the inertia that was given, if any
     btVector3 inertia(0.0f, 0.0f, 0.0f);
-    shape_->calculateLocalInertia(mass, inertia);
-    body_->setMassProps(mass, inertia);
+    if (inertia_.length2() > 0.0f) {
+        inertia = btVector3(inertia_.x, inertia_.y, inertia_.z) * mass_;
+    } else {
+        shape_->calculateLocalInertia(mass_, inertia);
+    }
+    body_->setMassProps(mass_, inertia);
     body_->updateInertiaTensor();
     body_->activate(true);
 
-	// If the body is active, remove and re-add it back into the world.
-	// Otherwise, Physics won't update the object's mass from zero to 
-	// a non-zero mass (this will cause the object to be static even
-	// though it has a positive mass).
-	if (active_) {
-        BulletPhysics* physics = static_cast<BulletPhysics*>(engine_->physics());
-		physics->world()->removeCollisionObject(body_.get());
-		physics->world()->addRigidBody(body_.get());
+	// If the body changed from static to dynamic (or back), remove and 
+	// re-add it back into the world.  Otherwise, Physics won't update the
+	// object's mass from zero to a non-zero mass (this will cause the 
+	// object to be static even though it has a positive mass).
+	if (active_ && was_static != body_->isStaticObject()) {
+		physics_->world()->removeCollisionObject(body_.get());
+		physics_->world()->addRigidBody(body_.get());
 	}
-    
-    update_collision_shapes();
 }
 
 
+void BulletRigidBody::ccd_sphere_radius(float radius) {
+    ccd_auto_ = false;
+    body_->setCcdSweptSphereRadius(radius);
+}
+
+void BulletRigidBody::ccd_motion_threshold(float threshold) {
+    ccd_auto_ = false;
+    body_->setCcdMotionThreshold(threshold);
+}
+
 void BulletRigidBody::active(bool active) {
 	if (active_ != active) {
 		active_ = active;
-        BulletPhysics* physics = static_cast<BulletPhysics*>(engine_->physics());
 		if (active_) {
-			physics->world()->addRigidBody(body_.get());
+			physics_->world()->addRigidBody(body_.get());
 		} else {
-			physics->world()->removeCollisionObject(body_.get());
+			physics_->world()->removeCollisionObject(body_.get());
 		}
 	}
 }
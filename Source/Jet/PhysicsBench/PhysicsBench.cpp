@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <Jet/Physics/BulletGridBroadphase.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace Jet;
+using namespace std;
+
+// Measures how long each broadphase takes to find the overlapping pairs in
+// a field of similarly sized bodies spread evenly through a cube, like an
+// asteroid field.  Every body drifts a little each frame, so the pairs 
+// change over time.  Only the AABB update and pair search are timed; the
+// narrowphase is the same for every broadphase.
+//
+// Usage: PhysicsBench [-bodies <n>] [-frames <n>] [-size <half width>] [-cell <cell size>]
+
+static float uniform(float min, float max) {
+	return min + (max - min) * rand() / (float)RAND_MAX;
+}
+
+static void run(const string& name, btBroadphaseInterface* broadphase, size_t bodies, size_t frames, float size) {
+	btDefaultCollisionConfiguration config;
+	btCollisionDispatcher dispatcher(&config);
+	btCollisionWorld world(&dispatcher, broadphase, &config);
+
+	// Use the same seed for each broadphase, so that they all see the same
+	// bodies moving the same way
+	srand(1);
+	btSphereShape shape[] = { btSphereShape(0.5f), btSphereShape(1.0f), btSphereShape(1.5f), btSphereShape(2.0f) };
+	vector<btCollisionObject*> object(bodies);
+	vector<btVector3> velocity(bodies);
+	for (size_t i = 0; i < bodies; i++) {
+		object[i] = new btCollisionObject;
+		object[i]->setCollisionShape(&shape[i % 4]);
+		object[i]->getWorldTransform().setOrigin(btVector3(uniform(-size, size), uniform(-size, size), uniform(-size, size)));
+		velocity[i] = btVector3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f));
+		world.addCollisionObject(object[i]);
+	}
+
+	btClock clock;
+	unsigned long elapsed = 0;
+	size_t pairs = 0;
+	for (size_t frame = 0; frame < frames; frame++) {
+		for (size_t i = 0; i < bodies; i++) {
+			btVector3& origin = object[i]->getWorldTransform().getOrigin();
+			origin += velocity[i];
+			for (int axis = 0; axis < 3; axis++) {
+				if (origin[axis] < -size || origin[axis] > size) {
+					velocity[i][axis] = -velocity[i][axis];
+				}
+			}
+		}
+
+		unsigned long start = clock.getTimeMicroseconds();
+		world.updateAabbs();
+		broadphase->calculateOverlappingPairs(&dispatcher);
+		elapsed += clock.getTimeMicroseconds() - start;
+		pairs += world.getPairCache()->getNumOverlappingPairs();
+	}
+	cout << name << ": " << elapsed / 1000.0f / frames << " ms/frame, ";
+	cout << (float)pairs / frames << " pairs/frame" << endl;
+
+	for (size_t i = 0; i < bodies; i++) {
+		world.removeCollisionObject(object[i]);
+		delete object[i];
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t bodies = 10000;
+	size_t frames = 100;
+	float size = 500.0f;
+	float cell = 8.0f;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			string arg = argv[i];
+			if ("-bodies" == arg && i + 1 < argc) {
+				bodies = boost::lexical_cast<size_t>(argv[++i]);
+			} else if ("-frames" == arg && i + 1 < argc) {
+				frames = boost::lexical_cast<size_t>(argv[++i]);
+			} else if ("-size" == arg && i + 1 < argc) {
+				size = boost::lexical_cast<float>(argv[++i]);
+			} else if ("-cell" == arg && i + 1 < argc) {
+				cell = boost::lexical_cast<float>(argv[++i]);
+			} else {
+				cerr << "Usage: PhysicsBench [-bodies <n>] [-frames <n>] [-size <half width>] [-cell <cell size>]" << endl;
+				return 1;
+			}
+		}
+		if (!frames) {
+			frames = 1;
+		}
+
+		cout << bodies << " bodies, " << frames << " frames, " << 2 * size << " units wide" << endl;
+		{
+			btDbvtBroadphase broadphase;
+			run("dbvt", &broadphase, bodies, frames, size);
+		}
+		{
+			// Leave some room, because bodies can drift a little past the
+			// edge before they turn around
+			btVector3 extent(size + 10.0f, size + 10.0f, size + 10.0f);
+			bt32BitAxisSweep3 broadphase(-extent, extent, (unsigned int)bodies + 1);
+			run("sweep", &broadphase, bodies, frames, size);
+		}
+		{
+			BulletGridBroadphase broadphase(cell);
+			run("grid", &broadphase, bodies, frames, size);
+		}
+		return 0;
+	} catch (std::exception& ex) {
+		cerr << ex.what() << endl;
+		return 1;
+	}
+}
@@ -29,6 +29,7 @@
 #include <Jet/Types.hpp>
 #include <Jet/Network.hpp>
 #include <Jet/Input.hpp>
+#include <Jet/Physics.hpp>
 #include <Jet/Interface/Overlay.hpp>
 #include <Jet/Types/Player.hpp>
 #include <Jet/Types/NetworkMatch.hpp>
@@ -40,6 +41,7 @@
 #include <Jet/Types/Box.hpp>
 #include <Jet/Types/Point.hpp>
 #include <Jet/Types/Matrix.hpp>
+#include <Jet/Types/PhysicsQuery.hpp>
 #include <Jet/Scene/MeshObject.hpp>
 #include <Jet/Scene/Node.hpp>
 #include <Jet/Scene/Actor.hpp>
@@ -309,6 +311,40 @@ int LuaScript::network_reliable_rpc(lua_State* env) {
 	return 0;
 }
 
+luabind::object LuaScript::physics_query(Physics* physics, const luabind::object& query) {
+	// Copy the queries out of the Lua array, run them all at once, and 
+	// return the results as another array in the same order.  Raycasts
+	// and sweeps return a single PhysicsHit; overlap tests return an
+	// array of hits, one for each body.
+	vector<PhysicsQuery> in;
+	for (luabind::iterator i(query), end; i != end; i++) {
+		in.push_back(luabind::object_cast<PhysicsQuery>(*i));
+	}
+
+	vector<PhysicsHit> out;
+	physics->query(in, out);
+
+	luabind::object result = luabind::newtable(query.interpreter());
+	luabind::object list;
+	size_t count = 0;
+	for (size_t i = 0; i < out.size(); i++) {
+		size_t index = out[i].query;
+		if (QT_OVERLAP != in[index].type) {
+			result[index+1] = out[i];
+			continue;
+		}
+		if (0 == i || out[i-1].query != index) {
+			list = luabind::newtable(query.interpreter());
+			result[index+1] = list;
+			count = 0;
+		}
+		if (out[i].hit) {
+			list[++count] = out[i];
+		}
+	}
+	return result;
+}
+
 void LuaScript::init_value_type_bindings() {
     // Load Lua bindings for basic value types exported by the engine.
     // These types are enough to perform the majority of operations needed.
@@ -448,7 +484,25 @@ void LuaScript::init_value_type_bindings() {
 		luabind::class_<NetworkMatch>("NetworkMatch")
 			.def(luabind::constructor<const string&>())
 			.def_readonly("name", &NetworkMatch::name)
-			.def_readonly("uuid", &NetworkMatch::uuid)
+			.def_readonly("uuid", &NetworkMatch::uuid),
+
+		luabind::class_<PhysicsQuery>("PhysicsQuery")
+			.def(luabind::constructor<>())
+			.def(luabind::constructor<QueryType, const Vector&, const Vector&, float>())
+			.def_readwrite("type", &PhysicsQuery::type)
+			.def_readwrite("from", &PhysicsQuery::from)
+			.def_readwrite("to", &PhysicsQuery::to)
+			.def_readwrite("radius", &PhysicsQuery::radius)
+			.def_readwrite("ignore", &PhysicsQuery::ignore)
+			.enum_("QueryType") [ luabind::value("QT_RAY", QT_RAY), luabind::value("QT_SWEEP", QT_SWEEP), luabind::value("QT_OVERLAP", QT_OVERLAP) ],
+
+		luabind::class_<PhysicsHit>("PhysicsHit")
+			.def_readonly("query", &PhysicsHit::query)
+			.def_readonly("hit", &PhysicsHit::hit)
+			.def_readonly("node", &PhysicsHit::node)
+			.def_readonly("position", &PhysicsHit::position)
+			.def_readonly("normal", &PhysicsHit::normal)
+			.def_readonly("fraction", &PhysicsHit::fraction)
 
     ];
 }
@@ -533,7 +587,9 @@ void LuaScript::init_entity_type_bindings() {
             .property("cast_shadows", (bool (FractureObject::*)() const)&FractureObject::cast_shadows, (void (FractureObject::*)(bool))&FractureObject::cast_shadows)
             .property("seal_fractures", (bool (FractureObject::*)() const)&FractureObject::seal_fractures, (void (FractureObject::*)(bool))&FractureObject::seal_fractures)
             .property("fracture_count", (size_t (FractureObject::*)() const)&FractureObject::fracture_count, (void (FractureObject::*)(size_t))&FractureObject::fracture_count)
-			.def("fracture", &FractureObject::fracture),
+            .property("shatter_count", (size_t (FractureObject::*)() const)&FractureObject::shatter_count, (void (FractureObject::*)(size_t))&FractureObject::shatter_count)
+			.def("fracture", &FractureObject::fracture)
+			.def("shatter", &FractureObject::shatter),
             
         luabind::class_<ParticleSystem, ParticleSystemPtr>("ParticleSystem")
             .property("parent", &ParticleSystem::parent)
@@ -569,7 +625,10 @@ void LuaScript::init_entity_type_bindings() {
             .def("apply_torque", &RigidBody::apply_torque)
             .def("apply_local_force", &RigidBody::apply_local_force)
             .def("apply_local_torque", &RigidBody::apply_local_torque)
-            .property("mass", (float (RigidBody::*)() const)&RigidBody::mass, (void (RigidBody::*)(float))&RigidBody::mass),
+            .property("mass", (float (RigidBody::*)() const)&RigidBody::mass, (void (RigidBody::*)(float))&RigidBody::mass)
+            .property("inertia", (Vector (RigidBody::*)() const)&RigidBody::inertia, (void (RigidBody::*)(const Vector&))&RigidBody::inertia)
+            .property("ccd_sphere_radius", (float (RigidBody::*)() const)&RigidBody::ccd_sphere_radius, (void (RigidBody::*)(float))&RigidBody::ccd_sphere_radius)
+            .property("ccd_motion_threshold", (float (RigidBody::*)() const)&RigidBody::ccd_motion_threshold, (void (RigidBody::*)(float))&RigidBody::ccd_motion_threshold),
             
         luabind::class_<Engine, EnginePtr>("Engine")
             .property("root", &Engine::root)
@@ -578,6 +637,7 @@ void LuaScript::init_entity_type_bindings() {
             .property("frame_delta", &Engine::frame_delta)           
 			.property("network", &Engine::network)
 			.property("input", &Engine::input)
+			.property("physics", &Engine::physics)
             .property("running", (bool (Engine::*)() const)&Engine::running, (void (Engine::*)(bool))&Engine::running)
 			.def("mesh", (Mesh* (Engine::*)(const std::string&))&Engine::mesh)
             .def("material", &Engine::material)
@@ -585,6 +645,9 @@ void LuaScript::init_entity_type_bindings() {
             .def("option", (const boost::any& (Engine::*)(const std::string&) const)&Engine::option)
             .def("search_folder", &Engine::search_folder),
 
+		luabind::class_<Physics, PhysicsPtr>("Physics")
+			.def("query", &LuaScript::physics_query),
+
 		luabind::class_<Input, InputPtr>("Input")
 			.def("key_down", &Input::key_down)
 			.def("mouse_down", &Input::mouse_down)
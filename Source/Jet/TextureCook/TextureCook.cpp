@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2010 Matt Fichman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <Jet/Core/CoreTextureCodec.hpp>
+#include <SDL/SDL_image.h>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+using namespace Jet;
+using namespace std;
+
+// Converts an image to a block-compressed DDS file with a full mip chain.
+// Each level is decoded again after encoding, and the PSNR is printed so
+// that the tool doubles as a headless check of the encoder.
+//
+// Usage: TextureCook [-bc1|-bc3|-bc5] [-psnr <min dB>] <image> <output.dds>
+//        TextureCook -test
+//
+// If no format is given, BC3 is used for images with transparent pixels
+// and BC1 for everything else.  If -psnr is given, the tool fails if any
+// level of at least 4x4 pixels (or the first level of a smaller image) is
+// below the threshold; smaller levels don't fill a block, and measure 
+// poorly whatever the encoder does.  With -test, every format is run on a
+// synthetic image, checked against a fixed PSNR, and written to a DDS 
+// file and read back; no input image is needed.
+
+// Size of the synthetic image used by the self-test
+#define TEST_IMAGE_SIZE 64
+
+// Minimum PSNR in dB for the top level of each format on the synthetic 
+// image
+#define TEST_PSNR_BC1 36.0f
+#define TEST_PSNR_BC3 36.0f
+#define TEST_PSNR_BC5 50.0f
+
+// Scratch file written by the self-test
+#define TEST_FILE "TextureCookTest.dds"
+
+static void load_image(const string& path, size_t& width, size_t& height, vector<uint8_t>& rgba) {
+	SDL_Surface* surface = IMG_Load(path.c_str());
+	if (!surface) {
+		throw runtime_error(IMG_GetError());
+	}
+	size_t bpp = surface->format->BytesPerPixel;
+	if (4 != bpp && 3 != bpp) {
+		SDL_FreeSurface(surface);
+		throw runtime_error("Invalid image format: " + path);
+	}
+
+	// Expand the image to RGBA
+	bool rgb = (0xff == surface->format->Rmask);
+	width = surface->w;
+	height = surface->h;
+	rgba.resize(4*width*height);
+	uint8_t* out = &rgba.front();
+	for (size_t y = 0; y < height; y++) {
+		const uint8_t* in = (const uint8_t*)surface->pixels + y*surface->pitch;
+		for (size_t x = 0; x < width; x++) {
+			out[0] = rgb ? in[0] : in[2];
+			out[1] = in[1];
+			out[2] = rgb ? in[2] : in[0];
+			out[3] = (4 == bpp) ? in[3] : 0xff;
+			out += 4;
+			in += bpp;
+		}
+	}
+	SDL_FreeSurface(surface);
+}
+
+// Encodes every level of an image down to 1x1, and compares each one 
+// against the decoded result.  The PSNR of each level is returned in psnr.
+// The image is replaced by its last mip level.
+static void encode_levels(TextureCodecFormat format, vector<uint8_t>& image, size_t width, size_t height, vector<vector<uint8_t> >& level, vector<float>& psnr) {
+	vector<uint8_t> decoded;
+	vector<uint8_t> next;
+	level.clear();
+	psnr.clear();
+	while (true) {
+		level.push_back(vector<uint8_t>(CoreTextureCodec::compressed_size(format, width, height)));
+		CoreTextureCodec::encode(format, &image.front(), width, height, &level.back().front());
+
+		decoded.resize(image.size());
+		CoreTextureCodec::decode(format, &level.back().front(), width, height, &decoded.front());
+		psnr.push_back(CoreTextureCodec::psnr(&image.front(), &decoded.front(), width, height, CoreTextureCodec::channels(format)));
+		cout << "Level " << level.size() - 1 << ": " << width << "x" << height << ", " << psnr.back() << " dB" << endl;
+
+		if (1 == width && 1 == height) {
+			break;
+		}
+		size_t next_width = max(width/2, (size_t)1);
+		size_t next_height = max(height/2, (size_t)1);
+		next.resize(4*next_width*next_height);
+		CoreTextureCodec::downsample(&image.front(), width, height, &next.front());
+		image.swap(next);
+		width = next_width;
+		height = next_height;
+	}
+}
+
+// Runs every format on a synthetic image: smooth gradients in each 
+// channel, with a soft-edged disc in the alpha channel.  The top level of
+// each format must meet its PSNR; the smaller levels squeeze the whole 
+// gradient into a few blocks, so they are only printed.  Every format must
+// come back unchanged from a DDS file, and a DDS file with a zero width 
+// must be rejected.
+static bool self_test() {
+	static const TextureCodecFormat format[] = { TCF_BC1, TCF_BC3, TCF_BC5 };
+	static const char* name[] = { "BC1", "BC3", "BC5" };
+	static const float min_psnr[] = { TEST_PSNR_BC1, TEST_PSNR_BC3, TEST_PSNR_BC5 };
+
+	size_t size = TEST_IMAGE_SIZE;
+	vector<uint8_t> source(4*size*size);
+	for (size_t y = 0; y < size; y++) {
+		for (size_t x = 0; x < size; x++) {
+			float dx = (float)x - size/2.0f;
+			float dy = (float)y - size/2.0f;
+			float alpha = 1.0f - (sqrtf(dx*dx + dy*dy) - size/4.0f)/(size/4.0f);
+			uint8_t* pixel = &source[4*(y*size + x)];
+			pixel[0] = (uint8_t)(255*x/(size-1));
+			pixel[1] = (uint8_t)(255*y/(size-1));
+			pixel[2] = (uint8_t)(255*(x+y)/(2*(size-1)));
+			pixel[3] = (uint8_t)(255*min(max(alpha, 0.0f), 1.0f));
+		}
+	}
+
+	bool passed = true;
+	for (size_t i = 0; i < sizeof(format)/sizeof(format[0]); i++) {
+		cout << name[i] << endl;
+		vector<uint8_t> image(source);
+		vector<vector<uint8_t> > level;
+		vector<float> psnr;
+		encode_levels(format[i], image, size, size, level, psnr);
+		if (psnr[0] < min_psnr[i]) {
+			cerr << name[i] << ": PSNR is below " << min_psnr[i] << " dB" << endl;
+			passed = false;
+		}
+
+		TextureCodecFormat read_format;
+		size_t read_width = 0, read_height = 0;
+		vector<vector<uint8_t> > read_level;
+		CoreTextureCodec::write_dds(TEST_FILE, format[i], size, size, level);
+		CoreTextureCodec::read_dds(TEST_FILE, read_format, read_width, read_height, read_level);
+		if (read_format != format[i] || read_width != size || read_height != size || read_level != level) {
+			cerr << name[i] << ": DDS file did not read back the same" << endl;
+			passed = false;
+		}
+	}
+
+	// Write a DDS file with a zero width
+	vector<vector<uint8_t> > empty(1);
+	CoreTextureCodec::write_dds(TEST_FILE, TCF_BC1, 0, 1, empty);
+	try {
+		TextureCodecFormat read_format;
+		size_t read_width = 0, read_height = 0;
+		vector<vector<uint8_t> > read_level;
+		CoreTextureCodec::read_dds(TEST_FILE, read_format, read_width, read_height, read_level);
+		cerr << "DDS file with a zero width was accepted" << endl;
+		passed = false;
+	} catch (std::exception&) {
+	}
+	remove(TEST_FILE);
+
+	cout << (passed ? "Passed" : "Failed") << endl;
+	return passed;
+}
+
+int main(int argc, char** argv) {
+	TextureCodecFormat format = TCF_BC1;
+	bool auto_format = true;
+	float min_psnr = 0.0f;
+	vector<string> files;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if ("-test" == arg) {
+			try {
+				return self_test() ? 0 : 1;
+			} catch (std::exception& ex) {
+				cerr << ex.what() << endl;
+				return 1;
+			}
+		} else if ("-bc1" == arg) {
+			format = TCF_BC1;
+			auto_format = false;
+		} else if ("-bc3" == arg) {
+			format = TCF_BC3;
+			auto_format = false;
+		} else if ("-bc5" == arg) {
+			format = TCF_BC5;
+			auto_format = false;
+		} else if ("-psnr" == arg && i + 1 < argc) {
+			min_psnr = boost::lexical_cast<float>(argv[++i]);
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (files.size() != 2) {
+		cerr << "Usage: TextureCook [-bc1|-bc3|-bc5] [-psnr <min dB>] <image> <output.dds>" << endl;
+		cerr << "       TextureCook -test" << endl;
+		return 1;
+	}
+
+	try {
+		size_t width = 0, height = 0;
+		vector<uint8_t> image;
+		load_image(files[0], width, height, image);
+
+		if (auto_format) {
+			for (size_t i = 0; i < width*height && TCF_BC1 == format; i++) {
+				if (image[4*i+3] != 0xff) {
+					format = TCF_BC3;
+				}
+			}
+		}
+
+		vector<vector<uint8_t> > level;
+		vector<float> psnr;
+		encode_levels(format, image, width, height, level, psnr);
+		CoreTextureCodec::write_dds(files[1], format, width, height, level);
+		size_t level_width = width;
+		size_t level_height = height;
+		for (size_t i = 0; i < psnr.size(); i++) {
+			bool checked = !i || (level_width >= 4 && level_height >= 4);
+			if (checked && psnr[i] < min_psnr) {
+				cerr << "Level " << i << ": PSNR is below " << min_psnr << " dB" << endl;
+				return 1;
+			}
+			level_width = max(level_width/2, (size_t)1);
+			level_height = max(level_height/2, (size_t)1);
+		}
+		return 0;
+	} catch (std::exception& ex) {
+		cerr << ex.what() << endl;
+		return 1;
+	}
+}
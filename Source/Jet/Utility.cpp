@@ -21,9 +21,24 @@
  */
 
 #include <Jet/Utility.hpp>
+#include <Jet/Resources/Mesh.hpp>
+#include <Jet/Types/Vertex.hpp>
 
 using namespace Jet;
 
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+// Mixes a block of bytes into a 64-bit FNV-1a hash.
+static uint64_t fnv_hash(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* byte = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= byte[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
 
 
 
@@ -93,6 +108,22 @@ uint32_t Jet::hash(const std::string& key) {
 	return murmur_hash2(key.c_str(), key.length(), 0);
 }
 
+uint64_t Jet::hash(const Mesh* mesh) {
+	uint64_t hash = FNV_OFFSET;
+	for (size_t g = 0; g < mesh->group_count(); g++) {
+		uint32_t count = mesh->index_count(g);
+		hash = fnv_hash(hash, &count, sizeof(count));
+		if (count) {
+			hash = fnv_hash(hash, mesh->index_data(g), count*sizeof(uint32_t));
+		}
+	}
+	const Vertex* vertex = mesh->vertex_data();
+	for (size_t i = 0; i < mesh->vertex_count(); i++) {
+		hash = fnv_hash(hash, &vertex[i].position, sizeof(vertex[i].position));
+	}
+	return hash;
+}
+
 /*
 static int seed_ = 3;
 static int x_ = 3;